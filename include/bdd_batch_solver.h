@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ILP_input.h"
+#include <vector>
+#include <memory>
+
+namespace LPMP {
+
+    // Solve many small independent ILPs at once: bdds of all instances are packed into one solver with disjoint variable ranges.
+    // Variables of an instance are shifted by the number of variables of all instances before it.
+    // Constraints are converted individually, constraint groups of the instances are not coalesced.
+    // Lower bounds are tracked per instance. Converged instances are removed from the message passing sweeps, their lower bounds are kept.
+    // Instances with a constraint that can never be satisfied are converged from the start with lower bound infinity.
+    class bdd_batch_solver {
+        public:
+            bdd_batch_solver(const std::vector<ILP_input>& instances);
+            bdd_batch_solver(bdd_batch_solver&&);
+            bdd_batch_solver& operator=(bdd_batch_solver&&);
+            ~bdd_batch_solver();
+
+            size_t nr_instances() const;
+            size_t nr_active_instances() const;
+            // first variable of instance in the packed solver
+            size_t variable_offset(const size_t instance) const;
+
+            // one parallel mma iteration on all active instances. An instance converges if its lower bound improves by at most tolerance*|lb_prev|.
+            void iteration(const double tolerance = 1e-9);
+            // iterate until all instances have converged or max_iter iterations or time_limit seconds have passed
+            void solve(const size_t max_iter = 1000, const double tolerance = 1e-9, const double time_limit = 3600);
+
+            double lower_bound(const size_t instance) const;
+            std::vector<double> lower_bounds() const;
+            bool converged(const size_t instance) const;
+            // number of iterations the instance took part in
+            size_t nr_iterations(const size_t instance) const;
+
+        private:
+            class impl;
+            std::unique_ptr<impl> pimpl;
+    };
+
+}
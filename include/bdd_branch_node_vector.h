@@ -11,6 +11,7 @@
 #include <filesystem>
 #include <unordered_set>
 #include <queue>
+#include <algorithm>
 #include "bdd_storage.h"
 #include "bdd_collection/bdd_collection.h"
 #include "two_dimensional_variable_array.hxx"
@@ -20,6 +21,9 @@
 #include "bdd_manager/bdd.h"
 #include "min_marginal_utils.h"
 #include <iostream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace LPMP {
 
@@ -49,6 +53,9 @@ namespace LPMP {
                 std::array<value_type,2> average_marginals(std::array<value_type,2>* marginals, const size_t nr_marginals);
 
                 void iteration();
+                // With more than one thread, forward and backward sweeps advance in wavefronts of variables, see compute_wavefronts.
+                // Variables within a wavefront are processed in parallel. Results are bit-identical to the sequential sweeps.
+                void set_nr_threads(const size_t nr_threads);
                 void backward_run();
                 void forward_run();
 
@@ -57,6 +64,7 @@ namespace LPMP {
                 void compute_lower_bound_after_backward_pass(); 
 
                 two_dim_variable_array<std::array<double,2>> min_marginals();
+                void min_marginal_agreement(std::vector<mm_agreement>& agreement, const double eps = 1e-6);
                 void solve(const size_t max_iter, const double tolerance, const double time_limit); 
                 double lower_bound() const { return lower_bound_; }
                 void update_cost(const double lo_cost, const double hi_cost, const size_t var);
@@ -76,6 +84,8 @@ namespace LPMP {
                     void update_arc_costs(const size_t first_node, ITERATOR begin, ITERATOR end);
                 void transfer_cost(const size_t from_bdd_nr, const size_t to_bdd_nr);
                 void get_arc_marginals(const size_t first_node, const size_t last_node, std::vector<double>& arc_marginals);
+                // arc marginals of root nodes after a backward pass, i.e. arc costs plus cost-to-go of children
+                void get_root_arc_marginals(const size_t first_node, const size_t last_node, std::vector<double>& arc_marginals);
 
                 std::array<size_t,2> bdd_branch_node_offset(const size_t var, const size_t bdd_index) const;
                 size_t variable(const size_t bdd_offset) const;
@@ -91,6 +101,7 @@ namespace LPMP {
                 // TODO: remove all group stuff
                 std::vector<size_t> bdd_branch_node_group_offsets_; // offsets into where bdd branch nodes belonging to a variable group start 
                 std::vector<size_t> nr_bdds_; // nr bdds per variable
+                size_t max_nr_bdds_ = 0; // max nr bdds over all variables
                 // TODO: use std::vector<std::array<size_t,2>> for range of first resp. last bdd nodes of each BDD. Also sort them for faster access time
                 two_dim_variable_array<size_t> first_bdd_node_indices_;  // used for computing lower bound
                 two_dim_variable_array<size_t> last_bdd_node_indices_;  // used for computing lower bound
@@ -108,6 +119,28 @@ namespace LPMP {
                 two_dim_variable_array<size_t> tighten_bdd_groups(const std::vector<char>& tighten_variables);
                 mutable std::vector<size_t> bdd_branch_instruction_variables_;
 
+                // wavefront parallelization of min-marginal averaging sweeps.
+                // A variable is in wavefront k if the longest chain of variables of consecutive bdd nodes leading to it has length k.
+                // Variables in the same wavefront share no bdd nodes and can be processed in parallel.
+                void compute_wavefronts();
+                void min_marginal_averaging_forward_wavefront();
+                void min_marginal_averaging_backward_wavefront();
+                size_t nr_threads_ = 1;
+                constexpr static size_t min_parallel_wavefront_nodes = 256;
+                two_dim_variable_array<size_t> forward_wavefronts_; // variables of each wavefront of forward sweep
+                two_dim_variable_array<size_t> backward_wavefronts_;
+                std::vector<char> forward_parallel_; // whether wavefront has enough nodes for parallel processing
+                std::vector<char> backward_parallel_;
+
+                // preallocated buffer for reduced min-marginals of one variable, one slot of max_nr_bdds_ entries per thread
+                std::vector<std::array<value_type,2>> min_marginal_scratch_;
+                void allocate_min_marginal_scratch();
+                std::array<value_type,2>* min_marginal_scratch(const size_t thread_nr);
+                // initialize min-marginals of all bdds of var to infinity and reduce min-marginals of its nodes into them
+                void compute_min_marginals(const size_t var, std::array<value_type,2>* min_marginals);
+                void min_marginal_averaging_step_forward(const size_t var, std::array<value_type,2>* min_marginals);
+                void min_marginal_averaging_step_backward(const size_t var, std::array<value_type,2>* min_marginals);
+
             public: // TODO: change to private again
                 template<typename LAMBDA>
                     void visit_nodes(const size_t bdd_nr, LAMBDA&& f);
@@ -122,6 +155,13 @@ namespace LPMP {
                 void add_bdds(BDD::bdd_collection& bdd_col);
                 template<typename BDD_NR_ITERATOR>
                     std::vector<size_t> add_bdds(BDD::bdd_collection& bdd_col, BDD_NR_ITERATOR bdd_nrs_begin, BDD_NR_ITERATOR bdd_nrs_end);
+                // add parts of bdds lying between the given first and last variable (inclusive).
+                // All nodes of the first variable become roots, arcs leaving nodes of the last variable lead to the 1-terminal unless they lead to the 0-terminal.
+                template<typename BDD_NR_ITERATOR, typename VAR_RANGE_ITERATOR>
+                    std::vector<size_t> add_bdd_slices(BDD::bdd_collection& bdd_col, BDD_NR_ITERATOR bdd_nrs_begin, BDD_NR_ITERATOR bdd_nrs_end, VAR_RANGE_ITERATOR var_range_begin);
+                // contiguous range of nodes of bdd at its first resp. last variable
+                std::array<size_t,2> first_bdd_node_range(const size_t bdd_nr) const;
+                std::array<size_t,2> last_bdd_node_range(const size_t bdd_nr) const;
 
                 std::vector<size_t> variables(const size_t bdd_idx);
                 std::vector<bdd_branch_instruction<float,uint32_t>> export_bdd(const size_t bdd_idx);
@@ -179,59 +219,93 @@ namespace LPMP {
     template<typename BDD_BRANCH_NODE>
     std::array<typename BDD_BRANCH_NODE::value_type,2> bdd_mma_base<BDD_BRANCH_NODE>::average_marginals(std::array<typename BDD_BRANCH_NODE::value_type,2>* marginals, const size_t nr_marginals)
     {
-        std::array<value_type,2> avg_margs = {0.0,0.0};
+        value_type sum_0 = 0.0;
+        value_type sum_1 = 0.0;
+#pragma omp simd reduction(+:sum_0,sum_1)
         for(size_t i=0; i<nr_marginals; ++i)
         {
             //assert(std::isfinite(marginals[i][0])); // need not hold true after fix_variable
             //assert(std::isfinite(marginals[i][1]));
-            avg_margs[0] += marginals[i][0];
-            avg_margs[1] += marginals[i][1];
+            sum_0 += marginals[i][0];
+            sum_1 += marginals[i][1];
         }
-        avg_margs[0] /= value_type(nr_marginals);
-        avg_margs[1] /= value_type(nr_marginals);
+        std::array<value_type,2> avg_margs = {sum_0 / value_type(nr_marginals), sum_1 / value_type(nr_marginals)};
         //assert(std::isfinite(avg_margs[0]));
         //assert(std::isfinite(avg_margs[1]));
         return avg_margs;
     } 
 
+    template<typename BDD_BRANCH_NODE>
+    void bdd_mma_base<BDD_BRANCH_NODE>::allocate_min_marginal_scratch()
+    {
+        max_nr_bdds_ = nr_bdds_.empty() ? 0 : *std::max_element(nr_bdds_.begin(), nr_bdds_.end());
+        min_marginal_scratch_.resize(nr_threads_ * max_nr_bdds_);
+    }
+
+    template<typename BDD_BRANCH_NODE>
+    std::array<typename BDD_BRANCH_NODE::value_type,2>* bdd_mma_base<BDD_BRANCH_NODE>::min_marginal_scratch(const size_t thread_nr)
+    {
+        assert(thread_nr < nr_threads_);
+        assert(min_marginal_scratch_.size() == nr_threads_ * max_nr_bdds_);
+        return min_marginal_scratch_.data() + thread_nr * max_nr_bdds_;
+    }
+
+    template<typename BDD_BRANCH_NODE>
+    void bdd_mma_base<BDD_BRANCH_NODE>::compute_min_marginals(const size_t var, std::array<value_type,2>* min_marginals)
+    {
+        assert(var < nr_variables());
+        assert(nr_bdds(var) <= max_nr_bdds_);
+        std::fill(min_marginals, min_marginals + nr_bdds(var), std::array<value_type,2>{std::numeric_limits<value_type>::infinity(), std::numeric_limits<value_type>::infinity()});
+        for(size_t i=bdd_branch_node_offsets_[var]; i<bdd_branch_node_offsets_[var+1]; ++i)
+            bdd_branch_nodes_[i].min_marginal(min_marginals);
+    }
+
     template<typename BDD_BRANCH_NODE>
     void bdd_mma_base<BDD_BRANCH_NODE>::min_marginal_averaging_step_forward(const size_t var)
+    {
+        min_marginal_averaging_step_forward(var, min_marginal_scratch(0));
+    }
+
+    template<typename BDD_BRANCH_NODE>
+    void bdd_mma_base<BDD_BRANCH_NODE>::min_marginal_averaging_step_forward(const size_t var, std::array<value_type,2>* min_marginals)
     {
         assert(var < nr_variables());
         const size_t _nr_bdds = nr_bdds(var);
         if(_nr_bdds == 0)
             return;
 
-        std::array<value_type,2> min_marginals[_nr_bdds];
-        std::fill(min_marginals, min_marginals + _nr_bdds, std::array<value_type,2>{std::numeric_limits<value_type>::infinity(), std::numeric_limits<value_type>::infinity()});
-
-        for(size_t i=bdd_branch_node_offsets_[var]; i<bdd_branch_node_offsets_[var+1]; ++i)
-            bdd_branch_nodes_[i].min_marginal(min_marginals);
-
-        std::array<value_type,2> avg_marginals = average_marginals(min_marginals, _nr_bdds);
+        compute_min_marginals(var, min_marginals);
+        const std::array<value_type,2> avg_marginals = average_marginals(min_marginals, _nr_bdds);
 
+        // setting marginals only touches the node itself, hence can be fused with resetting its children
         for(size_t i=bdd_branch_node_offsets_[var]; i<bdd_branch_node_offsets_[var+1]; ++i)
+        {
             bdd_branch_nodes_[i].set_marginal(min_marginals, avg_marginals);
+            bdd_branch_nodes_[i].prepare_forward_step();
+        }
 
-        forward_step(var);
+        for(size_t i=bdd_branch_node_offsets_[var]; i<bdd_branch_node_offsets_[var+1]; ++i)
+            bdd_branch_nodes_[i].forward_step();
     }
 
     template<typename BDD_BRANCH_NODE>
     void bdd_mma_base<BDD_BRANCH_NODE>::min_marginal_averaging_step_backward(const size_t var)
     {
-        // TODO: pad to four so that SIMD instructions can be applied?
+        min_marginal_averaging_step_backward(var, min_marginal_scratch(0));
+    }
+
+    template<typename BDD_BRANCH_NODE>
+    void bdd_mma_base<BDD_BRANCH_NODE>::min_marginal_averaging_step_backward(const size_t var, std::array<value_type,2>* min_marginals)
+    {
+        assert(var < nr_variables());
         const size_t _nr_bdds = nr_bdds(var);
         if(_nr_bdds == 0)
             return;
-        std::array<value_type,2> min_marginals[_nr_bdds];
-        std::fill(min_marginals, min_marginals + _nr_bdds, std::array<value_type,2>{std::numeric_limits<value_type>::infinity(), std::numeric_limits<value_type>::infinity()});
-
-        for(size_t i=bdd_branch_node_offsets_[var]; i<bdd_branch_node_offsets_[var+1]; ++i)
-            bdd_branch_nodes_[i].min_marginal(min_marginals);
 
-        std::array<value_type,2> avg_marginals = average_marginals(min_marginals, _nr_bdds);
+        compute_min_marginals(var, min_marginals);
+        const std::array<value_type,2> avg_marginals = average_marginals(min_marginals, _nr_bdds);
 
-        //std::cout << "backward step for var " << var << ", offset = " << bdd_branch_node_offsets_[var] << ", #nodes = " << bdd_branch_nodes_.size() << "\n";
+        //std::cout << "backward step for var " << var << ", offset = " << bdd_branch_node_offsets_[var] << ", #nodes = " << bdd_branch_node_offsets_.size() << "\n";
         for(size_t i=bdd_branch_node_offsets_[var]; i<bdd_branch_node_offsets_[var+1]; ++i)
         {
             bdd_branch_nodes_[i].set_marginal(min_marginals, avg_marginals);
@@ -250,8 +324,11 @@ namespace LPMP {
             for(size_t j=0; j<first_bdd_node_indices_.size(bdd_index); ++j)
                 bdd_branch_nodes_[first_bdd_node_indices_(bdd_index,j)].m = 0.0;
 
-        for(size_t i=0; i<nr_variables(); ++i)
-            min_marginal_averaging_step_forward(i);
+        if(nr_threads_ > 1)
+            min_marginal_averaging_forward_wavefront();
+        else
+            for(size_t i=0; i<nr_variables(); ++i)
+                min_marginal_averaging_step_forward(i);
         message_passing_state_ = message_passing_state::after_forward_pass;
     }
 
@@ -262,11 +339,125 @@ namespace LPMP {
             forward_run();
         message_passing_state_ = message_passing_state::none;
         //MEASURE_FUNCTION_EXECUTION_TIME;
-        for(std::ptrdiff_t i=nr_variables()-1; i>=0; --i)
-            min_marginal_averaging_step_backward(i);
+        if(nr_threads_ > 1)
+            min_marginal_averaging_backward_wavefront();
+        else
+            for(std::ptrdiff_t i=nr_variables()-1; i>=0; --i)
+                min_marginal_averaging_step_backward(i);
         message_passing_state_ = message_passing_state::after_backward_pass;
     }
 
+    template<typename BDD_BRANCH_NODE>
+    void bdd_mma_base<BDD_BRANCH_NODE>::set_nr_threads(const size_t nr_threads)
+    {
+        assert(nr_threads > 0);
+        nr_threads_ = nr_threads;
+        allocate_min_marginal_scratch();
+    }
+
+    template<typename BDD_BRANCH_NODE>
+    void bdd_mma_base<BDD_BRANCH_NODE>::compute_wavefronts()
+    {
+        MEASURE_FUNCTION_EXECUTION_TIME;
+        // a step for variable v reads and writes the nodes of v and their children.
+        // Hence variables of consecutive nodes in a bdd must be processed in order, all other pairs of steps are independent.
+        std::vector<size_t> forward_level(nr_variables(), 0);
+        std::vector<size_t> backward_level(nr_variables(), 0);
+        two_dim_variable_array<size_t> successors = [&]() {
+            std::vector<std::vector<size_t>> successors(nr_variables());
+            for(size_t v=0; v<nr_variables(); ++v)
+            {
+                for(size_t i=bdd_branch_node_offsets_[v]; i<bdd_branch_node_offsets_[v+1]; ++i)
+                {
+                    const auto& node = bdd_branch_nodes_[i];
+                    for(const auto offset : {node.offset_low, node.offset_high})
+                        if(offset != BDD_BRANCH_NODE::terminal_0_offset && offset != BDD_BRANCH_NODE::terminal_1_offset)
+                            successors[v].push_back(variable(i + offset));
+                }
+                std::sort(successors[v].begin(), successors[v].end());
+                successors[v].erase(std::unique(successors[v].begin(), successors[v].end()), successors[v].end());
+            }
+            return two_dim_variable_array<size_t>(successors);
+        }();
+
+        for(size_t v=0; v<nr_variables(); ++v)
+            for(const size_t w : successors[v])
+            {
+                assert(w > v);
+                forward_level[w] = std::max(forward_level[w], forward_level[v]+1);
+            }
+        for(std::ptrdiff_t v=nr_variables()-1; v>=0; --v)
+            for(const size_t w : successors[v])
+                backward_level[v] = std::max(backward_level[v], backward_level[w]+1);
+
+        auto group_by_level = [&](const std::vector<size_t>& level) {
+            const size_t nr_levels = level.empty() ? 0 : *std::max_element(level.begin(), level.end()) + 1;
+            std::vector<std::vector<size_t>> wavefronts(nr_levels);
+            for(size_t v=0; v<level.size(); ++v)
+                wavefronts[level[v]].push_back(v);
+            return two_dim_variable_array<size_t>(wavefronts);
+        };
+        forward_wavefronts_ = group_by_level(forward_level);
+        backward_wavefronts_ = group_by_level(backward_level);
+
+        // parallelize only wavefronts with enough work to amortize synchronization
+        auto parallel_wavefronts = [&](const two_dim_variable_array<size_t>& wavefronts) {
+            std::vector<char> parallel(wavefronts.size(), false);
+            for(size_t w=0; w<wavefronts.size(); ++w)
+            {
+                size_t nr_nodes = 0;
+                for(const size_t v : wavefronts[w])
+                    nr_nodes += nr_bdd_nodes(v);
+                parallel[w] = wavefronts.size(w) > 1 && nr_nodes >= min_parallel_wavefront_nodes;
+            }
+            return parallel;
+        };
+        forward_parallel_ = parallel_wavefronts(forward_wavefronts_);
+        backward_parallel_ = parallel_wavefronts(backward_wavefronts_);
+    }
+
+    template<typename BDD_BRANCH_NODE>
+    void bdd_mma_base<BDD_BRANCH_NODE>::min_marginal_averaging_forward_wavefront()
+    {
+        if(forward_parallel_.size() != forward_wavefronts_.size() || forward_wavefronts_.size() == 0)
+            compute_wavefronts();
+
+        for(size_t w=0; w<forward_wavefronts_.size(); ++w)
+        {
+#pragma omp parallel for schedule(dynamic, 4) num_threads(nr_threads_) if(forward_parallel_[w])
+            for(size_t j=0; j<forward_wavefronts_.size(w); ++j)
+            {
+#ifdef _OPENMP
+                const size_t thread_nr = omp_get_thread_num();
+#else
+                const size_t thread_nr = 0;
+#endif
+                min_marginal_averaging_step_forward(forward_wavefronts_(w,j), min_marginal_scratch(thread_nr));
+            }
+        }
+    }
+
+    template<typename BDD_BRANCH_NODE>
+    void bdd_mma_base<BDD_BRANCH_NODE>::min_marginal_averaging_backward_wavefront()
+    {
+        if(backward_parallel_.size() != backward_wavefronts_.size() || backward_wavefronts_.size() == 0)
+            compute_wavefronts();
+
+        for(size_t w=0; w<backward_wavefronts_.size(); ++w)
+        {
+#pragma omp parallel for schedule(dynamic, 4) num_threads(nr_threads_) if(backward_parallel_[w])
+            for(size_t j=0; j<backward_wavefronts_.size(w); ++j)
+            {
+#ifdef _OPENMP
+                const size_t thread_nr = omp_get_thread_num();
+#else
+                const size_t thread_nr = 0;
+#endif
+                min_marginal_averaging_step_backward(backward_wavefronts_(w,j), min_marginal_scratch(thread_nr));
+            }
+        }
+    }
+
     template<typename BDD_BRANCH_NODE>
     void bdd_mma_base<BDD_BRANCH_NODE>::iteration()
     {
@@ -408,6 +599,26 @@ namespace LPMP {
                     bdd_branch_nodes_[l].high_cost += *it; 
                 ++it;
             }
+
+            // keep messages consistent with changed costs
+            if(message_passing_state_ == message_passing_state::after_backward_pass)
+            {
+                for(std::ptrdiff_t i=l-1; i>=std::ptrdiff_t(first_node); --i)
+                    bdd_branch_nodes_[i].backward_step();
+            }
+            else if(message_passing_state_ == message_passing_state::after_forward_pass)
+            {
+                for(size_t i=first_node; i<l; ++i)
+                {
+                    const auto& node = bdd_branch_nodes_[i];
+                    auto is_terminal = [](const auto offset) { return offset == BDD_BRANCH_NODE::terminal_0_offset || offset == BDD_BRANCH_NODE::terminal_1_offset; };
+                    if(!is_terminal(node.offset_low) || !is_terminal(node.offset_high))
+                    {
+                        message_passing_state_ = message_passing_state::none;
+                        break;
+                    }
+                }
+            }
         }
 
     template<typename BDD_BRANCH_NODE>
@@ -450,29 +661,23 @@ namespace LPMP {
     template<typename BDD_BRANCH_NODE>
     std::vector<typename BDD_BRANCH_NODE::value_type> bdd_mma_base<BDD_BRANCH_NODE>::get_costs(const size_t bdd_nr)
     {
-        std::vector<value_type> costs;
-
-        size_t cur_var = std::numeric_limits<size_t>::max();
-        value_type hi_cost = std::numeric_limits<value_type>::infinity();
-        value_type lo_cost = std::numeric_limits<value_type>::infinity();
+        // nodes are not visited in variable order for non-quasi-reduced bdds, hence accumulate per variable.
+        // Costs may be infinite after tightening or fixing variables.
+        const auto vars = variables(bdd_nr);
+        std::vector<value_type> hi_costs(vars.size(), std::numeric_limits<value_type>::infinity());
+        std::vector<value_type> lo_costs(vars.size(), std::numeric_limits<value_type>::infinity());
         visit_nodes(bdd_nr, [&](const size_t i) {
                 const BDD_BRANCH_NODE& bdd = bdd_branch_nodes_[i];
-                if(cur_var != this->variable(i) && cur_var != std::numeric_limits<size_t>::max())
-                {
-                costs.push_back(hi_cost - lo_cost); 
-                hi_cost = std::numeric_limits<value_type>::infinity();
-                lo_cost = std::numeric_limits<value_type>::infinity();
-                }
-                hi_cost = std::min(hi_cost, bdd.high_cost);
-                lo_cost = std::min(lo_cost, bdd.low_cost);
-                cur_var = this->variable(i); 
+                const auto var_it = std::lower_bound(vars.begin(), vars.end(), this->variable(i));
+                assert(var_it != vars.end() && *var_it == this->variable(i));
+                const size_t idx = std::distance(vars.begin(), var_it);
+                hi_costs[idx] = std::min(hi_costs[idx], bdd.high_cost);
+                lo_costs[idx] = std::min(lo_costs[idx], bdd.low_cost);
                 });
-        costs.push_back(hi_cost - lo_cost);
-
-        for(const value_type x : costs)
-            assert(std::isfinite(x));
-        assert(costs.size() == variables(bdd_nr).size());
 
+        std::vector<value_type> costs(vars.size());
+        for(size_t idx=0; idx<vars.size(); ++idx)
+            costs[idx] = hi_costs[idx] - lo_costs[idx];
         return costs; 
     }
 
@@ -488,19 +693,13 @@ namespace LPMP {
             lower_bound_ = -std::numeric_limits<double>::infinity();
             message_passing_state_ = message_passing_state::none;
 
-            auto cost_it = cost_begin;
-            auto var_it = variable_begin;
-
+            // nodes are not visited in variable order for non-quasi-reduced bdds, hence search variable for each node
             visit_nodes(bdd_nr, [&](const size_t i) {
-                    if(variable(i) < *var_it)
+                    const auto var_it = std::lower_bound(variable_begin, variable_end, variable(i));
+                    if(var_it == variable_end || *var_it != variable(i))
                     return;
-                    if(variable(i) > *var_it && var_it < variable_end)
-                    {
-                    ++var_it;
-                    ++cost_it; 
-                    }
+                    const auto cost_it = cost_begin + std::distance(variable_begin, var_it);
                     assert(std::isfinite(*cost_it));
-                    if(*var_it == variable(i))
                     bdd_branch_nodes_[i].high_cost += *cost_it;
                     });
         }
@@ -529,6 +728,26 @@ namespace LPMP {
         } 
     }
 
+    template<typename BDD_BRANCH_NODE>
+    void bdd_mma_base<BDD_BRANCH_NODE>::get_root_arc_marginals(const size_t first_node, const size_t last_node, std::vector<double>& arc_marginals)
+    {
+        assert(message_passing_state_ == message_passing_state::after_backward_pass);
+        arc_marginals.clear();
+        assert(first_node < bdd_branch_nodes_.size());
+        for(size_t l=first_node; l<last_node; ++l)
+        {
+            const auto& node = bdd_branch_nodes_[l];
+            assert(bdd_branch_nodes_[first_node].bdd_index == node.bdd_index);
+            auto arc_marginal = [&](const auto offset, const value_type cost) -> double {
+                if(offset == BDD_BRANCH_NODE::terminal_0_offset || offset == BDD_BRANCH_NODE::terminal_1_offset)
+                    return cost;
+                return cost + node.address(offset)->m;
+            };
+            arc_marginals.push_back(arc_marginal(node.offset_low, node.low_cost));
+            arc_marginals.push_back(arc_marginal(node.offset_high, node.high_cost));
+        } 
+    }
+
     template<typename BDD_BRANCH_NODE>
     std::array<size_t,2> bdd_mma_base<BDD_BRANCH_NODE>::bdd_branch_node_offset(const size_t var, const size_t bdd_index) const
     {
@@ -575,16 +794,15 @@ namespace LPMP {
                 bdd_branch_nodes_[first_bdd_node_indices_(bdd_index,j)].m = 0.0;
 
         two_dim_variable_array<std::array<double,2>> mms;
+        std::array<value_type,2>* min_marginals = min_marginal_scratch(0);
+        std::vector<std::array<double,2>> min_marginals_double;
 
         for(size_t var=0; var<this->nr_variables(); ++var)
         {
             const size_t _nr_bdds = nr_bdds(var);
-            std::array<value_type,2> min_marginals[_nr_bdds];
-            std::fill(min_marginals, min_marginals + _nr_bdds, std::array<value_type,2>{std::numeric_limits<value_type>::infinity(), std::numeric_limits<value_type>::infinity()});
-            for(size_t i=bdd_branch_node_offsets_[var]; i<bdd_branch_node_offsets_[var+1]; ++i)
-                bdd_branch_nodes_[i].min_marginal(min_marginals);
+            compute_min_marginals(var, min_marginals);
 
-            std::array<double,2> min_marginals_double[_nr_bdds];
+            min_marginals_double.resize(_nr_bdds);
             for(size_t i=0; i<_nr_bdds; ++i)
             {
                 //assert(std::isfinite(min_marginals[i][0]));
@@ -594,13 +812,43 @@ namespace LPMP {
             }
             this->forward_step(var);
 
-            mms.push_back(min_marginals_double, min_marginals_double + _nr_bdds); 
+            mms.push_back(min_marginals_double.begin(), min_marginals_double.end()); 
         }
 
         message_passing_state_ = message_passing_state::after_forward_pass;
         return mms;
     }
 
+    template<typename BDD_BRANCH_NODE>
+    void bdd_mma_base<BDD_BRANCH_NODE>::min_marginal_agreement(std::vector<mm_agreement>& agreement, const double eps)
+    {
+        if(message_passing_state_ != message_passing_state::after_backward_pass)
+            this->backward_run();
+        message_passing_state_ = message_passing_state::none;
+        // prepare forward run
+        for(size_t bdd_index=0; bdd_index<first_bdd_node_indices_.size(); ++bdd_index)
+            for(size_t j=0; j<first_bdd_node_indices_.size(bdd_index); ++j)
+                bdd_branch_nodes_[first_bdd_node_indices_(bdd_index,j)].m = 0.0;
+
+        agreement.resize(this->nr_variables());
+        std::array<value_type,2>* min_marginals = min_marginal_scratch(0);
+
+        for(size_t var=0; var<this->nr_variables(); ++var)
+        {
+            const size_t _nr_bdds = nr_bdds(var);
+            compute_min_marginals(var, min_marginals);
+
+            agreement[var] = mm_agreement{};
+            for(size_t i=0; i<_nr_bdds; ++i)
+                agreement[var].add(double(min_marginals[i][1]) - double(min_marginals[i][0]));
+            agreement[var].compute_type(eps);
+
+            this->forward_step(var);
+        }
+
+        message_passing_state_ = message_passing_state::after_forward_pass;
+    }
+
     template<typename BDD_BRANCH_NODE>
     std::vector<size_t> bdd_mma_base<BDD_BRANCH_NODE>::compute_bdd_branch_instruction_variables() const
     {
@@ -1174,6 +1422,24 @@ namespace LPMP {
         return {bdd_map.find(first_bdd_node_indices_(bdd_idx,0))->second, variable_vec};
     }
 
+    template<typename BDD_BRANCH_NODE>
+    std::array<size_t,2> bdd_mma_base<BDD_BRANCH_NODE>::first_bdd_node_range(const size_t bdd_nr) const
+    {
+        assert(bdd_nr < nr_bdds());
+        const auto [min_it, max_it] = std::minmax_element(first_bdd_node_indices_[bdd_nr].begin(), first_bdd_node_indices_[bdd_nr].end());
+        assert(*max_it + 1 - *min_it == first_bdd_node_indices_.size(bdd_nr));
+        return {*min_it, *max_it + 1};
+    }
+
+    template<typename BDD_BRANCH_NODE>
+    std::array<size_t,2> bdd_mma_base<BDD_BRANCH_NODE>::last_bdd_node_range(const size_t bdd_nr) const
+    {
+        assert(bdd_nr < nr_bdds());
+        const auto [min_it, max_it] = std::minmax_element(last_bdd_node_indices_[bdd_nr].begin(), last_bdd_node_indices_[bdd_nr].end());
+        assert(*max_it + 1 - *min_it == last_bdd_node_indices_.size(bdd_nr));
+        return {*min_it, *max_it + 1};
+    }
+
     template<typename BDD_BRANCH_NODE>
     void bdd_mma_base<BDD_BRANCH_NODE>::add_bdds(BDD::bdd_collection& bdd_col)
     {
@@ -1185,6 +1451,17 @@ namespace LPMP {
     template<typename BDD_BRANCH_NODE>
         template<typename BDD_NR_ITERATOR>
         std::vector<size_t> bdd_mma_base<BDD_BRANCH_NODE>::add_bdds(BDD::bdd_collection& bdd_col, BDD_NR_ITERATOR bdd_nrs_begin, BDD_NR_ITERATOR bdd_nrs_end)
+        {
+            std::vector<std::array<size_t,2>> var_ranges;
+            var_ranges.reserve(std::distance(bdd_nrs_begin, bdd_nrs_end));
+            for(auto bdd_nr_it=bdd_nrs_begin; bdd_nr_it!=bdd_nrs_end; ++bdd_nr_it)
+                var_ranges.push_back(bdd_col.min_max_variables(*bdd_nr_it));
+            return add_bdd_slices(bdd_col, bdd_nrs_begin, bdd_nrs_end, var_ranges.begin());
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        template<typename BDD_NR_ITERATOR, typename VAR_RANGE_ITERATOR>
+        std::vector<size_t> bdd_mma_base<BDD_BRANCH_NODE>::add_bdd_slices(BDD::bdd_collection& bdd_col, BDD_NR_ITERATOR bdd_nrs_begin, BDD_NR_ITERATOR bdd_nrs_end, VAR_RANGE_ITERATOR var_range_begin)
         {
             message_passing_state_ = message_passing_state::none;
 
@@ -1199,17 +1476,21 @@ namespace LPMP {
 
             const size_t bdd_col_max_var = [&]() {
                 size_t max_var = 0;
-                for(auto bdd_nr_it=bdd_nrs_begin; bdd_nr_it!=bdd_nrs_end; ++bdd_nr_it)
-                    max_var = std::max(max_var, bdd_col.min_max_variables(*bdd_nr_it)[1]);
+                auto var_range_it = var_range_begin;
+                for(auto bdd_nr_it=bdd_nrs_begin; bdd_nr_it!=bdd_nrs_end; ++bdd_nr_it, ++var_range_it)
+                    max_var = std::max(max_var, (*var_range_it)[1]);
                 return max_var; 
             }();
             const size_t new_nr_variables = std::max(nr_variables(), bdd_col_max_var+1);
             // count bdd branch nodes per variable
             std::vector<size_t> new_bdd_branch_nodes_per_var(new_nr_variables, 0);
-            for(auto bdd_nr_it=bdd_nrs_begin; bdd_nr_it!=bdd_nrs_end; ++bdd_nr_it)
-                for(auto bdd_it=bdd_col.begin(*bdd_nr_it); bdd_it!=bdd_col.end(*bdd_nr_it); ++bdd_it)
-                    if(!bdd_it->is_terminal())
-                        ++new_bdd_branch_nodes_per_var[bdd_it->index];
+            {
+                auto var_range_it = var_range_begin;
+                for(auto bdd_nr_it=bdd_nrs_begin; bdd_nr_it!=bdd_nrs_end; ++bdd_nr_it, ++var_range_it)
+                    for(auto bdd_it=bdd_col.begin(*bdd_nr_it); bdd_it!=bdd_col.end(*bdd_nr_it); ++bdd_it)
+                        if(!bdd_it->is_terminal() && (*var_range_it)[0] <= bdd_it->index && bdd_it->index <= (*var_range_it)[1])
+                            ++new_bdd_branch_nodes_per_var[bdd_it->index];
+            }
             for(size_t v=0; v<nr_variables(); ++v)
                 new_bdd_branch_nodes_per_var[v] += nr_bdd_nodes(v);
 
@@ -1226,8 +1507,6 @@ namespace LPMP {
             // fill in previous bdd nodes
             for(size_t bdd_idx=0; bdd_idx<nr_bdds(); ++bdd_idx)
             {
-                assert(bdd_col.is_qbdd(bdd_idx));
-                assert(bdd_col.is_reordered(bdd_idx));
                 // TODO: put in front of loop and clear before use
                 std::deque<size_t> dq;
                 for(size_t j=0; j<first_bdd_node_indices_.size(bdd_idx); ++j)
@@ -1300,7 +1579,8 @@ namespace LPMP {
             // fill in bdds from bdd_collection
             std::unordered_map<size_t,BDD_BRANCH_NODE*> stored_bdd_index_to_bdd_offset;
             std::vector<size_t> new_bdd_nrs;
-            for(auto bdd_nr_it=bdd_nrs_begin; bdd_nr_it!=bdd_nrs_end; ++bdd_nr_it)
+            auto var_range_it = var_range_begin;
+            for(auto bdd_nr_it=bdd_nrs_begin; bdd_nr_it!=bdd_nrs_end; ++bdd_nr_it, ++var_range_it)
             {
                 const size_t bdd_nr = *bdd_nr_it;
                 assert(bdd_col.is_reordered(bdd_nr));
@@ -1308,13 +1588,16 @@ namespace LPMP {
                 new_bdd_nrs.push_back(std::distance(bdd_nrs_begin,bdd_nr_it) + nr_bdds());
                 cur_first_bdd_node_indices.clear();
                 cur_last_bdd_node_indices.clear();
-                const auto [first_var, last_var] = bdd_col.min_max_variables(bdd_nr);
+                const auto [first_var, last_var] = *var_range_it;
+                assert(first_var <= last_var);
 
                 for(auto bdd_it=bdd_col.rbegin(*bdd_nr_it); bdd_it!=bdd_col.rend(*bdd_nr_it); ++bdd_it)
                 {
                     const auto stored_bdd = *bdd_it;
                     assert(!stored_bdd.is_terminal());
                     const size_t v = stored_bdd.index;
+                    if(v < first_var || v > last_var)
+                        continue;
                     const size_t bdd_branch_index = new_bdd_branch_node_offsets_[v] + new_bdd_branch_nodes_counter[v];
                     ++new_bdd_branch_nodes_counter[v];
                     assert(bdd_branch_index < new_bdd_branch_nodes_.size());
@@ -1332,7 +1615,7 @@ namespace LPMP {
                         new_bdd_branch_nodes_[bdd_branch_index].offset_low = BDD_BRANCH_NODE::terminal_0_offset;
                         new_bdd_branch_nodes_[bdd_branch_index].low_cost = std::numeric_limits<value_type>::infinity();
                     }
-                    else if(bdd_col(bdd_nr,stored_bdd.lo).is_topsink())
+                    else if(bdd_col(bdd_nr,stored_bdd.lo).is_topsink() || v == last_var)
                     {
                         assert(new_bdd_branch_nodes_[bdd_branch_index].low_cost == 0.0);
                         new_bdd_branch_nodes_[bdd_branch_index].offset_low = BDD_BRANCH_NODE::terminal_1_offset;
@@ -1350,7 +1633,7 @@ namespace LPMP {
                         new_bdd_branch_nodes_[bdd_branch_index].offset_high = BDD_BRANCH_NODE::terminal_0_offset;
                         new_bdd_branch_nodes_[bdd_branch_index].high_cost = std::numeric_limits<value_type>::infinity();
                     }
-                    else if(bdd_col(bdd_nr,stored_bdd.hi).is_topsink())
+                    else if(bdd_col(bdd_nr,stored_bdd.hi).is_topsink() || v == last_var)
                     {
                         assert(new_bdd_branch_nodes_[bdd_branch_index].high_cost == 0.0);
                         new_bdd_branch_nodes_[bdd_branch_index].offset_high = BDD_BRANCH_NODE::terminal_1_offset;
@@ -1401,10 +1684,13 @@ namespace LPMP {
             }
 
             bdd_branch_instruction_variables_.clear(); // to force recomputation for variable of bdd node
+            forward_parallel_.clear(); // to force recomputation of wavefronts
+            backward_parallel_.clear();
             // swap new and old data structures
             std::swap(new_bdd_branch_nodes_, bdd_branch_nodes_);
             std::swap(new_bdd_branch_node_offsets_, bdd_branch_node_offsets_);
             std::swap(new_nr_bdds_, nr_bdds_);
+            allocate_min_marginal_scratch();
             std::swap(new_first_bdd_node_indices_, first_bdd_node_indices_);
             std::swap(new_last_bdd_node_indices_, last_bdd_node_indices_);
             message_passing_state_ = message_passing_state::none;
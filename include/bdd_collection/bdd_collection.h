@@ -3,6 +3,9 @@
 #include "bdd_manager/bdd_mgr.h"
 #include <vector>
 #include <iterator>
+#include <algorithm>
+#include <limits>
+#include <cassert>
 #include <unordered_map> // TODO: replace with faster hash map
 #include <iterator>
 #include <iostream> // TODO: remove
@@ -120,7 +123,9 @@ namespace BDD {
         friend class bdd_collection_node;
         friend class bdd_collection_entry;
         public:
-            // synthesize bdd unless it has too many nodes. If so, return std::numeric_limits<size_t>::max()
+            // synthesize bdd unless it has more than node_limit nodes. If so, abort as soon as the limit is exceeded and return std::numeric_limits<size_t>::max()
+            size_t bdd_and(const size_t i, const size_t j, bdd_collection& o, const size_t node_limit);
+            size_t bdd_and(const size_t i, const size_t j, const size_t node_limit);
             size_t bdd_and(const size_t i, const size_t j, bdd_collection& o);
             size_t bdd_and(const size_t i, const size_t j);
             size_t bdd_and(const int i, const int j, bdd_collection& o);
@@ -136,9 +141,26 @@ namespace BDD {
             template<typename VAR_MAP>
                 size_t bdd_or_var(const size_t i, const VAR_MAP& positive_variables, const VAR_MAP& negative_variables);
 
-            // compute how many solutions there are after forcing some variables to be true or false
+            // compute how many solutions there are after forcing some variables to be true or false. Throws if the count does not fit into size_t.
             template<typename VAR_MAP>
-                size_t bdd_nr_solutions(const size_t bdd_nr, const VAR_MAP& positive_variables, const VAR_MAP& negative_variables);
+                size_t bdd_nr_solutions(const size_t bdd_nr, const VAR_MAP& positive_variables, const VAR_MAP& negative_variables) const;
+
+            // Solutions are counted over the variables of the bdd and given as log2 of their number, -infinity if there is none.
+            // Variables in positive_variables resp. negative_variables are forced to be true resp. false and do not count as free variables.
+            double log_nr_solutions(const size_t bdd_nr) const;
+            template<typename VAR_MAP>
+                double log_nr_solutions(const size_t bdd_nr, const VAR_MAP& positive_variables, const VAR_MAP& negative_variables) const;
+            // log2 of nr of solutions with variables(bdd_nr)[i] set to true
+            std::vector<double> log_nr_solutions_marginals(const size_t bdd_nr) const;
+            template<typename VAR_MAP>
+                std::vector<double> log_nr_solutions_marginals(const size_t bdd_nr, const VAR_MAP& positive_variables, const VAR_MAP& negative_variables) const;
+            // counts resp. marginals of all bdds, computed in parallel
+            std::vector<double> log_nr_solutions() const;
+            template<typename VAR_MAP>
+                std::vector<double> log_nr_solutions(const VAR_MAP& positive_variables, const VAR_MAP& negative_variables) const;
+            std::vector<std::vector<double>> log_nr_solutions_marginals() const;
+            template<typename VAR_MAP>
+                std::vector<std::vector<double>> log_nr_solutions_marginals(const VAR_MAP& positive_variables, const VAR_MAP& negative_variables) const;
 
             size_t add_bdd(node_ref bdd);
             node_ref export_bdd(bdd_mgr& mgr, const size_t bdd_nr) const;
@@ -146,6 +168,8 @@ namespace BDD {
             size_t size() const { return nr_bdds(); }
             size_t nr_bdd_nodes(const size_t bdd_nr) const;
             size_t nr_bdd_nodes(const size_t bdd_nr, const size_t variable) const;
+            // nodes of all bdds together
+            size_t nr_bdd_nodes() const { return bdd_instructions.size(); }
 
             bdd_instruction* begin(const size_t bdd_nr);
             bdd_instruction* end(const size_t bdd_nr);
@@ -191,11 +215,16 @@ namespace BDD {
             size_t new_bdd();
             bdd_collection_node add_bdd_node(const size_t var);
             void close_bdd();
+            // append bdd whose instructions have arcs relative to the first instruction, the two terminals coming last
+            template<typename ITERATOR>
+                size_t add_bdd_instructions(ITERATOR instr_begin, ITERATOR instr_end);
 
             // for exporting to solvers: need modified BDD with arcs connecting consecutive variables
             bool contiguous_vars(const size_t bdd_nr) const;
             size_t make_qbdd(const size_t bdd_nr);
             size_t make_qbdd(const size_t bdd_nr, bdd_collection& o);
+            // bdds with more nodes are transformed and reduced level by level in parallel
+            constexpr static size_t parallel_threshold = 1 << 16;
 
             bool is_bdd(const size_t i) const;
             bool is_qbdd(const size_t bdd_nr) const;
@@ -217,15 +246,22 @@ namespace BDD {
             void append(const bdd_collection& o);
 
         private:
-            size_t bdd_and_impl(const size_t i, const size_t j, bdd_collection& o);
-            template<size_t N>
-                size_t bdd_and(const std::array<size_t,N>& bdds);
-            template<size_t N>
-                size_t bdd_and(const std::array<size_t,N>& bdds, bdd_collection& o);
-            template<size_t N>
-            size_t bdd_and_impl(const std::array<size_t,N>& bdds, std::unordered_map<std::array<size_t,N>,size_t,array_hasher<N>>& generated_nodes, bdd_collection& o);
+            size_t bdd_and_impl(const size_t i, const size_t j, bdd_collection& o, const size_t node_limit);
+            // conjunction of arbitrarily many bdds, product nodes are generated level by level
+            size_t bdd_and_impl(std::vector<size_t>& bdd_nrs, bdd_collection& o);
+            size_t bdd_and_product(const std::vector<size_t>& bdd_nrs, bdd_collection& o);
+            // conjunction that reduced to a terminal: bdd without branch instructions whose root is the given terminal
+            size_t add_terminal_bdd(const bool topsink_root);
+            // larger groups are split into subgroups whose conjunctions are reduced first
+            constexpr static size_t bdd_and_max_arity = 32;
 
             size_t splitting_variable(const bdd_instruction& k, const bdd_instruction& l) const;
+
+            // forced value per variable of bdd, i.e. 0 for free, 1 for true and 2 for false variables
+            template<typename VAR_MAP>
+                std::vector<char> forced_variables(const size_t bdd_nr, const VAR_MAP& positive_variables, const VAR_MAP& negative_variables) const;
+            // return log2 of nr of solutions. If marginals is not null, fill it with log2 of nr of solutions with variable set to true.
+            double log_nr_solutions_impl(const size_t bdd_nr, const std::vector<char>& forced, std::vector<double>* marginals) const;
             size_t add_bdd_impl(node_ref bdd);
 
             bool bdd_basic_check(const size_t bdd_nr) const;
@@ -235,6 +271,9 @@ namespace BDD {
             void remove_parallel_arcs();
             void reduce_isomorphic_subgraphs();
             void reduce();
+            // bdd must be reordered
+            void reduce_parallel();
+            size_t make_qbdd_parallel(const size_t bdd_nr, bdd_collection& o);
             void remove_dead_nodes(const std::vector<char>& remove);
             std::vector<char> reachable_nodes(const size_t bdd_nr) const;
 
@@ -369,15 +408,24 @@ namespace BDD {
             }
         }
 
-    template<size_t N, typename ITERATOR>
-        std::array<size_t,N> construct_array(ITERATOR begin, ITERATOR end)
+    template<typename ITERATOR>
+        size_t bdd_collection::add_bdd_instructions(ITERATOR instr_begin, ITERATOR instr_end)
         {
-            assert(std::distance(begin,end) == N);
-            std::array<size_t,N> a;
-            auto it = begin;
-            for(size_t i=0; i<N; ++i, ++it)
-                a[i] = *it;
-            return a;
+            assert(std::distance(instr_begin, instr_end) >= 3);
+            const size_t offset = bdd_instructions.size();
+            for(auto it=instr_begin; it!=instr_end; ++it)
+            {
+                bdd_instruction instr = *it;
+                if(!instr.is_terminal())
+                {
+                    instr.lo += offset;
+                    instr.hi += offset;
+                }
+                bdd_instructions.push_back(instr);
+            }
+            bdd_delimiters.push_back(bdd_instructions.size());
+            assert(is_bdd(nr_bdds()-1) || is_qbdd(nr_bdds()-1));
+            return nr_bdds()-1;
         }
 
     template<typename BDD_ITERATOR>
@@ -390,87 +438,11 @@ namespace BDD {
         size_t bdd_collection::bdd_and(BDD_ITERATOR bdd_begin, BDD_ITERATOR bdd_end, bdd_collection& o)
         {
             const size_t nr_bdds = std::distance(bdd_begin, bdd_end);
-
-            constexpr static size_t bdd_and_th = 49; // can be up to 49
-
-            if(nr_bdds > bdd_and_th)
-            {
-                // TODO: remove intermediate intersection bdds
-                std::vector<size_t> bdd_nrs(bdd_begin, bdd_end);
-                std::sort(bdd_nrs.begin(), bdd_nrs.end(), [&](const size_t bdd_nr_1, const size_t bdd_nr_2) {
-                        const auto [first_var_1, last_var_1] = this->min_max_variables(bdd_nr_1);
-                        const auto [first_var_2, last_var_2] = this->min_max_variables(bdd_nr_2);
-                        if(first_var_1 != first_var_2)
-                        return first_var_1 < first_var_2;
-                        if(last_var_1 != last_var_2)
-                        return first_var_1 < first_var_2;
-                        if(this->nr_bdd_nodes(bdd_nr_1) != this->nr_bdd_nodes(bdd_nr_2))
-                        return this->nr_bdd_nodes(bdd_nr_1) < this->nr_bdd_nodes(bdd_nr_2);
-                        return bdd_nr_1 < bdd_nr_2; 
-                        });
-                std::reverse(bdd_nrs.begin(), bdd_nrs.end());
-
-                while(bdd_nrs.size() >= bdd_and_th)
-                {
-                    size_t new_bdd_nr = bdd_and(bdd_nrs.end()-bdd_and_th, bdd_nrs.end());
-                    bdd_nrs.resize(bdd_nrs.size()-bdd_and_th);
-                    bdd_nrs.push_back(new_bdd_nr);
-                }
-
-                return bdd_and(bdd_nrs.begin(), bdd_nrs.end());
-            }
-
             switch(nr_bdds) {
+                case 0: throw std::runtime_error("conjunction of no bdds not defined.");
                 case 1: return *bdd_begin;
                 case 2: { const size_t i = *bdd_begin; ++bdd_begin; const size_t j = *bdd_begin; return bdd_and(i, j, o); }
-                case 3: { auto b = construct_array<3>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 4: { auto b = construct_array<4>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 5: { auto b = construct_array<5>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 6: { auto b = construct_array<6>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 7: { auto b = construct_array<7>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 8: { auto b = construct_array<8>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 9: { auto b = construct_array<9>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 10: { auto b = construct_array<10>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 11: { auto b = construct_array<11>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 12: { auto b = construct_array<12>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 13: { auto b = construct_array<13>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 14: { auto b = construct_array<14>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 15: { auto b = construct_array<15>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 16: { auto b = construct_array<16>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 17: { auto b = construct_array<17>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 18: { auto b = construct_array<18>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 19: { auto b = construct_array<19>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 20: { auto b = construct_array<20>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 21: { auto b = construct_array<21>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 22: { auto b = construct_array<22>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 23: { auto b = construct_array<23>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 24: { auto b = construct_array<24>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 25: { auto b = construct_array<25>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 26: { auto b = construct_array<26>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 27: { auto b = construct_array<27>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 28: { auto b = construct_array<28>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 29: { auto b = construct_array<29>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 30: { auto b = construct_array<30>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 31: { auto b = construct_array<31>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 32: { auto b = construct_array<32>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 33: { auto b = construct_array<33>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 34: { auto b = construct_array<34>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 35: { auto b = construct_array<35>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 36: { auto b = construct_array<36>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 37: { auto b = construct_array<37>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 38: { auto b = construct_array<38>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 39: { auto b = construct_array<39>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 40: { auto b = construct_array<40>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 41: { auto b = construct_array<41>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 42: { auto b = construct_array<42>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 43: { auto b = construct_array<43>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 44: { auto b = construct_array<44>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 45: { auto b = construct_array<45>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 46: { auto b = construct_array<46>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 47: { auto b = construct_array<47>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 48: { auto b = construct_array<48>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                case 49: { auto b = construct_array<49>(bdd_begin, bdd_end); return bdd_and(b, o); }
-                default: throw std::runtime_error("generic and not implemented.");
+                default: { std::vector<size_t> bdd_nrs(bdd_begin, bdd_end); return bdd_and_impl(bdd_nrs, o); }
             }
         }
 
@@ -522,6 +494,124 @@ namespace BDD {
         }
 
 
+    template<typename VAR_MAP>
+        std::vector<char> bdd_collection::forced_variables(const size_t bdd_nr, const VAR_MAP& positive_variables, const VAR_MAP& negative_variables) const
+        {
+            const std::vector<size_t> vars = variables(bdd_nr);
+            std::vector<char> forced(vars.size(), 0);
+            for(size_t i=0; i<vars.size(); ++i)
+            {
+                assert(!(positive_variables.count(vars[i]) > 0 && negative_variables.count(vars[i]) > 0));
+                if(positive_variables.count(vars[i]) > 0)
+                    forced[i] = 1;
+                else if(negative_variables.count(vars[i]) > 0)
+                    forced[i] = 2;
+            }
+            return forced;
+        }
+
+    template<typename VAR_MAP>
+        size_t bdd_collection::bdd_nr_solutions(const size_t bdd_nr, const VAR_MAP& positive_variables, const VAR_MAP& negative_variables) const
+        {
+            assert(bdd_nr < nr_bdds());
+            const std::vector<size_t> vars = variables(bdd_nr);
+            const std::vector<char> forced = forced_variables(bdd_nr, positive_variables, negative_variables);
+            // nr of free variables before each variable position, terminals come after the last one
+            std::vector<size_t> nr_free(vars.size()+1, 0);
+            for(size_t i=0; i<vars.size(); ++i)
+                nr_free[i+1] = nr_free[i] + (forced[i] == 0);
+            auto position = [&](const bdd_instruction& instr) -> size_t {
+                if(instr.is_terminal())
+                    return vars.size();
+                return std::distance(vars.begin(), std::lower_bound(vars.begin(), vars.end(), instr.index));
+            };
+
+            auto add = [](const size_t a, const size_t b) {
+                if(a > std::numeric_limits<size_t>::max() - b)
+                    throw std::runtime_error("nr of bdd solutions exceeds size_t, use log_nr_solutions");
+                return a + b;
+            };
+            auto shift = [](const size_t a, const size_t k) {
+                if(a != 0 && (k >= std::numeric_limits<size_t>::digits || a > (std::numeric_limits<size_t>::max() >> k)))
+                    throw std::runtime_error("nr of bdd solutions exceeds size_t, use log_nr_solutions");
+                return a << k;
+            };
+
+            // only nodes reachable under the forced variables are counted, their counts do not exceed the total one
+            const size_t begin = bdd_delimiters[bdd_nr];
+            const size_t end = bdd_delimiters[bdd_nr+1];
+            std::vector<char> reachable(end - begin, 0);
+            reachable[0] = 1;
+            for(size_t i=begin; i<end-2; ++i)
+            {
+                if(!reachable[i - begin])
+                    continue;
+                const bdd_instruction& instr = bdd_instructions[i];
+                const char f = forced[position(instr)];
+                if(f != 1)
+                    reachable[instr.lo - begin] = 1;
+                if(f != 2)
+                    reachable[instr.hi - begin] = 1;
+            }
+
+            std::vector<size_t> count(end - begin, 0);
+            for(size_t i=end; i-- > begin;)
+            {
+                const bdd_instruction& instr = bdd_instructions[i];
+                if(instr.is_terminal())
+                {
+                    count[i - begin] = instr.is_topsink();
+                    continue;
+                }
+                if(!reachable[i - begin])
+                    continue;
+                const size_t p = position(instr);
+                size_t c = 0;
+                if(forced[p] != 1)
+                    c = add(c, shift(count[instr.lo - begin], nr_free[position(bdd_instructions[instr.lo])] - nr_free[p+1]));
+                if(forced[p] != 2)
+                    c = add(c, shift(count[instr.hi - begin], nr_free[position(bdd_instructions[instr.hi])] - nr_free[p+1]));
+                count[i - begin] = c;
+            }
+            return shift(count[0], nr_free[position(bdd_instructions[begin])]);
+        }
+
+    template<typename VAR_MAP>
+        double bdd_collection::log_nr_solutions(const size_t bdd_nr, const VAR_MAP& positive_variables, const VAR_MAP& negative_variables) const
+        {
+            assert(bdd_nr < nr_bdds());
+            return log_nr_solutions_impl(bdd_nr, forced_variables(bdd_nr, positive_variables, negative_variables), nullptr);
+        }
+
+    template<typename VAR_MAP>
+        std::vector<double> bdd_collection::log_nr_solutions_marginals(const size_t bdd_nr, const VAR_MAP& positive_variables, const VAR_MAP& negative_variables) const
+        {
+            assert(bdd_nr < nr_bdds());
+            std::vector<double> marginals;
+            log_nr_solutions_impl(bdd_nr, forced_variables(bdd_nr, positive_variables, negative_variables), &marginals);
+            return marginals;
+        }
+
+    template<typename VAR_MAP>
+        std::vector<double> bdd_collection::log_nr_solutions(const VAR_MAP& positive_variables, const VAR_MAP& negative_variables) const
+        {
+            std::vector<double> counts(nr_bdds());
+#pragma omp parallel for schedule(dynamic)
+            for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+                counts[bdd_nr] = log_nr_solutions(bdd_nr, positive_variables, negative_variables);
+            return counts;
+        }
+
+    template<typename VAR_MAP>
+        std::vector<std::vector<double>> bdd_collection::log_nr_solutions_marginals(const VAR_MAP& positive_variables, const VAR_MAP& negative_variables) const
+        {
+            std::vector<std::vector<double>> marginals(nr_bdds());
+#pragma omp parallel for schedule(dynamic)
+            for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+                marginals[bdd_nr] = log_nr_solutions_marginals(bdd_nr, positive_variables, negative_variables);
+            return marginals;
+        }
+
     template<typename ITERATOR>
         void bdd_collection_entry::rebase(ITERATOR var_map_begin, ITERATOR var_map_end) 
         { 
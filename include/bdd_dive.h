@@ -0,0 +1,26 @@
+#pragma once
+
+#include "bdd_collection/bdd_collection.h"
+#include "bdd_fix.h"
+#include <memory>
+
+namespace LPMP {
+
+    // diving primal heuristic on the compact node arrays of a bdd collection.
+    // Same interface and options as bdd_fix, but propagation works on per-bdd reachability bitsets with a trail for backtracking.
+    class bdd_dive {
+        public:
+            bdd_dive(BDD::bdd_collection& bdd_col);
+            bdd_dive(BDD::bdd_collection& bdd_col, bdd_fix_options opts);
+            bdd_dive(bdd_dive&&);
+            bdd_dive& operator=(bdd_dive&&);
+            ~bdd_dive();
+            bool round(const std::vector<double> total_min_marginals);
+            std::vector<char> primal_solution();
+        private:
+
+            class impl;
+            std::unique_ptr<impl> pimpl;
+    };
+
+}
@@ -0,0 +1,575 @@
+#pragma once
+
+#include "bdd_collection/bdd_collection.h"
+#include "bdd_fix.h"
+#include "two_dimensional_variable_array.hxx"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <stack>
+#include <deque>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace LPMP {
+
+    ////////////////////////////////////////////////////
+    // Variable Fixing on compact bdd arrays
+    ////////////////////////////////////////////////////
+
+    // Each bdd is stored as a contiguous array of nodes with bdd-local arc targets, sorted by level.
+    // A node is alive if it lies on a path from the root to the top sink consistent with the current variable fixations.
+    // Aliveness is kept in one bitset per bdd, starting at a word boundary so that bdds can be propagated in parallel.
+    // Every changed bitset word and every variable fixation is recorded on a trail, backtracking restores the trail up to a given size.
+    class bdd_dive_base {
+        public:
+            bdd_dive_base(BDD::bdd_collection& bdd_col);
+
+            size_t nr_variables() const { return primal_solution_.size(); }
+            size_t nr_bdds() const { return bdd_levels_.size(); }
+
+            void set_options(bdd_fix_options opts) { options_ = opts; };
+            void set_total_min_marginals(const std::vector<double> total_min_marginals);
+
+            bool fix_variables();
+            bool fix_variables(const std::vector<size_t>& variables, const std::vector<char>& values);
+            // fix variable and propagate until no more variables are forced. Returns false on conflict, changes are not reverted then.
+            bool fix_variable(const size_t var, const char value);
+            bool is_fixed(const size_t var) const;
+
+            std::vector<double> search_space_reduction_coeffs();
+
+            void revert_changes(const size_t target_trail_size);
+            size_t trail_size() const { return trail_.size(); }
+
+            const std::vector<char>& primal_solution() const { return primal_solution_; }
+
+        private:
+            struct bdd_node {
+                uint32_t lo;
+                uint32_t hi;
+                constexpr static uint32_t botsink = std::numeric_limits<uint32_t>::max();
+                constexpr static uint32_t topsink = std::numeric_limits<uint32_t>::max()-1;
+            };
+
+            struct bdd_level {
+                size_t first_node;
+                size_t variable;
+            };
+
+            struct trail_entry {
+                size_t index; // variable or word in alive_
+                uint64_t old_bits;
+                bool variable;
+            };
+
+            static bool test_bit(const uint64_t* bits, const size_t i) { return (bits[i/64] >> (i%64)) & 1; }
+            static void set_bit(uint64_t* bits, const size_t i) { bits[i/64] |= uint64_t(1) << (i%64); }
+
+            // recompute alive nodes of bdd, log changed words and report variables that are forced. Returns false if root is not alive anymore.
+            bool propagate_bdd(const size_t bdd_nr, std::vector<uint64_t>& scratch, std::vector<trail_entry>& trail, std::vector<std::pair<size_t,char>>& forced);
+            bool propagate(std::vector<std::pair<size_t,char>>& fixes);
+
+            std::vector<bdd_node> nodes_;
+            two_dim_variable_array<bdd_level> bdd_levels_; // last entry for each bdd is a delimiter
+            std::vector<size_t> bdd_word_offsets_;
+            std::vector<uint64_t> alive_;
+            two_dim_variable_array<size_t> var_occurrences_; // bdds covering variable
+
+            // variables forced already before any fixation
+            std::vector<std::pair<size_t,char>> initial_fixes_;
+            bool initially_infeasible_ = false;
+
+            std::vector<trail_entry> trail_;
+            std::vector<char> bdd_marked_;
+            std::vector<size_t> affected_bdds_;
+            std::vector<std::pair<size_t,char>> pending_fixes_;
+
+            std::vector<double> total_min_marginals_;
+            bdd_fix_options options_;
+            std::vector<char> primal_solution_;
+    };
+
+    inline bdd_dive_base::bdd_dive_base(BDD::bdd_collection& bdd_col)
+    {
+        const size_t nr_vars = [&]() {
+            size_t max_v=0;
+            for(size_t bdd_nr=0; bdd_nr<bdd_col.nr_bdds(); ++bdd_nr)
+                max_v = std::max(max_v, bdd_col.min_max_variables(bdd_nr)[1]);
+            return max_v+1;
+        }();
+        std::vector<size_t> nr_bdds_per_variable(nr_vars, 0);
+
+        bdd_word_offsets_.reserve(bdd_col.nr_bdds()+1);
+        bdd_word_offsets_.push_back(0);
+        std::vector<bdd_level> cur_levels;
+        for(size_t bdd_nr=0; bdd_nr<bdd_col.nr_bdds(); ++bdd_nr)
+        {
+            assert(bdd_col.is_qbdd(bdd_nr));
+            assert(bdd_col.is_reordered(bdd_nr));
+            const size_t first_node = nodes_.size();
+            const size_t bdd_offset = bdd_col.offset(bdd_nr);
+            if(bdd_col.nr_bdd_nodes(bdd_nr) - 2 >= bdd_node::topsink)
+                throw std::runtime_error("bdd too large for diving heuristic");
+
+            cur_levels.clear();
+            for(auto bdd_it=bdd_col.cbegin(bdd_nr); bdd_it!=bdd_col.cend(bdd_nr); ++bdd_it)
+            {
+                const BDD::bdd_instruction& stored_bdd = *bdd_it;
+                assert(!stored_bdd.is_terminal());
+                const auto arc_target = [&](const size_t i) -> uint32_t {
+                    const BDD::bdd_instruction& target = bdd_col.get_bdd_instruction(i);
+                    if(target.is_botsink())
+                        return bdd_node::botsink;
+                    if(target.is_topsink())
+                        return bdd_node::topsink;
+                    assert(bdd_offset < i);
+                    return i - bdd_offset;
+                };
+                if(cur_levels.empty() || stored_bdd.index != cur_levels.back().variable)
+                {
+                    cur_levels.push_back({nodes_.size(), stored_bdd.index});
+                    nr_bdds_per_variable[stored_bdd.index]++;
+                }
+                nodes_.push_back({arc_target(stored_bdd.lo), arc_target(stored_bdd.hi)});
+            }
+            cur_levels.push_back({nodes_.size(), std::numeric_limits<size_t>::max()});
+
+            // arcs must point to the next level only
+            for(size_t l=0; l+1<cur_levels.size(); ++l)
+                for(size_t i=cur_levels[l].first_node; i<cur_levels[l+1].first_node; ++i)
+                    for(const uint32_t c : {nodes_[i].lo, nodes_[i].hi})
+                        if(c != bdd_node::botsink && c != bdd_node::topsink)
+                            if(l+2 >= cur_levels.size() || c + first_node < cur_levels[l+1].first_node || c + first_node >= cur_levels[l+2].first_node)
+                                throw std::runtime_error("diving heuristic needs arcs between consecutive variables only");
+
+            bdd_levels_.push_back(cur_levels.begin(), cur_levels.end());
+            const size_t nr_words = (nodes_.size() - first_node + 63) / 64;
+            bdd_word_offsets_.push_back(bdd_word_offsets_.back() + nr_words);
+        }
+
+        var_occurrences_ = two_dim_variable_array<size_t>(nr_bdds_per_variable.begin(), nr_bdds_per_variable.end());
+        std::fill(nr_bdds_per_variable.begin(), nr_bdds_per_variable.end(), 0);
+        for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+            for(size_t l=0; l+1<bdd_levels_.size(bdd_nr); ++l)
+            {
+                const size_t var = bdd_levels_(bdd_nr, l).variable;
+                var_occurrences_(var, nr_bdds_per_variable[var]++) = bdd_nr;
+            }
+
+        primal_solution_.resize(nr_vars, 2);
+        bdd_marked_.resize(nr_bdds(), 0);
+
+        // initially all nodes are alive, remove those not lying on any root to top sink path
+        alive_.resize(bdd_word_offsets_.back(), 0);
+        for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+        {
+            const size_t nr_nodes = bdd_levels_(bdd_nr, bdd_levels_.size(bdd_nr)-1).first_node - bdd_levels_(bdd_nr, 0).first_node;
+            for(size_t i=0; i<nr_nodes; ++i)
+                set_bit(&alive_[bdd_word_offsets_[bdd_nr]], i);
+        }
+
+#pragma omp parallel
+        {
+            std::vector<uint64_t> scratch;
+            std::vector<trail_entry> trail;
+            std::vector<std::pair<size_t,char>> forced;
+            bool feasible = true;
+#pragma omp for schedule(dynamic) nowait
+            for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+                if(!propagate_bdd(bdd_nr, scratch, trail, forced))
+                    feasible = false;
+#pragma omp critical
+            {
+                initial_fixes_.insert(initial_fixes_.end(), forced.begin(), forced.end());
+                initially_infeasible_ = initially_infeasible_ || !feasible;
+            }
+        }
+        std::sort(initial_fixes_.begin(), initial_fixes_.end());
+    }
+
+    inline bool bdd_dive_base::propagate_bdd(const size_t bdd_nr, std::vector<uint64_t>& scratch, std::vector<trail_entry>& trail, std::vector<std::pair<size_t,char>>& forced)
+    {
+        const size_t nr_levels = bdd_levels_.size(bdd_nr)-1;
+        const size_t first_node = bdd_levels_(bdd_nr, 0).first_node;
+        const size_t nr_words = bdd_word_offsets_[bdd_nr+1] - bdd_word_offsets_[bdd_nr];
+        uint64_t* alive = &alive_[bdd_word_offsets_[bdd_nr]];
+
+        // first half: nodes with a consistent path to the top sink, second half: nodes additionally reachable from the root
+        scratch.assign(2*nr_words, 0);
+        uint64_t* backward_alive = scratch.data();
+        uint64_t* forward_alive = scratch.data() + nr_words;
+
+        const auto child_alive = [&](const uint32_t c) {
+            return c == bdd_node::topsink || (c != bdd_node::botsink && test_bit(backward_alive, c));
+        };
+
+        for(std::ptrdiff_t l=nr_levels-1; l>=0; --l)
+        {
+            const char value = primal_solution_[bdd_levels_(bdd_nr, l).variable];
+            for(size_t i=bdd_levels_(bdd_nr, l).first_node - first_node; i<bdd_levels_(bdd_nr, l+1).first_node - first_node; ++i)
+            {
+                if(!test_bit(alive, i))
+                    continue;
+                const bdd_node& node = nodes_[first_node + i];
+                if((value != 1 && child_alive(node.lo)) || (value != 0 && child_alive(node.hi)))
+                    set_bit(backward_alive, i);
+            }
+        }
+
+        if(!test_bit(backward_alive, 0))
+            return false;
+
+        set_bit(forward_alive, 0);
+        size_t free_level = nr_levels; // from this level on some alive path has already reached the top sink, hence variables are not forced anymore
+        for(size_t l=0; l<nr_levels; ++l)
+        {
+            const size_t var = bdd_levels_(bdd_nr, l).variable;
+            const char value = primal_solution_[var];
+            bool lo_used = false;
+            bool hi_used = false;
+            for(size_t i=bdd_levels_(bdd_nr, l).first_node - first_node; i<bdd_levels_(bdd_nr, l+1).first_node - first_node; ++i)
+            {
+                if(!test_bit(forward_alive, i))
+                    continue;
+                const bdd_node& node = nodes_[first_node + i];
+                if(value != 1 && child_alive(node.lo))
+                {
+                    lo_used = true;
+                    if(node.lo == bdd_node::topsink)
+                        free_level = std::min(free_level, l+1);
+                    else
+                        set_bit(forward_alive, node.lo);
+                }
+                if(value != 0 && child_alive(node.hi))
+                {
+                    hi_used = true;
+                    if(node.hi == bdd_node::topsink)
+                        free_level = std::min(free_level, l+1);
+                    else
+                        set_bit(forward_alive, node.hi);
+                }
+            }
+            assert(lo_used || hi_used || l >= free_level);
+            if(value == 2 && l < free_level && lo_used != hi_used)
+                forced.push_back({var, hi_used ? 1 : 0});
+        }
+
+        for(size_t w=0; w<nr_words; ++w)
+        {
+            assert((forward_alive[w] & ~alive[w]) == 0);
+            if(forward_alive[w] != alive[w])
+            {
+                trail.push_back({bdd_word_offsets_[bdd_nr] + w, alive[w], false});
+                alive[w] = forward_alive[w];
+            }
+        }
+
+        return true;
+    }
+
+    inline bool bdd_dive_base::propagate(std::vector<std::pair<size_t,char>>& fixes)
+    {
+        bool feasible = true;
+        while(!fixes.empty() && feasible)
+        {
+            affected_bdds_.clear();
+            for(const auto [var, value] : fixes)
+            {
+                assert(var < primal_solution_.size());
+                assert(0 <= value && value <= 1);
+                if(primal_solution_[var] == value)
+                    continue;
+                if(is_fixed(var))
+                {
+                    feasible = false;
+                    break;
+                }
+                primal_solution_[var] = value;
+                trail_.push_back({var, 0, true});
+                if(var >= var_occurrences_.size()) // not covered by any bdd
+                    continue;
+                for(size_t j=0; j<var_occurrences_.size(var); ++j)
+                {
+                    const size_t bdd_nr = var_occurrences_(var, j);
+                    if(!bdd_marked_[bdd_nr])
+                    {
+                        bdd_marked_[bdd_nr] = 1;
+                        affected_bdds_.push_back(bdd_nr);
+                    }
+                }
+            }
+            fixes.clear();
+
+            if(feasible)
+            {
+#pragma omp parallel
+                {
+                    std::vector<uint64_t> scratch;
+                    std::vector<trail_entry> trail;
+                    std::vector<std::pair<size_t,char>> forced;
+                    bool local_feasible = true;
+#pragma omp for schedule(dynamic) nowait
+                    for(size_t i=0; i<affected_bdds_.size(); ++i)
+                        if(!propagate_bdd(affected_bdds_[i], scratch, trail, forced))
+                            local_feasible = false;
+#pragma omp critical
+                    {
+                        trail_.insert(trail_.end(), trail.begin(), trail.end());
+                        fixes.insert(fixes.end(), forced.begin(), forced.end());
+                        feasible = feasible && local_feasible;
+                    }
+                }
+            }
+
+            for(const size_t bdd_nr : affected_bdds_)
+                bdd_marked_[bdd_nr] = 0;
+        }
+
+        fixes.clear();
+        return feasible;
+    }
+
+    inline void bdd_dive_base::set_total_min_marginals(const std::vector<double> total_min_marginals)
+    {
+        // trailing variables not covered by any bdd are free
+        assert(total_min_marginals.size() >= var_occurrences_.size());
+        revert_changes(0);
+        primal_solution_.resize(total_min_marginals.size(), 2);
+        total_min_marginals_ = total_min_marginals;
+    }
+
+    inline bool bdd_dive_base::fix_variable(const size_t var, const char value)
+    {
+        pending_fixes_.clear();
+        pending_fixes_.push_back({var, value});
+        return propagate(pending_fixes_);
+    }
+
+    inline bool bdd_dive_base::is_fixed(const size_t var) const
+    {
+        assert(var < primal_solution_.size());
+        return primal_solution_[var] < 2;
+    }
+
+    inline void bdd_dive_base::revert_changes(const size_t target_trail_size)
+    {
+        assert(target_trail_size <= trail_.size());
+        while(trail_.size() > target_trail_size)
+        {
+            const trail_entry& e = trail_.back();
+            if(e.variable)
+                primal_solution_[e.index] = 2;
+            else
+                alive_[e.index] = e.old_bits;
+            trail_.pop_back();
+        }
+    }
+
+    inline std::vector<double> bdd_dive_base::search_space_reduction_coeffs()
+    {
+        // difference of number of solutions through high and low arcs, normalized by number of solutions of each bdd
+        std::vector<double> r_coeffs(nr_variables(), 0.0);
+        std::vector<double> backward_count;
+        std::vector<double> forward_count;
+        for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+        {
+            const size_t nr_levels = bdd_levels_.size(bdd_nr)-1;
+            const size_t first_node = bdd_levels_(bdd_nr, 0).first_node;
+            const size_t nr_nodes = bdd_levels_(bdd_nr, nr_levels).first_node - first_node;
+            const uint64_t* alive = &alive_[bdd_word_offsets_[bdd_nr]];
+            backward_count.assign(nr_nodes, 0.0);
+            forward_count.assign(nr_nodes, 0.0);
+
+            const auto count = [&](const uint32_t c) -> double {
+                if(c == bdd_node::topsink)
+                    return 1.0;
+                if(c == bdd_node::botsink)
+                    return 0.0;
+                return backward_count[c];
+            };
+
+            for(std::ptrdiff_t i=nr_nodes-1; i>=0; --i)
+                if(test_bit(alive, i))
+                    backward_count[i] = count(nodes_[first_node + i].lo) + count(nodes_[first_node + i].hi);
+
+            if(backward_count[0] == 0.0)
+                continue;
+            forward_count[0] = 1.0 / backward_count[0];
+
+            for(size_t l=0; l<nr_levels; ++l)
+            {
+                const size_t var = bdd_levels_(bdd_nr, l).variable;
+                for(size_t i=bdd_levels_(bdd_nr, l).first_node - first_node; i<bdd_levels_(bdd_nr, l+1).first_node - first_node; ++i)
+                {
+                    if(!test_bit(alive, i))
+                        continue;
+                    const bdd_node& node = nodes_[first_node + i];
+                    r_coeffs[var] += forward_count[i] * (count(node.hi) - count(node.lo));
+                    if(node.lo != bdd_node::topsink && node.lo != bdd_node::botsink)
+                        forward_count[node.lo] += forward_count[i];
+                    if(node.hi != bdd_node::topsink && node.hi != bdd_node::botsink)
+                        forward_count[node.hi] += forward_count[i];
+                }
+            }
+        }
+
+        return r_coeffs;
+    }
+
+    inline bool bdd_dive_base::fix_variables(const std::vector<size_t>& variables, const std::vector<char>& values)
+    {
+        assert(variables.size() == values.size());
+
+        revert_changes(0);
+        if(initially_infeasible_)
+        {
+            std::cout << "Problem is infeasible." << std::endl;
+            return false;
+        }
+        pending_fixes_ = initial_fixes_;
+        if(!propagate(pending_fixes_))
+        {
+            std::cout << "Problem is infeasible." << std::endl;
+            return false;
+        }
+        if(variables.size() == 0 || std::all_of(variables.begin(), variables.end(), [&](const size_t var) { return is_fixed(var); }))
+            return true;
+
+        struct VarFix
+        {
+            VarFix(const size_t trail_size, const size_t index, const char val)
+            : trail_size_(trail_size), index_(index), val_(val) {}
+
+            const size_t trail_size_;
+            const size_t index_;
+            const char val_;
+        };
+
+        std::stack<VarFix, std::deque<VarFix>> variable_fixes;
+        variable_fixes.emplace(trail_.size(), 0, 1-values[0]);
+        variable_fixes.emplace(trail_.size(), 0, values[0]);
+
+        size_t nfixes = 0;
+        const size_t max_fixes = this->nr_variables();
+        std::cout << "Search tree node budget: " << max_fixes << std::endl;
+        std::cout << "Searching for primal solution..." << std::endl;
+
+        while (!variable_fixes.empty())
+        {
+            nfixes++;
+            if (nfixes > max_fixes)
+            {
+                std::cout << "No feasible solution found within budget." << std::endl;
+                return false;
+            }
+
+            const auto fix = variable_fixes.top();
+            variable_fixes.pop();
+            size_t index = fix.index_;
+
+            revert_changes(fix.trail_size_);
+            if (!fix_variable(variables[index], fix.val_))
+                continue;
+
+            while (is_fixed(variables[index]))
+            {
+                index++;
+                if (index >= variables.size())
+                {
+                    std::cout << "Found feasible solution after expanding " << nfixes << " search tree nodes." << std::endl;
+                    return true;
+                }
+            }
+
+            variable_fixes.emplace(trail_.size(), index, 1-values[index]);
+            variable_fixes.emplace(trail_.size(), index, values[index]);
+        }
+
+        std::cout << "Expanded " << nfixes << " search tree nodes." << std::endl;
+        std::cout << "Problem appears to be infeasible." << std::endl;
+        return false;
+    }
+
+    inline bool bdd_dive_base::fix_variables()
+    {
+        assert(total_min_marginals_.size() == nr_variables());
+        std::vector<double> reduction_coeffs;
+        if(options_.var_order == bdd_fix_options::variable_order::marginals_reduction || options_.var_value == bdd_fix_options::variable_value::reduction)
+        {
+            revert_changes(0);
+            reduction_coeffs = search_space_reduction_coeffs();
+        }
+        std::vector<size_t> variables;
+        for (size_t i = 0; i < this->nr_variables(); i++)
+            variables.push_back(i);
+
+        const double eps = std::numeric_limits<double>::epsilon();
+
+        auto sign = [](const double val) -> double
+        {
+            if (val < 0)
+                return -1.0;
+            else if (val > 0)
+                return 1.0;
+            else
+                return 0.0;
+        };
+
+        auto order_reduction = [&](const size_t a, const size_t b)
+        {
+            return sign(reduction_coeffs[a]) * total_min_marginals_[a] > sign(reduction_coeffs[b]) * total_min_marginals_[b];
+        };
+
+        auto order_abs = [&](const size_t a, const size_t b)
+        {
+            return std::abs(total_min_marginals_[a]) > std::abs(total_min_marginals_[b]);
+        };
+
+        auto order_up = [&](const size_t a, const size_t b)
+        {
+            return total_min_marginals_[a] < total_min_marginals_[b];
+        };
+
+        auto order_down = [&](const size_t a, const size_t b)
+        {
+            return total_min_marginals_[a] > total_min_marginals_[b];
+        };
+
+        if (options_.var_order == bdd_fix_options::variable_order::marginals_absolute)
+            std::sort(variables.begin(), variables.end(), order_abs);
+        else if (options_.var_order == bdd_fix_options::variable_order::marginals_up)
+            std::sort(variables.begin(), variables.end(), order_up);
+        else if (options_.var_order == bdd_fix_options::variable_order::marginals_down)
+            std::sort(variables.begin(), variables.end(), order_down);
+        else if (options_.var_order == bdd_fix_options::variable_order::marginals_reduction)
+            std::sort(variables.begin(), variables.end(), order_reduction);
+        else
+            std::sort(variables.begin(), variables.end(), order_up);
+
+        std::vector<char> values;
+        for (size_t i = 0; i < variables.size(); i++)
+        {
+            char val;
+            if (options_.var_value == bdd_fix_options::variable_value::marginal)
+                val = (total_min_marginals_[variables[i]] < eps) ? 1 : 0;
+            else if (options_.var_value == bdd_fix_options::variable_value::reduction)
+                val = (sign(reduction_coeffs[variables[i]]) < 0) ? 1 : 0;
+            else if (options_.var_value == bdd_fix_options::variable_value::one)
+                val = 1;
+            else if (options_.var_value == bdd_fix_options::variable_value::zero)
+                val = 0;
+            else
+                val = (total_min_marginals_[variables[i]] < eps) ? 1 : 0;
+            values.push_back(val);
+        }
+
+        return fix_variables(variables, values);
+    }
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <cstdint>
+#include <cmath>
+#include <cassert>
+#include <stdexcept>
+
+namespace LPMP {
+
+    // Dual state of a bdd solver for warm starting re-solves of structurally identical instances.
+    // Holds the reparametrized costs of all bdds, i.e. per bdd and bdd variable the difference of high and low arc costs, in order of bdd numbers and variables.
+    // The objective the reparametrization was computed for is kept, so that a changed objective can be applied on top.
+    struct bdd_dual_state {
+        uint64_t structure_hash = 0; // of variables of all bdds
+        uint8_t value_size = sizeof(float); // costs are stored with precision of solver
+        std::vector<double> objective;
+        std::vector<double> costs;
+
+        void write(std::ostream& s) const;
+        static bdd_dual_state read(std::istream& s);
+        void save(const std::string& filename) const;
+        static bdd_dual_state load(const std::string& filename);
+        std::vector<char> serialize() const;
+        static bdd_dual_state deserialize(const char* begin, const char* end);
+    };
+
+    // FNV-1a hash of the number of bdds and the variables of each bdd
+    template<typename BDD_SOLVER>
+        uint64_t bdd_structure_hash(BDD_SOLVER& s)
+        {
+            uint64_t h = 14695981039346656037ull;
+            auto combine = [&](const uint64_t x) {
+                for(size_t i=0; i<8; ++i)
+                {
+                    h ^= (x >> (8*i)) & 0xff;
+                    h *= 1099511628211ull;
+                }
+            };
+            combine(s.nr_bdds());
+            for(size_t bdd_nr=0; bdd_nr<s.nr_bdds(); ++bdd_nr)
+            {
+                const auto vars = s.variables(bdd_nr);
+                combine(vars.size());
+                for(const size_t v : vars)
+                    combine(v);
+            }
+            return h;
+        }
+
+    // pending cost updates of the solver must have been applied to the bdds beforehand
+    template<typename BDD_SOLVER, typename COST_ITERATOR>
+        bdd_dual_state export_dual_state(BDD_SOLVER& s, COST_ITERATOR objective_begin, COST_ITERATOR objective_end)
+        {
+            bdd_dual_state state;
+            state.structure_hash = bdd_structure_hash(s);
+            state.value_size = sizeof(typename BDD_SOLVER::value_type);
+            state.objective.assign(objective_begin, objective_end);
+            for(size_t bdd_nr=0; bdd_nr<s.nr_bdds(); ++bdd_nr)
+            {
+                const auto bdd_costs = s.get_costs(bdd_nr);
+                state.costs.insert(state.costs.end(), bdd_costs.begin(), bdd_costs.end());
+            }
+            return state;
+        }
+
+    // Set reparametrized costs of all bdds to the ones of state and add the difference of the given objective and the objective of state, split evenly among bdds covering a variable.
+    // Costs of variables not covered by any bdd must already be set to the given objective, e.g. by constructing the solver with it.
+    template<typename BDD_SOLVER, typename COST_ITERATOR>
+        void import_dual_state(BDD_SOLVER& s, const bdd_dual_state& state, COST_ITERATOR objective_begin, COST_ITERATOR objective_end)
+        {
+            if(state.structure_hash != bdd_structure_hash(s))
+                throw std::runtime_error("dual state was exported from a structurally different instance");
+
+            const size_t nr_objective = std::distance(objective_begin, objective_end);
+            auto cost_delta = [&](const size_t var) {
+                const double new_cost = var < nr_objective ? double(*(objective_begin + var)) : 0.0;
+                const double old_cost = var < state.objective.size() ? state.objective[var] : 0.0;
+                return new_cost - old_cost;
+            };
+
+            size_t c = 0;
+            std::vector<double> update;
+            for(size_t bdd_nr=0; bdd_nr<s.nr_bdds(); ++bdd_nr)
+            {
+                const auto vars = s.variables(bdd_nr);
+                const auto bdd_costs = s.get_costs(bdd_nr);
+                assert(bdd_costs.size() == vars.size());
+                if(c + vars.size() > state.costs.size())
+                    throw std::runtime_error("dual state has too few costs");
+                update.clear();
+                for(size_t i=0; i<vars.size(); ++i, ++c)
+                {
+                    // costs of variables forced by the bdd stay infinite
+                    if(!std::isfinite(state.costs[c]) || !std::isfinite(bdd_costs[i]))
+                        update.push_back(0.0);
+                    else
+                        update.push_back(state.costs[c] - bdd_costs[i] + cost_delta(vars[i]) / double(s.nr_bdds(vars[i])));
+                }
+                s.update_costs(bdd_nr, update.begin(), update.end(), vars.begin(), vars.end());
+            }
+            if(c != state.costs.size())
+                throw std::runtime_error("dual state has too many costs");
+        }
+
+}
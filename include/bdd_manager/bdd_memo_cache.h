@@ -3,8 +3,8 @@
 #include "bdd_node.h"
 #include "bdd_node_cache.h"
 #include <vector>
-#include <unordered_map>
 #include <array>
+#include <cstdint>
 
 namespace BDD {
 
@@ -25,7 +25,7 @@ namespace BDD {
 
         template<typename T>
         constexpr static node* xor_symb_impl() { return static_cast<T*>(nullptr) + 3; }
-        constexpr static node* xor_symb() { return or_symb_impl<node>(); }
+        constexpr static node* xor_symb() { return xor_symb_impl<node>(); }
 
         bool operator==(const memo_struct& m) const;
         bool operator!=(const memo_struct& m) const;
@@ -35,40 +35,54 @@ namespace BDD {
 
     using memo = memo_struct;
 
+    // Operation results are kept in sets of associativity many entries. Each entry has an aging bit that is set when the entry is hit.
+    // When an entry must be evicted from a full set, an entry not hit since the last eviction in that set is chosen and all aging bits of the set are cleared.
+    // The nr of sets is doubled whenever as many entries have been evicted since the last resize as the cache has entries, up to the maximum size.
     class memo_cache {
         public:
+            constexpr static size_t associativity = 4;
+            enum class operation { and_op, or_op, xor_op, ite_op };
+            struct statistics {
+                size_t hits = 0;
+                size_t misses = 0;
+                size_t insertions = 0;
+                size_t evictions = 0;
+                double hit_rate() const { return hits + misses > 0 ? double(hits) / double(hits + misses) : 0.0; }
+            };
+
             memo_cache(bdd_node_cache& _node_cache);
             node* cache_lookup(node* f, node* g, node* h);
             void cache_insert(node* f, node* g, node* h, node* r);
-            memo_struct& get_memo(const size_t slot);
 
+            // remove entries with killed nodes and shrink the cache if it is sparsely populated afterwards
             void purge();
+            size_t memory_usage() const;
+
+            size_t size() const { return memos.size(); }
+            size_t max_size() const { return max_size_; }
+            // rounded down to a power of two of at least associativity many entries. Entries that do not fit anymore are dropped.
+            void set_max_size(const size_t max_entries);
+
+            const statistics& get_statistics(const operation op) const { return stats[static_cast<size_t>(op)]; }
+            void reset_statistics();
+            void print_statistics() const;
 
         private:
-            size_t cache_hash(node* f, node* g, node* h);
+            size_t cache_hash(node* f, node* g, node* h) const;
+            static operation memo_operation(node* h);
             void init_cache();
             void double_cache();
+            void resize(const size_t new_size);
             size_t choose_cache_size(const size_t items) const;
-            size_t nr_occupied_slots() const;
-
-            std::vector<memo_struct> memos;
-            size_t memos_mask = 0;
-            size_t cache_inserts = 0; // nr of times we have inserted into cache
-            size_t threshold = 0; // nr of inserts that triggers cache doubling
-
-            struct array_hasher {
-                std::size_t operator()(const std::array<node*, 3>& a) const {
-                    size_t h = 0;
-                    for (auto e : a) {
-                        h ^= std::hash<node*>{}(e)  + 0x9e3779b9 + (h << 6) + (h >> 2); 
-                    }
-                    return h;
-                }   
-            };
-            std::unordered_map<std::array<node*,3>, std::tuple<node*,size_t>, array_hasher> memos2;
-            bdd_node_cache& node_cache;
-            size_t insert_time_stamp = 0;
 
+            std::vector<memo_struct> memos; // set s occupies entries [associativity*s, associativity*(s+1))
+            std::vector<uint8_t> aging_bits; // per set, bit i is set if entry i was hit since the last eviction
+            size_t sets_mask = 0;
+            size_t max_size_ = 2<<21;
+            size_t evictions_since_resize = 0;
+            std::array<statistics,4> stats;
+
+            bdd_node_cache& node_cache;
     };
 
 }
@@ -8,7 +8,10 @@
 #include <unordered_map>
 #include <tuple>
 #include <algorithm>
+#include <cstdint>
 #include <cassert>
+#include <limits>
+#include <chrono>
 
 namespace BDD {
 
@@ -29,12 +32,15 @@ namespace BDD {
 
             node_ref unique_find(const size_t var, node_ref lo, node_ref hi);
 
+            // Binary operations and ite are computed non-recursively by a breadth-first apply: requests are expanded level by level in variable order and reduced bottom up, such that all unique table lookups of one variable are done consecutively.
+            // The *_recursive variants are the depth-first reference implementations. Their recursion depth is the number of variables of the operands.
             template<class... NODES>
                 node_ref and_rec(node_ref p, NODES...);
             template<class ITERATOR>
                 node_ref and_rec(ITERATOR nodes_begin, ITERATOR nodes_end);
             node_ref and_rec(node_ref f, node_ref g);
-            // return and conjunction if it has fewer than node_limit nodes. Otherwise return null reference and abort early
+            // return conjunction and its nr of nodes if it has at most node_limit nodes. Nodes shared between subproblems are counted once.
+            // Otherwise abort as soon as node_limit+1 nodes of the conjunction are reached and return a null reference together with this partial node count.
             std::tuple<node_ref,size_t> and_rec_limited(node_ref f, node_ref g, const size_t node_limit);
 
             template<class... NODES>
@@ -51,7 +57,11 @@ namespace BDD {
 
             // f is if-condition, g is for 1-outcome, h is for lo outcome
             node_ref ite_rec(node_ref f, node_ref g, node_ref h);
-            //node_ref ite_non_rec(node_ref f, node_ref g, node_ref h, std::stack<>& stack);
+
+            node_ref and_recursive(node_ref f, node_ref g);
+            node_ref or_recursive(node_ref f, node_ref g);
+            node_ref xor_recursive(node_ref f, node_ref g);
+            node_ref ite_recursive(node_ref f, node_ref g, node_ref h);
 
             // make a copy of bdd rooted at node to variables given
             // assume variable map is given by hash
@@ -64,8 +74,30 @@ namespace BDD {
             // make private and add friend classes
             bdd_node_cache& get_node_cache() { return node_cache_; }
             unique_table_page_caches& get_unique_table_page_cache() { return page_cache_; }
-
+            // size policy and per operation hit, miss and eviction counts of the memo cache
+            memo_cache& get_memo_cache() { return memo_; }
+            const memo_cache& get_memo_cache() const { return memo_; }
+
+            // Garbage collection frees nodes that are neither referenced by a node_ref nor reachable from a referenced node.
+            // Afterwards sparsely populated unique tables and the memo cache are shrunk and unused pages are returned to the operating system.
+            // It is run automatically at the start of operations whenever
+            //   (i) the nr of nodes has reached a threshold and at least dead_node_ratio of them are dead, or
+            //   (ii) memory_usage() exceeds the memory limit. If collecting garbage does not bring memory usage below the limit, an exception is thrown.
+            // After each check the threshold is set to twice the nr of remaining nodes, but not below min_nodes.
             void collect_garbage();
+            void set_garbage_collection(const double dead_node_ratio, const size_t min_nodes, const bool verbose = false);
+            void set_memory_limit(const size_t bytes) { memory_limit_ = bytes; }
+            // bytes allocated for nodes, unique tables and memo cache
+            size_t memory_usage() const;
+
+            struct garbage_collection_statistics {
+                size_t nr_collections = 0;
+                size_t nr_freed_nodes = 0;
+                size_t reclaimed_bytes = 0;
+                double total_pause = 0.0; // in seconds
+                double max_pause = 0.0;
+            };
+            const garbage_collection_statistics& gc_statistics() const { return gc_stats_; }
 
             // utility functions for computing common functions
             template<typename BDD_ITERATOR>
@@ -88,6 +120,41 @@ namespace BDD {
             node_ref add_bdd(bdd_collection& bdd_col, const size_t bdd_nr);
 
         private:
+            // called when no intermediate results of operations are held outside of node_refs
+            void collect_garbage_if_needed();
+            size_t kill_dead_nodes();
+            void remove_dead_nodes(const std::chrono::steady_clock::time_point start_time);
+            double dead_node_ratio_ = 0.5;
+            size_t gc_min_nodes_ = size_t(1) << 20;
+            size_t gc_threshold_ = size_t(1) << 20;
+            size_t memory_limit_ = std::numeric_limits<size_t>::max();
+            bool gc_verbose_ = false;
+            garbage_collection_statistics gc_stats_;
+
+            enum class apply_op { and_op, or_op, xor_op, ite_op };
+            node* apply(const apply_op op, node* f, node* g, node* h);
+            // return result if it is known without expansion, i.e. if it is a terminal case or in the memo cache. Operands are brought into normal form.
+            node* apply_lookup(const apply_op op, node*& f, node*& g, node*& h);
+            // result node or index of the request that computes it
+            std::uintptr_t apply_request(const apply_op op, node* f, node* g, node* h);
+
+            void grow_apply_request_table();
+
+            struct apply_request_struct {
+                node* f;
+                node* g;
+                node* h; // nullptr for binary operations
+                std::uintptr_t lo; // node or (request index << 1) | 1
+                std::uintptr_t hi;
+                node* r;
+                size_t slot; // in apply_request_table_
+            };
+            // scratch space of apply, empty between calls
+            std::vector<apply_request_struct> apply_requests_;
+            std::vector<size_t> apply_request_table_; // open addressing hash table of request indices plus one, zero for empty slots
+            std::vector<std::vector<size_t>> apply_levels_; // requests per variable
+            std::vector<size_t> apply_level_heap_; // variables with requests yet to be expanded
+            std::vector<size_t> apply_expanded_levels_;
 
             bdd_node_cache node_cache_;
             unique_table_page_caches page_cache_;
@@ -23,8 +23,8 @@ class node_struct
 
     void init_new_node(std::size_t v, node_struct* l, node_struct* h);
     std::size_t hash_code() const;
-    void mark(); // TODO: make non-recursive and add recursive marking as well
-    void unmark(); // TODO: make non-recursive and add recursive marking as well
+    void mark(); // marks all nodes reachable from this one that are not yet marked
+    void unmark();
     bool marked() const;
 
     void recursively_revive();
@@ -141,17 +141,14 @@ class node_ref {
 template<typename ITERATOR>
 bool node_struct::evaluate(ITERATOR var_begin, ITERATOR var_end)
 {
-    if(this->is_botsink())
-        return false;
-    if(this->is_topsink())
-        return true;
-    assert(index < std::distance(var_begin, var_end));
-    const bool x = *(var_begin + this->index);
-    if(x == true)
-        return hi->evaluate(var_begin, var_end);
-    else
-        return lo->evaluate(var_begin, var_end);
-
+    node_struct* p = this;
+    while(!p->is_terminal())
+    {
+        assert(p->index < std::distance(var_begin, var_end));
+        const bool x = *(var_begin + p->index);
+        p = x == true ? p->hi : p->lo;
+    }
+    return p->is_topsink();
 }
 
 template<typename STREAM>
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <array>
+#include <limits>
 #include "bdd_node.h"
 
 namespace BDD {
@@ -23,6 +24,12 @@ class bdd_node_cache
         node* reserve_node(void);
         void free_node(node*p);
         size_t nr_nodes() const { return total_nodes; }
+        size_t nr_pages() const { return nr_pages_; }
+        size_t memory_usage() const { return nr_pages_ * sizeof(bdd_node_page); }
+        // delete pages all of whose nodes are unused except the one nodes are currently taken from. Return nr of bytes released.
+        size_t release_free_pages();
+        // reference count of unused nodes
+        constexpr static int free_node_xref = std::numeric_limits<int>::min();
         node* botsink() const { return botsink_; }
         node* topsink() const { return topsink_; }
 
@@ -37,6 +44,7 @@ class bdd_node_cache
         node* topsink_; 
         size_t total_nodes = 2; // nr nodes currently in use
         size_t deadnodes = 0; // nr nodes currently having xref < 0
+        size_t nr_pages_ = 1;
 };
 
 }
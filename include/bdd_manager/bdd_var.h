@@ -3,6 +3,8 @@
 #include <memory>
 #include <array>
 #include <vector>
+#include <algorithm>
+#include <cassert>
 #include "bdd_node.h"
 #include "bdd_node_cache.h"
 
@@ -43,6 +45,9 @@ class unique_table_page_cache {
         unique_table_page<PAGE_SIZE>* reserve_page();
         void free_page(unique_table_page<PAGE_SIZE>* p); 
         std::size_t nr_pages() const { return pages.size() * nr_pages_simultaneous_allocation; }
+        std::size_t memory_usage() const { return nr_pages() * sizeof(unique_table_page<PAGE_SIZE>); }
+        // delete blocks of simultaneously allocated pages that are all unused. Return nr of bytes released.
+        std::size_t release_free_pages();
 
     private: 
         void increase_cache();
@@ -67,6 +72,15 @@ class unique_table_page_caches {
         unique_table_page_cache<262144,4> cache_262144;
         unique_table_page_cache<524288,2> cache_524288;
         unique_table_page_cache<1048576,1> cache_1048576;
+
+        std::size_t memory_usage() const;
+        std::size_t release_free_pages();
+
+    private:
+        template<typename F>
+            void for_each_cache(F f);
+        template<typename F>
+            void for_each_cache(F f) const;
 };
 
 class bdd_mgr; // forward declaration
@@ -86,7 +100,10 @@ class var_struct {
         node* unique_find(const std::size_t index, node* l,node* h); 
         node* unique_find(node* l,node* h); 
         //node* projection() const;
-        void remove_dead_nodes();
+        // kill nodes that are neither referenced nor reachable from live nodes of preceding variables. Return nr of killed nodes of this variable.
+        std::size_t kill_dead_nodes();
+        // free killed nodes and shrink the unique table if it is sparsely populated. Return nr of freed nodes.
+        std::size_t remove_dead_nodes();
 
     private:
         const size_t var;
@@ -126,10 +143,6 @@ class var_struct {
 
         size_t mask = 0; // number of pages for the unique table minus 1 
         size_t free = 0; // number of unused slots in the unique table for v
-        //std::size_t dead_nodes = 0;
-        std::size_t timer = 0;
-        constexpr static std::size_t timerinterval = 1024;
-        constexpr static double dead_fraction = 1.0;
         //std::array<unique_table_page*, nr_unique_table_pages> base = {}; // base addresses for its pages
         std::size_t name; // user's name (subscript) for this variable
         unsigned int timestamp; // time stamp for composition
@@ -187,4 +200,61 @@ void unique_table_page_cache<PAGE_SIZE, NR_SIMUL_ALLOC>::free_page(unique_table_
     p->next_available = page_avail;
     page_avail= p;
 }
+
+    template<size_t PAGE_SIZE, size_t NR_SIMUL_ALLOC>
+std::size_t unique_table_page_cache<PAGE_SIZE, NR_SIMUL_ALLOC>::release_free_pages()
+{
+    if(page_avail == nullptr)
+        return 0;
+
+    std::sort(pages.begin(), pages.end());
+    auto block_index = [&](unique_table_page<PAGE_SIZE>* p) -> std::size_t {
+        auto it = std::upper_bound(pages.begin(), pages.end(), p);
+        assert(it != pages.begin());
+        return std::distance(pages.begin(), it) - 1;
+    };
+    std::vector<std::size_t> nr_free(pages.size(), 0);
+    for(unique_table_page<PAGE_SIZE>* p = page_avail; p != nullptr; p = p->next_available)
+        nr_free[block_index(p)]++;
+
+    // rebuild free list from pages of remaining blocks before deleting blocks the list runs through
+    unique_table_page<PAGE_SIZE>* new_page_avail = nullptr;
+    unique_table_page<PAGE_SIZE>** tail = &new_page_avail;
+    for(unique_table_page<PAGE_SIZE>* p = page_avail; p != nullptr; p = p->next_available)
+        if(nr_free[block_index(p)] < nr_pages_simultaneous_allocation)
+        {
+            *tail = p;
+            tail = &p->next_available;
+        }
+    *tail = nullptr;
+    page_avail = new_page_avail;
+
+    std::size_t nr_released = 0;
+    for(std::size_t i=0; i<pages.size(); ++i)
+    {
+        if(nr_free[i] == nr_pages_simultaneous_allocation)
+        {
+            delete[] pages[i];
+            ++nr_released;
+        }
+        else
+            pages[i - nr_released] = pages[i];
+    }
+    pages.resize(pages.size() - nr_released);
+    return nr_released * nr_pages_simultaneous_allocation * sizeof(unique_table_page<PAGE_SIZE>);
+}
+
+template<typename F>
+void unique_table_page_caches::for_each_cache(F f)
+{
+    f(cache_64); f(cache_128); f(cache_256); f(cache_512); f(cache_1024); f(cache_2048); f(cache_4096); f(cache_8192);
+    f(cache_16384); f(cache_32768); f(cache_65536); f(cache_131072); f(cache_262144); f(cache_524288); f(cache_1048576);
+}
+
+template<typename F>
+void unique_table_page_caches::for_each_cache(F f) const
+{
+    f(cache_64); f(cache_128); f(cache_256); f(cache_512); f(cache_1024); f(cache_2048); f(cache_4096); f(cache_8192);
+    f(cache_16384); f(cache_32768); f(cache_65536); f(cache_131072); f(cache_262144); f(cache_524288); f(cache_1048576);
+}
 }
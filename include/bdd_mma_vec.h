@@ -2,6 +2,9 @@
 
 #include "bdd_collection/bdd_collection.h"
 #include "two_dimensional_variable_array.hxx"
+#include "min_marginal_utils.h"
+#include "bdd_tightening.h"
+#include "bdd_dual_state.h"
 #include <memory>
 
 namespace LPMP {
@@ -23,11 +26,19 @@ namespace LPMP {
             void set_avg_type(const averaging_type avg_type);
             double lower_bound();
             void iteration();
+            // process sweeps in wavefronts of variables not connected by bdd nodes in parallel, results are identical to sequential execution
+            void set_nr_threads(const size_t nr_threads);
             void backward_run(); 
             two_dim_variable_array<std::array<double,2>> min_marginals();
+            void min_marginal_agreement(std::vector<mm_agreement>& agreement, const double eps = 1e-6);
             void fix_variable(const size_t var, const bool value);
 
-            void tighten();
+            // add intersections of bdds covering variables with inconsistent min-marginals
+            tightening_statistics tighten(const tightening_options& opt);
+
+            // reparametrized costs for warm starting structurally identical instances, see bdd_dual_state.h
+            bdd_dual_state export_dual_state(const std::vector<double>& objective);
+            void import_dual_state(const bdd_dual_state& state, const std::vector<double>& objective);
         private:
 
             class impl;
@@ -2,6 +2,9 @@
 
 #include "bdd_collection/bdd_collection.h"
 #include "two_dimensional_variable_array.hxx"
+#include "min_marginal_utils.h"
+#include "bdd_tightening.h"
+#include "bdd_dual_state.h"
 #include <memory>
 
 namespace LPMP {
@@ -21,14 +24,33 @@ namespace LPMP {
 
             double lower_bound();
             void iteration();
+            // skip bdds whose variables have settled, see bdd_sequential_base::set_active_set
+            void set_active_set(const double threshold, const size_t full_sweep_interval = 10);
+            size_t nr_active_bdds() const;
+            // acceleration, see bdd_sequential_base::set_omega and set_momentum
+            void set_omega(const double omega, const bool adaptive = false);
+            void set_momentum(const double momentum, const size_t interval = 3);
             void distribute_delta();
             void backward_run(); 
             two_dim_variable_array<std::array<double,2>> min_marginals();
+            void min_marginal_agreement(std::vector<mm_agreement>& agreement, const double eps = 1e-6);
+            std::vector<char> decode_primal_solution(const bool verbose = false);
             void fix_variable(const size_t var, const bool value);
             template<typename ITERATOR>
                 void fix_variables(ITERATOR zero_fixations_begin, ITERATOR zero_fixations_end, ITERATOR one_fixations_begin, ITERATOR one_fixations_end);
 
-            void tighten();
+            // add intersections of bdds covering variables with inconsistent min-marginals
+            tightening_statistics tighten(const tightening_options& opt);
+
+            // append all bdds of bdd_col and remove bdds without rebuilding the solver. Dual costs of other bdds are kept.
+            // Both return the new numbers of the affected bdds, see bdd_sequential_base::remove_bdds for renumbering after removal.
+            std::vector<size_t> add_bdds(BDD::bdd_collection& bdd_col);
+            std::vector<size_t> remove_bdds(const std::vector<size_t>& bdd_nrs);
+            size_t nr_bdds() const;
+
+            // reparametrized costs for warm starting structurally identical instances, see bdd_dual_state.h
+            bdd_dual_state export_dual_state(const std::vector<double>& objective);
+            void import_dual_state(const bdd_dual_state& state, const std::vector<double>& objective);
         private:
 
             class impl;
@@ -10,6 +10,24 @@
 #include <vector>
 
 namespace LPMP {
+
+    struct coalesce_options {
+        size_t node_limit = 10000; // merged bdds exceeding this nr of nodes are discarded
+        double node_budget = 1.2; // total nr of nodes after coalescing relative to the nr of nodes before
+        size_t max_rounds = 5; // each bdd is merged at most once per round
+        size_t max_bdds_per_variable = 16; // overlap candidates are only formed from variables covered by at most so many bdds
+    };
+
+    struct coalesce_statistics {
+        size_t nr_rounds = 0;
+        size_t nr_candidates = 0;
+        size_t nr_exceeded_node_limit = 0;
+        size_t nr_merges = 0;
+        size_t nr_bdds_before = 0;
+        size_t nr_bdds_after = 0;
+        size_t nr_nodes_before = 0;
+        size_t nr_nodes_after = 0;
+    };
     
     class bdd_preprocessor {
         public:
@@ -29,10 +47,12 @@ namespace LPMP {
             void set_coalesce_subsumption_except_one() { coalesce_subsumption_except_one_ = true; }
             void set_coalesce_partial_contiguous_overlap() { coalesce_partial_contiguous_overlap_ = true; }
             void set_coalesce_cliques() { coalesce_cliques_ = true; }
+            void set_coalesce_overlap() { coalesce_overlap_ = true; }
 
             void rebase_bdds();
             void construct_bdd_collection();
-            void coalesce();
+            // merge pairs of bdds proposed by the enabled candidate heuristics (overlap if none is set) whose conjunction stays small
+            coalesce_statistics coalesce(const coalesce_options& opt = coalesce_options());
             void coalesce_bdd_collection();
             const auto get_bdd_indices() { return indices; };
             //BDD::bdd_mgr& get_bdd_manager() { return bdd_mgr; }
@@ -50,14 +70,16 @@ namespace LPMP {
             //    coalesce_candidate_type type;
             //    bool operator<(const coalesce_candidate& o) { return type < o.type; }
                 bool operator<(const coalesce_candidate& o) const { 
-                    if((*this)[0] == o[0]) return (*this)[0] < o[0];
-                    return (*this)[1] < o[1];
+                    if((*this)[0] == o[0]) return (*this)[1] < o[1];
+                    return (*this)[0] < o[0];
                 }
             };
             std::vector<coalesce_candidate> bridge_candidates(const two_dim_variable_array<size_t>& bdd_var_adjacency, const two_dim_variable_array<size_t>& var_bdd_adjacency) const;
+            // all bdd pairs sharing a variable that is covered by at most max_bdds_per_variable bdds
+            std::vector<coalesce_candidate> overlap_candidates(const two_dim_variable_array<size_t>& var_bdd_adjacency, const size_t max_bdds_per_variable) const;
             std::vector<coalesce_candidate> subsumption_candidates(const two_dim_variable_array<size_t>& bdd_var_adjacency, const two_dim_variable_array<size_t>& var_bdd_adjacency) const { return compute_candidates(true, false, false, false, bdd_var_adjacency, var_bdd_adjacency); }
             std::vector<coalesce_candidate> contiguous_overlap_candidates(const two_dim_variable_array<size_t>& bdd_var_adjacency, const two_dim_variable_array<size_t>& var_bdd_adjacency) const { return compute_candidates(false, true, false, false, bdd_var_adjacency, var_bdd_adjacency); }
-            std::vector<coalesce_candidate> subsumption_except_one_candidates(const two_dim_variable_array<size_t>& bdd_var_adjacency, const two_dim_variable_array<size_t>& var_bdd_adjacency) const { return compute_candidates(false, true, false, false, bdd_var_adjacency, var_bdd_adjacency); }
+            std::vector<coalesce_candidate> subsumption_except_one_candidates(const two_dim_variable_array<size_t>& bdd_var_adjacency, const two_dim_variable_array<size_t>& var_bdd_adjacency) const { return compute_candidates(false, false, true, false, bdd_var_adjacency, var_bdd_adjacency); }
             std::vector<coalesce_candidate> partial_contiguous_overlap_candidates(const two_dim_variable_array<size_t>& bdd_var_adjacency, const two_dim_variable_array<size_t>& var_bdd_adjacency) const { return compute_candidates(false, false, false, true, bdd_var_adjacency, var_bdd_adjacency); }
 
             std::vector<coalesce_candidate> compute_candidates(const bool subsumption, const bool contiguous_overlap, const bool subsumption_except_one, const bool partial_contiguous_overlap, const two_dim_variable_array<size_t>& bdd_var_adjacency, const two_dim_variable_array<size_t>& var_bdd_adjacency) const;
@@ -86,6 +108,7 @@ namespace LPMP {
             bool coalesce_subsumption_except_one_ = false;
             bool coalesce_partial_contiguous_overlap_ = false;
             bool coalesce_cliques_ = false;
+            bool coalesce_overlap_ = false;
     };
 
     template<typename VARIABLE_ITERATOR>
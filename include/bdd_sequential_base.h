@@ -5,10 +5,13 @@
 #include <Eigen/SparseCore>
 #include "bdd_collection/bdd_collection.h"
 #include "two_dimensional_variable_array.hxx"
+#include "min_marginal_utils.h"
 #include <fstream>
 #include <cstdlib>
 #include <filesystem>
 #include <unordered_set>
+#include <deque>
+#include <algorithm>
 #include "time_measure_util.h"
 #include "atomic_ref.hpp"
 
@@ -23,6 +26,19 @@ namespace LPMP {
             bdd_sequential_base(BDD::bdd_collection& bdd_col) { add_bdds(bdd_col); }
 
             void add_bdds(BDD::bdd_collection& bdd_col);
+            // append bdds after the present ones, existing bdds and their costs are left untouched. Returns new bdd numbers
+            template<typename BDD_NR_ITERATOR>
+                std::vector<size_t> add_bdds(BDD::bdd_collection& bdd_col, BDD_NR_ITERATOR bdd_nrs_begin, BDD_NR_ITERATOR bdd_nrs_end);
+            // Tombstone bdds: their variables and nodes stay in place until compactify, nr_variables reports none for them.
+            // Low and high costs of removed bdds are handed to the remaining bdds covering the same variables, dual costs of remaining bdds are kept.
+            // Takes one pass over all nodes to apply the handed over costs together with pending min-marginal deltas, hence remove many bdds at once.
+            // Compacts when more than half of all bdd branch nodes belong to removed bdds.
+            // Returns new numbers of all bdds present before removal, std::numeric_limits<size_t>::max() for removed ones.
+            template<typename BDD_NR_ITERATOR>
+                std::vector<size_t> remove_bdds(BDD_NR_ITERATOR bdd_nrs_begin, BDD_NR_ITERATOR bdd_nrs_end);
+            bool removed(const size_t bdd_nr) const;
+            // drop nodes of removed bdds and renumber remaining ones. Return value as for remove_bdds
+            std::vector<size_t> compactify();
 
             size_t nr_bdds() const;
             size_t nr_bdds(const size_t var) const;
@@ -30,10 +46,15 @@ namespace LPMP {
             size_t nr_variables(const size_t bdd_nr) const;
             size_t variable(const size_t bdd_nr, const size_t bdd_index) const;
             size_t nr_bdd_variables() const;
+            std::vector<size_t> variables(const size_t bdd_nr) const;
+            // add bdd to bdd collection, returns its number there
+            size_t export_bdd(BDD::bdd_collection& bdd_col, const size_t bdd_nr) const;
 
             double lower_bound();
             using vector_type = Eigen::Matrix<typename BDD_BRANCH_NODE::value_type, Eigen::Dynamic, 1>;
             vector_type lower_bound_per_bdd();
+            // write into preallocated buffer of size nr_bdds()
+            void lower_bound_per_bdd(Eigen::Ref<vector_type> lbs);
 
             void forward_run();
             void backward_run();
@@ -42,15 +63,32 @@ namespace LPMP {
             two_dim_variable_array<std::array<double,2>> min_marginals();
             using min_marginal_type = Eigen::Matrix<typename BDD_BRANCH_NODE::value_type, Eigen::Dynamic, 2>;
             std::tuple<min_marginal_type, std::vector<char>> min_marginals_stacked();
+            // write min-marginals only into preallocated buffer with nr_bdd_variables() rows
+            void min_marginals_stacked(Eigen::Ref<min_marginal_type> min_margs);
+            // aggregate min-marginal differences per variable into agreement without materializing all min-marginals
+            void min_marginal_agreement(std::vector<mm_agreement>& agreement, const double eps = 1e-6);
+            // primal solution from argmin paths of all bdds by majority vote per variable.
+            // Violated bdds are repaired by a path with fewest changes, bdds sharing changed variables are queued for rechecking.
+            // Changing a variable again is penalized by the number of its previous changes to avoid cycling between bdds.
+            // Returns empty vector if no solution is found within max_repair_steps. Progress is printed only if verbose.
+            std::vector<char> decode_primal_solution(const size_t max_repair_steps, const bool verbose = false);
 
             template<typename COST_ITERATOR>
                 void update_costs(COST_ITERATOR cost_lo_begin, COST_ITERATOR cost_lo_end, COST_ITERATOR cost_hi_begin, COST_ITERATOR cost_hi_end);
             // TODO: remove these! //
             void update_costs(const two_dim_variable_array<std::array<value_type,2>>& delta);
-            void update_costs(const min_marginal_type& delta);
+            // delta has one row per bdd variable in the order of min_marginals_stacked.
+            // Two columns are added to low and high arc costs, a single column to high arc costs.
+            template<typename DERIVED>
+                void update_costs(const Eigen::MatrixBase<DERIVED>& delta);
             vector_type get_costs();
-            void update_costs(const vector_type& delta);
+            void get_costs(Eigen::Ref<vector_type> costs);
             /////////////////////////
+            // difference of minimal high and low arc costs of bdd per variable
+            std::vector<value_type> get_costs(const size_t bdd_nr) const;
+            // add costs to high arcs of bdd. Variables must be sorted and a subset of the bdd's variables
+            template<typename COST_ITERATOR, typename VARIABLE_ITERATOR>
+                void update_costs(const size_t bdd_nr, COST_ITERATOR cost_begin, COST_ITERATOR cost_end, VARIABLE_ITERATOR variable_begin, VARIABLE_ITERATOR variable_end);
 
             template<typename ITERATOR>
                 void fix_variables(ITERATOR zero_fixations_begin, ITERATOR zero_fixations_end, ITERATOR one_fixations_begin, ITERATOR one_fixations_end);
@@ -60,9 +98,23 @@ namespace LPMP {
 
             // compute incremental min marginals and perform min-marginal averaging subsequently
             void parallel_mma();
-            void forward_mm(const size_t bdd_nr, const typename BDD_BRANCH_NODE::value_type omega, std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_collect, std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_distribute);
-            value_type backward_mm(const size_t bdd_nr, const typename BDD_BRANCH_NODE::value_type omega, std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_collect, std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_distribute);
+            // If residuals are given, the largest change of cost difference of high and low arcs per variable is recorded in them. It vanishes when bdds agree on min-marginals.
+            void forward_mm(const size_t bdd_nr, const typename BDD_BRANCH_NODE::value_type omega, std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_collect, std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_distribute, std::vector<value_type>* residuals = nullptr);
+            value_type backward_mm(const size_t bdd_nr, const typename BDD_BRANCH_NODE::value_type omega, std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_collect, std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_distribute, std::vector<value_type>* residuals = nullptr);
             void distribute_delta();
+            // Active set mode of parallel_mma: bdds all of whose variables had residuals (see forward_mm) of at most threshold in the previous iteration are skipped.
+            // A skipped bdd is woken as soon as a bdd sharing one of its variables has a larger residual. Deltas are averaged over the processed bdds of a variable only.
+            // All bdds are processed every full_sweep_interval iterations and after costs have been changed from outside. threshold = 0 processes all bdds always.
+            void set_active_set(const value_type threshold, const size_t full_sweep_interval = 10);
+            // number of bdds processed in last parallel_mma iteration
+            size_t nr_active_bdds() const { return nr_active_bdds_; }
+            // Fraction of min-marginal differences sent per pass of parallel_mma, default 0.5. If adaptive, omega is adjusted between omega_min and omega_max to lower bound progress.
+            void set_omega(const value_type omega, const bool adaptive = false, const value_type omega_min = 0.3, const value_type omega_max = 0.7);
+            value_type omega() const { return omega_; }
+            // Every interval parallel_mma iterations extrapolate the reparametrization by momentum times its change since the last extrapolation.
+            // The extrapolation is reverted and momentum restarted if the lower bound does not improve. Forces full sweeps in active set mode. 0 = off.
+            // An extrapolation costs about one backward pass and two passes over all arc costs, larger intervals amortize it over more iterations.
+            void set_momentum(const value_type momentum, const size_t interval = 3);
 
             // Both operations below are inverses of each other
             // Given elements in order bdd_nr/bdd_index, transpose to variable/bdd_index with same variable.
@@ -97,10 +149,20 @@ namespace LPMP {
             double compute_lower_bound_after_forward_pass();
             double compute_lower_bound_after_backward_pass();
 
-            vector_type lower_bound_per_bdd_after_forward_pass();
-            vector_type lower_bound_per_bdd_after_backward_pass();
+            void lower_bound_per_bdd_after_forward_pass(Eigen::Ref<vector_type> lbs);
+            void lower_bound_per_bdd_after_backward_pass(Eigen::Ref<vector_type> lbs);
 
             std::array<size_t,2> bdd_range(const size_t bdd_nr) const;
+            void append_bdd(BDD::bdd_collection& bdd_col, const size_t bdd_nr);
+
+            // for primal decoding
+            bool bdd_feasible(const size_t bdd_nr, const std::vector<char>& sol) const;
+            struct path_repair_cost {
+                size_t nr_changes;
+                value_type cost;
+                bool operator<(const path_repair_cost& o) const { return nr_changes < o.nr_changes || (nr_changes == o.nr_changes && cost < o.cost); }
+            };
+            bool repair_bdd(const size_t bdd_nr, std::vector<char>& sol, const std::vector<size_t>& nr_changes, std::vector<path_repair_cost>& scratch, std::vector<size_t>& changed_vars) const;
             std::array<size_t,2> bdd_index_range(const size_t bdd_nr, const size_t bdd_idx) const;
 
             std::vector<BDD_BRANCH_NODE> bdd_branch_nodes_;
@@ -112,10 +174,41 @@ namespace LPMP {
             };
             two_dim_variable_array<bdd_variable> bdd_variables_;
             std::vector<size_t> nr_bdds_per_variable_;
+            size_t nr_removed_bdd_nodes_ = 0;
+            std::vector<char> removed_bdds_; // tombstones set by remove_bdds, bdds added afterwards are not covered
+            two_dim_variable_array<size_t> variable_bdds_; // bdds covering each variable, built on first primal decoding
 
             // for parallel mma
             std::vector<std::array<value_type,2>> mms_to_collect_;
             std::vector<std::array<value_type,2>> mms_to_distribute_;
+
+            // active set of parallel mma
+            void parallel_mma_active_set();
+            static value_type mm_residual(const std::array<value_type,2> mm, const std::array<value_type,2> delta, const value_type omega);
+            value_type active_set_threshold_ = 0.0;
+            size_t full_sweep_interval_ = 10;
+            size_t iterations_since_full_sweep_ = 0;
+            std::vector<value_type> variable_residual_; // largest residual of variable in last iteration
+            std::vector<char> bdd_active_;
+            std::vector<size_t> active_bdds_;
+            std::vector<size_t> nr_active_bdds_per_variable_;
+            size_t nr_active_bdds_ = 0;
+
+            // acceleration of parallel mma
+            void parallel_mma_all();
+            void adapt_omega(const double prev_lb);
+            void extrapolate(const bool restart);
+            value_type omega_ = 0.5;
+            bool adaptive_omega_ = false;
+            value_type omega_min_ = 0.3;
+            value_type omega_max_ = 0.7;
+            double prev_lb_gain_ = 0.0;
+            value_type momentum_ = 0.0;
+            size_t momentum_interval_ = 3;
+            size_t iterations_since_extrapolation_ = 0;
+            std::vector<std::array<value_type,2>> prev_costs_; // low and high arc costs per bdd branch node after previous iteration
+            std::vector<std::array<value_type,2>> cur_costs_;
+            size_t nr_rejected_extrapolations_ = 0;
         };
 
     ////////////////////
@@ -147,6 +240,8 @@ namespace LPMP {
         {
             assert(bdd_nr < nr_bdds());
             assert(bdd_variables_.size(bdd_nr) > 0);
+            if(removed(bdd_nr))
+                return 0;
             return bdd_variables_.size(bdd_nr) - 1; 
         }
 
@@ -164,11 +259,62 @@ namespace LPMP {
             return std::accumulate(nr_bdds_per_variable_.begin(), nr_bdds_per_variable_.end(), 0); 
         }
 
+    template<typename BDD_BRANCH_NODE>
+        std::vector<size_t> bdd_sequential_base<BDD_BRANCH_NODE>::variables(const size_t bdd_nr) const
+        {
+            assert(bdd_nr < nr_bdds());
+            std::vector<size_t> vars;
+            vars.reserve(nr_variables(bdd_nr));
+            for(size_t bdd_idx=0; bdd_idx<nr_variables(bdd_nr); ++bdd_idx)
+                vars.push_back(variable(bdd_nr, bdd_idx));
+            return vars;
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        size_t bdd_sequential_base<BDD_BRANCH_NODE>::export_bdd(BDD::bdd_collection& bdd_col, const size_t bdd_nr) const
+        {
+            assert(bdd_nr < nr_bdds());
+            assert(!removed(bdd_nr));
+            const auto [first_bdd_node, last_bdd_node] = bdd_range(bdd_nr);
+            const size_t new_bdd_nr = bdd_col.new_bdd();
+            std::vector<BDD::bdd_collection_node> bdd_col_nodes;
+            bdd_col_nodes.reserve(last_bdd_node - first_bdd_node);
+            for(size_t bdd_idx=0; bdd_idx<nr_variables(bdd_nr); ++bdd_idx)
+            {
+                const auto [first, last] = bdd_index_range(bdd_nr, bdd_idx);
+                for(size_t i=first; i<last; ++i)
+                    bdd_col_nodes.push_back(bdd_col.add_bdd_node(variable(bdd_nr, bdd_idx)));
+            }
+
+            for(size_t i=first_bdd_node; i<last_bdd_node; ++i)
+            {
+                const auto& bdd = bdd_branch_nodes_[i];
+                auto& node = bdd_col_nodes[i - first_bdd_node];
+
+                if(bdd.offset_low == BDD_BRANCH_NODE::terminal_0_offset)
+                    node.set_lo_to_0_terminal();
+                else if(bdd.offset_low == BDD_BRANCH_NODE::terminal_1_offset)
+                    node.set_lo_to_1_terminal();
+                else
+                    node.set_lo_arc(bdd_col_nodes[i - first_bdd_node + bdd.offset_low]);
+
+                if(bdd.offset_high == BDD_BRANCH_NODE::terminal_0_offset)
+                    node.set_hi_to_0_terminal();
+                else if(bdd.offset_high == BDD_BRANCH_NODE::terminal_1_offset)
+                    node.set_hi_to_1_terminal();
+                else
+                    node.set_hi_arc(bdd_col_nodes[i - first_bdd_node + bdd.offset_high]);
+            }
+
+            bdd_col.close_bdd();
+            return new_bdd_nr;
+        }
+
     template<typename BDD_BRANCH_NODE>
         void bdd_sequential_base<BDD_BRANCH_NODE>::add_bdds(BDD::bdd_collection& bdd_col)
         {
             message_passing_state_ = message_passing_state::none;
-            assert(bdd_branch_nodes_.size() == 0); // currently does not support incremental addition of BDDs
+            assert(bdd_branch_nodes_.size() == 0); // use add_bdds with bdd numbers for incremental addition of BDDs
             bdd_branch_nodes_.clear();
             const size_t total_nr_bdd_nodes = [&]() {
                 size_t i=0;
@@ -179,6 +325,8 @@ namespace LPMP {
             bdd_branch_nodes_.reserve(total_nr_bdd_nodes);
             bdd_variables_.clear();
             nr_bdds_per_variable_.clear();
+            nr_removed_bdd_nodes_ = 0;
+            removed_bdds_.clear();
             const size_t nr_vars = [&]() {
                 size_t max_v=0;
                 for(size_t bdd_nr=0; bdd_nr<bdd_col.nr_bdds(); ++bdd_nr)
@@ -194,68 +342,243 @@ namespace LPMP {
             }
 
             for(size_t bdd_nr=0; bdd_nr<bdd_col.nr_bdds(); ++bdd_nr)
+                append_bdd(bdd_col, bdd_nr);
+
+            assert(bdd_branch_nodes_.size() == total_nr_bdd_nodes);
+            // add last entry for offset
+            std::vector<bdd_variable> tmp_bdd_variables;
+            tmp_bdd_variables.push_back({bdd_branch_nodes_.size(), std::numeric_limits<size_t>::max()});
+            bdd_variables_.push_back(tmp_bdd_variables.begin(), tmp_bdd_variables.end());
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        template<typename BDD_NR_ITERATOR>
+        std::vector<size_t> bdd_sequential_base<BDD_BRANCH_NODE>::add_bdds(BDD::bdd_collection& bdd_col, BDD_NR_ITERATOR bdd_nrs_begin, BDD_NR_ITERATOR bdd_nrs_end)
+        {
+            // pending min-marginal deltas are meant for the bdds present before
+            if(mms_to_distribute_.size() > 0)
+                distribute_delta();
+            message_passing_state_ = message_passing_state::none;
+            lower_bound_state_ = lower_bound_state::invalid;
+
+            size_t nr_new_bdd_nodes = 0;
+            size_t max_var = 0;
+            for(auto bdd_nr_it=bdd_nrs_begin; bdd_nr_it!=bdd_nrs_end; ++bdd_nr_it)
             {
-                assert(bdd_col.is_qbdd(bdd_nr));
-                assert(bdd_col.is_reordered(bdd_nr));
-                std::vector<bdd_variable> cur_bdd_variables;
-                cur_bdd_variables.push_back({bdd_branch_nodes_.size(), bdd_col.min_max_variables(bdd_nr)[0]}); // TODO: use min_variable
-                for(auto bdd_it=bdd_col.cbegin(bdd_nr); bdd_it!=bdd_col.cend(bdd_nr); ++bdd_it)
+                assert(bdd_col.is_qbdd(*bdd_nr_it));
+                assert(bdd_col.is_reordered(*bdd_nr_it));
+                nr_new_bdd_nodes += bdd_col.nr_bdd_nodes(*bdd_nr_it)-2;
+                max_var = std::max(max_var, bdd_col.min_max_variables(*bdd_nr_it)[1]);
+            }
+            bdd_branch_nodes_.reserve(bdd_branch_nodes_.size() + nr_new_bdd_nodes);
+
+            if(max_var >= nr_variables())
+            {
+                nr_bdds_per_variable_.resize(max_var+1, 0);
+                if(mms_to_collect_.size() > 0)
+                    mms_to_collect_.resize(max_var+1, {0.0,0.0});
+                if(mms_to_distribute_.size() > 0)
+                    mms_to_distribute_.resize(max_var+1, {0.0,0.0});
+            }
+
+            // remove extra delimiter at the end and add it again after the new bdds
+            assert(bdd_variables_.size() > 0 && bdd_variables_.size(bdd_variables_.size()-1) == 1);
+            bdd_variables_.pop_back();
+
+            std::vector<size_t> new_bdd_nrs;
+            for(auto bdd_nr_it=bdd_nrs_begin; bdd_nr_it!=bdd_nrs_end; ++bdd_nr_it)
+            {
+                new_bdd_nrs.push_back(bdd_variables_.size());
+                append_bdd(bdd_col, *bdd_nr_it);
+            }
+
+            std::vector<bdd_variable> tmp_bdd_variables;
+            tmp_bdd_variables.push_back({bdd_branch_nodes_.size(), std::numeric_limits<size_t>::max()});
+            bdd_variables_.push_back(tmp_bdd_variables.begin(), tmp_bdd_variables.end());
+            variable_bdds_.clear(); // to force recomputation for primal decoding
+
+            return new_bdd_nrs;
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        void bdd_sequential_base<BDD_BRANCH_NODE>::append_bdd(BDD::bdd_collection& bdd_col, const size_t bdd_nr)
+        {
+            assert(bdd_col.is_qbdd(bdd_nr));
+            assert(bdd_col.is_reordered(bdd_nr));
+            std::vector<bdd_variable> cur_bdd_variables;
+            cur_bdd_variables.push_back({bdd_branch_nodes_.size(), bdd_col.min_max_variables(bdd_nr)[0]}); // TODO: use min_variable
+            for(auto bdd_it=bdd_col.cbegin(bdd_nr); bdd_it!=bdd_col.cend(bdd_nr); ++bdd_it)
+            {
+                const BDD::bdd_instruction& stored_bdd = *bdd_it;
+                assert(!stored_bdd.is_terminal());
+                BDD_BRANCH_NODE bdd;
+
+                if(bdd_col.get_bdd_instruction(stored_bdd.lo).is_botsink()) 
+                    bdd.offset_low = BDD_BRANCH_NODE::terminal_0_offset;
+                else if(bdd_col.get_bdd_instruction(stored_bdd.lo).is_topsink()) 
+                    bdd.offset_low = BDD_BRANCH_NODE::terminal_1_offset;
+                else
                 {
-                    const BDD::bdd_instruction& stored_bdd = *bdd_it;
-                    assert(!stored_bdd.is_terminal());
-                    BDD_BRANCH_NODE bdd;
-
-                    if(bdd_col.get_bdd_instruction(stored_bdd.lo).is_botsink()) 
-                        bdd.offset_low = BDD_BRANCH_NODE::terminal_0_offset;
-                    else if(bdd_col.get_bdd_instruction(stored_bdd.lo).is_topsink()) 
-                        bdd.offset_low = BDD_BRANCH_NODE::terminal_1_offset;
-                    else
-                    {
-                        assert(bdd_col.offset(stored_bdd) < stored_bdd.lo);
-                        bdd.offset_low = stored_bdd.lo - bdd_col.offset(stored_bdd);
-                    }
+                    assert(bdd_col.offset(stored_bdd) < stored_bdd.lo);
+                    assert(stored_bdd.lo - bdd_col.offset(stored_bdd) < BDD_BRANCH_NODE::terminal_1_offset);
+                    bdd.offset_low = stored_bdd.lo - bdd_col.offset(stored_bdd);
+                }
 
-                    if(bdd_col.get_bdd_instruction(stored_bdd.hi).is_botsink()) 
-                        bdd.offset_high = BDD_BRANCH_NODE::terminal_0_offset;
-                    else if(bdd_col.get_bdd_instruction(stored_bdd.hi).is_topsink()) 
-                        bdd.offset_high = BDD_BRANCH_NODE::terminal_1_offset;
-                    else
-                    {
-                        assert(bdd_col.offset(stored_bdd) < stored_bdd.hi);
-                        bdd.offset_high = stored_bdd.hi - bdd_col.offset(stored_bdd);
-                    }
+                if(bdd_col.get_bdd_instruction(stored_bdd.hi).is_botsink()) 
+                    bdd.offset_high = BDD_BRANCH_NODE::terminal_0_offset;
+                else if(bdd_col.get_bdd_instruction(stored_bdd.hi).is_topsink()) 
+                    bdd.offset_high = BDD_BRANCH_NODE::terminal_1_offset;
+                else
+                {
+                    assert(bdd_col.offset(stored_bdd) < stored_bdd.hi);
+                    assert(stored_bdd.hi - bdd_col.offset(stored_bdd) < BDD_BRANCH_NODE::terminal_1_offset);
+                    bdd.offset_high = stored_bdd.hi - bdd_col.offset(stored_bdd);
+                }
+
+                if(bdd.offset_low == BDD_BRANCH_NODE::terminal_0_offset)
+                    bdd.low_cost = std::numeric_limits<decltype(bdd.low_cost)>::infinity();
 
-                    if(bdd.offset_low == BDD_BRANCH_NODE::terminal_0_offset)
-                        bdd.low_cost = std::numeric_limits<decltype(bdd.low_cost)>::infinity();
+                if(bdd.offset_high == BDD_BRANCH_NODE::terminal_0_offset)
+                    bdd.high_cost = std::numeric_limits<decltype(bdd.high_cost)>::infinity();
 
-                    if(bdd.offset_high == BDD_BRANCH_NODE::terminal_0_offset)
-                        bdd.high_cost = std::numeric_limits<decltype(bdd.high_cost)>::infinity();
+                if(stored_bdd.index != cur_bdd_variables.back().variable)
+                    cur_bdd_variables.push_back({bdd_branch_nodes_.size(), stored_bdd.index});
 
-                    if(stored_bdd.index != cur_bdd_variables.back().variable)
-                        cur_bdd_variables.push_back({bdd_branch_nodes_.size(), stored_bdd.index});
+                bdd_branch_nodes_.push_back(bdd);
+            }
+
+            assert(cur_bdd_variables.back().variable == bdd_col.min_max_variables(bdd_nr)[1]);
+            cur_bdd_variables.push_back({bdd_branch_nodes_.size(), std::numeric_limits<size_t>::max()}); // For extra delimiter at the end
+            bdd_variables_.push_back(cur_bdd_variables.begin(), cur_bdd_variables.end());
+            assert(bdd_variables_.size(bdd_variables_.size()-1) == bdd_col.variables(bdd_nr).size()+1);
+
+            for(const auto [offset, v] : cur_bdd_variables)
+            {
+                assert(v < nr_bdds_per_variable_.size() || v == std::numeric_limits<size_t>::max());
+                if(v != std::numeric_limits<size_t>::max())
+                    nr_bdds_per_variable_[v]++; 
+            }
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        bool bdd_sequential_base<BDD_BRANCH_NODE>::removed(const size_t bdd_nr) const
+        {
+            assert(bdd_nr < nr_bdds());
+            return bdd_nr < removed_bdds_.size() && removed_bdds_[bdd_nr];
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        template<typename BDD_NR_ITERATOR>
+        std::vector<size_t> bdd_sequential_base<BDD_BRANCH_NODE>::remove_bdds(BDD_NR_ITERATOR bdd_nrs_begin, BDD_NR_ITERATOR bdd_nrs_end)
+        {
+            message_passing_state_ = message_passing_state::none;
+            lower_bound_state_ = lower_bound_state::invalid;
+            if(mms_to_distribute_.size() != nr_variables())
+                mms_to_distribute_ = std::vector<std::array<value_type,2>>(nr_variables(), {0.0,0.0});
+
+            // the share of pending min-marginal deltas meant for removed bdds is part of their costs
+            removed_bdds_.resize(nr_bdds(), false);
+            std::vector<std::array<value_type,2>> removed_costs(nr_variables(), {0.0,0.0});
+            std::vector<size_t> removed_vars;
+            for(auto bdd_nr_it=bdd_nrs_begin; bdd_nr_it!=bdd_nrs_end; ++bdd_nr_it)
+            {
+                const size_t bdd_nr = *bdd_nr_it;
+                assert(bdd_nr < nr_bdds());
+                if(removed(bdd_nr))
+                    continue;
+                for(size_t bdd_idx=0; bdd_idx<nr_variables(bdd_nr); ++bdd_idx)
+                {
+                    const size_t var = variable(bdd_nr, bdd_idx);
+                    // all nodes of a variable carry the same costs, arcs to the 0-terminal have infinite ones
+                    const auto [first_bdd_node, last_bdd_node] = bdd_index_range(bdd_nr, bdd_idx);
+                    value_type lo_cost = std::numeric_limits<value_type>::infinity();
+                    value_type hi_cost = std::numeric_limits<value_type>::infinity();
+                    for(size_t i=first_bdd_node; i<last_bdd_node; ++i)
+                    {
+                        lo_cost = std::min(lo_cost, bdd_branch_nodes_[i].low_cost);
+                        hi_cost = std::min(hi_cost, bdd_branch_nodes_[i].high_cost);
+                    }
+                    lo_cost += mms_to_distribute_[var][0];
+                    hi_cost += mms_to_distribute_[var][1];
+                    // values forbidden by the removed bdd only are allowed again
+                    if(std::isfinite(lo_cost))
+                        removed_costs[var][0] += lo_cost;
+                    if(std::isfinite(hi_cost))
+                        removed_costs[var][1] += hi_cost;
+                    assert(nr_bdds_per_variable_[var] > 0);
+                    nr_bdds_per_variable_[var]--;
+                    removed_vars.push_back(var);
+                }
+                nr_removed_bdd_nodes_ += bdd_variables_(bdd_nr+1, 0).offset - bdd_variables_(bdd_nr, 0).offset;
+                removed_bdds_[bdd_nr] = true;
+            }
+            variable_bdds_.clear(); // to force recomputation for primal decoding
 
-                    assert(bdd_branch_nodes_.size() < total_nr_bdd_nodes);
-                    bdd_branch_nodes_.push_back(bdd);
+            // handed over costs are distributed together with pending deltas, variables not covered anymore contribute to constant
+            std::sort(removed_vars.begin(), removed_vars.end());
+            removed_vars.erase(std::unique(removed_vars.begin(), removed_vars.end()), removed_vars.end());
+            for(const size_t var : removed_vars)
+            {
+                if(nr_bdds(var) > 0)
+                {
+                    mms_to_distribute_[var][0] += removed_costs[var][0] / value_type(nr_bdds(var));
+                    mms_to_distribute_[var][1] += removed_costs[var][1] / value_type(nr_bdds(var));
                 }
+                else
+                    constant_ += std::min(removed_costs[var][0], removed_costs[var][1]);
+            }
+            distribute_delta();
 
-                assert(cur_bdd_variables.back().variable == bdd_col.min_max_variables(bdd_nr)[1]);
-                cur_bdd_variables.push_back({bdd_branch_nodes_.size(), std::numeric_limits<size_t>::max()}); // For extra delimiter at the end
-                bdd_variables_.push_back(cur_bdd_variables.begin(), cur_bdd_variables.end());
-                assert(bdd_variables_.size(bdd_nr) == bdd_col.variables(bdd_nr).size()+1);
+            if(2*nr_removed_bdd_nodes_ > bdd_branch_nodes_.size())
+                return compactify();
 
-                for(const auto [offset, v] : cur_bdd_variables)
+            std::vector<size_t> new_bdd_nrs(nr_bdds());
+            for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+                new_bdd_nrs[bdd_nr] = removed(bdd_nr) ? std::numeric_limits<size_t>::max() : bdd_nr;
+            return new_bdd_nrs;
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        std::vector<size_t> bdd_sequential_base<BDD_BRANCH_NODE>::compactify()
+        {
+            std::vector<size_t> new_bdd_nrs(nr_bdds(), std::numeric_limits<size_t>::max());
+            std::vector<size_t> bdd_variables_size;
+            for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+                if(!removed(bdd_nr))
+                {
+                    new_bdd_nrs[bdd_nr] = bdd_variables_size.size();
+                    bdd_variables_size.push_back(bdd_variables_.size(bdd_nr));
+                }
+            bdd_variables_size.push_back(1);
+            if(bdd_variables_size.size() == bdd_variables_.size())
+                return new_bdd_nrs;
+
+            // node offsets are relative within a bdd, hence nodes can be moved as a block. Costs and messages are kept
+            std::vector<BDD_BRANCH_NODE> new_bdd_branch_nodes;
+            new_bdd_branch_nodes.reserve(bdd_branch_nodes_.size() - nr_removed_bdd_nodes_);
+            two_dim_variable_array<bdd_variable> new_bdd_variables(bdd_variables_size);
+            for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+            {
+                if(removed(bdd_nr))
+                    continue;
+                const auto [first_bdd_node, last_bdd_node] = bdd_range(bdd_nr);
+                const size_t new_first_bdd_node = new_bdd_branch_nodes.size();
+                new_bdd_branch_nodes.insert(new_bdd_branch_nodes.end(), bdd_branch_nodes_.begin() + first_bdd_node, bdd_branch_nodes_.begin() + last_bdd_node);
+                for(size_t j=0; j<bdd_variables_.size(bdd_nr); ++j)
                 {
-                    assert(v < nr_bdds_per_variable_.size() || v == std::numeric_limits<size_t>::max());
-                    if(v != std::numeric_limits<size_t>::max())
-                        nr_bdds_per_variable_[v]++; 
+                    const bdd_variable bv = bdd_variables_(bdd_nr, j);
+                    new_bdd_variables(new_bdd_nrs[bdd_nr], j) = {bv.offset - first_bdd_node + new_first_bdd_node, bv.variable};
                 }
             }
+            new_bdd_variables(new_bdd_variables.size()-1, 0) = {new_bdd_branch_nodes.size(), std::numeric_limits<size_t>::max()};
 
-            assert(bdd_branch_nodes_.size() == total_nr_bdd_nodes);
-            // add last entry for offset
-            std::vector<bdd_variable> tmp_bdd_variables;
-            tmp_bdd_variables.push_back({bdd_branch_nodes_.size(), std::numeric_limits<size_t>::max()});
-            bdd_variables_.push_back(tmp_bdd_variables.begin(), tmp_bdd_variables.end());
+            std::swap(bdd_branch_nodes_, new_bdd_branch_nodes);
+            std::swap(bdd_variables_, new_bdd_variables);
+            nr_removed_bdd_nodes_ = 0;
+            removed_bdds_.clear();
+            variable_bdds_.clear();
+
+            return new_bdd_nrs;
         }
 
     template<typename BDD_BRANCH_NODE>
@@ -298,6 +621,8 @@ namespace LPMP {
             // TODO: works only for non-split BDDs
             for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
             {
+                if(removed(bdd_nr))
+                    continue;
                 const auto [first,last] = bdd_index_range(bdd_nr, 0);
                 assert(first+1 == last);
                 lb += bdd_branch_nodes_[first].m;
@@ -316,6 +641,8 @@ namespace LPMP {
             // TODO: works only for non-split BDDs
             for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
             {
+                if(removed(bdd_nr))
+                    continue;
                 const auto [first,last] = bdd_index_range(bdd_nr, nr_variables(bdd_nr)-1);
                 value_type bdd_lb = std::numeric_limits<value_type>::infinity();
                 for(size_t idx=first; idx<last; ++idx)
@@ -332,31 +659,44 @@ namespace LPMP {
     template<typename BDD_BRANCH_NODE>
         typename bdd_sequential_base<BDD_BRANCH_NODE>::vector_type bdd_sequential_base<BDD_BRANCH_NODE>::lower_bound_per_bdd()
         {
+            vector_type lbs(nr_bdds());
+            lower_bound_per_bdd(lbs);
+            return lbs;
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        void bdd_sequential_base<BDD_BRANCH_NODE>::lower_bound_per_bdd(Eigen::Ref<vector_type> lbs)
+        {
+            assert(lbs.size() == nr_bdds());
             if(message_passing_state_ == message_passing_state::after_backward_pass)
             {
-                return lower_bound_per_bdd_after_backward_pass();
+                lower_bound_per_bdd_after_backward_pass(lbs);
             }
             else if(message_passing_state_ == message_passing_state::after_forward_pass)
             {
-                return lower_bound_per_bdd_after_forward_pass();
+                lower_bound_per_bdd_after_forward_pass(lbs);
             }
             else
             {
                 assert(message_passing_state_ == message_passing_state::none);
                 backward_run();
-                return lower_bound_per_bdd_after_backward_pass();
+                lower_bound_per_bdd_after_backward_pass(lbs);
             }
         }
 
     // TODO: possibly implement template functino that takes lambda and can compute lower bound and lower bound per bdd
 
     template<typename BDD_BRANCH_NODE>
-        typename bdd_sequential_base<BDD_BRANCH_NODE>::vector_type bdd_sequential_base<BDD_BRANCH_NODE>::lower_bound_per_bdd_after_forward_pass()
+        void bdd_sequential_base<BDD_BRANCH_NODE>::lower_bound_per_bdd_after_forward_pass(Eigen::Ref<vector_type> lbs)
         {
             assert(message_passing_state_ == message_passing_state::after_forward_pass);
-            vector_type lbs(nr_bdds());
             for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
             {
+                if(removed(bdd_nr))
+                {
+                    lbs[bdd_nr] = 0.0;
+                    continue;
+                }
                 const auto [first,last] = bdd_index_range(bdd_nr, nr_variables(bdd_nr)-1);
                 value_type bdd_lb = std::numeric_limits<value_type>::infinity();
                 for(size_t idx=first; idx<last; ++idx)
@@ -366,25 +706,25 @@ namespace LPMP {
                 }
                 lbs[bdd_nr] = bdd_lb;
             }
-
-            return lbs;
         }
 
     template<typename BDD_BRANCH_NODE>
-        typename bdd_sequential_base<BDD_BRANCH_NODE>::vector_type bdd_sequential_base<BDD_BRANCH_NODE>::lower_bound_per_bdd_after_backward_pass()
+        void bdd_sequential_base<BDD_BRANCH_NODE>::lower_bound_per_bdd_after_backward_pass(Eigen::Ref<vector_type> lbs)
         {
             assert(message_passing_state_ == message_passing_state::after_backward_pass);
-            vector_type lbs(nr_bdds());
 
             // TODO: works only for non-split BDDs
             for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
             {
+                if(removed(bdd_nr))
+                {
+                    lbs[bdd_nr] = 0.0;
+                    continue;
+                }
                 const auto [first,last] = bdd_index_range(bdd_nr, 0);
                 assert(first+1 == last);
                 lbs[bdd_nr] = bdd_branch_nodes_[first].m;
             }
-
-            return lbs;
         }
 
     template<typename BDD_BRANCH_NODE>
@@ -397,6 +737,8 @@ namespace LPMP {
 #pragma omp parallel for schedule(static,512)
             for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
             {
+                if(removed(bdd_nr))
+                    continue;
                 // TODO: This only works for non-split BDDs with exactly one root node
                 {
                     const auto [first_bdd_node, last_bdd_node] = bdd_index_range(bdd_nr,0);
@@ -451,6 +793,8 @@ namespace LPMP {
         {
             assert(bdd_nr < nr_bdds());
             const size_t first = bdd_variables_(bdd_nr, 0).offset;
+            if(removed(bdd_nr))
+                return {first, first};
             const size_t last = bdd_variables_(bdd_nr+1, 0).offset;
             assert(first < last);
             return {first, last}; 
@@ -470,6 +814,8 @@ namespace LPMP {
 //#pragma omp parallel for schedule(guided,128)
             for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
             {
+                if(removed(bdd_nr))
+                    continue;
                 // intialize
                 const auto [first,last] = bdd_index_range(bdd_nr, 0);
                 assert(first + 1 == last);
@@ -513,6 +859,8 @@ namespace LPMP {
             size_t c = 0;
             for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
             {
+                if(removed(bdd_nr))
+                    continue;
                 // intialize
                 const auto [first,last] = bdd_index_range(bdd_nr, 0);
                 assert(first + 1 == last);
@@ -589,35 +937,81 @@ namespace LPMP {
             return {min_margs, solutions};
         }
 
+    template<typename BDD_BRANCH_NODE>
+        void bdd_sequential_base<BDD_BRANCH_NODE>::min_marginals_stacked(Eigen::Ref<min_marginal_type> min_margs)
+        {
+            assert(min_margs.rows() == nr_bdd_variables());
+            backward_run();
+
+            size_t c = 0;
+            for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+            {
+                if(removed(bdd_nr))
+                    continue;
+                const auto [first,last] = bdd_index_range(bdd_nr, 0);
+                assert(first + 1 == last);
+                bdd_branch_nodes_[first].m = 0.0;
+
+                for(size_t idx=0; idx<nr_variables(bdd_nr); ++idx, ++c)
+                {
+                    std::array<value_type,2> mm = {std::numeric_limits<value_type>::infinity(), std::numeric_limits<value_type>::infinity()};
+                    const auto [first,last] = bdd_index_range(bdd_nr, idx);
+                    for(size_t i=first; i<last; ++i)
+                    {
+                        const std::array<value_type,2> cur_mm = bdd_branch_nodes_[i].min_marginals();
+                        mm[0] = std::min(mm[0], cur_mm[0]);
+                        mm[1] = std::min(mm[1], cur_mm[1]); 
+                    }
+
+                    min_margs(c,0) = mm[0];
+                    min_margs(c,1) = mm[1];
+
+                    for(size_t i=first; i<last; ++i)
+                        bdd_branch_nodes_[i].prepare_forward_step(); 
+                    for(size_t i=first; i<last; ++i)
+                        bdd_branch_nodes_[i].forward_step();
+                }
+            }
+            assert(c == nr_bdd_variables());
+
+            message_passing_state_ = message_passing_state::after_forward_pass;
+        }
+
     template<typename BDD_BRANCH_NODE>
         typename bdd_sequential_base<BDD_BRANCH_NODE>::vector_type bdd_sequential_base<BDD_BRANCH_NODE>::get_costs()
         {
             vector_type costs(nr_bdd_variables());
+            get_costs(costs);
+            return costs;
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        void bdd_sequential_base<BDD_BRANCH_NODE>::get_costs(Eigen::Ref<vector_type> costs)
+        {
+            assert(costs.size() == nr_bdd_variables());
             size_t c = 0;
 
             for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
             {
-                for(size_t idx=0; idx<nr_variables(bdd_nr); ++idx)
+                for(size_t idx=0; idx<nr_variables(bdd_nr); ++idx, ++c)
                 {
+                    // low arc costs are nonzero after message passing, report high cost relative to them
+                    value_type lo_cost = std::numeric_limits<value_type>::infinity();
+                    value_type hi_cost = std::numeric_limits<value_type>::infinity();
                     const auto [first,last] = bdd_index_range(bdd_nr, idx);
                     for(size_t i=first; i<last; ++i)
                     {
                         const auto& bdd = bdd_branch_nodes_[i];
                         if(bdd.offset_low != BDD_BRANCH_NODE::terminal_0_offset)
-                            assert(bdd.low_cost == 0.0);
+                            lo_cost = std::min(lo_cost, bdd.low_cost);
                         if(bdd.offset_high != BDD_BRANCH_NODE::terminal_0_offset)
-                        {
-                            costs[c++] = bdd.high_cost;
-                            break;
-                        } 
+                            hi_cost = std::min(hi_cost, bdd.high_cost);
                     }
-
+                    costs[c] = hi_cost - (std::isfinite(lo_cost) ? lo_cost : 0.0);
                 }
             }
 
-            assert(costs.size() == nr_bdd_variables());
-
-            return costs;
+            assert(c == nr_bdd_variables());
         }
 
     template<typename BDD_BRANCH_NODE>
@@ -627,15 +1021,17 @@ namespace LPMP {
             message_passing_state_ = message_passing_state::none;
             lower_bound_state_ = lower_bound_state::invalid;
 
+            // costs of variables not covered by any bdd are not split
             auto get_lo_cost = [&](const size_t var) {
-                if(var < std::distance(cost_lo_begin, cost_lo_end) && var < nr_variables())
-                    return *(cost_lo_begin+var)/double(nr_bdds(var));
+                if(var < std::distance(cost_lo_begin, cost_lo_end))
+                    return *(cost_lo_begin+var)/double(var < nr_variables() ? std::max(nr_bdds(var), size_t(1)) : size_t(1));
                 else
                     return 0.0;
             };
+            // costs of variables not covered by any bdd are not split
             auto get_hi_cost = [&](const size_t var) {
-                if(var < std::distance(cost_hi_begin, cost_hi_end) && var < nr_variables())
-                    return *(cost_hi_begin+var)/double(nr_bdds(var));
+                if(var < std::distance(cost_hi_begin, cost_hi_end))
+                    return *(cost_hi_begin+var)/double(var < nr_variables() ? std::max(nr_bdds(var), size_t(1)) : size_t(1));
                 else
                     return 0.0;
             };
@@ -701,33 +1097,15 @@ namespace LPMP {
         }
 
     template<typename BDD_BRANCH_NODE>
-        void bdd_sequential_base<BDD_BRANCH_NODE>::update_costs(const min_marginal_type& delta)
-        {
-            message_passing_state_ = message_passing_state::none;
-            assert(delta.rows() == nr_bdd_variables());
-            assert(delta.cols() == 2);
-//#pragma omp parallel for schedule(guided,128)
-            size_t c = 0;
-            for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
-            {
-                for(size_t bdd_idx=0; bdd_idx<nr_variables(bdd_nr); ++bdd_idx, ++c)
-                {
-                    const auto [first_node, last_node] = bdd_index_range(bdd_nr, bdd_idx);
-                    for(size_t i=first_node; i<last_node; ++i)
-                    {
-                        bdd_branch_nodes_[i].low_cost += delta(c, 0);
-                        bdd_branch_nodes_[i].high_cost += delta(c, 1);
-                    }
-                }
-            }
-        }
-
-    template<typename BDD_BRANCH_NODE>
-        void bdd_sequential_base<BDD_BRANCH_NODE>::update_costs(const vector_type& delta)
+        template<typename DERIVED>
+        void bdd_sequential_base<BDD_BRANCH_NODE>::update_costs(const Eigen::MatrixBase<DERIVED>& delta)
         {
             message_passing_state_ = message_passing_state::none;
+            lower_bound_state_ = lower_bound_state::invalid;
             assert(delta.rows() == nr_bdd_variables());
-            assert(delta.cols() == 1);
+            assert(delta.cols() == 1 || delta.cols() == 2);
+            const bool update_lo = delta.cols() == 2;
+            const size_t hi_col = delta.cols() - 1;
 //#pragma omp parallel for schedule(guided,128)
             size_t c = 0;
             for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
@@ -737,7 +1115,9 @@ namespace LPMP {
                     const auto [first_node, last_node] = bdd_index_range(bdd_nr, bdd_idx);
                     for(size_t i=first_node; i<last_node; ++i)
                     {
-                        bdd_branch_nodes_[i].high_cost += delta(c, 0);
+                        if(update_lo)
+                            bdd_branch_nodes_[i].low_cost += delta(c, 0);
+                        bdd_branch_nodes_[i].high_cost += delta(c, hi_col);
                     }
                 }
             }
@@ -815,16 +1195,269 @@ namespace LPMP {
         f_ref.store(d);
     }
 
+    template<typename REAL>
+    void atomic_min(REAL& f, const REAL d) 
+    {
+        Foo::atomic_ref<REAL> f_ref{f};
+        REAL cur = f_ref.load();
+        while(d < cur && !f_ref.compare_exchange_weak(cur, d));
+    }
+
+    template<typename REAL>
+    void atomic_max(REAL& f, const REAL d) 
+    {
+        Foo::atomic_ref<REAL> f_ref{f};
+        REAL cur = f_ref.load();
+        while(d > cur && !f_ref.compare_exchange_weak(cur, d));
+    }
+
+    template<typename BDD_BRANCH_NODE>
+        void bdd_sequential_base<BDD_BRANCH_NODE>::min_marginal_agreement(std::vector<mm_agreement>& agreement, const double eps)
+        {
+            MEASURE_CUMULATIVE_FUNCTION_EXECUTION_TIME2("parallel mma min marginal agreement");
+            backward_run();
+
+            agreement.resize(nr_variables());
+            std::fill(agreement.begin(), agreement.end(), mm_agreement{});
+
+#pragma omp parallel for schedule(static,512)
+            for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+            {
+                if(removed(bdd_nr))
+                    continue;
+                const auto [first,last] = bdd_index_range(bdd_nr, 0);
+                assert(first + 1 == last);
+                bdd_branch_nodes_[first].m = 0.0;
+
+                for(size_t idx=0; idx<nr_variables(bdd_nr); ++idx)
+                {
+                    std::array<value_type,2> mm = {std::numeric_limits<value_type>::infinity(), std::numeric_limits<value_type>::infinity()};
+                    const auto [first,last] = bdd_index_range(bdd_nr, idx);
+                    for(size_t i=first; i<last; ++i)
+                    {
+                        const std::array<value_type,2> cur_mm = bdd_branch_nodes_[i].min_marginals();
+                        mm[0] = std::min(mm[0], cur_mm[0]);
+                        mm[1] = std::min(mm[1], cur_mm[1]); 
+                    }
+
+                    const double diff = double(mm[1]) - double(mm[0]);
+                    mm_agreement& a = agreement[variable(bdd_nr, idx)];
+                    atomic_min(a.min_diff, diff);
+                    atomic_max(a.max_diff, diff);
+                    atomic_add(a.sum_diff, diff);
+
+                    for(size_t i=first; i<last; ++i)
+                        bdd_branch_nodes_[i].prepare_forward_step(); 
+                    for(size_t i=first; i<last; ++i)
+                        bdd_branch_nodes_[i].forward_step();
+                }
+            }
+
+#pragma omp parallel for schedule(static,2048)
+            for(size_t var=0; var<nr_variables(); ++var)
+            {
+                agreement[var].nr_bdds = nr_bdds(var);
+                agreement[var].compute_type(eps);
+            }
+
+            message_passing_state_ = message_passing_state::after_forward_pass;
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        bool bdd_sequential_base<BDD_BRANCH_NODE>::bdd_feasible(const size_t bdd_nr, const std::vector<char>& sol) const
+        {
+            if(removed(bdd_nr))
+                return true;
+            size_t i = bdd_variables_(bdd_nr, 0).offset;
+            for(size_t idx=0; idx<nr_variables(bdd_nr); ++idx)
+            {
+                assert(bdd_index_range(bdd_nr, idx)[0] <= i && i < bdd_index_range(bdd_nr, idx)[1]);
+                const BDD_BRANCH_NODE& node = bdd_branch_nodes_[i];
+                const auto offset = sol[variable(bdd_nr, idx)] == 1 ? node.offset_high : node.offset_low;
+                if(offset == BDD_BRANCH_NODE::terminal_0_offset)
+                    return false;
+                if(offset == BDD_BRANCH_NODE::terminal_1_offset)
+                    return true;
+                i += offset;
+            }
+            assert(false);
+            return false;
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        bool bdd_sequential_base<BDD_BRANCH_NODE>::repair_bdd(const size_t bdd_nr, std::vector<char>& sol, const std::vector<size_t>& nr_changes, std::vector<path_repair_cost>& scratch, std::vector<size_t>& changed_vars) const
+        {
+            constexpr static path_repair_cost infeasible = {std::numeric_limits<size_t>::max(), std::numeric_limits<value_type>::infinity()};
+            const auto [first_bdd_node, last_bdd_node] = bdd_range(bdd_nr);
+            scratch.resize(last_bdd_node - first_bdd_node);
+
+            // weighted number of changes to current solution first, then costs
+            const auto arc_cost = [&](const size_t i, const size_t var, const char value) -> path_repair_cost {
+                const BDD_BRANCH_NODE& node = bdd_branch_nodes_[i];
+                const auto offset = value == 1 ? node.offset_high : node.offset_low;
+                if(offset == BDD_BRANCH_NODE::terminal_0_offset)
+                    return infeasible;
+                const path_repair_cost arc = {sol[var] != value ? 1 + nr_changes[var] : 0, value == 1 ? node.high_cost : node.low_cost};
+                if(offset == BDD_BRANCH_NODE::terminal_1_offset)
+                    return arc;
+                const path_repair_cost& child = scratch[i + offset - first_bdd_node];
+                if(child.nr_changes == infeasible.nr_changes)
+                    return infeasible;
+                return {arc.nr_changes + child.nr_changes, arc.cost + child.cost};
+            };
+
+            for(std::ptrdiff_t idx=nr_variables(bdd_nr)-1; idx>=0; --idx)
+            {
+                const size_t var = variable(bdd_nr, idx);
+                const auto [first,last] = bdd_index_range(bdd_nr, idx);
+                for(size_t i=first; i<last; ++i)
+                    scratch[i - first_bdd_node] = std::min(arc_cost(i, var, 0), arc_cost(i, var, 1));
+            }
+
+            if(scratch[0].nr_changes == infeasible.nr_changes)
+                return false;
+
+            changed_vars.clear();
+            size_t i = first_bdd_node;
+            for(size_t idx=0; idx<nr_variables(bdd_nr); ++idx)
+            {
+                const size_t var = variable(bdd_nr, idx);
+                const path_repair_cost lo = arc_cost(i, var, 0);
+                const path_repair_cost hi = arc_cost(i, var, 1);
+                // on ties keep current value
+                const char value = lo < hi || (!(hi < lo) && sol[var] == 0) ? 0 : 1;
+                if(sol[var] != value)
+                {
+                    sol[var] = value;
+                    changed_vars.push_back(var);
+                }
+                const auto offset = value == 1 ? bdd_branch_nodes_[i].offset_high : bdd_branch_nodes_[i].offset_low;
+                assert(offset != BDD_BRANCH_NODE::terminal_0_offset);
+                if(offset == BDD_BRANCH_NODE::terminal_1_offset)
+                    break;
+                i += offset;
+            }
+
+            assert(bdd_feasible(bdd_nr, sol));
+            return true;
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        std::vector<char> bdd_sequential_base<BDD_BRANCH_NODE>::decode_primal_solution(const size_t max_repair_steps, const bool verbose)
+        {
+            MEASURE_CUMULATIVE_FUNCTION_EXECUTION_TIME2("parallel mma primal decoding");
+            if(variable_bdds_.size() != nr_variables())
+            {
+                std::vector<size_t> bdd_counter(nr_variables(), 0);
+                variable_bdds_ = two_dim_variable_array<size_t>(nr_bdds_per_variable_.begin(), nr_bdds_per_variable_.end());
+                for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+                    for(size_t idx=0; idx<nr_variables(bdd_nr); ++idx)
+                    {
+                        const size_t var = variable(bdd_nr, idx);
+                        variable_bdds_(var, bdd_counter[var]++) = bdd_nr;
+                    }
+            }
+
+            backward_run();
+
+            // argmin path of each bdd votes for the values of its variables. Variables skipped by arcs to the top sink get no vote.
+            std::vector<std::array<uint32_t,2>> votes(nr_variables(), {0,0});
+#pragma omp parallel for schedule(static,512)
+            for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+            {
+                size_t i = bdd_variables_(bdd_nr, 0).offset;
+                for(size_t idx=0; idx<nr_variables(bdd_nr); ++idx)
+                {
+                    const BDD_BRANCH_NODE& node = bdd_branch_nodes_[i];
+                    const auto path_cost = [&](const auto offset, const value_type cost) -> value_type {
+                        if(offset == BDD_BRANCH_NODE::terminal_0_offset)
+                            return std::numeric_limits<value_type>::infinity();
+                        if(offset == BDD_BRANCH_NODE::terminal_1_offset)
+                            return cost;
+                        return cost + bdd_branch_nodes_[i + offset].m;
+                    };
+                    const char value = path_cost(node.offset_high, node.high_cost) < path_cost(node.offset_low, node.low_cost) ? 1 : 0;
+                    atomic_add(votes[variable(bdd_nr, idx)][value], uint32_t(1));
+                    const auto offset = value == 1 ? node.offset_high : node.offset_low;
+                    if(offset == BDD_BRANCH_NODE::terminal_0_offset || offset == BDD_BRANCH_NODE::terminal_1_offset)
+                        break;
+                    i += offset;
+                }
+            }
+
+            std::vector<char> sol(nr_variables());
+            for(size_t var=0; var<nr_variables(); ++var)
+                sol[var] = votes[var][1] > votes[var][0] ? 1 : 0;
+
+            std::vector<char> violated(nr_bdds(), 0);
+#pragma omp parallel for schedule(static,512)
+            for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+                violated[bdd_nr] = !bdd_feasible(bdd_nr, sol);
+
+            std::deque<size_t> queue;
+            for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+                if(violated[bdd_nr])
+                    queue.push_back(bdd_nr);
+            if(verbose)
+                std::cout << "[primal decoding] #violated bdds after voting = " << queue.size() << "\n";
+
+            // violated now holds whether bdd is in queue
+            std::vector<path_repair_cost> scratch;
+            std::vector<size_t> changed_vars;
+            std::vector<size_t> nr_changes(nr_variables(), 0);
+            size_t nr_repair_steps = 0;
+            while(!queue.empty())
+            {
+                const size_t bdd_nr = queue.front();
+                queue.pop_front();
+                violated[bdd_nr] = 0;
+                if(bdd_feasible(bdd_nr, sol))
+                    continue;
+                if(nr_repair_steps++ >= max_repair_steps)
+                {
+                    if(verbose)
+                        std::cout << "[primal decoding] no solution found within " << max_repair_steps << " repair steps\n";
+                    return {};
+                }
+                if(!repair_bdd(bdd_nr, sol, nr_changes, scratch, changed_vars))
+                {
+                    if(verbose)
+                        std::cout << "[primal decoding] bdd " << bdd_nr << " has no feasible path\n";
+                    return {};
+                }
+                for(const size_t var : changed_vars)
+                {
+                    nr_changes[var]++;
+                    for(size_t j=0; j<variable_bdds_.size(var); ++j)
+                    {
+                        const size_t other_bdd_nr = variable_bdds_(var, j);
+                        if(!violated[other_bdd_nr] && !bdd_feasible(other_bdd_nr, sol))
+                        {
+                            violated[other_bdd_nr] = 1;
+                            queue.push_back(other_bdd_nr);
+                        }
+                    }
+                }
+            }
+
+            if(verbose)
+                std::cout << "[primal decoding] found solution after " << nr_repair_steps << " repair steps\n";
+            return sol;
+        }
+
     template<typename BDD_BRANCH_NODE>
         void bdd_sequential_base<BDD_BRANCH_NODE>::forward_mm(
                 const size_t bdd_nr, const typename BDD_BRANCH_NODE::value_type omega,
                 std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_collect,
-                std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_distribute)
+                std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_distribute,
+                std::vector<value_type>* residuals)
         {
             assert(mms_to_collect.size() == nr_variables());
             assert(mms_to_distribute.size() == nr_variables());
             assert(omega > 0.0 && omega <= 1.0);
             assert(bdd_nr < nr_bdds());
+            if(removed(bdd_nr))
+                return;
 
             {
                 const auto [first_bdd_node, last_bdd_node] = bdd_index_range(bdd_nr, 0);
@@ -858,6 +1491,8 @@ namespace LPMP {
 
                 assert(mms_to_collect[var][0] >= 0.0);
                 assert(mms_to_collect[var][1] >= 0.0);
+                if(residuals != nullptr)
+                    atomic_max((*residuals)[var], mm_residual(cur_mm, mms_to_distribute[var], omega));
 
                 for(size_t i=first_bdd_node; i<last_bdd_node; ++i)
                 {
@@ -893,12 +1528,14 @@ namespace LPMP {
 
     template<typename BDD_BRANCH_NODE>
         typename BDD_BRANCH_NODE::value_type 
-        bdd_sequential_base<BDD_BRANCH_NODE>::backward_mm(const size_t bdd_nr, const typename BDD_BRANCH_NODE::value_type omega, std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_collect, std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_distribute)
+        bdd_sequential_base<BDD_BRANCH_NODE>::backward_mm(const size_t bdd_nr, const typename BDD_BRANCH_NODE::value_type omega, std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_collect, std::vector<std::array<typename BDD_BRANCH_NODE::value_type,2>>& mms_to_distribute, std::vector<value_type>* residuals)
         {
             assert(mms_to_collect.size() == nr_variables());
             assert(mms_to_distribute.size() == nr_variables());
             assert(omega > 0.0 && omega <= 1.0);
             assert(bdd_nr < nr_bdds());
+            if(removed(bdd_nr))
+                return 0.0;
 
             for(std::ptrdiff_t bdd_idx=nr_variables(bdd_nr)-1; bdd_idx>=0; --bdd_idx)
             {
@@ -927,6 +1564,8 @@ namespace LPMP {
 
                 assert(mms_to_collect[var][0] >= 0.0);
                 assert(mms_to_collect[var][1] >= 0.0);
+                if(residuals != nullptr)
+                    atomic_max((*residuals)[var], mm_residual(cur_mm, mms_to_distribute[var], omega));
 
                 for(std::ptrdiff_t i=std::ptrdiff_t(last_bdd_node)-1; i>=std::ptrdiff_t(first_bdd_node); --i)
                 {
@@ -958,10 +1597,77 @@ namespace LPMP {
             return bdd_branch_nodes_[root_bdd_node_begin].m;
         }
 
+    template<typename BDD_BRANCH_NODE>
+        std::vector<typename BDD_BRANCH_NODE::value_type> bdd_sequential_base<BDD_BRANCH_NODE>::get_costs(const size_t bdd_nr) const
+        {
+            assert(bdd_nr < nr_bdds());
+            std::vector<value_type> costs;
+            costs.reserve(nr_variables(bdd_nr));
+            for(size_t bdd_idx=0; bdd_idx<nr_variables(bdd_nr); ++bdd_idx)
+            {
+                const auto [first_bdd_node, last_bdd_node] = bdd_index_range(bdd_nr, bdd_idx);
+                value_type lo_cost = std::numeric_limits<value_type>::infinity();
+                value_type hi_cost = std::numeric_limits<value_type>::infinity();
+                for(size_t i=first_bdd_node; i<last_bdd_node; ++i)
+                {
+                    lo_cost = std::min(lo_cost, bdd_branch_nodes_[i].low_cost);
+                    hi_cost = std::min(hi_cost, bdd_branch_nodes_[i].high_cost);
+                }
+                costs.push_back(hi_cost - lo_cost); // not finite if the bdd forces a value of the variable
+            }
+            return costs;
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        template<typename COST_ITERATOR, typename VARIABLE_ITERATOR>
+        void bdd_sequential_base<BDD_BRANCH_NODE>::update_costs(const size_t bdd_nr, COST_ITERATOR cost_begin, COST_ITERATOR cost_end, VARIABLE_ITERATOR variable_begin, VARIABLE_ITERATOR variable_end)
+        {
+            assert(bdd_nr < nr_bdds());
+            assert(std::distance(cost_begin, cost_end) == std::distance(variable_begin, variable_end));
+            assert(std::is_sorted(variable_begin, variable_end));
+            message_passing_state_ = message_passing_state::none;
+            lower_bound_state_ = lower_bound_state::invalid;
+
+            auto cost_it = cost_begin;
+            auto var_it = variable_begin;
+            for(size_t bdd_idx=0; bdd_idx<nr_variables(bdd_nr) && var_it!=variable_end; ++bdd_idx)
+            {
+                if(variable(bdd_nr, bdd_idx) < *var_it)
+                    continue;
+                assert(variable(bdd_nr, bdd_idx) == *var_it);
+                assert(std::isfinite(*cost_it));
+                const auto [first_bdd_node, last_bdd_node] = bdd_index_range(bdd_nr, bdd_idx);
+                for(size_t i=first_bdd_node; i<last_bdd_node; ++i)
+                    bdd_branch_nodes_[i].high_cost += *cost_it;
+                ++var_it;
+                ++cost_it;
+            }
+            assert(var_it == variable_end);
+        }
+
     template<typename BDD_BRANCH_NODE>
         void bdd_sequential_base<BDD_BRANCH_NODE>::parallel_mma()
+        {
+            // costs changed from outside since last iteration
+            const bool restart = message_passing_state_ != message_passing_state::after_backward_pass;
+            const double prev_lb = restart ? -std::numeric_limits<double>::infinity() : lower_bound_;
+
+            if(active_set_threshold_ > 0.0)
+                parallel_mma_active_set();
+            else
+                parallel_mma_all();
+
+            if(adaptive_omega_)
+                adapt_omega(prev_lb);
+            if(momentum_ > 0.0)
+                extrapolate(restart);
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        void bdd_sequential_base<BDD_BRANCH_NODE>::parallel_mma_all()
         {
             backward_run();
+            nr_active_bdds_ = nr_bdds();
 
             auto reset_mms = [&](std::vector<std::array<value_type,2>>& mms) {
                 assert(mms.size() == nr_variables());
@@ -981,7 +1687,9 @@ namespace LPMP {
 #pragma omp parallel for
                 for(size_t var=0; var<nr_variables(); ++var)
                 {
-                    assert(nr_bdds(var) > 0);
+                    // variables of removed bdds only
+                    if(nr_bdds(var) == 0)
+                        continue;
                     mms[var][0] /= value_type(nr_bdds(var));
                     mms[var][1] /= value_type(nr_bdds(var));
                 }
@@ -996,13 +1704,13 @@ namespace LPMP {
                 MEASURE_CUMULATIVE_FUNCTION_EXECUTION_TIME2("parallel mma incremental marginal computation");
 #pragma omp parallel for schedule(static,256)
                 for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
-                    forward_mm(bdd_nr, 0.5, mms_to_collect_, mms_to_distribute_);
+                    forward_mm(bdd_nr, omega_, mms_to_collect_, mms_to_distribute_);
                 average_mms(mms_to_collect_);
                 reset_mms(mms_to_distribute_);
                 std::swap(mms_to_collect_, mms_to_distribute_);
 #pragma omp parallel for schedule(static,256) reduction(+:lb)
                 for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
-                    lb += backward_mm(bdd_nr, 0.5, mms_to_collect_, mms_to_distribute_);
+                    lb += backward_mm(bdd_nr, omega_, mms_to_collect_, mms_to_distribute_);
                 average_mms(mms_to_collect_);
                 reset_mms(mms_to_distribute_);
                 std::swap(mms_to_collect_, mms_to_distribute_);
@@ -1014,9 +1722,265 @@ namespace LPMP {
             lower_bound_state_ = lower_bound_state::valid; 
         }
 
+    // Cost difference of high and low arcs changes by the received minus the sent delta.
+    // Infinite costs are consistent if both the bdd and the received delta forbid the same value.
+    template<typename BDD_BRANCH_NODE>
+        typename BDD_BRANCH_NODE::value_type bdd_sequential_base<BDD_BRANCH_NODE>::mm_residual(const std::array<value_type,2> mm, const std::array<value_type,2> delta, const value_type omega)
+        {
+            if(std::isfinite(mm[0]) && std::isfinite(mm[1]) && std::isfinite(delta[0]) && std::isfinite(delta[1]))
+                return std::abs(delta[1] - delta[0] - omega*(mm[1] - mm[0]));
+            for(size_t l=0; l<2; ++l)
+                if(std::isfinite(mm[l]) != std::isfinite(delta[l]))
+                    return std::numeric_limits<value_type>::infinity();
+            return 0.0;
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        void bdd_sequential_base<BDD_BRANCH_NODE>::set_active_set(const value_type threshold, const size_t full_sweep_interval)
+        {
+            assert(threshold >= 0.0);
+            active_set_threshold_ = threshold;
+            full_sweep_interval_ = full_sweep_interval;
+            variable_residual_.clear();
+        }
+
+    // Between iterations mms_to_distribute_ holds deltas split among all bdds of a variable, as in parallel_mma.
+    // During an iteration they are split among the active bdds of a variable only. Deltas of variables without active bdds are kept until one is woken.
+    // Skipped bdds keep their costs and backward messages, hence their lower bound is read off their root node.
+    template<typename BDD_BRANCH_NODE>
+        void bdd_sequential_base<BDD_BRANCH_NODE>::parallel_mma_active_set()
+        {
+            const bool full_sweep = message_passing_state_ != message_passing_state::after_backward_pass
+                || variable_residual_.size() != nr_variables()
+                || iterations_since_full_sweep_ + 1 >= full_sweep_interval_;
+
+            backward_run();
+
+            if(mms_to_collect_.size() != nr_variables())
+                mms_to_collect_ = std::vector<std::array<value_type,2>>(nr_variables(), {0.0,0.0});
+            if(mms_to_distribute_.size() != nr_variables())
+                mms_to_distribute_ = std::vector<std::array<value_type,2>>(nr_variables(), {0.0,0.0});
+
+            {
+                MEASURE_CUMULATIVE_FUNCTION_EXECUTION_TIME2("parallel mma active set selection");
+                bdd_active_.resize(nr_bdds());
+                variable_residual_.resize(nr_variables(), 0.0);
+#pragma omp parallel for schedule(static,256)
+                for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+                {
+                    bdd_active_[bdd_nr] = false;
+                    if(removed(bdd_nr))
+                        continue;
+                    for(size_t bdd_idx=0; bdd_idx<nr_variables(bdd_nr); ++bdd_idx)
+                        if(full_sweep || variable_residual_[variable(bdd_nr, bdd_idx)] > active_set_threshold_)
+                        {
+                            bdd_active_[bdd_nr] = true;
+                            break;
+                        }
+                }
+
+                active_bdds_.clear();
+                nr_active_bdds_per_variable_.assign(nr_variables(), 0);
+                for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+                {
+                    if(!bdd_active_[bdd_nr])
+                        continue;
+                    active_bdds_.push_back(bdd_nr);
+                    for(size_t bdd_idx=0; bdd_idx<nr_variables(bdd_nr); ++bdd_idx)
+                        nr_active_bdds_per_variable_[variable(bdd_nr, bdd_idx)]++;
+                }
+                nr_active_bdds_ = active_bdds_.size();
+                iterations_since_full_sweep_ = full_sweep ? 0 : iterations_since_full_sweep_ + 1;
+            }
+
+            // split pending deltas among active bdds
+#pragma omp parallel for
+            for(size_t var=0; var<nr_variables(); ++var)
+            {
+                variable_residual_[var] = 0.0;
+                const size_t n = nr_active_bdds_per_variable_[var];
+                if(n == 0 || n == nr_bdds(var))
+                    continue;
+                mms_to_distribute_[var][0] *= value_type(nr_bdds(var)) / value_type(n);
+                mms_to_distribute_[var][1] *= value_type(nr_bdds(var)) / value_type(n);
+            }
+
+            auto average_mms = [&]() {
+                MEASURE_CUMULATIVE_FUNCTION_EXECUTION_TIME2("parallel mma marginal averaging");
+#pragma omp parallel for
+                for(size_t var=0; var<nr_variables(); ++var)
+                {
+                    const size_t n = nr_active_bdds_per_variable_[var];
+                    if(n == 0)
+                        mms_to_collect_[var] = mms_to_distribute_[var];
+                    else
+                    {
+                        mms_to_collect_[var][0] /= value_type(n);
+                        mms_to_collect_[var][1] /= value_type(n);
+                    }
+                    mms_to_distribute_[var] = {0.0, 0.0};
+                }
+                std::swap(mms_to_collect_, mms_to_distribute_);
+            };
+
+            {
+                MEASURE_CUMULATIVE_FUNCTION_EXECUTION_TIME2("parallel mma incremental marginal computation");
+#pragma omp parallel for schedule(static,256)
+                for(size_t i=0; i<active_bdds_.size(); ++i)
+                    forward_mm(active_bdds_[i], omega_, mms_to_collect_, mms_to_distribute_, &variable_residual_);
+                average_mms();
+#pragma omp parallel for schedule(static,256)
+                for(size_t i=0; i<active_bdds_.size(); ++i)
+                    backward_mm(active_bdds_[i], omega_, mms_to_collect_, mms_to_distribute_, &variable_residual_);
+                average_mms();
+            }
+
+            // split pending deltas among all bdds again
+#pragma omp parallel for
+            for(size_t var=0; var<nr_variables(); ++var)
+            {
+                const size_t n = nr_active_bdds_per_variable_[var];
+                if(n == 0 || n == nr_bdds(var))
+                    continue;
+                mms_to_distribute_[var][0] *= value_type(n) / value_type(nr_bdds(var));
+                mms_to_distribute_[var][1] *= value_type(n) / value_type(nr_bdds(var));
+            }
+
+            double lb = constant_;
+#pragma omp parallel for schedule(static,256) reduction(+:lb)
+            for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+            {
+                if(removed(bdd_nr))
+                    continue;
+                const auto [root_bdd_node_begin, root_bdd_node_end] = bdd_index_range(bdd_nr, 0);
+                assert(root_bdd_node_begin+1 == root_bdd_node_end);
+                lb += bdd_branch_nodes_[root_bdd_node_begin].m;
+            }
+            lower_bound_ = lb;
+
+            message_passing_state_ = message_passing_state::after_backward_pass;
+            lower_bound_state_ = lower_bound_state::valid; 
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        void bdd_sequential_base<BDD_BRANCH_NODE>::set_omega(const value_type omega, const bool adaptive, const value_type omega_min, const value_type omega_max)
+        {
+            if(!(omega_min > 0.0 && omega_min <= omega_max && omega_max <= 1.0))
+                throw std::runtime_error("omega bounds must satisfy 0 < omega_min <= omega_max <= 1");
+            if(!(omega > 0.0 && omega <= 1.0))
+                throw std::runtime_error("omega must be in (0,1]");
+            omega_ = adaptive ? std::clamp(omega, omega_min, omega_max) : omega;
+            adaptive_omega_ = adaptive;
+            omega_min_ = omega_min;
+            omega_max_ = omega_max;
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        void bdd_sequential_base<BDD_BRANCH_NODE>::set_momentum(const value_type momentum, const size_t interval)
+        {
+            if(momentum < 0.0)
+                throw std::runtime_error("momentum must be nonnegative");
+            if(interval == 0)
+                throw std::runtime_error("momentum interval must be positive");
+            momentum_ = momentum;
+            momentum_interval_ = interval;
+            iterations_since_extrapolation_ = 0;
+            prev_costs_.clear();
+            cur_costs_.clear();
+        }
+
+    // Larger omega speeds up propagation of min-marginals, but lets them oscillate when too large.
+    // Omega grows while lower bound gains do not slow down, shrinks slowly when they do and fast when the lower bound decreases.
+    template<typename BDD_BRANCH_NODE>
+        void bdd_sequential_base<BDD_BRANCH_NODE>::adapt_omega(const double prev_lb)
+        {
+            if(!std::isfinite(prev_lb))
+            {
+                prev_lb_gain_ = 0.0;
+                return;
+            }
+            const double gain = lower_bound_ - prev_lb;
+            if(gain < 0.0)
+                omega_ = std::max(omega_min_, value_type(0.5) * omega_);
+            else if(gain >= 0.9 * prev_lb_gain_)
+                omega_ = std::min(omega_max_, value_type(1.05) * omega_);
+            else
+                omega_ = std::max(omega_min_, value_type(0.98) * omega_);
+            prev_lb_gain_ = gain;
+        }
+
+    template<typename BDD_BRANCH_NODE>
+        void bdd_sequential_base<BDD_BRANCH_NODE>::extrapolate(const bool restart)
+        {
+            MEASURE_CUMULATIVE_FUNCTION_EXECUTION_TIME2("parallel mma extrapolation");
+            // the reparametrization of the last extrapolation is not comparable after changes from outside
+            const bool new_reference = restart || prev_costs_.size() != bdd_branch_nodes_.size();
+            if(!new_reference && ++iterations_since_extrapolation_ < momentum_interval_)
+                return;
+            iterations_since_extrapolation_ = 0;
+
+            const double lb = lower_bound_;
+            distribute_delta();
+
+            cur_costs_.resize(bdd_branch_nodes_.size());
+#pragma omp parallel for schedule(static,1024)
+            for(size_t i=0; i<bdd_branch_nodes_.size(); ++i)
+                cur_costs_[i] = {bdd_branch_nodes_[i].low_cost, bdd_branch_nodes_[i].high_cost};
+
+            if(new_reference)
+            {
+                std::swap(prev_costs_, cur_costs_);
+                backward_run();
+                lower_bound_ = std::max(lb, compute_lower_bound_after_backward_pass());
+                lower_bound_state_ = lower_bound_state::valid;
+                return;
+            }
+
+            // affine combination of two reparametrizations is again one. Infinite costs are left untouched
+            auto extrapolate_cost = [&](const value_type cur, const value_type prev) {
+                if(!std::isfinite(cur) || !std::isfinite(prev))
+                    return cur;
+                return cur + momentum_ * (cur - prev);
+            };
+#pragma omp parallel for schedule(static,1024)
+            for(size_t i=0; i<bdd_branch_nodes_.size(); ++i)
+            {
+                bdd_branch_nodes_[i].low_cost = extrapolate_cost(cur_costs_[i][0], prev_costs_[i][0]);
+                bdd_branch_nodes_[i].high_cost = extrapolate_cost(cur_costs_[i][1], prev_costs_[i][1]);
+            }
+            backward_run();
+            const double extrapolated_lb = compute_lower_bound_after_backward_pass();
+
+            if(extrapolated_lb >= lb)
+            {
+                lower_bound_ = extrapolated_lb;
+                std::swap(prev_costs_, cur_costs_);
+                // residuals of skipped bdds are outdated
+                variable_residual_.clear();
+            }
+            else
+            {
+                nr_rejected_extrapolations_++;
+                for(size_t i=0; i<bdd_branch_nodes_.size(); ++i)
+                {
+                    bdd_branch_nodes_[i].low_cost = cur_costs_[i][0];
+                    bdd_branch_nodes_[i].high_cost = cur_costs_[i][1];
+                }
+                // restart momentum from current reparametrization
+                std::swap(prev_costs_, cur_costs_);
+                message_passing_state_ = message_passing_state::none;
+                backward_run();
+                lower_bound_ = std::max(lb, compute_lower_bound_after_backward_pass());
+            }
+            lower_bound_state_ = lower_bound_state::valid;
+        }
+
     template<typename BDD_BRANCH_NODE>
         void bdd_sequential_base<BDD_BRANCH_NODE>::distribute_delta()
         {
+            // no parallel_mma iteration yet, hence nothing to distribute
+            if(mms_to_distribute_.size() == 0)
+                return;
             message_passing_state_ = message_passing_state::none;
             lower_bound_state_ = lower_bound_state::invalid; 
 
@@ -9,6 +9,8 @@
 #include "bdd_cuda.h"
 #include "bdd_parallel_mma.h"
 #include "bdd_fix.h"
+#include "bdd_dive.h"
+#include "primal_local_search.h"
 #include "incremental_mm_agreement_rounding.hxx"
 #include <variant> 
 #include <optional>
@@ -42,26 +44,53 @@ namespace LPMP {
         double time_limit = 3600;
         //////////////////////////
 
+        // anytime primal solutions during dual optimization //
+        size_t anytime_primal_iterations = 0; // run cheap primal heuristic every so many iterations, 0 = never
+        double anytime_primal_time = 0.0; // run cheap primal heuristic every so many seconds, 0 = never
+        double gap_tolerance = 0.0; // stop when relative gap between best primal solution and lower bound is below
+        ///////////////////////////////////////////////////////
+
         enum class bdd_solver_impl { sequential_mma, decomposition_mma, mma_cuda, parallel_mma } bdd_solver_impl_;
         enum class bdd_solver_precision { single_prec, double_prec } bdd_solver_precision_ = bdd_solver_precision::single_prec;
         decomposition_mma_options decomposition_mma_options_;
+        size_t sequential_mma_nr_threads = 1; // wavefront parallelization of sequential mma sweeps
+        double parallel_mma_active_set_threshold = 0.0; // skip bdds of parallel mma whose variables have settled up to this residual, 0 = process all bdds
+        double parallel_mma_omega = 0.5;
+        bool parallel_mma_adaptive_omega = false;
+        double parallel_mma_momentum = 0.0; // extrapolation of reparametrization, 0 = off
+        size_t parallel_mma_momentum_interval = 3; // parallel mma iterations between extrapolations
         bool solution_statistics = false;
 
         bool tighten = false;
+        size_t tighten_max_rounds = 10; // tighten whenever lower bound progress stalls, at most so many times
+        tightening_options tightening_options_;
 
         bool incremental_primal_rounding = false;
         double incremental_initial_perturbation = std::numeric_limits<double>::infinity();
         double incremental_growth_rate = 1.2;
         int incremental_primal_num_itr_lb = 500;
 
+        bool decoding_primal_rounding = false;
         bool diving_primal_rounding = false;
         bdd_fix_options fixing_options_;
 
+        bool local_search = false;
+        primal_local_search_options local_search_options_;
+
         bool statistics = false;
         std::string export_bdd_lp_file = "";
         std::string export_bdd_graph_file = "";
 
+        // warm start from and save reparametrized costs, see bdd_dual_state.h
+        std::string import_dual_state_file = "";
+        std::string export_dual_state_file = "";
+
         bool constraint_groups = true; // allow constraint groups to be formed e.g. from indicators in the input lp files
+
+        // merge overlapping bdds before constructing the solver, see bdd_preprocessor::coalesce
+        bool coalesce = false;
+        std::vector<std::string> coalesce_heuristics;
+        coalesce_options coalesce_options_;
     };
 
     class bdd_solver {
@@ -73,8 +102,11 @@ namespace LPMP {
 
             void solve();
             void round();
-            void tighten();
+            tightening_statistics tighten();
             double lower_bound();
+            // objective and solution of best primal solution found during anytime optimization
+            double upper_bound() const { return upper_bound_; }
+            const std::vector<char>& incumbent() const { return incumbent_; }
             void fix_variable(const size_t var, const bool value);
             void fix_variable(const std::string& var, const bool value);
             two_dim_variable_array<std::array<double,2>> min_marginals();
@@ -84,12 +116,21 @@ namespace LPMP {
             //bdd_preprocessor preprocess(ILP_input& ilp);
             bdd_storage transfer_to_bdd_storage(bdd_preprocessor& bp);
             void construct_solver(bdd_storage& bs);
+            // primal solution from the current dual state without changing it substantially
+            std::vector<char> cheap_primal_solution();
+            // returns whether dual optimization should continue
+            bool anytime_primal(const size_t iter, const double lb, const double time_spent, double& last_primal_time);
+            void import_dual_state(const std::string& filename);
+            void export_dual_state(const std::string& filename);
 
             bdd_solver_options options;
             using solver_type = std::variant<bdd_mma_vec<float>, bdd_mma_vec<double>, decomposition_bdd_mma, bdd_cuda<float>, bdd_cuda<double>, bdd_parallel_mma<float>, bdd_parallel_mma<double>>;
             std::optional<solver_type> solver;
             std::vector<double> costs;
-            std::optional<bdd_fix> primal_heuristic;
+            std::optional<bdd_dive> primal_heuristic;
+            std::optional<primal_local_search> local_search;
+            std::vector<char> incumbent_;
+            double upper_bound_ = std::numeric_limits<double>::infinity();
     };
 
 }
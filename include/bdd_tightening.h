@@ -3,8 +3,14 @@
 #include "bdd_manager/bdd.h"
 #include "bdd_collection/bdd_collection.h"
 #include "union_find.hxx"
+#include "two_dimensional_variable_array.hxx"
 #include "min_marginal_utils.h"
 #include <unordered_set>
+#include <unordered_map>
+#include <set>
+#include <numeric>
+#include <algorithm>
+#include <limits>
 #include <fstream> // TODO: remove
 
 namespace LPMP {
@@ -76,7 +82,7 @@ namespace LPMP {
         not_set 
     };
 
-    std::vector<variable_fixation> variable_fixations(const std::vector<float>& min_marg_diffs, const float eps)
+    inline std::vector<variable_fixation> variable_fixations(const std::vector<float>& min_marg_diffs, const float eps)
     {
         // compute variables to relax
         std::vector<variable_fixation> var_fixes;
@@ -165,110 +171,184 @@ namespace LPMP {
             return {bdd_col, bdd_col_nrs, bdd_variables, solver_bdd_nrs};
         }
 
+    struct tightening_options {
+        size_t max_variables = 100; // nr of variables with inconsistent or tied min-marginals targeted per round
+        size_t max_bdds_per_group = 8; // max nr of bdds covering a targeted variable that are intersected
+        size_t node_limit = 10000; // intersections exceeding this nr of nodes are discarded
+        double eps = 1e-6;
+    };
+
+    struct tightening_statistics {
+        size_t nr_inconsistent_variables = 0;
+        size_t nr_groups = 0;
+        size_t nr_new_bdds = 0;
+        size_t nr_existing_intersections = 0; // intersection coincided with a group member, costs of the others are moved onto it
+        size_t nr_exceeded_node_limit = 0;
+        size_t nr_intersection_nodes = 0; // of all intersections within the node limit
+    };
+
+    // intersect the bdds covering variables with inconsistent or tied min-marginals and add the intersections to the solver.
+    // Costs of the intersected bdds are moved to their intersection, hence the lower bound cannot decrease.
+    // Intersections are computed in parallel, each thread with its own bdd manager.
     template<typename BDD_SOLVER>
-        void tighten(BDD_SOLVER& s, float eps)
+        tightening_statistics tighten(BDD_SOLVER& s, const tightening_options& opt)
         {
-            assert(eps > 0.0);
-            eps = 1e-6;
-            BDD::bdd_collection bdd_col;
-            BDD::bdd_mgr bdd_mgr;
+            assert(opt.max_bdds_per_group >= 2);
+            tightening_statistics stats;
+
+            std::vector<mm_agreement> agreement;
+            s.min_marginal_agreement(agreement, opt.eps);
+
+            // Variables on which bdds disagree or are all indifferent indicate a fractional solution of the relaxation.
+            // Target most disagreeing variables first.
+            std::vector<size_t> inconsistent_vars;
+            for(size_t v=0; v<agreement.size(); ++v)
+                if(agreement[v].type == mm_type::inconsistent || agreement[v].type == mm_type::equal)
+                    inconsistent_vars.push_back(v);
+            stats.nr_inconsistent_variables = inconsistent_vars.size();
+            std::stable_sort(inconsistent_vars.begin(), inconsistent_vars.end(), [&](const size_t v, const size_t w) {
+                    return agreement[v].max_diff - agreement[v].min_diff > agreement[w].max_diff - agreement[w].min_diff;
+                    });
+            if(inconsistent_vars.size() > opt.max_variables)
+                inconsistent_vars.resize(opt.max_variables);
+
+            std::vector<char> targeted(agreement.size(), false);
+            for(const size_t v : inconsistent_vars)
+                targeted[v] = true;
+            std::vector<std::vector<size_t>> var_bdds(agreement.size());
+            for(size_t bdd_nr=0; bdd_nr<s.nr_bdds(); ++bdd_nr)
+                for(const size_t v : s.variables(bdd_nr))
+                    if(targeted[v] && var_bdds[v].size() < opt.max_bdds_per_group)
+                        var_bdds[v].push_back(bdd_nr);
 
-            // first get min-marginals for each BDD and each variable.
-            const two_dim_variable_array<std::array<float,2>> min_marginals = s.min_marginals();
-            const std::vector<float> min_marg_diffs = min_marginal_differences(min_marginals, eps);
-            const std::vector<variable_fixation> fixed_vars = variable_fixations(min_marg_diffs, eps);
+            std::vector<std::vector<size_t>> groups;
+            {
+                std::set<std::vector<size_t>> unique_groups;
+                for(const size_t v : inconsistent_vars)
+                    if(var_bdds[v].size() >= 2 && unique_groups.insert(var_bdds[v]).second)
+                        groups.push_back(var_bdds[v]);
+            }
+            stats.nr_groups = groups.size();
+            if(groups.size() == 0)
+                return stats;
 
-            //std::cout << "# positive vars = " << positive_vars.size() << ", # negative vars = " << negative_vars.size() << ", # remaining vars = " << s.nr_variables() - positive_vars.size() - negative_vars.size() << "\n";
+            BDD::bdd_collection bdd_col;
+            std::unordered_map<size_t,size_t> solver_to_col_bdd_nr;
+            size_t max_var = 0;
+            for(const auto& group : groups)
+                for(const size_t bdd_nr : group)
+                    if(solver_to_col_bdd_nr.count(bdd_nr) == 0)
+                    {
+                        const size_t col_bdd_nr = s.export_bdd(bdd_col, bdd_nr);
+                        solver_to_col_bdd_nr.insert({bdd_nr, col_bdd_nr});
+                        max_var = std::max(max_var, bdd_col.min_max_variables(col_bdd_nr)[1]);
+                    }
 
-            // get all BDDs that cover at least one variable with small min-marginal difference. Weaken them with the other variables.
-            std::vector<size_t> solver_bdd_nrs; // affected BDDs from solver
-            std::vector<BDD::node_ref> bdds; // exported and converted BDDs from solver
-            std::vector<size_t> bdd_col_nrs; // bdd numbers from bdd_collection
-            two_dim_variable_array<float> bdd_costs;
-            two_dim_variable_array<size_t> bdd_variables;
-            std::cout << "# bdds in solver = " << s.nr_bdds() << "\n";
-            for(size_t bdd_nr=0; bdd_nr<s.nr_bdds(); ++bdd_nr)
+            std::vector<BDD::bdd_collection> intersections(groups.size());
+            constexpr size_t no_member = std::numeric_limits<size_t>::max();
+            std::vector<size_t> intersection_member(groups.size(), no_member);
+            size_t nr_exceeded_node_limit = 0;
+            size_t nr_intersection_nodes = 0;
+            bool infeasible = false;
+#pragma omp parallel
             {
-                const auto vars = s.variables(bdd_nr);
-                for(const size_t v : vars)
+                BDD::bdd_mgr bdd_mgr;
+                for(size_t i=0; i<=max_var; ++i)
+                    bdd_mgr.add_variable();
+#pragma omp for schedule(dynamic) reduction(+:nr_exceeded_node_limit,nr_intersection_nodes) reduction(||:infeasible)
+                for(size_t g=0; g<groups.size(); ++g)
                 {
-                    if(std::abs(min_marg_diffs[v]) <= eps)
+                    std::vector<BDD::node_ref> members;
+                    for(const size_t bdd_nr : groups[g])
+                        members.push_back(bdd_col.export_bdd(bdd_mgr, solver_to_col_bdd_nr.find(bdd_nr)->second));
+                    BDD::node_ref intersect = members[0];
+                    size_t nr_nodes = 0;
+                    for(size_t j=1; j<members.size() && intersect.address() != nullptr; ++j)
+                        std::tie(intersect, nr_nodes) = bdd_mgr.and_rec_limited(intersect, members[j], opt.node_limit);
+                    // bdds are canonical within one manager, so an intersection coinciding with a member needs not be added again
+                    const size_t member = std::distance(members.begin(), std::find(members.begin(), members.end(), intersect));
+                    nr_intersection_nodes += intersect.address() != nullptr ? nr_nodes : 0;
+                    if(intersect.address() == nullptr)
+                        ++nr_exceeded_node_limit;
+                    else if(intersect.is_botsink())
+                        infeasible = true;
+                    else if(member < members.size())
+                        intersection_member[g] = member;
+                    else if(!intersect.is_topsink())
                     {
-                        solver_bdd_nrs.push_back(bdd_nr);
-
-                        auto [bdd, bdd_vars] = s.export_bdd(bdd_mgr, bdd_nr);
-                        bdds.push_back(bdd);
-                        bdd_col_nrs.push_back(bdd_col.add_bdd(bdds.back()));
-                        bdd_col.rebase(bdd_col_nrs.back(), bdd_vars.begin(), bdd_vars.end());
-                        std::unordered_set<size_t> positive_vars;
-                        std::unordered_set<size_t> negative_vars;
-                        for(const auto i : bdd_vars)
-                        {
-                            if(fixed_vars[i] == variable_fixation::one)
-                                positive_vars.insert(i);
-                            else if(fixed_vars[i] == variable_fixation::zero)
-                                negative_vars.insert(i);
-                        }
-
-                        bdd_col_nrs.back() = bdd_col.bdd_or_var(bdd_col_nrs.back(), positive_vars, negative_vars);
-                        if(bdd_col.nr_bdd_nodes(bdd_col_nrs.back()) <= 2)
-                        {
-                            bdds.resize(bdds.size()-1);
-                            bdd_col_nrs.resize(bdd_col_nrs.size()-1);
-                            break;
-                        }
-
-                        const auto costs = s.get_costs(bdd_nr);
-                        bdd_costs.push_back(costs.begin(), costs.end()); 
-
-                        bdd_variables.push_back(vars.begin(), vars.end());
-                        break;
+                        BDD::bdd_collection tmp_bdd_col;
+                        const size_t bdd_nr = tmp_bdd_col.add_bdd(intersect);
+                        tmp_bdd_col.make_qbdd(bdd_nr, intersections[g]);
                     }
                 }
             }
-            //std::cout << "# bdds to investigate for tightening = " << bdd_nrs.size() << "\n";
-            std::cout << "# bdds used in tightening = " << bdds.size() << "\n";
-
-            const auto [bdd_group_idx, bdd_group_nrs] = bdd_groups(bdd_col, bdd_col_nrs.begin(), bdd_col_nrs.end());
-
-            //assert(bdd_group_idx.size() <= s.nr_variables() - positive_vars.size() - negative_vars.size());
-
-            std::vector<size_t> intersect_bdd_nrs;
-            for(size_t g=0; g<bdd_group_nrs.size(); ++g)
-            {
-                std::cout << "intersected bdd group " << g;
-                std::cout << ", has " << bdd_group_nrs.size(g) << " bdds";
-                std::cout << std::flush;
-                intersect_bdd_nrs.push_back(bdd_col.bdd_and(bdd_group_nrs[g].begin(), bdd_group_nrs[g].end()));
-                std::cout << ", resulting bdd has " << bdd_col.nr_bdd_nodes(intersect_bdd_nrs.back()) << " nodes\n";
-                intersect_bdd_nrs.back() = bdd_col.make_qbdd(intersect_bdd_nrs.back()); 
-                assert(bdd_col.fixed_variables(intersect_bdd_nrs.back())[0].size() == 0);
-                assert(bdd_col.fixed_variables(intersect_bdd_nrs.back())[1].size() == 0);
-            }
-
-            const auto new_solver_bdd_nrs = s.add_bdds(bdd_col, intersect_bdd_nrs.begin(), intersect_bdd_nrs.end());
-            //assert(new_solver_bdd_nrs.size() == 1);
 
-            // put costs of affected BDDs into costs of new BDD
-            for(size_t g=0; g<bdd_group_idx.size(); ++g)
+            if(infeasible)
+                throw std::runtime_error("problem is infeasible");
+            stats.nr_exceeded_node_limit = nr_exceeded_node_limit;
+            stats.nr_intersection_nodes = nr_intersection_nodes;
+
+            BDD::bdd_collection new_bdd_col;
+            std::vector<size_t> new_bdd_groups;
+            // different groups may yield the same intersection, add it only once
+            auto same_bdd = [&](const size_t g, const size_t h) {
+                const auto [g_begin, g_end] = intersections[g].get_bdd_instructions(0);
+                const auto [h_begin, h_end] = intersections[h].get_bdd_instructions(0);
+                return std::equal(g_begin, g_end, h_begin, h_end);
+            };
+            for(size_t g=0; g<groups.size(); ++g)
+                if(intersections[g].nr_bdds() > 0)
+                {
+                    assert(intersections[g].nr_bdds() == 1);
+                    if(std::any_of(new_bdd_groups.begin(), new_bdd_groups.end(), [&](const size_t h) { return same_bdd(g, h); }))
+                        continue;
+                    new_bdd_col.append(intersections[g]);
+                    new_bdd_groups.push_back(g);
+                }
+            std::vector<size_t> new_bdd_col_nrs(new_bdd_col.nr_bdds());
+            std::iota(new_bdd_col_nrs.begin(), new_bdd_col_nrs.end(), 0);
+            const std::vector<size_t> new_solver_bdd_nrs = s.add_bdds(new_bdd_col, new_bdd_col_nrs.begin(), new_bdd_col_nrs.end());
+            assert(new_solver_bdd_nrs.size() == new_bdd_groups.size());
+            stats.nr_new_bdds = new_solver_bdd_nrs.size();
+
+            // move costs of intersected bdds into their intersection.
+            // A bdd contained in several groups hands its costs to the first intersection only.
+            std::vector<std::array<size_t,2>> cost_transfers; // (group, receiving bdd)
+            for(size_t i=0; i<new_bdd_groups.size(); ++i)
+                cost_transfers.push_back({new_bdd_groups[i], new_solver_bdd_nrs[i]});
+            for(size_t g=0; g<groups.size(); ++g)
+                if(intersection_member[g] != no_member)
+                    cost_transfers.push_back({g, groups[g][intersection_member[g]]});
+            stats.nr_existing_intersections = cost_transfers.size() - new_bdd_groups.size();
+
+            for(const auto [g, receiving_bdd_nr] : cost_transfers)
             {
-                const size_t solver_intersect_bdd_nr = new_solver_bdd_nrs[g];
-                for(size_t idx=0; idx<bdd_group_idx.size(g); ++idx)
+                // variables not in the support of the receiving bdd keep their costs
+                const auto receiving_vars = s.variables(receiving_bdd_nr);
+                for(const size_t bdd_nr : groups[g])
                 {
-                    const size_t solver_bdd_nr = solver_bdd_nrs[bdd_group_idx(g,idx)];
-                    auto costs = s.get_costs(solver_bdd_nr);
-                    const auto vars = s.variables(solver_bdd_nr);
-                    s.update_costs(solver_intersect_bdd_nr,
-                            costs.begin(), costs.end(),
-                            vars.begin(), vars.end());
-
+                    if(bdd_nr == receiving_bdd_nr)
+                        continue;
+                    const auto bdd_costs = s.get_costs(bdd_nr);
+                    const auto bdd_vars = s.variables(bdd_nr);
+                    std::vector<size_t> vars;
+                    std::vector<typename decltype(bdd_costs)::value_type> costs;
+                    for(size_t j=0; j<bdd_vars.size(); ++j)
+                        if(std::binary_search(receiving_vars.begin(), receiving_vars.end(), bdd_vars[j]))
+                        {
+                            vars.push_back(bdd_vars[j]);
+                            costs.push_back(std::isfinite(bdd_costs[j]) ? bdd_costs[j] : 0.0);
+                        }
+                    s.update_costs(receiving_bdd_nr, costs.begin(), costs.end(), vars.begin(), vars.end());
                     for(auto& x : costs)
                         x *= -1.0;
-                    s.update_costs(solver_bdd_nr,
-                            costs.begin(), costs.end(),
-                            vars.begin(), vars.end()); 
-                } 
+                    s.update_costs(bdd_nr, costs.begin(), costs.end(), vars.begin(), vars.end());
+                }
             }
+            if(cost_transfers.size() > 0)
+                s.backward_run();
+
+            return stats;
         }
 
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "bdd_manager/bdd.h"
+#include "bdd_collection/bdd_collection.h"
 #include "ILP_input.h"
 #include "hash_helper.hxx"
 #include <tsl/robin_map.h>
@@ -15,7 +16,8 @@ namespace LPMP {
 
     class bdd_converter {
         public:
-            bdd_converter(BDD::bdd_mgr& bdd_mgr) : bdd_mgr_(bdd_mgr) 
+            // cached qbdds are dropped once they hold more than max_qbdd_cache_nodes nodes
+            bdd_converter(BDD::bdd_mgr& bdd_mgr, const size_t max_qbdd_cache_nodes = 1 << 20) : bdd_mgr_(bdd_mgr), max_qbdd_cache_nodes_(max_qbdd_cache_nodes)
             {
                 bdd_ = lineq_bdd();
             }
@@ -24,6 +26,11 @@ namespace LPMP {
                 BDD::node_ref convert_to_bdd(LEFT_HAND_SIDE_ITERATOR begin, LEFT_HAND_SIDE_ITERATOR end, const ILP_input::inequality_type ineq_type, const int right_hand_side);
 
             BDD::node_ref convert_to_bdd(const std::vector<int> coefficients, const ILP_input::inequality_type ineq_type, const int right_hand_side);
+
+            // Append reordered quasi-reduced bdd of constraint directly to bdd_col, the i-th coefficient belonging to variable *(var_begin+i). Variables must be increasing.
+            // Return bdd number or BDD::bdd_instruction::topsink_index (botsink_index) if constraint is always (never) satisfied.
+            template<typename LEFT_HAND_SIDE_ITERATOR, typename VARIABLE_ITERATOR>
+                size_t convert_to_qbdd(LEFT_HAND_SIDE_ITERATOR begin, LEFT_HAND_SIDE_ITERATOR end, const ILP_input::inequality_type ineq_type, const int right_hand_side, VARIABLE_ITERATOR var_begin, BDD::bdd_collection& bdd_col);
             
             const lineq_bdd& get_lineq_bdd() const { return bdd_; }
             lineq_bdd& get_lineq_bdd() { return bdd_; }
@@ -37,6 +44,14 @@ namespace LPMP {
             constraint_cache_type equality_cache;
             constraint_cache_type lower_equal_cache;
 
+            // qbdds on variables 0,1,... of constraints in normal form, or sink indices
+            size_t max_qbdd_cache_nodes_;
+            BDD::bdd_collection qbdd_cache;
+            using qbdd_cache_type = tsl::robin_map<std::vector<int>,size_t>;
+            qbdd_cache_type equality_qbdd_cache;
+            qbdd_cache_type lower_equal_qbdd_cache;
+            std::vector<BDD::bdd_instruction> qbdd_instructions;
+
             lineq_bdd bdd_;
     };
 
@@ -91,4 +106,62 @@ namespace LPMP {
 
             return bdd_ref;
         }
+
+    template<typename LEFT_HAND_SIDE_ITERATOR, typename VARIABLE_ITERATOR>
+        size_t bdd_converter::convert_to_qbdd(LEFT_HAND_SIDE_ITERATOR begin, LEFT_HAND_SIDE_ITERATOR end, const ILP_input::inequality_type ineq, const int right_hand_side, VARIABLE_ITERATOR var_begin, BDD::bdd_collection& bdd_col)
+        {
+            assert(std::is_sorted(var_begin, var_begin + std::distance(begin, end)));
+            auto [nf, ineq_type] = bdd_.normal_form(begin, end, ineq, right_hand_side);
+
+            qbdd_cache_type& cache = [&]() -> qbdd_cache_type& {
+                switch(ineq_type) {
+                    case ILP_input::inequality_type::equal: 
+                        return equality_qbdd_cache;
+                    case ILP_input::inequality_type::smaller_equal:
+                        return lower_equal_qbdd_cache;
+                    case ILP_input::inequality_type::greater_equal:
+                        throw std::runtime_error("greater equal constraint not in normal form");
+                    default:
+                        throw std::runtime_error("inequality type not supported");
+                }
+            }();
+
+            // build qbdd on local variables unless constraint was seen before
+            auto cached = cache.find(nf);
+            const size_t cache_nr = [&]() {
+                if(cached != cache.end())
+                    return cached->second;
+                if(qbdd_cache.nr_bdd_nodes() > max_qbdd_cache_nodes_)
+                {
+                    qbdd_cache = BDD::bdd_collection();
+                    equality_qbdd_cache.clear();
+                    lower_equal_qbdd_cache.clear();
+                }
+                bdd_.build_from_inequality(nf, ineq_type);
+                const size_t nr = bdd_.is_topsink() ? BDD::bdd_instruction::topsink_index
+                    : bdd_.is_botsink() ? BDD::bdd_instruction::botsink_index
+                    : bdd_.convert_to_qbdd(qbdd_cache);
+                cache.insert(std::make_pair(nf, nr));
+                return nr;
+            }();
+            if(cache_nr == BDD::bdd_instruction::topsink_index || cache_nr == BDD::bdd_instruction::botsink_index)
+                return cache_nr;
+
+            // copy with variables of constraint
+            qbdd_instructions.clear();
+            const size_t offset = qbdd_cache.offset(cache_nr);
+            const auto [instr_begin, instr_end] = qbdd_cache.get_bdd_instructions(cache_nr);
+            for(auto it = instr_begin; it != instr_end; ++it)
+            {
+                BDD::bdd_instruction instr = *it;
+                if(!instr.is_terminal())
+                {
+                    instr.lo -= offset;
+                    instr.hi -= offset;
+                    instr.index = *(var_begin + instr.index);
+                }
+                qbdd_instructions.push_back(instr);
+            }
+            return bdd_col.add_bdd_instructions(qbdd_instructions.begin(), qbdd_instructions.end());
+        }
 }
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <memory>
-#include "bdd_mma.h"
+#include <cassert>
+#include "bdd_collection/bdd_collection.h"
+#include "two_dimensional_variable_array.hxx"
 
 namespace LPMP {
 
@@ -10,19 +12,21 @@ namespace LPMP {
         bool force_thread_nr = false; // otherwise a smaller number of threads might be used
         constexpr static size_t min_nr_bdd_nodes = 10000; // TODO: measure good value
         double parallel_message_passing_weight = 0.5;
+        size_t multiplier_channel_capacity = 4; // nr of Lagrange multiplier updates buffered between two intervals
     };
 
     class decomposition_bdd_mma {
         public:
 
-            decomposition_bdd_mma(bdd_storage& bdd_storage_, decomposition_mma_options opt);
+            decomposition_bdd_mma(BDD::bdd_collection& bdd_col, decomposition_mma_options opt);
             template<typename ITERATOR>
-                decomposition_bdd_mma(bdd_storage& stor, ITERATOR cost_begin, ITERATOR cost_end, decomposition_mma_options opt);
+                decomposition_bdd_mma(BDD::bdd_collection& bdd_col, ITERATOR cost_begin, ITERATOR cost_end, decomposition_mma_options opt);
             decomposition_bdd_mma(decomposition_bdd_mma&&);
 
             decomposition_bdd_mma& operator=(decomposition_bdd_mma&&);
 
             ~decomposition_bdd_mma();
+            size_t nr_variables() const;
             void set_cost(const double c, const size_t var);
             void backward_run();
             void iteration();
@@ -36,10 +40,10 @@ namespace LPMP {
     };
 
     template<typename ITERATOR>
-        decomposition_bdd_mma::decomposition_bdd_mma(bdd_storage& stor, ITERATOR cost_begin, ITERATOR cost_end, decomposition_mma_options opt)
-        : decomposition_bdd_mma(stor, opt)
+        decomposition_bdd_mma::decomposition_bdd_mma(BDD::bdd_collection& bdd_col, ITERATOR cost_begin, ITERATOR cost_end, decomposition_mma_options opt)
+        : decomposition_bdd_mma(bdd_col, opt)
         {
-            assert(std::distance(cost_begin, cost_end) <= stor.nr_variables());
+            assert(std::distance(cost_begin, cost_end) <= nr_variables());
             size_t var = 0;
             for(auto cost_it=cost_begin; cost_it!=cost_end; ++cost_it)
                 set_cost(*cost_it, var++);
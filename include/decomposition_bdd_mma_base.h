@@ -1,95 +1,88 @@
-#pragma once 
+#pragma once
 
 #include <vector>
 #include <cmath>
 #include <cassert>
-#include <thread>
-#include <queue>
-#include <mutex>
+#include <memory>
 #include "decomposition_bdd_mma.h"
-#include "bdd_storage.h"
+#include "bdd_collection/bdd_collection.h"
 #include "bdd_branch_node_vector.h"
+#include "bdd_branch_instruction.h"
+#include "spsc_ring_buffer.hxx"
 #include "time_measure_util.h"
 #include <iostream> // TODO: remove
 
 namespace LPMP {
 
+    // The variable order is split into intervals, each one optimized by its own thread.
+    // Bdds crossing interval boundaries are split into slices sharing the nodes of one variable, whose arc costs are coupled by Lagrange multipliers.
     class decomposition_bdd_base {
         public:
-            decomposition_bdd_base(bdd_storage& stor, decomposition_mma_options opt);
+            decomposition_bdd_base(BDD::bdd_collection& bdd_col, decomposition_mma_options opt);
 
-            size_t nr_variables() const;
+            size_t nr_variables() const { return nr_variables_; }
+            size_t nr_intervals() const { return interval_boundaries.size()-1; }
             void set_cost(const double c, const size_t var);
             void backward_run();
-            void solve(const size_t max_iter, const double tolerance, const double time_limit);
             void iteration();
             double lower_bound();
 
             two_dim_variable_array<std::array<double,2>> min_marginals();
         private:
+            void compute_intervals(const BDD::bdd_collection& bdd_col, const decomposition_mma_options& opt);
+            size_t interval(const size_t var) const;
+
             void min_marginal_averaging_forward(const size_t interval_nr);
             void min_marginal_averaging_backward(const size_t interval_nr);
 
-            bdd_storage::intervals intervals;
+            std::vector<size_t> interval_boundaries; // variables at which new interval starts
             std::vector<double> costs;
-
-            struct Lagrange_multiplier {
-                union {
-                    size_t interval_nr;
-                    size_t first_node;
-                    size_t nr_deltas;
-                    double delta;
-                };
-            }; 
+            size_t nr_variables_ = 0;
 
             struct endpoint {
-                // bdd branch node delimiters from this interval coming from a split
+                // bdd branch node delimiters of the duplicated variable in the sending interval
                 size_t first_node;
-                size_t last_node; // TODO: possibly not needed, can be inferred from bdd index in bdd base
-                // first bdd branch node in opposite interval
-                size_t opposite_interval_nr;
+                size_t last_node;
+                // first bdd branch node of the duplicated variable in the receiving interval
                 size_t first_node_opposite_interval;
             };
 
-            struct Lagrange_multiplier_queue {
-                std::mutex mutex;
-                std::queue<Lagrange_multiplier> queue;
-
-                // TODO: possibly not needed?
-                // we first write Lagrange multipliers that need to be synchronized via the queue in this cache in order to save synchronization calls
-                //std::vector<Lagrange_multiplier> queue_cache;
-                //std::vector<size_t> queue_cache_offset;
-                //size_t queue_cache_offset_counter;
-
-                // write Lagrange multipliers into queue cache
-                //template<typename ITERATOR>
-                //    void write_to_cache(const size_t interval_nr, size_t offset, ITERATOR begin, ITERATOR end);
-
-                // write from cache to queue
-                //template<typename ITERATOR>
-                //    size_t write_to_queue(ITERATOR it);
-                template<typename ITERATOR>
-                    void write_to_queue(const size_t node_nr, ITERATOR begin, ITERATOR end);
-
-                //void init_cache(const std::vector<endpoint>& endpoints);
-                //void reset_cache();
+            // Lagrange multipliers for all duplicated arcs from one interval to another one.
+            // Each frame holds two deltas per duplicated bdd node of all endpoints.
+            // If the ring is full, updates are accumulated by the sender and sent with the next frame.
+            struct Lagrange_multiplier_channel {
+                Lagrange_multiplier_channel(const size_t _from_interval, const size_t _to_interval)
+                    : from_interval(_from_interval), to_interval(_to_interval) {}
+                size_t from_interval;
+                size_t to_interval;
+                std::vector<endpoint> endpoints;
+                std::unique_ptr<spsc_ring_buffer<double>> ring;
+                std::vector<double> pending;
+                bool has_pending = false;
+
+                size_t frame_size() const;
+                void init(const size_t capacity);
             };
 
+            using bdd_sub_base_type = bdd_mma_base<bdd_branch_instruction_bdd_index<float,uint32_t>>;
             struct bdd_sub_base {
-                bdd_mma_base<bdd_branch_instruction_bdd_index<float,uint32_t>> base;
-                //bdd_mma_base_vec base;
+                bdd_sub_base_type base;
 
-                void read_in_Lagrange_multipliers(Lagrange_multiplier_queue& queue);
-
-                // TODO: determine whether two_dim_variable_array<endpoint> and interleaved message passing updates are faster.
-                // TODO: rename to right/left endpoints?  
-                std::vector<endpoint> forward_endpoints;
-                std::vector<endpoint> backward_endpoints;
-                Lagrange_multiplier_queue forward_queue;
-                Lagrange_multiplier_queue backward_queue;
+                std::vector<Lagrange_multiplier_channel*> forward_in;
+                std::vector<Lagrange_multiplier_channel*> forward_out;
+                std::vector<Lagrange_multiplier_channel*> backward_in;
+                std::vector<Lagrange_multiplier_channel*> backward_out;
             };
 
+            // compute arc marginals at the duplicated variables, move fraction of them into channel
+            void send_Lagrange_multipliers(Lagrange_multiplier_channel& c, const bool forward);
+            void read_in_Lagrange_multipliers(Lagrange_multiplier_channel& c);
+            // also take over updates that did not fit into the channel
+            void flush_Lagrange_multipliers(Lagrange_multiplier_channel& c);
+            void apply_Lagrange_multipliers(const Lagrange_multiplier_channel& c, const double* deltas);
+
             std::unique_ptr<bdd_sub_base[]> bdd_bases;
+            std::vector<std::unique_ptr<Lagrange_multiplier_channel>> channels;
             double intra_interval_message_passing_weight;
     };
 
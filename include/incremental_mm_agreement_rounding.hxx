@@ -8,78 +8,25 @@
 #include <iostream>
 #include <iomanip>
 #include "two_dimensional_variable_array.hxx"
+#include "min_marginal_utils.h"
 #include "run_solver_util.h"
 
 namespace LPMP {
 
     namespace {
-        enum class mm_type {
-            zero,
-            one,
-            equal,
-            inconsistent
-        }; 
-
-        template<typename REAL>
-            std::vector<mm_type> compute_mm_types(const two_dim_variable_array<std::array<REAL,2>>& mms)
-            {
-                std::vector<mm_type> diffs(mms.size(),mm_type::inconsistent);
-
-                for(size_t i=0; i<mms.size(); ++i)
-                {
-                    assert(mms.size(i) > 0);
-
-                    const bool all_equal = [&]() { // all min-marginals are equal
-                        for(size_t j=0; j<mms.size(i); ++j)
-                            if(std::abs(mms(i,j)[1] - mms(i,j)[0]) > 1e-6)
-                                return false;
-                        return true;
-                    }();
-
-                    const bool all_one = [&]() { // min-marginals indicate one variable should be taken
-                        for(size_t j=0; j<mms.size(i); ++j)
-                            if(!(mms(i,j)[1] + 1e-6 < mms(i,j)[0]))
-                                return false;
-                        return true;
-                    }();
-
-                    const bool all_zero = [&]() { // min-marginals indicate zero variable should be taken
-                        for(size_t j=0; j<mms.size(i); ++j)
-                            if(!(mms(i,j)[0] + 1e-6 < mms(i,j)[1]))
-                                return false;
-                        return true;
-                    }();
-
-                    assert(int(all_zero) + int(all_one) + int(all_equal) <= 1);
-
-                    if(all_zero)
-                        diffs[i] = mm_type::zero;
-                    else if(all_one)
-                        diffs[i] = mm_type::one;
-                    else if(all_equal)
-                        diffs[i] = mm_type::equal;
-                    else
-                        diffs[i] = mm_type::inconsistent;
-                }
-
-                return diffs;
-            }
-
-        template<typename REAL>
-            double compute_initial_delta(const two_dim_variable_array<std::array<REAL,2>>& mms)
+        inline double compute_initial_delta(const std::vector<mm_agreement>& agreement)
+        {
+            std::vector<double> mm_diffs(agreement.size());;
+            for(size_t i=0; i<agreement.size(); ++i)
             {
-                std::vector<double> mm_diffs(mms.size());;
-                for(size_t i=0; i<mms.size(); ++i)
-                {
-                    for(size_t j=0; j<mms.size(i); ++j)
-                        mm_diffs[i] += mms(i,j)[1] - mms(i,j)[0];
-                    mm_diffs[i] = std::abs(mm_diffs[i])/double(mms.size(i));
-                }
-                nth_element(mm_diffs.begin(), mm_diffs.begin() + 0.1*mms.size(), mm_diffs.end());
-                const double computed_delta = mm_diffs[0.1*mms.size()];
-                std::cout << "[incremental primal rounding] computed delta = " << computed_delta << "\n";
-                return computed_delta;
+                assert(agreement[i].nr_bdds > 0);
+                mm_diffs[i] = std::abs(agreement[i].sum_diff)/double(agreement[i].nr_bdds);
             }
+            nth_element(mm_diffs.begin(), mm_diffs.begin() + 0.1*agreement.size(), mm_diffs.end());
+            const double computed_delta = mm_diffs[0.1*agreement.size()];
+            std::cout << "[incremental primal rounding] computed delta = " << computed_delta << "\n";
+            return computed_delta;
+        }
     }
 
     namespace detail {
@@ -91,7 +38,20 @@ namespace LPMP {
             }
 
         template <typename S>
-            auto distribute_delta(S& solver, double) -> void { } 
+            auto distribute_delta(S& solver, double) -> void { }
+
+        // use allocation-free min-marginal agreement of solver if available, otherwise aggregate full min-marginals
+        template <typename S>
+            auto min_marginal_agreement(S& solver, std::vector<mm_agreement>& agreement, int) -> decltype(solver.min_marginal_agreement(agreement))
+            {
+                solver.min_marginal_agreement(agreement);
+            }
+
+        template <typename S>
+            auto min_marginal_agreement(S& solver, std::vector<mm_agreement>& agreement, double) -> void
+            {
+                compute_mm_agreement(solver.min_marginals(), agreement);
+            }
     }
 
     template<typename SOLVER>
@@ -102,8 +62,16 @@ namespace LPMP {
 
             const auto start_time = std::chrono::steady_clock::now();
 
+            // buffers are reused over all rounds
+            std::vector<mm_agreement> agreement;
+            std::vector<double> cost_lo_updates;
+            std::vector<double> cost_hi_updates;
+
             if(init_delta == std::numeric_limits<double>::infinity())
-                init_delta = compute_initial_delta(s.min_marginals());
+            {
+                detail::min_marginal_agreement(s, agreement, 0);
+                init_delta = compute_initial_delta(agreement);
+            }
 
             std::cout << "[incremental primal rounding] initial perturbation delta = " << init_delta << ", growth rate for perturbation " << delta_growth_rate << "\n";
 
@@ -123,35 +91,38 @@ namespace LPMP {
                 // flush stored computations to get best min marginals
                 detail::distribute_delta(s, 0);
 
-                const auto mms = s.min_marginals();
-                const auto mm_types = compute_mm_types(mms);
-                const size_t nr_one_mms = std::count(mm_types.begin(), mm_types.end(), mm_type::one);
-                const size_t nr_zero_mms = std::count(mm_types.begin(), mm_types.end(), mm_type::zero);
-                const size_t nr_equal_mms = std::count(mm_types.begin(), mm_types.end(), mm_type::equal);
-                const size_t nr_inconsistent_mms = std::count(mm_types.begin(), mm_types.end(), mm_type::inconsistent);
-                assert(nr_one_mms + nr_zero_mms + nr_equal_mms + nr_inconsistent_mms == mms.size());
+                detail::min_marginal_agreement(s, agreement, 0);
+                const size_t nr_vars = agreement.size();
+                const auto count_type = [&](const mm_type t) {
+                    return std::count_if(agreement.begin(), agreement.end(), [t](const mm_agreement& a) { return a.type == t; });
+                };
+                const size_t nr_one_mms = count_type(mm_type::one);
+                const size_t nr_zero_mms = count_type(mm_type::zero);
+                const size_t nr_equal_mms = count_type(mm_type::equal);
+                const size_t nr_inconsistent_mms = count_type(mm_type::inconsistent);
+                assert(nr_one_mms + nr_zero_mms + nr_equal_mms + nr_inconsistent_mms == nr_vars);
 
                 const int old_precision = std::cout.precision();
                 std::cout << std::setprecision(2);
                 std::cout << "[incremental primal rounding] " <<
-                    "#one min-marg diffs = " << nr_one_mms << " % " << double(100*nr_one_mms)/double(mms.size()) << ", " <<  
-                    "#zero min-marg diffs = " << nr_zero_mms << " % " << double(100*nr_zero_mms)/double(mms.size()) << ", " << 
-                    "#equal min-marg diffs = " << nr_equal_mms << " % " << double(100*nr_equal_mms)/double(mms.size()) << ", " << 
-                    "#inconsistent min-marg diffs = " << nr_inconsistent_mms << " % " << double(100*nr_inconsistent_mms)/double(mms.size()) << "\n";
+                    "#one min-marg diffs = " << nr_one_mms << " % " << double(100*nr_one_mms)/double(nr_vars) << ", " <<  
+                    "#zero min-marg diffs = " << nr_zero_mms << " % " << double(100*nr_zero_mms)/double(nr_vars) << ", " << 
+                    "#equal min-marg diffs = " << nr_equal_mms << " % " << double(100*nr_equal_mms)/double(nr_vars) << ", " << 
+                    "#inconsistent min-marg diffs = " << nr_inconsistent_mms << " % " << double(100*nr_inconsistent_mms)/double(nr_vars) << "\n";
                 std::cout << std::setprecision(old_precision);
 
                 std::uniform_real_distribution<> dis(-cur_delta, cur_delta);
 
-                if(nr_one_mms + nr_zero_mms == mms.size())
+                if(nr_one_mms + nr_zero_mms == nr_vars)
                 {
-                    std::vector<char> sol(mms.size(),0);
+                    std::vector<char> sol(nr_vars,0);
                     for(size_t i=0; i<sol.size(); ++i)
                     {
-                        if(mm_types[i] == mm_type::one)
+                        if(agreement[i].type == mm_type::one)
                             sol[i] = 1;
                         else
                         {
-                            assert(mm_types[i] == mm_type::zero);
+                            assert(agreement[i].type == mm_type::zero);
                             sol[i] = 0;
                         }
                     }
@@ -159,21 +130,21 @@ namespace LPMP {
                     return sol;
                 }
 
-                std::vector<double> cost_lo_updates(mms.size(), 0.0);
-                std::vector<double> cost_hi_updates(mms.size(), 0.0);
-                for(size_t i=0; i<mms.size(); ++i)
+                cost_lo_updates.resize(nr_vars);
+                cost_hi_updates.resize(nr_vars);
+                for(size_t i=0; i<nr_vars; ++i)
                 {
-                    if(mm_types[i] == mm_type::one)
+                    if(agreement[i].type == mm_type::one)
                     {
                         cost_lo_updates[i] = cur_delta;
                         cost_hi_updates[i] = 0.0;
                     }
-                    else if(mm_types[i] == mm_type::zero)
+                    else if(agreement[i].type == mm_type::zero)
                     {
                         cost_lo_updates[i] = 0.0;
                         cost_hi_updates[i] = cur_delta;
                     }
-                    else if(mm_types[i] == mm_type::equal)
+                    else if(agreement[i].type == mm_type::equal)
                     {
                         const double r = dis(gen);
                         assert(-cur_delta <= r && r <= cur_delta);
@@ -190,18 +161,9 @@ namespace LPMP {
                     }
                     else
                     {
-                        assert(mm_types[i] == mm_type::inconsistent);
-                        const auto mm_sum = [&]() {
-                            std::array<double,2> s = {0.0,0.0};
-                            for(size_t j=0; j<mms.size(i); ++j)
-                            {
-                                s[0] += mms(i,j)[0];
-                                s[1] += mms(i,j)[1];
-                            }
-                            return s;
-                        }();
+                        assert(agreement[i].type == mm_type::inconsistent);
                         const double r = 5.0*dis(gen);
-                        if(mm_sum[0] < mm_sum[1])
+                        if(agreement[i].sum_diff > 0.0) // sum of zero min-marginals is smaller
                         {
                             cost_lo_updates[i] = 0.0;
                             cost_hi_updates[i] = std::abs(r)*cur_delta;
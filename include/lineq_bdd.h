@@ -3,12 +3,13 @@
 #include <numeric>
 #include <stack>
 #include <vector>
+#include <array>
 #include <queue>
+#include <limits>
 #include <sstream>
-#include <tsl/robin_map.h>
 #include "bdd_manager/bdd.h"
 #include "ILP_input.h"
-#include "avl_tree.hxx"
+#include "bdd_collection/bdd_collection.h"
 
 namespace LPMP {
 
@@ -17,29 +18,56 @@ using integer = long long int;
 
     struct lineq_bdd_node {
 
-        lineq_bdd_node() {}
-        lineq_bdd_node(integer lb, integer ub) : lb_(lb), ub_(ub)
-        {}
-
         integer lb_ = 0;
         integer ub_ = 0; // initially also serves as cost of path from root
 
-        lineq_bdd_node* zero_kid_ = nullptr;
-        lineq_bdd_node* one_kid_ = nullptr;
-        avl_node<lineq_bdd_node>* wrapper_ = nullptr; // wrapper node in the AVL tree
+        // index of node on next level or one of the sinks
+        size_t zero_kid_ = undefined;
+        size_t one_kid_ = undefined;
+
+        constexpr static size_t topsink = std::numeric_limits<size_t>::max();
+        constexpr static size_t botsink = std::numeric_limits<size_t>::max()-1;
+        constexpr static size_t undefined = std::numeric_limits<size_t>::max()-2;
+    };
+
+    // slack interval [lb,ub] of nodes on a level that are equivalent to node
+    struct lineq_bdd_interval {
+        integer lb;
+        integer ub;
+        size_t node; // lineq_bdd_node::botsink for nodes equivalent to botsink (only applicable for equations)
+    };
+
+    // disjoint slack intervals of one level, kept sorted in blocks of bounded size so that insertion does not move all intervals
+    class lineq_bdd_interval_map {
+        public:
+            void clear();
+            // interval containing slack, nullptr if there is none
+            const lineq_bdd_interval* find(const integer slack) const;
+            void insert(const lineq_bdd_interval& interval);
+
+        private:
+            constexpr static size_t max_block_size = 256;
+            std::vector<std::vector<lineq_bdd_interval>> blocks; // blocks beyond nr_blocks are kept for reuse
+            std::vector<integer> block_lb; // lower bound of first interval per block
+            size_t nr_blocks = 0;
     };
 
     // Implementation of BDD construction from a linear inequality/equation (cf. Behle, 2007)
+    // Nodes are stored contiguously per level and equivalent nodes are looked up in sorted interval arrays per level.
+    // Memory of levels is kept for subsequent constructions.
     class lineq_bdd {
         public:
 
-            lineq_bdd() : topsink(0, std::numeric_limits<integer>::max()), 
-                botsink(std::numeric_limits<integer>::min(), -1)
-            {}
+            lineq_bdd() {}
             lineq_bdd(lineq_bdd & other) = delete;
 
             void build_from_inequality(const std::vector<int>& nf, const ILP_input::inequality_type ineq_type);
             BDD::node_ref convert_to_lbdd(BDD::bdd_mgr & bdd_mgr_) const;
+            // append quasi-reduced and reordered bdd on variables 0,...,#levels-1 to bdd_col. Bdd must not be constant
+            size_t convert_to_qbdd(BDD::bdd_collection& bdd_col) const;
+
+            bool is_topsink() const { return root_node == lineq_bdd_node::topsink; }
+            bool is_botsink() const { return root_node == lineq_bdd_node::botsink; }
 
             template<typename COEFF_ITERATOR>
                 static std::tuple< std::vector<int>, ILP_input::inequality_type >
@@ -52,17 +80,18 @@ using integer = long long int;
 
         private:
 
-            bool build_bdd_node(lineq_bdd_node* &node_ptr, const integer path_cost, const unsigned int level, const ILP_input::inequality_type ineq_type);
+            // returns true if new node was created
+            bool build_bdd_node(size_t& node, const integer path_cost, const size_t level, const ILP_input::inequality_type ineq_type);
 
             std::vector<char> inverted; // flags inverted variables
             std::vector<int> coefficients;
             std::vector<integer> rests;
             int rhs;
 
-            lineq_bdd_node* root_node;
-            std::vector<avl_tree<lineq_bdd_node>> levels;
-            lineq_bdd_node topsink;
-            lineq_bdd_node botsink;
+            size_t root_node; // root is first node on level 0 if not a sink
+            size_t nr_levels = 0;
+            std::vector<std::vector<lineq_bdd_node>> levels;
+            std::vector<lineq_bdd_interval_map> intervals;
     };
 
 
@@ -93,37 +122,39 @@ using integer = long long int;
         void lineq_bdd::export_graphviz(STREAM& s)
         {
             s << "digraph BDD {\n";
-            tsl::robin_set<lineq_bdd_node*> visited;
-            std::queue<lineq_bdd_node*> q;
-            q.push(root_node);
-            while(!q.empty())
+            if(!is_topsink() && !is_botsink())
             {
-                lineq_bdd_node* b = q.front();
-                q.pop();
-                if(visited.count(b) > 0)
-                    continue;
-                visited.insert(b);
-
-                if(b == &topsink)
-                    continue;
-                if(b == &botsink)
-                    continue;
-
-                auto node_id = [&](lineq_bdd_node* p) -> std::string {
-                    if(p == &botsink)
-                        return std::string("bot");
-                    if(p == &topsink)
-                        return std::string("top");
-                    const void* address = static_cast<const void*>(p);
-                    std::stringstream ss;
-                    ss << "\"" << address << "\"";
-                    return ss.str();
-                };
-
-                s << node_id(b) << " -> " << node_id(b->zero_kid_) << " [label=\"0\"]\n";;
-                s << node_id(b) << " -> " << node_id(b->one_kid_) << " [label=\"1\"]\n";;
-                q.push(b->zero_kid_);
-                q.push(b->one_kid_);
+                std::vector<std::vector<char>> visited(nr_levels);
+                for(size_t l=0; l<nr_levels; ++l)
+                    visited[l].resize(levels[l].size(), 0);
+                std::queue<std::array<size_t,2>> q; // level, node
+                q.push({0, root_node});
+                while(!q.empty())
+                {
+                    const auto [l, i] = q.front();
+                    q.pop();
+                    if(visited[l][i])
+                        continue;
+                    visited[l][i] = 1;
+
+                    auto node_id = [&](const size_t level, const size_t node) -> std::string {
+                        if(node == lineq_bdd_node::botsink)
+                            return std::string("bot");
+                        if(node == lineq_bdd_node::topsink)
+                            return std::string("top");
+                        std::stringstream ss;
+                        ss << "\"" << level << "," << node << "\"";
+                        return ss.str();
+                    };
+
+                    const lineq_bdd_node& b = levels[l][i];
+                    s << node_id(l, i) << " -> " << node_id(l+1, b.zero_kid_) << " [label=\"0\"]\n";;
+                    s << node_id(l, i) << " -> " << node_id(l+1, b.one_kid_) << " [label=\"1\"]\n";;
+                    if(b.zero_kid_ != lineq_bdd_node::botsink && b.zero_kid_ != lineq_bdd_node::topsink)
+                        q.push({l+1, b.zero_kid_});
+                    if(b.one_kid_ != lineq_bdd_node::botsink && b.one_kid_ != lineq_bdd_node::topsink)
+                        q.push({l+1, b.one_kid_});
+                }
             }
 
             s << "}\n";
@@ -2,11 +2,69 @@
 
 #include <vector>
 #include <array>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <iostream>
 #include "two_dimensional_variable_array.hxx"
 #include "permutation.hxx"
 
 namespace LPMP {
 
+    enum class mm_type {
+        zero,
+        one,
+        equal,
+        inconsistent
+    };
+
+    // aggregated min-marginal differences mm[1] - mm[0] of one variable over all bdds covering it.
+    // Solvers fill a caller provided buffer of these in one pass instead of returning all min-marginals.
+    struct mm_agreement {
+        double min_diff = std::numeric_limits<double>::infinity();
+        double max_diff = -std::numeric_limits<double>::infinity();
+        double sum_diff = 0.0;
+        size_t nr_bdds = 0;
+        mm_type type = mm_type::inconsistent;
+
+        void add(const double diff)
+        {
+            min_diff = std::min(min_diff, diff);
+            max_diff = std::max(max_diff, diff);
+            sum_diff += diff;
+            ++nr_bdds;
+        }
+
+        // zero: all bdds prefer 0, one: all bdds prefer 1, equal: no bdd has a preference.
+        void compute_type(const double eps)
+        {
+            assert(eps >= 0.0);
+            if(min_diff > eps)
+                type = mm_type::zero;
+            else if(max_diff < -eps)
+                type = mm_type::one;
+            else if(min_diff >= -eps && max_diff <= eps)
+                type = mm_type::equal;
+            else
+                type = mm_type::inconsistent;
+        }
+    };
+
+    // fallback for solvers that only provide full min-marginals
+    template<typename REAL>
+    void compute_mm_agreement(const two_dim_variable_array<std::array<REAL,2>>& mms, std::vector<mm_agreement>& agreement, const double eps = 1e-6)
+    {
+        agreement.resize(mms.size());
+        for(size_t var=0; var<mms.size(); ++var)
+        {
+            agreement[var] = mm_agreement{};
+            for(size_t j=0; j<mms.size(var); ++j)
+                agreement[var].add(double(mms(var,j)[1]) - double(mms(var,j)[0]));
+            agreement[var].compute_type(eps);
+        }
+    }
+
     template<typename REAL>
     std::vector<REAL> min_marginal_differences(const two_dim_variable_array<std::array<REAL,2>>& min_marginals, const REAL eps)
     {
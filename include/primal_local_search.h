@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ILP_input.h"
+#include "bdd_collection/bdd_collection.h"
+#include "two_dimensional_variable_array.hxx"
+#include <vector>
+#include <array>
+#include <utility>
+#include <cstdint>
+#include <limits>
+
+namespace LPMP {
+
+    struct primal_local_search_options {
+        size_t max_rounds = 10;
+        bool two_flip = true;
+        size_t max_two_flip_row_length = 64; // rows with more variables are not searched for improving pairs
+        bool bdd_neighbourhood = true;
+        size_t max_repair_iterations = 3; // shortest path resolves with variables of violated rows fixed
+    };
+
+    // Improves a feasible primal solution by 1-flips, 2-flips of variables sharing a constraint and by re-optimizing the variables of single bdds exactly.
+    // Candidate moves are evaluated in parallel w.r.t. the current solution and then applied sequentially if they are still feasible and improving.
+    // Feasibility of moves is checked incrementally on the row activities of the ILP.
+    class primal_local_search {
+        public:
+            primal_local_search(const ILP_input& ilp, const BDD::bdd_collection& bdd_col, const primal_local_search_options opts = primal_local_search_options{});
+
+            // solution must be feasible, returns objective of improved solution
+            double improve(std::vector<char>& sol);
+
+        private:
+            using change = std::pair<size_t,char>; // variable and new value
+            struct move {
+                double delta;
+                std::vector<change> changes;
+            };
+
+            // sparse row activity deltas of a move, one per thread
+            struct row_delta_buffer {
+                std::vector<int> delta;
+                std::vector<char> touched;
+                std::vector<size_t> touched_rows;
+                void clear();
+            };
+
+            // returns objective delta of move and whether all rows stay feasible. Violated rows are collected if requested.
+            std::pair<double,bool> evaluate(const std::vector<change>& changes, const std::vector<char>& sol, row_delta_buffer& buf, std::vector<size_t>* violated_rows = nullptr) const;
+            void apply(const std::vector<change>& changes, std::vector<char>& sol);
+            // apply moves in order of decreasing improvement as long as they are still feasible and improving
+            size_t commit(std::vector<move>& moves, std::vector<char>& sol);
+
+            std::vector<move> one_flip_moves(const std::vector<char>& sol) const;
+            std::vector<move> two_flip_moves(const std::vector<char>& sol) const;
+            std::vector<move> bdd_moves(const std::vector<char>& sol) const;
+            // minimum cost change of assignment to variables of bdd w.r.t. current solution, fixed variables must keep their value
+            void shortest_path(const size_t bdd_nr, const std::vector<char>& sol, const std::vector<char>& fixed, std::vector<double>& dist, std::vector<change>& changes) const;
+
+            // bdd nodes with lo and hi relative to the first node of their bdd, terminals are marked by their variable
+            struct bdd_node {
+                uint32_t lo, hi, var;
+                constexpr static uint32_t botsink_var = std::numeric_limits<uint32_t>::max();
+                constexpr static uint32_t topsink_var = std::numeric_limits<uint32_t>::max()-1;
+                bool is_botsink() const { return var == botsink_var; }
+                bool is_topsink() const { return var == topsink_var; }
+                bool is_terminal() const { return is_botsink() || is_topsink(); }
+            };
+
+            bool row_feasible(const size_t row, const int activity) const { return row_bounds_[row][0] <= activity && activity <= row_bounds_[row][1]; }
+
+            primal_local_search_options options_;
+            std::vector<double> costs_;
+            two_dim_variable_array<ILP_input::weighted_variable> rows_;
+            std::vector<std::array<int,2>> row_bounds_;
+            two_dim_variable_array<std::array<size_t,2>> var_rows_; // row and coefficient index into rows_
+            std::vector<int> activity_;
+            double objective_ = 0.0;
+            two_dim_variable_array<bdd_node> bdd_nodes_;
+
+            row_delta_buffer commit_buffer_;
+    };
+
+}
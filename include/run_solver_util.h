@@ -1,11 +1,16 @@
 #pragma once
 
 #include <chrono>
+#include <functional>
 
 namespace LPMP {
 
+    // observer called after every iteration with iteration number, current lower bound and elapsed time in seconds.
+    // Returning false stops the solver, e.g. when a primal solution with small enough gap has been found.
+    using run_solver_callback = std::function<bool(const size_t iter, const double lower_bound, const double time_spent)>;
+
     template<typename SOLVER>
-        void run_solver(SOLVER& s, const size_t max_iter, const double tolerance, const double improvement_slope, const double time_limit, const bool verbose = true)
+        void run_solver(SOLVER& s, const size_t max_iter, const double tolerance, const double improvement_slope, const double time_limit, const bool verbose = true, const run_solver_callback& callback = run_solver_callback{})
         {
             assert(improvement_slope > 0.0 && improvement_slope < 1.0);
             assert(time_limit >= 0.0);
@@ -50,6 +55,12 @@ namespace LPMP {
                         std::cout << "[bdd solver] Time limit reached." << std::endl;
                     break;
                 }
+                if(callback && !callback(iter, lb_post, time_spent))
+                {
+                    if(verbose)
+                        std::cout << "[bdd solver] stopped by callback\n";
+                    break;
+                }
                 if (std::abs(lb_prev-lb_post) < std::abs(tolerance*lb_prev))
                 {
                     if(verbose)
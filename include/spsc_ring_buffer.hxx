@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+namespace LPMP {
+
+    // fixed-capacity lock-free ring buffer of equally sized frames for exactly one producer and one consumer thread.
+    // Frames are written and read in place, so no copies are needed on either side.
+    template<typename T>
+    class spsc_ring_buffer {
+        public:
+            spsc_ring_buffer(const size_t frame_size, const size_t capacity);
+            spsc_ring_buffer(const spsc_ring_buffer&) = delete;
+            spsc_ring_buffer& operator=(const spsc_ring_buffer&) = delete;
+
+            size_t frame_size() const { return frame_size_; }
+            size_t capacity() const { return capacity_; }
+
+            // producer: returns frame to write into or nullptr if buffer is full. Frame becomes visible after push()
+            T* front_write();
+            void push();
+
+            // consumer: returns oldest frame or nullptr if buffer is empty. Frame is released by pop()
+            const T* front_read();
+            void pop();
+
+        private:
+            const size_t frame_size_;
+            const size_t capacity_;
+            std::vector<T> data_;
+            alignas(64) std::atomic<size_t> head_ = 0; // nr of frames read, written by consumer only
+            alignas(64) std::atomic<size_t> tail_ = 0; // nr of frames written, written by producer only
+    };
+
+    template<typename T>
+        spsc_ring_buffer<T>::spsc_ring_buffer(const size_t frame_size, const size_t capacity)
+        : frame_size_(frame_size),
+        capacity_(capacity),
+        data_(frame_size*capacity)
+        {
+            assert(capacity > 0);
+        }
+
+    template<typename T>
+        T* spsc_ring_buffer<T>::front_write()
+        {
+            const size_t tail = tail_.load(std::memory_order_relaxed);
+            if(tail - head_.load(std::memory_order_acquire) == capacity_)
+                return nullptr;
+            return data_.data() + (tail % capacity_) * frame_size_;
+        }
+
+    template<typename T>
+        void spsc_ring_buffer<T>::push()
+        {
+            const size_t tail = tail_.load(std::memory_order_relaxed);
+            assert(tail - head_.load(std::memory_order_acquire) < capacity_);
+            tail_.store(tail + 1, std::memory_order_release);
+        }
+
+    template<typename T>
+        const T* spsc_ring_buffer<T>::front_read()
+        {
+            const size_t head = head_.load(std::memory_order_relaxed);
+            if(head == tail_.load(std::memory_order_acquire))
+                return nullptr;
+            return data_.data() + (head % capacity_) * frame_size_;
+        }
+
+    template<typename T>
+        void spsc_ring_buffer<T>::pop()
+        {
+            const size_t head = head_.load(std::memory_order_relaxed);
+            assert(head != tail_.load(std::memory_order_acquire));
+            head_.store(head + 1, std::memory_order_release);
+        }
+
+}
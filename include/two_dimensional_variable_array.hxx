@@ -99,6 +99,7 @@ public:
    void clear();
    template<typename ITERATOR>
        void push_back(ITERATOR val_begin, ITERATOR val_end);
+   void pop_back();
 
    template<typename ITERATOR>
    void resize(ITERATOR begin, ITERATOR end)
@@ -188,7 +189,7 @@ public:
 
    std::size_t no_elements() const { return data_.size(); }
    std::size_t size() const { assert(offsets_.size() > 0); return offsets_.size()-1; }
-   size_t size(const size_t i) const { assert(i < no_elements()); return offsets_[i+1] - offsets_[i]; }
+   size_t size(const size_t i) const { assert(i < size()); return offsets_[i+1] - offsets_[i]; }
 
    ConstArrayAccessObject back() const 
    {
@@ -376,6 +377,14 @@ void two_dim_variable_array<T>::clear()
     offsets_.push_back(0);
 }
 
+template<typename T>
+void two_dim_variable_array<T>::pop_back()
+{
+    assert(size() > 0);
+    offsets_.pop_back();
+    data_.resize(offsets_.back());
+}
+
 template<typename T>
 template<typename ITERATOR>
 void two_dim_variable_array<T>::push_back(ITERATOR val_begin, ITERATOR val_end)
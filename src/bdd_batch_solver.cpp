@@ -0,0 +1,318 @@
+#include "bdd_batch_solver.h"
+#include "bdd_sequential_base.h"
+#include "bdd_branch_instruction.h"
+#include "convert_pb_to_bdd.h"
+#include "time_measure_util.h"
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include <array>
+#include <string>
+#include <chrono>
+#include <limits>
+#include <iostream>
+#include <omp.h>
+
+namespace LPMP {
+
+    class bdd_batch_solver::impl {
+        public:
+            impl(const std::vector<ILP_input>& ilps);
+
+            void iteration(const double tolerance);
+            void remove_converged_bdds(const std::vector<size_t>& bdd_nrs);
+
+            struct instance {
+                size_t variable_offset;
+                std::vector<size_t> bdd_nrs; // current numbers in base, empty after convergence
+                double constant = 0.0; // costs of variables not covered by any bdd
+                double lb = -std::numeric_limits<double>::infinity();
+                size_t nr_iterations = 0;
+                bool converged = false;
+                bool infeasible = false; // some constraint can never be satisfied
+            };
+            std::vector<instance> instances;
+            size_t nr_active_instances = 0;
+
+        private:
+            // fill instances, costs and bdd_col, which must be constructed before base
+            BDD::bdd_collection& pack(const std::vector<ILP_input>& ilps);
+            std::vector<double> costs;
+            BDD::bdd_collection bdd_col;
+
+        public:
+            bdd_sequential_base<bdd_branch_instruction<float,uint16_t>> base;
+    };
+
+    BDD::bdd_collection& bdd_batch_solver::impl::pack(const std::vector<ILP_input>& ilps)
+    {
+        MEASURE_FUNCTION_EXECUTION_TIME;
+        instances.resize(ilps.size());
+        // constraints of all instances with their variables shifted
+        std::vector<std::array<size_t,2>> constraints; // instance and constraint
+        size_t offset = 0;
+        for(size_t i=0; i<ilps.size(); ++i)
+        {
+            const ILP_input& ilp = ilps[i];
+            for(size_t c=0; c<ilp.constraints().size(); ++c)
+                constraints.push_back({i, c});
+            instances[i].variable_offset = offset;
+            costs.insert(costs.end(), ilp.objective().begin(), ilp.objective().end());
+            costs.resize(offset + ilp.nr_variables(), 0.0);
+            offset += ilp.nr_variables();
+        }
+
+        // one converter per thread is shared by all instances, so that identical constraints are converted once
+        std::vector<size_t> bdd_instance;
+#ifdef _OPENMP
+        const size_t nr_threads = omp_get_max_threads();
+#else
+        const size_t nr_threads = 1;
+#endif
+#pragma omp parallel for ordered schedule(static) num_threads(nr_threads)
+        for(size_t tid=0; tid<nr_threads; ++tid)
+        {
+            std::vector<int> coefficients;
+            std::vector<size_t> variables;
+            BDD::bdd_mgr bdd_mgr;
+            bdd_converter converter(bdd_mgr);
+            BDD::bdd_collection cur_bdd_collection;
+            BDD::bdd_collection tmp_bdd_collection;
+            std::vector<size_t> cur_bdd_instance;
+            // exceptions must not escape the parallel region, infeasible instances are recorded instead
+            std::vector<size_t> cur_infeasible_instances;
+
+            const size_t first_constr = constraints.size()/nr_threads * tid;
+            const size_t last_constr = (tid+1 == nr_threads) ? constraints.size() : (constraints.size()/nr_threads) * (tid+1);
+            for(size_t k=first_constr; k<last_constr; ++k)
+            {
+                const auto [i, c] = constraints[k];
+                const auto& constraint = ilps[i].constraints()[c];
+                coefficients.clear();
+                variables.clear();
+                for(const auto e : constraint.variables) {
+                    coefficients.push_back(e.coefficient);
+                    variables.push_back(instances[i].variable_offset + e.var);
+                }
+                const bool increasing_vars = std::adjacent_find(variables.begin(), variables.end(), std::greater_equal<size_t>()) == variables.end();
+                const size_t bdd_nr = [&]() {
+                    if(increasing_vars)
+                        return converter.convert_to_qbdd(coefficients.begin(), coefficients.end(), constraint.ineq, constraint.right_hand_side, variables.begin(), cur_bdd_collection);
+                    BDD::node_ref bdd = converter.convert_to_bdd(coefficients, constraint.ineq, constraint.right_hand_side);
+                    if(bdd.is_topsink())
+                        return BDD::bdd_instruction::topsink_index;
+                    if(bdd.is_botsink())
+                        return BDD::bdd_instruction::botsink_index;
+                    const size_t nr = tmp_bdd_collection.add_bdd(bdd);
+                    tmp_bdd_collection.reorder(nr);
+                    tmp_bdd_collection.rebase(nr, variables.begin(), variables.end());
+                    if(tmp_bdd_collection.is_qbdd(nr))
+                        cur_bdd_collection.append(tmp_bdd_collection);
+                    else
+                        tmp_bdd_collection.make_qbdd(nr, cur_bdd_collection);
+                    tmp_bdd_collection = BDD::bdd_collection();
+                    return cur_bdd_collection.nr_bdds()-1;
+                }();
+                if(bdd_nr == BDD::bdd_instruction::topsink_index)
+                    continue;
+                else if(bdd_nr == BDD::bdd_instruction::botsink_index)
+                {
+                    cur_infeasible_instances.push_back(i);
+                    continue;
+                }
+                cur_bdd_instance.push_back(i);
+            }
+#pragma omp ordered
+            {
+                bdd_col.append(cur_bdd_collection);
+                bdd_instance.insert(bdd_instance.end(), cur_bdd_instance.begin(), cur_bdd_instance.end());
+                for(const size_t i : cur_infeasible_instances)
+                    instances[i].infeasible = true;
+            }
+        }
+
+        assert(bdd_instance.size() == bdd_col.nr_bdds());
+        for(size_t bdd_nr=0; bdd_nr<bdd_col.nr_bdds(); ++bdd_nr)
+        {
+            assert(bdd_col.is_qbdd(bdd_nr));
+            instances[bdd_instance[bdd_nr]].bdd_nrs.push_back(bdd_nr);
+        }
+        return bdd_col;
+    }
+
+    bdd_batch_solver::impl::impl(const std::vector<ILP_input>& ilps)
+        : base(pack(ilps))
+    {
+        // packed bdds are copied into base
+        bdd_col = BDD::bdd_collection();
+
+        base.update_costs(costs.begin(), costs.begin(), costs.begin(), costs.end());
+        for(size_t i=0; i<instances.size(); ++i)
+        {
+            const size_t var_end = i+1 < instances.size() ? instances[i+1].variable_offset : costs.size();
+            for(size_t var=instances[i].variable_offset; var<var_end; ++var)
+                if(var >= base.nr_variables() || base.nr_bdds(var) == 0)
+                    instances[i].constant += std::min(costs[var], 0.0);
+        }
+        costs.clear();
+        costs.shrink_to_fit();
+
+        base.backward_run();
+        const auto lbs = base.lower_bound_per_bdd();
+        std::vector<size_t> infeasible_bdds;
+        for(auto& inst : instances)
+        {
+            // infeasible instances are not optimized, their remaining bdds are dropped
+            if(inst.infeasible)
+            {
+                inst.lb = std::numeric_limits<double>::infinity();
+                inst.converged = true;
+                infeasible_bdds.insert(infeasible_bdds.end(), inst.bdd_nrs.begin(), inst.bdd_nrs.end());
+                inst.bdd_nrs.clear();
+                continue;
+            }
+            inst.lb = inst.constant;
+            for(const size_t bdd_nr : inst.bdd_nrs)
+                inst.lb += lbs[bdd_nr];
+            // nothing to optimize
+            inst.converged = inst.bdd_nrs.empty();
+            if(!inst.converged)
+                nr_active_instances++;
+        }
+        if(infeasible_bdds.size() > 0)
+            remove_converged_bdds(infeasible_bdds);
+    }
+
+    void bdd_batch_solver::impl::iteration(const double tolerance)
+    {
+        if(nr_active_instances == 0)
+            return;
+
+        base.parallel_mma();
+        const auto lbs = base.lower_bound_per_bdd();
+
+        std::vector<size_t> converged_bdds;
+        for(auto& inst : instances)
+        {
+            if(inst.converged)
+                continue;
+            double lb = inst.constant;
+            for(const size_t bdd_nr : inst.bdd_nrs)
+                lb += lbs[bdd_nr];
+            inst.nr_iterations++;
+            if(lb - inst.lb <= tolerance * std::abs(inst.lb))
+            {
+                inst.converged = true;
+                nr_active_instances--;
+                converged_bdds.insert(converged_bdds.end(), inst.bdd_nrs.begin(), inst.bdd_nrs.end());
+                inst.bdd_nrs.clear();
+            }
+            inst.lb = std::max(inst.lb, lb);
+        }
+
+        if(converged_bdds.size() > 0)
+            remove_converged_bdds(converged_bdds);
+    }
+
+    void bdd_batch_solver::impl::remove_converged_bdds(const std::vector<size_t>& bdd_nrs)
+    {
+        // variables of instances are disjoint, so remaining instances are not affected by the removal
+        const auto new_bdd_nrs = base.remove_bdds(bdd_nrs.begin(), bdd_nrs.end());
+        for(auto& inst : instances)
+            for(size_t& bdd_nr : inst.bdd_nrs)
+            {
+                assert(new_bdd_nrs[bdd_nr] != std::numeric_limits<size_t>::max());
+                bdd_nr = new_bdd_nrs[bdd_nr];
+            }
+    }
+
+    bdd_batch_solver::bdd_batch_solver(const std::vector<ILP_input>& instances)
+    {
+        MEASURE_FUNCTION_EXECUTION_TIME;
+        pimpl = std::make_unique<impl>(instances);
+    }
+
+    bdd_batch_solver::bdd_batch_solver(bdd_batch_solver&& o)
+        : pimpl(std::move(o.pimpl))
+    {}
+
+    bdd_batch_solver& bdd_batch_solver::operator=(bdd_batch_solver&& o)
+    {
+        pimpl = std::move(o.pimpl);
+        return *this;
+    }
+
+    bdd_batch_solver::~bdd_batch_solver()
+    {}
+
+    size_t bdd_batch_solver::nr_instances() const
+    {
+        return pimpl->instances.size();
+    }
+
+    size_t bdd_batch_solver::nr_active_instances() const
+    {
+        return pimpl->nr_active_instances;
+    }
+
+    size_t bdd_batch_solver::variable_offset(const size_t instance) const
+    {
+        assert(instance < nr_instances());
+        return pimpl->instances[instance].variable_offset;
+    }
+
+    void bdd_batch_solver::iteration(const double tolerance)
+    {
+        pimpl->iteration(tolerance);
+    }
+
+    void bdd_batch_solver::solve(const size_t max_iter, const double tolerance, const double time_limit)
+    {
+        const auto start_time = std::chrono::steady_clock::now();
+        std::cout << "[bdd batch solver] solve " << nr_instances() << " instances, " << nr_active_instances() << " not yet converged\n";
+        size_t iter = 0;
+        for(; iter<max_iter && nr_active_instances() > 0; ++iter)
+        {
+            iteration(tolerance);
+            const auto time = std::chrono::steady_clock::now();
+            const double time_spent = (double) std::chrono::duration_cast<std::chrono::milliseconds>(time - start_time).count() / 1000;
+            if(time_spent > time_limit)
+            {
+                std::cout << "[bdd batch solver] Time limit reached." << std::endl;
+                ++iter;
+                break;
+            }
+        }
+        const auto time = std::chrono::steady_clock::now();
+        std::cout << "[bdd batch solver] " << iter << " iterations, " << nr_instances() - nr_active_instances() << " of " << nr_instances() << " instances converged"
+            << ", time = " << (double) std::chrono::duration_cast<std::chrono::milliseconds>(time - start_time).count() / 1000 << " s\n";
+    }
+
+    double bdd_batch_solver::lower_bound(const size_t instance) const
+    {
+        assert(instance < nr_instances());
+        return pimpl->instances[instance].lb;
+    }
+
+    std::vector<double> bdd_batch_solver::lower_bounds() const
+    {
+        std::vector<double> lbs;
+        lbs.reserve(nr_instances());
+        for(const auto& inst : pimpl->instances)
+            lbs.push_back(inst.lb);
+        return lbs;
+    }
+
+    bool bdd_batch_solver::converged(const size_t instance) const
+    {
+        assert(instance < nr_instances());
+        return pimpl->instances[instance].converged;
+    }
+
+    size_t bdd_batch_solver::nr_iterations(const size_t instance) const
+    {
+        assert(instance < nr_instances());
+        return pimpl->instances[instance].nr_iterations;
+    }
+
+}
@@ -3,6 +3,13 @@
 #include <cassert>
 #include <unordered_set>
 #include <unordered_map>
+#include <algorithm>
+#include <tuple>
+#include <numeric>
+#include <cmath>
+#include <limits>
+#include <atomic>
+#include <omp.h>
 #include <iostream> // TODO: remove
 
 namespace BDD {
@@ -20,6 +27,16 @@ namespace BDD {
     }
 
     size_t bdd_collection::bdd_and(const size_t i, const size_t j, bdd_collection& o)
+    {
+        return bdd_and(i, j, o, std::numeric_limits<size_t>::max());
+    }
+
+    size_t bdd_collection::bdd_and(const size_t i, const size_t j, const size_t node_limit)
+    {
+        return bdd_and(i, j, *this, node_limit);
+    }
+
+    size_t bdd_collection::bdd_and(const size_t i, const size_t j, bdd_collection& o, const size_t node_limit)
     {
         assert(i < nr_bdds());
         assert(j < nr_bdds());
@@ -31,11 +48,14 @@ namespace BDD {
         // generate terminal vertices
         o.stack.push_back(bdd_instruction::botsink());
         o.stack.push_back(bdd_instruction::topsink());
-        const size_t root_idx = bdd_and_impl(bdd_delimiters[i], bdd_delimiters[j], o);
+        const size_t root_idx = bdd_and_impl(bdd_delimiters[i], bdd_delimiters[j], o, node_limit);
 
-        if(root_idx != std::numeric_limits<size_t>::max())
+        if(root_idx < 2)
+            o.add_terminal_bdd(root_idx == 1);
+        else if(root_idx != std::numeric_limits<size_t>::max())
         {
             assert(o.stack.size() > 2);
+            assert(root_idx == o.stack.size()-1);
             const size_t offset = o.bdd_delimiters.back();
             for(ptrdiff_t s = o.stack.size()-1; s>=0; --s)
             {
@@ -67,7 +87,7 @@ namespace BDD {
     }
 
     // given two bdd_instructions indices, compute new melded node, if it has not yet been created. Return index on stack.
-    size_t bdd_collection::bdd_and_impl(const size_t f_i, const size_t g_i, bdd_collection& o)
+    size_t bdd_collection::bdd_and_impl(const size_t f_i, const size_t g_i, bdd_collection& o, const size_t node_limit)
     {
         // first, check whether node has been generated already
         if(o.generated_nodes.count({f_i,g_i}) > 0)
@@ -94,14 +114,14 @@ namespace BDD {
         const size_t lo = bdd_and_impl(
                 v == f.index ? f.lo : f_i,
                 v == g.index ? g.lo : g_i,
-                o
+                o, node_limit
                 );
         if(lo == std::numeric_limits<size_t>::max())
             return std::numeric_limits<size_t>::max();
         const size_t hi = bdd_and_impl(
                 v == f.index ? f.hi : f_i,
                 v == g.index ? g.hi : g_i,
-                o
+                o, node_limit
                 );
         if(hi == std::numeric_limits<size_t>::max())
             return std::numeric_limits<size_t>::max();
@@ -113,6 +133,9 @@ namespace BDD {
             return o.reduction.find({lo,hi,v})->second;
 
         o.stack.push_back({lo, hi, v});
+        // stack holds the two terminals and each node of the conjunction once
+        if(o.stack.size() - 2 > node_limit)
+            return std::numeric_limits<size_t>::max();
         const size_t meld_idx = o.stack.size()-1;
         o.generated_nodes.insert(std::make_pair(std::array<size_t,2>{f_i,g_i}, meld_idx));
         o.reduction.insert(std::make_pair(bdd_instruction{lo,hi,v}, meld_idx));
@@ -120,179 +143,258 @@ namespace BDD {
         return meld_idx;
     }
 
-    template<size_t N>
-        size_t bdd_collection::bdd_and(const std::array<size_t,N>& bdds)
+    namespace {
+        // open addressing with linear probing over indices into some external key storage
+        class index_hash_table {
+            public:
+                // return index of entry equal to idx if present, otherwise insert idx and return it
+                template<typename HASH, typename EQUAL>
+                    size_t find_or_insert(const size_t idx, HASH hash, EQUAL equal)
+                    {
+                        if(2*(nr_entries+1) > slots.size())
+                            grow(hash);
+                        const size_t mask = slots.size()-1;
+                        for(size_t s = hash(idx) & mask;; s = (s+1) & mask)
+                        {
+                            if(slots[s] == 0)
+                            {
+                                slots[s] = idx+1;
+                                nr_entries++;
+                                return idx;
+                            }
+                            if(equal(slots[s]-1, idx))
+                                return slots[s]-1;
+                        }
+                    }
+
+            private:
+                template<typename HASH>
+                    void grow(HASH hash)
+                    {
+                        std::vector<size_t> old_slots(std::max(size_t(1024), 2*slots.size()), 0);
+                        std::swap(slots, old_slots);
+                        const size_t mask = slots.size()-1;
+                        for(const size_t e : old_slots)
+                        {
+                            if(e == 0)
+                                continue;
+                            size_t s = hash(e-1) & mask;
+                            while(slots[s] != 0)
+                                s = (s+1) & mask;
+                            slots[s] = e;
+                        }
+                    }
+
+                std::vector<size_t> slots; // entry+1, 0 for empty slots
+                size_t nr_entries = 0;
+        };
+
+        size_t hash_mix(size_t h)
         {
-            return bdd_and(bdds, *this);
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdull;
+            h ^= h >> 33;
+            return h;
         }
+    }
 
-    template<size_t N>
-        size_t bdd_collection::bdd_and(const std::array<size_t,N>& bdds, bdd_collection& o)
+    size_t bdd_collection::bdd_and_impl(std::vector<size_t>& bdd_nrs, bdd_collection& o)
+    {
+        assert(bdd_nrs.size() > 2);
+        if(bdd_nrs.size() <= bdd_and_max_arity)
+            return bdd_and_product(bdd_nrs, o);
+
+        // group bdds with nearby variables
+        struct bdd_order { std::array<size_t,2> min_max_vars; size_t nr_nodes; size_t bdd_nr; };
+        std::vector<bdd_order> order;
+        order.reserve(bdd_nrs.size());
+        for(const size_t bdd_nr : bdd_nrs)
+            order.push_back({min_max_variables(bdd_nr), nr_bdd_nodes(bdd_nr), bdd_nr});
+        std::sort(order.begin(), order.end(), [](const bdd_order& a, const bdd_order& b) {
+                return std::make_tuple(a.min_max_vars, a.nr_nodes, a.bdd_nr) < std::make_tuple(b.min_max_vars, b.nr_nodes, b.bdd_nr);
+                });
+        for(size_t i=0; i<order.size(); ++i)
+            bdd_nrs[i] = order[i].bdd_nr;
+
+        // intersect groups of equal size, then intersect their reduced conjunctions
+        const size_t nr_groups = (bdd_nrs.size() + bdd_and_max_arity - 1) / bdd_and_max_arity;
+        bdd_collection intermediate;
+        std::vector<size_t> intermediate_nrs;
+        for(size_t g=0; g<nr_groups; ++g)
         {
-            for(const size_t bdd_nr : bdds)
-            {
-                assert(bdd_nr < nr_bdds());
-            }
-            assert(o.stack.empty());
-            assert(o.generated_nodes.empty());
-            assert(o.reduction.empty());
+            const size_t group_begin = g * bdd_nrs.size() / nr_groups;
+            const size_t group_end = (g+1) * bdd_nrs.size() / nr_groups;
+            intermediate_nrs.push_back(bdd_and(bdd_nrs.begin() + group_begin, bdd_nrs.begin() + group_end, intermediate));
+        }
+        return intermediate.bdd_and(intermediate_nrs.begin(), intermediate_nrs.end(), o);
+    }
 
-            std::array<size_t,N> bdd_indices;
+    size_t bdd_collection::bdd_and_product(const std::vector<size_t>& bdd_nrs, bdd_collection& o)
+    {
+        for(const size_t bdd_nr : bdd_nrs)
+        {
+            assert(bdd_nr < nr_bdds());
+        }
+        assert(o.stack.empty());
+
+        // a product node is a tuple of one bdd instruction per bdd, stored consecutively in an arena.
+        // Product nodes are expanded top down one variable level at a time and afterwards reduced bottom up.
+        const size_t N = bdd_nrs.size();
+        std::vector<size_t> tuples;
+        std::vector<std::array<size_t,2>> children; // 0: botsink, 1: topsink, otherwise product node + 2
+        index_hash_table tuple_table;
+        auto tuple_hash = [&](const size_t t) {
+            size_t h = 0;
             for(size_t i=0; i<N; ++i)
-                bdd_indices[i] = bdd_delimiters[bdds[i]];
+                h = hash_mix(h ^ tuples[t*N + i]);
+            return h;
+        };
+        auto tuple_equal = [&](const size_t t1, const size_t t2) {
+            return std::equal(tuples.begin() + t1*N, tuples.begin() + (t1+1)*N, tuples.begin() + t2*N);
+        };
 
-            // generate terminal vertices
-            o.stack.push_back(bdd_instruction::botsink());
-            o.stack.push_back(bdd_instruction::topsink());
-            std::unordered_map<std::array<size_t,N>,size_t,array_hasher<N>> generated_nodes;
-            const size_t root_idx = bdd_and_impl(bdd_indices, generated_nodes, o);
+        std::vector<size_t> vars;
+        for(const size_t bdd_nr : bdd_nrs)
+            for(size_t i=bdd_delimiters[bdd_nr]; i<bdd_delimiters[bdd_nr+1]; ++i)
+                if(!bdd_instructions[i].is_terminal())
+                    vars.push_back(bdd_instructions[i].index);
+        std::sort(vars.begin(), vars.end());
+        vars.erase(std::unique(vars.begin(), vars.end()), vars.end());
+        std::vector<std::vector<size_t>> levels(vars.size());
 
-            if(root_idx != std::numeric_limits<size_t>::max())
+        // tuple at the end of the arena is a candidate node. Return its child encoding and drop it if terminal or already present
+        auto add_candidate = [&](const bool botsink, const size_t min_var) -> size_t {
+            const size_t c = children.size();
+            if(botsink || min_var == bdd_instruction::topsink_index)
             {
-                assert(o.stack.size() > 2);
-                const size_t offset = o.bdd_delimiters.back();
-                for(ptrdiff_t s = o.stack.size()-1; s>=0; --s)
+                tuples.resize(c*N);
+                return botsink ? 0 : 1;
+            }
+            const size_t t = tuple_table.find_or_insert(c, tuple_hash, tuple_equal);
+            if(t != c)
+                tuples.resize(c*N);
+            else
+            {
+                children.push_back({0,0});
+                const size_t l = std::lower_bound(vars.begin(), vars.end(), min_var) - vars.begin();
+                levels[l].push_back(c);
+            }
+            return t+2;
+        };
+
+        bool root_botsink = false;
+        size_t root_var = bdd_instruction::topsink_index;
+        tuples.resize(N);
+        for(size_t i=0; i<N; ++i)
+        {
+            tuples[i] = bdd_delimiters[bdd_nrs[i]];
+            const bdd_instruction& instr = bdd_instructions[tuples[i]];
+            root_botsink |= instr.is_botsink();
+            if(!instr.is_terminal())
+                root_var = std::min(root_var, instr.index);
+        }
+        const size_t root = add_candidate(root_botsink, root_var);
+
+        for(size_t l=0; l<levels.size(); ++l)
+        {
+            const size_t v = vars[l];
+            for(const size_t t : levels[l])
+            {
+                std::array<size_t,2> child;
+                for(size_t b=0; b<2; ++b)
                 {
-                    const bdd_instruction bdd_stack = o.stack[s];
-                    const size_t lo = offset + o.stack.size() - bdd_stack.lo - 1;
-                    const size_t hi = offset + o.stack.size() - bdd_stack.hi - 1;
-                    o.bdd_instructions.push_back({lo, hi, o.stack[s].index});
+                    const size_t c = children.size();
+                    tuples.resize((c+1)*N);
+                    bool botsink = false;
+                    size_t min_var = bdd_instruction::topsink_index;
+                    for(size_t i=0; i<N; ++i)
+                    {
+                        const size_t idx = tuples[t*N + i];
+                        const bdd_instruction& instr = bdd_instructions[idx];
+                        const size_t child_idx = instr.index != v ? idx : (b == 0 ? instr.lo : instr.hi);
+                        const bdd_instruction& child_instr = bdd_instructions[child_idx];
+                        if(child_instr.is_botsink())
+                        {
+                            botsink = true;
+                            break;
+                        }
+                        if(!child_instr.is_topsink())
+                            min_var = std::min(min_var, child_instr.index);
+                        tuples[c*N + i] = child_idx;
+                    }
+                    child[b] = add_candidate(botsink, min_var);
                 }
-                o.bdd_delimiters.push_back(o.bdd_instructions.size());
-                assert(o.is_bdd(o.bdd_delimiters.size()-2));
+                children[t] = child;
             }
+        }
 
-            //generated_nodes.clear();
-            o.reduction.clear();
+        // reduce bottom up: equal children or node already present on stack
+        std::vector<size_t>().swap(tuples);
+        o.stack.push_back(bdd_instruction::botsink());
+        o.stack.push_back(bdd_instruction::topsink());
+        index_hash_table node_table;
+        auto node_hash = [&](const size_t s) {
+            return hash_mix(hash_mix(hash_mix(o.stack[s].lo) ^ o.stack[s].hi) ^ o.stack[s].index);
+        };
+        auto node_equal = [&](const size_t s1, const size_t s2) { return o.stack[s1] == o.stack[s2]; };
+        std::vector<size_t> stack_idx(children.size());
+        auto stack_index = [&](const size_t c) { return c < 2 ? c : stack_idx[c-2]; };
+        for(ptrdiff_t l=levels.size()-1; l>=0; --l)
+        {
+            for(const size_t t : levels[l])
+            {
+                const size_t lo = stack_index(children[t][0]);
+                const size_t hi = stack_index(children[t][1]);
+                if(lo == hi)
+                {
+                    stack_idx[t] = lo;
+                    continue;
+                }
+                o.stack.push_back({lo, hi, vars[l]});
+                stack_idx[t] = node_table.find_or_insert(o.stack.size()-1, node_hash, node_equal);
+                if(stack_idx[t] != o.stack.size()-1)
+                    o.stack.pop_back();
+            }
+        }
+        const size_t root_idx = stack_index(root);
+        if(root_idx < 2)
+        {
             o.stack.clear();
-            if(root_idx == std::numeric_limits<size_t>::max())
-                return std::numeric_limits<size_t>::max();
-            return o.bdd_delimiters.size()-2;
+            return o.add_terminal_bdd(root_idx == 1);
         }
+        assert(root_idx == o.stack.size()-1);
 
-    // explicit instantiation of bdd_and
-    template size_t bdd_collection::bdd_and<3>(const std::array<size_t,3>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<4>(const std::array<size_t,4>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<5>(const std::array<size_t,5>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<6>(const std::array<size_t,6>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<7>(const std::array<size_t,7>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<8>(const std::array<size_t,8>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<9>(const std::array<size_t,9>& bdds, bdd_collection& o);
-
-    template size_t bdd_collection::bdd_and<10>(const std::array<size_t,10>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<11>(const std::array<size_t,11>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<12>(const std::array<size_t,12>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<13>(const std::array<size_t,13>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<14>(const std::array<size_t,14>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<15>(const std::array<size_t,15>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<16>(const std::array<size_t,16>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<17>(const std::array<size_t,17>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<18>(const std::array<size_t,18>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<19>(const std::array<size_t,19>& bdds, bdd_collection& o);
-
-    template size_t bdd_collection::bdd_and<20>(const std::array<size_t,20>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<21>(const std::array<size_t,21>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<22>(const std::array<size_t,22>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<23>(const std::array<size_t,23>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<24>(const std::array<size_t,24>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<25>(const std::array<size_t,25>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<26>(const std::array<size_t,26>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<27>(const std::array<size_t,27>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<28>(const std::array<size_t,28>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<29>(const std::array<size_t,29>& bdds, bdd_collection& o);
-
-    template size_t bdd_collection::bdd_and<30>(const std::array<size_t,30>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<31>(const std::array<size_t,31>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<32>(const std::array<size_t,32>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<33>(const std::array<size_t,33>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<34>(const std::array<size_t,34>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<35>(const std::array<size_t,35>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<36>(const std::array<size_t,36>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<37>(const std::array<size_t,37>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<38>(const std::array<size_t,38>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<39>(const std::array<size_t,39>& bdds, bdd_collection& o);
-
-    template size_t bdd_collection::bdd_and<40>(const std::array<size_t,40>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<41>(const std::array<size_t,41>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<42>(const std::array<size_t,42>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<43>(const std::array<size_t,43>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<44>(const std::array<size_t,44>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<45>(const std::array<size_t,45>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<46>(const std::array<size_t,46>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<47>(const std::array<size_t,47>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<48>(const std::array<size_t,48>& bdds, bdd_collection& o);
-    template size_t bdd_collection::bdd_and<49>(const std::array<size_t,49>& bdds, bdd_collection& o);
-
-    // given two bdd_instructions indices, compute new melded node, if it has not yet been created. Return index on stack.
-    template<size_t N>
-    size_t bdd_collection::bdd_and_impl(const std::array<size_t,N>& bdds, std::unordered_map<std::array<size_t,N>,size_t,array_hasher<N>>& generated_nodes, bdd_collection& o)
-    {
-        // first, check whether node has been generated already
-        if(generated_nodes.count(bdds) > 0)
-            return generated_nodes.find(bdds)->second;
-
-        std::array<bdd_instruction,N> bdd_instrs;
-        for(size_t i=0; i<N; ++i)
-            bdd_instrs[i] = bdd_instructions[bdds[i]];
-
-        // check if all instructions are true
-        const bool all_true_terminal = [&]() {
-            for(bdd_instruction& f : bdd_instrs)
-                if(!f.is_topsink())
-                    return false;
-            return true;
-        }();
-        if(all_true_terminal)
-            return 1;
-
-        const bool one_false_terminal = [&]() {
-            for(bdd_instruction& f : bdd_instrs)
-                if(f.is_botsink())
-                    return true;
-            return false; 
-        }();
-        if(one_false_terminal)
-            return 0;
+        const size_t offset = o.bdd_delimiters.back();
+        for(ptrdiff_t s = o.stack.size()-1; s>=0; --s)
+        {
+            const bdd_instruction bdd_stack = o.stack[s];
+            const size_t lo = offset + o.stack.size() - bdd_stack.lo - 1;
+            const size_t hi = offset + o.stack.size() - bdd_stack.hi - 1;
+            o.bdd_instructions.push_back({lo, hi, o.stack[s].index});
+        }
+        o.bdd_delimiters.push_back(o.bdd_instructions.size());
+        assert(o.is_bdd(o.bdd_delimiters.size()-2));
 
-        const size_t v = [&]() {
-            size_t idx = std::numeric_limits<size_t>::max();
-            for(const bdd_instruction& f : bdd_instrs)
-                idx = std::min(idx, f.index);
-            return idx;
-        }();
+        o.stack.clear();
+        return o.bdd_delimiters.size()-2;
+    }
 
-        std::array<size_t,N> lo_nodes;
-        for(size_t i=0; i<N; ++i)
+    size_t bdd_collection::add_terminal_bdd(const bool topsink_root)
+    {
+        assert(bdd_delimiters.back() == bdd_instructions.size());
+        if(topsink_root)
         {
-            const bdd_instruction& f = bdd_instrs[i];
-            lo_nodes[i] = f.index == v ? f.lo : bdds[i];
+            bdd_instructions.push_back(bdd_instruction::topsink());
+            bdd_instructions.push_back(bdd_instruction::botsink());
         }
-        const size_t lo = bdd_and_impl(lo_nodes, generated_nodes, o);
-        if(lo == std::numeric_limits<size_t>::max())
-            return std::numeric_limits<size_t>::max();
-
-        std::array<size_t,N> hi_nodes;
-        for(size_t i=0; i<N; ++i)
+        else
         {
-            const bdd_instruction& f = bdd_instrs[i];
-            hi_nodes[i] = f.index == v ? f.hi : bdds[i];
+            bdd_instructions.push_back(bdd_instruction::botsink());
+            bdd_instructions.push_back(bdd_instruction::topsink());
         }
-        const size_t hi = bdd_and_impl(hi_nodes, generated_nodes, o);
-        if(hi == std::numeric_limits<size_t>::max())
-            return std::numeric_limits<size_t>::max();
-
-        if(lo == hi)
-            return lo;
-
-        if(o.reduction.count({lo,hi,v}) > 0)
-            return o.reduction.find({lo,hi,v})->second;
-
-        o.stack.push_back({lo, hi, v});
-        const size_t meld_idx = o.stack.size()-1;
-        generated_nodes.insert(std::make_pair(bdds, meld_idx));
-        o.reduction.insert(std::make_pair(bdd_instruction{lo,hi,v}, meld_idx));
-
-        return meld_idx;
+        bdd_delimiters.push_back(bdd_instructions.size());
+        assert(is_bdd(nr_bdds()-1));
+        return nr_bdds()-1;
     }
 
     size_t bdd_collection::add_bdd(node_ref root)
@@ -340,7 +442,8 @@ namespace BDD {
     node_ref bdd_collection::export_bdd(bdd_mgr& mgr, const size_t bdd_nr) const
     {
         assert(bdd_nr < nr_bdds());
-        assert(nr_bdd_nodes(bdd_nr) > 2);
+        if(nr_bdd_nodes(bdd_nr) == 2)
+            return bdd_instructions[bdd_delimiters[bdd_nr]].is_botsink() ? mgr.botsink() : mgr.topsink();
         // TODO: use vector and shift indices by offset
         std::unordered_map<size_t, node_ref> bdd_instr_hash;
         assert(bdd_instructions[bdd_delimiters[bdd_nr+1]-2].is_terminal());
@@ -503,7 +606,9 @@ namespace BDD {
                 return false;
         }
 
-        if(reachable_nodes(bdd_nr) != std::vector<char>(nr_bdd_nodes(bdd_nr),true))
+        // all branch nodes must be reachable, constant functions only reach one terminal
+        const std::vector<char> reachable = reachable_nodes(bdd_nr);
+        if(std::count(reachable.begin(), reachable.end()-2, false) > 0)
             return false;
         return true; 
     }
@@ -552,7 +657,7 @@ namespace BDD {
                 remove[idx - bdd_delimiters[bdd_nr]] = true;
         }
 
-        for(std::ptrdiff_t idx=bdd_delimiters[bdd_nr+1]-3; idx>=bdd_delimiters[bdd_nr]; --idx)
+        for(std::ptrdiff_t idx=bdd_delimiters[bdd_nr+1]-3; idx>=std::ptrdiff_t(bdd_delimiters[bdd_nr]); --idx)
         {
             if(!remove[idx - bdd_delimiters[bdd_nr]])
             {
@@ -575,6 +680,19 @@ namespace BDD {
             }
         }
 
+        // all nodes collapsed into a terminal
+        size_t root = bdd_delimiters[bdd_nr];
+        while(root < bdd_delimiters[bdd_nr+1]-2 && remove[root - bdd_delimiters[bdd_nr]])
+            root = bdd_instructions[root].lo;
+        if(root >= bdd_delimiters[bdd_nr+1]-2)
+        {
+            const bool topsink_root = bdd_instructions[root].is_topsink();
+            bdd_instructions.resize(bdd_delimiters[bdd_nr]);
+            bdd_delimiters.pop_back();
+            add_terminal_bdd(topsink_root);
+            return;
+        }
+
         remove_dead_nodes(remove);
         assert(no_parallel_arcs(bdd_nr));
         reorder(bdd_nr);
@@ -592,7 +710,7 @@ namespace BDD {
         bdd_map.insert({bdd_instructions[bdd_delimiters[bdd_nr+1]-1], bdd_delimiters[bdd_nr+1]-1});
         bdd_map.insert({bdd_instructions[bdd_delimiters[bdd_nr+1]-2], bdd_delimiters[bdd_nr+1]-2});
 
-        for(std::ptrdiff_t idx=bdd_delimiters[bdd_nr+1]-3; idx>=bdd_delimiters[bdd_nr]; --idx)
+        for(std::ptrdiff_t idx=bdd_delimiters[bdd_nr+1]-3; idx>=std::ptrdiff_t(bdd_delimiters[bdd_nr]); --idx)
         {
             bdd_instruction& instr = bdd_instructions[idx];
             auto it = bdd_map.find(instr);
@@ -615,7 +733,7 @@ namespace BDD {
     {
         assert(nr_bdds() > 0);
         const size_t bdd_nr = nr_bdds() - 1;
-        assert(bdd_basic_check(bdd_nr));
+        // nodes to be removed need not be reachable anymore, hence no bdd_basic_check here
         assert(remove.size() == nr_bdd_nodes(bdd_nr));
         assert(std::count(remove.begin(), remove.end(), false) > 0); // not all nodes are to be removed
         if(std::count(remove.begin(), remove.end(), true) == 0)
@@ -695,12 +813,211 @@ namespace BDD {
         const size_t bdd_nr = nr_bdds() - 1;
         assert(bdd_basic_check(bdd_nr));
 
-        remove_parallel_arcs();
-        reduce_isomorphic_subgraphs();
+        if(nr_bdd_nodes(bdd_nr) > parallel_threshold)
+        {
+            reorder(bdd_nr);
+            reduce_parallel();
+        }
+        else
+        {
+            remove_parallel_arcs();
+            reduce_isomorphic_subgraphs();
+        }
 
         assert(is_bdd(bdd_nr));
     }
 
+    namespace {
+        // nodes with equal variable are consecutive in reordered bdds. Return relative offsets of levels, last entry is the number of nodes
+        std::vector<size_t> level_offsets(const bdd_instruction* begin, const size_t nr_nodes)
+        {
+            assert(nr_nodes > 0);
+            std::vector<size_t> offsets = {0};
+            for(size_t i=1; i<nr_nodes; ++i)
+                if(begin[i].index != begin[i-1].index)
+                    offsets.push_back(i);
+            offsets.push_back(nr_nodes);
+            return offsets;
+        }
+
+        size_t nr_parallel_threads()
+        {
+#ifdef _OPENMP
+            return omp_in_parallel() ? 1 : omp_get_max_threads();
+#else
+            return 1;
+#endif
+        }
+
+        size_t thread_num()
+        {
+#ifdef _OPENMP
+            return omp_get_thread_num();
+#else
+            return 0;
+#endif
+        }
+    }
+
+    void bdd_collection::reduce_parallel()
+    {
+        assert(nr_bdds() > 0);
+        const size_t bdd_nr = nr_bdds() - 1;
+        assert(bdd_basic_check(bdd_nr));
+        assert(is_reordered(bdd_nr));
+
+        const size_t b = bdd_delimiters[bdd_nr];
+        const size_t n = nr_bdd_nodes(bdd_nr) - 2;
+        // constant bdds have no levels
+        if(n == 0)
+            return;
+        const std::vector<size_t> levels = level_offsets(&bdd_instructions[b], n);
+        const size_t nr_threads = nr_parallel_threads();
+
+        // representative of each node after removing parallel arcs and merging isomorphic nodes, relative to b
+        std::vector<size_t> rep(n+2);
+        rep[n] = n;
+        rep[n+1] = n+1;
+
+        // isomorphic nodes of large levels are detected by each thread for the nodes whose hash falls into its partition
+        constexpr static size_t min_partition_level_size = 4096;
+        std::vector<size_t> node_hash(n);
+        std::vector<size_t> partitioned(n);
+        std::vector<std::vector<size_t>> partition_offsets(nr_threads+1, std::vector<size_t>(nr_threads, 0));
+        auto instr_hash = [&](const size_t i) {
+            const bdd_instruction& instr = bdd_instructions[b+i];
+            return hash_mix(hash_mix(instr.lo) ^ instr.hi);
+        };
+        auto instr_equal = [&](const size_t i, const size_t j) {
+            return bdd_instructions[b+i].lo == bdd_instructions[b+j].lo && bdd_instructions[b+i].hi == bdd_instructions[b+j].hi;
+        };
+        // high bits, low ones are used for probing
+        auto partition = [&](const size_t h) { return (h >> 32) % nr_threads; };
+
+#pragma omp parallel num_threads(nr_threads)
+        {
+            const size_t tid = thread_num();
+            for(ptrdiff_t l=levels.size()-2; l>=0; --l)
+            {
+                const size_t level_begin = levels[l];
+                const size_t level_end = levels[l+1];
+                const size_t level_size = level_end - level_begin;
+                const size_t chunk_begin = level_begin + level_size * tid / nr_threads;
+                const size_t chunk_end = level_begin + level_size * (tid+1) / nr_threads;
+
+                // children are final, remove parallel arcs
+                std::fill(partition_offsets[tid+1].begin(), partition_offsets[tid+1].end(), 0);
+                for(size_t i=chunk_begin; i<chunk_end; ++i)
+                {
+                    bdd_instruction& instr = bdd_instructions[b+i];
+                    instr.lo = b + rep[instr.lo - b];
+                    instr.hi = b + rep[instr.hi - b];
+                    rep[i] = instr.lo == instr.hi ? instr.lo - b : i;
+                    if(rep[i] == i)
+                    {
+                        node_hash[i] = instr_hash(i);
+                        partition_offsets[tid+1][partition(node_hash[i])]++;
+                    }
+                }
+#pragma omp barrier
+
+                if(level_size < min_partition_level_size || nr_threads == 1)
+                {
+#pragma omp single
+                    {
+                        index_hash_table table;
+                        for(ptrdiff_t i=level_end-1; i>=ptrdiff_t(level_begin); --i)
+                            if(rep[i] == i)
+                                rep[i] = table.find_or_insert(i, instr_hash, instr_equal);
+                    }
+                }
+                else
+                {
+#pragma omp single
+                    {
+                        // partition p of thread t starts after all smaller partitions and after partition p of all smaller threads
+                        size_t offset = level_begin;
+                        for(size_t p=0; p<nr_threads; ++p)
+                            for(size_t t=0; t<nr_threads; ++t)
+                            {
+                                const size_t nr_entries = partition_offsets[t+1][p];
+                                partition_offsets[t][p] = offset;
+                                offset += nr_entries;
+                            }
+                        partition_offsets[nr_threads][0] = offset;
+                    }
+
+                    std::vector<size_t> partition_pos(partition_offsets[tid]);
+                    for(size_t i=chunk_begin; i<chunk_end; ++i)
+                        if(rep[i] == i)
+                            partitioned[partition_pos[partition(node_hash[i])]++] = i;
+#pragma omp barrier
+
+                    // entries of partition are in order of node indices, keep the last one of isomorphic nodes
+                    const size_t partition_begin = partition_offsets[0][tid];
+                    const size_t partition_end = tid+1 < nr_threads ? partition_offsets[0][tid+1] : partition_offsets[nr_threads][0];
+                    index_hash_table table;
+                    auto partitioned_hash = [&](const size_t k) { return node_hash[partitioned[k]]; };
+                    auto partitioned_equal = [&](const size_t k1, const size_t k2) { return instr_equal(partitioned[k1], partitioned[k2]); };
+                    for(ptrdiff_t k=partition_end-1; k>=ptrdiff_t(partition_begin); --k)
+                        rep[partitioned[k]] = partitioned[table.find_or_insert(k, partitioned_hash, partitioned_equal)];
+#pragma omp barrier
+                }
+            }
+        }
+
+        // all nodes collapsed into a terminal: the constant bdd has the root terminal first
+        if(rep[0] >= n)
+        {
+            const bool topsink_root = bdd_instructions[b + rep[0]].is_topsink();
+            bdd_instructions.resize(b);
+            bdd_delimiters.pop_back();
+            add_terminal_bdd(topsink_root);
+            return;
+        }
+
+        // remove dead nodes: representatives are kept in their order
+        std::vector<size_t> new_address(n+2);
+        std::vector<size_t> thread_offsets(nr_threads+1, 0);
+#pragma omp parallel num_threads(nr_threads)
+        {
+            const size_t tid = thread_num();
+            const size_t chunk_begin = n * tid / nr_threads;
+            const size_t chunk_end = n * (tid+1) / nr_threads;
+            for(size_t i=chunk_begin; i<chunk_end; ++i)
+                thread_offsets[tid+1] += rep[i] == i;
+#pragma omp barrier
+#pragma omp single
+            std::partial_sum(thread_offsets.begin(), thread_offsets.end(), thread_offsets.begin());
+
+            size_t offset = thread_offsets[tid];
+            for(size_t i=chunk_begin; i<chunk_end; ++i)
+                if(rep[i] == i)
+                    new_address[i] = offset++;
+        }
+        const size_t nr_remaining_nodes = thread_offsets.back();
+        new_address[n] = nr_remaining_nodes;
+        new_address[n+1] = nr_remaining_nodes+1;
+
+        std::vector<bdd_instruction> new_bdd_instructions(nr_remaining_nodes+2);
+#pragma omp parallel for num_threads(nr_threads) schedule(static)
+        for(size_t i=0; i<n; ++i)
+        {
+            if(rep[i] != i)
+                continue;
+            const bdd_instruction& instr = bdd_instructions[b+i];
+            new_bdd_instructions[new_address[i]] = {b + new_address[instr.lo - b], b + new_address[instr.hi - b], instr.index};
+        }
+        new_bdd_instructions[nr_remaining_nodes] = bdd_instructions[b+n];
+        new_bdd_instructions[nr_remaining_nodes+1] = bdd_instructions[b+n+1];
+
+        bdd_instructions.resize(b);
+        bdd_instructions.insert(bdd_instructions.end(), new_bdd_instructions.begin(), new_bdd_instructions.end());
+        bdd_delimiters.back() = bdd_instructions.size();
+
+        assert(is_reordered(bdd_nr));
+    }
+
     std::vector<size_t> bdd_collection::variables(const size_t bdd_nr) const
     {
         assert(bdd_nr < nr_bdds());
@@ -718,6 +1035,144 @@ namespace BDD {
         return vars;
     }
 
+    namespace {
+        // log2(2^a + 2^b)
+        double log2_add(const double a, const double b)
+        {
+            if(a == -std::numeric_limits<double>::infinity())
+                return b;
+            if(b == -std::numeric_limits<double>::infinity())
+                return a;
+            const double m = std::max(a,b);
+            return m + std::log2(std::exp2(a - m) + std::exp2(b - m));
+        }
+    }
+
+    double bdd_collection::log_nr_solutions_impl(const size_t bdd_nr, const std::vector<char>& forced, std::vector<double>* marginals) const
+    {
+        assert(bdd_nr < nr_bdds());
+        constexpr double minus_inf = -std::numeric_limits<double>::infinity();
+        const std::vector<size_t> vars = variables(bdd_nr);
+        assert(forced.size() == vars.size());
+        std::vector<size_t> nr_free(vars.size()+1, 0);
+        for(size_t i=0; i<vars.size(); ++i)
+            nr_free[i+1] = nr_free[i] + (forced[i] == 0);
+
+        const size_t begin = bdd_delimiters[bdd_nr];
+        const size_t end = bdd_delimiters[bdd_nr+1];
+        std::vector<size_t> position(end - begin);
+        for(size_t i=begin; i<end; ++i)
+        {
+            const bdd_instruction& instr = bdd_instructions[i];
+            position[i - begin] = instr.is_terminal() ? vars.size() : std::distance(vars.begin(), std::lower_bound(vars.begin(), vars.end(), instr.index));
+        }
+        // nr of free variables skipped by the arc from instruction i to instruction j
+        auto skipped = [&](const size_t i, const size_t j) -> double {
+            return nr_free[position[j - begin]] - nr_free[position[i - begin]+1];
+        };
+
+        // backward pass: log2 of nr of paths to top sink, counting free variables below the node
+        std::vector<double> beta(end - begin, minus_inf);
+        for(size_t i=end; i-- > begin;)
+        {
+            const bdd_instruction& instr = bdd_instructions[i];
+            if(instr.is_terminal())
+            {
+                beta[i - begin] = instr.is_topsink() ? 0.0 : minus_inf;
+                continue;
+            }
+            const char f = forced[position[i - begin]];
+            if(f != 1)
+                beta[i - begin] = log2_add(beta[i - begin], beta[instr.lo - begin] + skipped(i, instr.lo));
+            if(f != 2)
+                beta[i - begin] = log2_add(beta[i - begin], beta[instr.hi - begin] + skipped(i, instr.hi));
+        }
+        const double total = beta[0] + nr_free[position[0]];
+
+        if(marginals == nullptr)
+            return total;
+
+        marginals->clear();
+        marginals->resize(vars.size(), minus_inf);
+        if(total == minus_inf)
+            return total;
+
+        // forward pass: log2 of nr of paths from root, counting free variables above the node
+        std::vector<double> alpha(end - begin, minus_inf);
+        alpha[0] = nr_free[position[0]];
+        // fraction of solutions with variable at given position set to true. Arcs skipping free variables contribute half of their mass, collected in a difference array.
+        std::vector<double> fraction(vars.size(), 0.0);
+        std::vector<double> skipped_fraction(vars.size()+1, 0.0);
+        for(size_t i=begin; i<end-2; ++i)
+        {
+            const bdd_instruction& instr = bdd_instructions[i];
+            if(alpha[i - begin] == minus_inf)
+                continue;
+            const size_t p = position[i - begin];
+            const char f = forced[p];
+            for(const size_t c : {instr.lo, instr.hi})
+            {
+                if((c == instr.lo && f == 1) || (c == instr.hi && f == 2))
+                    continue;
+                const double mass = alpha[i - begin] + skipped(i, c) + beta[c - begin];
+                if(mass == minus_inf)
+                    continue;
+                alpha[c - begin] = log2_add(alpha[c - begin], alpha[i - begin] + skipped(i, c));
+                const double frac = std::exp2(mass - total);
+                if(c == instr.hi)
+                    fraction[p] += frac;
+                skipped_fraction[p+1] += 0.5 * frac;
+                skipped_fraction[position[c - begin]] -= 0.5 * frac;
+            }
+        }
+
+        double skipped_sum = 0.0;
+        for(size_t p=0; p<vars.size(); ++p)
+        {
+            skipped_sum += skipped_fraction[p];
+            if(forced[p] == 1)
+                (*marginals)[p] = total;
+            else if(forced[p] == 0)
+            {
+                const double frac = std::min(1.0, fraction[p] + skipped_sum);
+                (*marginals)[p] = frac > 0.0 ? total + std::log2(frac) : minus_inf;
+            }
+        }
+        return total;
+    }
+
+    double bdd_collection::log_nr_solutions(const size_t bdd_nr) const
+    {
+        assert(bdd_nr < nr_bdds());
+        return log_nr_solutions_impl(bdd_nr, std::vector<char>(variables(bdd_nr).size(), 0), nullptr);
+    }
+
+    std::vector<double> bdd_collection::log_nr_solutions_marginals(const size_t bdd_nr) const
+    {
+        assert(bdd_nr < nr_bdds());
+        std::vector<double> marginals;
+        log_nr_solutions_impl(bdd_nr, std::vector<char>(variables(bdd_nr).size(), 0), &marginals);
+        return marginals;
+    }
+
+    std::vector<double> bdd_collection::log_nr_solutions() const
+    {
+        std::vector<double> counts(nr_bdds());
+#pragma omp parallel for schedule(dynamic)
+        for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+            counts[bdd_nr] = log_nr_solutions(bdd_nr);
+        return counts;
+    }
+
+    std::vector<std::vector<double>> bdd_collection::log_nr_solutions_marginals() const
+    {
+        std::vector<std::vector<double>> marginals(nr_bdds());
+#pragma omp parallel for schedule(dynamic)
+        for(size_t bdd_nr=0; bdd_nr<nr_bdds(); ++bdd_nr)
+            marginals[bdd_nr] = log_nr_solutions_marginals(bdd_nr);
+        return marginals;
+    }
+
     std::array<size_t,2> bdd_collection::min_max_variables(const size_t bdd_nr) const
     {
         assert(bdd_nr < nr_bdds());
@@ -982,9 +1437,147 @@ namespace BDD {
         return idx;
     }
 
+    size_t bdd_collection::make_qbdd_parallel(const size_t bdd_nr, bdd_collection& o)
+    {
+        assert(bdd_nr < nr_bdds());
+        assert(is_reordered(bdd_nr));
+
+        const size_t b = bdd_delimiters[bdd_nr];
+        const size_t n = nr_bdd_nodes(bdd_nr) - 2;
+        const size_t botsink = botsink_index(bdd_nr) - b;
+        const size_t topsink = topsink_index(bdd_nr) - b;
+        const std::vector<size_t> levels = level_offsets(&bdd_instructions[b], n);
+        const size_t nr_levels = levels.size()-1;
+        const size_t nr_threads = nr_parallel_threads();
+
+        // arcs skipping levels are replaced by chains of intermediate nodes in front of their endpoint.
+        // The chain of a node starts at the level below its topmost parent with a skipping arc.
+        std::vector<size_t> level(n+2);
+        std::vector<std::atomic<size_t>> chain_top(n+2);
+        level[topsink] = nr_levels;
+        level[botsink] = nr_levels;
+        chain_top[topsink] = std::numeric_limits<size_t>::max();
+        chain_top[botsink] = std::numeric_limits<size_t>::max();
+#pragma omp parallel for num_threads(nr_threads) schedule(static)
+        for(size_t l=0; l<nr_levels; ++l)
+            for(size_t i=levels[l]; i<levels[l+1]; ++i)
+            {
+                level[i] = l;
+                chain_top[i].store(std::numeric_limits<size_t>::max(), std::memory_order_relaxed);
+            }
+
+#pragma omp parallel for num_threads(nr_threads) schedule(static)
+        for(size_t i=0; i<n; ++i)
+        {
+            const bdd_instruction& instr = bdd_instructions[b+i];
+            for(const size_t c : {instr.lo - b, instr.hi - b})
+            {
+                if(c == botsink || level[c] == level[i]+1)
+                    continue;
+                assert(level[c] > level[i]+1);
+                size_t cur_top = chain_top[c].load(std::memory_order_relaxed);
+                while(level[i]+1 < cur_top && !chain_top[c].compare_exchange_weak(cur_top, level[i]+1, std::memory_order_relaxed)) {}
+            }
+        }
+
+        // original nodes come first in their level, followed by intermediate nodes in order of their chain's endpoint.
+        // Each thread handles the chains of consecutive endpoints.
+        std::vector<std::vector<size_t>> chain_level_pos(nr_threads, std::vector<size_t>(nr_levels, 0));
+        std::vector<size_t> thread_chain_offsets(nr_threads+1, 0);
+        std::vector<size_t> chain_offset(n+2);
+        std::vector<size_t> chain_pos;
+        std::vector<size_t> level_pos(nr_levels+1);
+        const size_t base = o.bdd_instructions.size();
+
+#pragma omp parallel num_threads(nr_threads)
+        {
+            const size_t tid = thread_num();
+            const size_t chunk_begin = (n+2) * tid / nr_threads;
+            const size_t chunk_end = (n+2) * (tid+1) / nr_threads;
+            std::vector<size_t>& cur_level_pos = chain_level_pos[tid];
+            for(size_t c=chunk_begin; c<chunk_end; ++c)
+            {
+                if(chain_top[c] == std::numeric_limits<size_t>::max())
+                    continue;
+                thread_chain_offsets[tid+1] += level[c] - chain_top[c];
+                for(size_t k=chain_top[c]; k<level[c]; ++k)
+                    cur_level_pos[k]++;
+            }
+#pragma omp barrier
+#pragma omp single
+            {
+                std::partial_sum(thread_chain_offsets.begin(), thread_chain_offsets.end(), thread_chain_offsets.begin());
+                chain_pos.resize(thread_chain_offsets.back());
+                size_t offset = 0;
+                for(size_t l=0; l<nr_levels; ++l)
+                {
+                    level_pos[l] = offset;
+                    offset += levels[l+1] - levels[l];
+                    for(size_t t=0; t<nr_threads; ++t)
+                    {
+                        const size_t nr_chain_nodes = chain_level_pos[t][l];
+                        chain_level_pos[t][l] = offset;
+                        offset += nr_chain_nodes;
+                    }
+                }
+                level_pos[nr_levels] = offset;
+                o.bdd_instructions.resize(base + offset + 2);
+            }
+
+            size_t offset = thread_chain_offsets[tid];
+            for(size_t c=chunk_begin; c<chunk_end; ++c)
+            {
+                if(chain_top[c] == std::numeric_limits<size_t>::max())
+                    continue;
+                chain_offset[c] = offset;
+                for(size_t k=chain_top[c]; k<level[c]; ++k)
+                    chain_pos[offset++] = cur_level_pos[k]++;
+            }
+#pragma omp barrier
+
+            // new position of original node resp. of its topmost chain node reachable from level l
+            auto new_position = [&](const size_t c, const size_t l) -> size_t {
+                if(c == botsink)
+                    return level_pos[nr_levels] + 1;
+                if(level[c] == l)
+                    return c == topsink ? level_pos[nr_levels] : level_pos[l] + c - levels[l];
+                assert(chain_top[c] <= l && l < level[c]);
+                return chain_pos[chain_offset[c] + l - chain_top[c]];
+            };
+
+#pragma omp for schedule(static)
+            for(size_t i=0; i<n; ++i)
+            {
+                const bdd_instruction& instr = bdd_instructions[b+i];
+                o.bdd_instructions[base + new_position(i, level[i])] = {base + new_position(instr.lo - b, level[i]+1), base + new_position(instr.hi - b, level[i]+1), instr.index};
+            }
+#pragma omp for schedule(static)
+            for(size_t c=0; c<n+2; ++c)
+            {
+                if(chain_top[c] == std::numeric_limits<size_t>::max())
+                    continue;
+                for(size_t k=chain_top[c]; k<level[c]; ++k)
+                {
+                    const size_t next = base + new_position(c, k+1);
+                    o.bdd_instructions[base + new_position(c, k)] = {next, next, bdd_instructions[b + levels[k]].index};
+                }
+            }
+        }
+
+        o.bdd_instructions[base + level_pos[nr_levels]] = bdd_instruction::topsink();
+        o.bdd_instructions[base + level_pos[nr_levels] + 1] = bdd_instruction::botsink();
+        o.bdd_delimiters.push_back(o.bdd_instructions.size());
+        assert(o.is_reordered(o.bdd_delimiters.size()-2));
+
+        return o.bdd_delimiters.size() - 2;
+    }
+
     size_t bdd_collection::make_qbdd(const size_t bdd_nr, bdd_collection& o)
     {
         assert(bdd_nr < nr_bdds());
+        if(nr_bdd_nodes(bdd_nr) > parallel_threshold && is_reordered(bdd_nr))
+            return make_qbdd_parallel(bdd_nr, o);
+
         std::vector<size_t> vars = variables(bdd_nr);
         std::unordered_map<size_t,size_t> next_var_map;
         next_var_map.reserve(vars.size());
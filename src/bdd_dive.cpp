@@ -0,0 +1,58 @@
+#include "bdd_dive.h"
+#include "bdd_dive_base.hxx"
+#include "time_measure_util.h"
+
+namespace LPMP {
+
+    class bdd_dive::impl {
+        public:
+            impl(BDD::bdd_collection& bdd_col)
+                : dive(bdd_col)
+            {}
+
+            impl(BDD::bdd_collection& bdd_col, bdd_fix_options opts)
+                : dive(bdd_col)
+            {
+                dive.set_options(opts);
+            }
+
+            bdd_dive_base dive;
+    };
+
+    bdd_dive::bdd_dive(BDD::bdd_collection& bdd_col)
+    {
+        MEASURE_FUNCTION_EXECUTION_TIME; 
+        pimpl = std::make_unique<impl>(bdd_col);
+    }
+
+    bdd_dive::bdd_dive(BDD::bdd_collection& bdd_col, bdd_fix_options opts)
+    {
+        MEASURE_FUNCTION_EXECUTION_TIME; 
+        pimpl = std::make_unique<impl>(bdd_col, opts);
+    }
+
+    bdd_dive::bdd_dive(bdd_dive&& o)
+        : pimpl(std::move(o.pimpl))
+    {}
+
+    bdd_dive& bdd_dive::operator=(bdd_dive&& o)
+    { 
+        pimpl = std::move(o.pimpl);
+        return *this;
+    }
+
+    bdd_dive::~bdd_dive()
+    {}
+
+    bool bdd_dive::round(const std::vector<double> total_min_marginals)
+    {
+        pimpl->dive.set_total_min_marginals(total_min_marginals);
+        return pimpl->dive.fix_variables();
+    }
+
+    std::vector<char> bdd_dive::primal_solution()
+    {
+        return pimpl->dive.primal_solution();
+    }
+
+}
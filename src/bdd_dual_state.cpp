@@ -0,0 +1,117 @@
+#include "bdd_dual_state.h"
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+namespace LPMP {
+
+    // binary layout in native byte order:
+    // magic, version, structure hash, value size, #objective, objective (double), #costs, costs (float or double)
+    constexpr static char dual_state_magic[4] = {'B','D','D','S'};
+    constexpr static uint32_t dual_state_version = 1;
+
+    namespace {
+        template<typename T>
+            void write_value(std::ostream& s, const T& x)
+            {
+                s.write(reinterpret_cast<const char*>(&x), sizeof(T));
+            }
+
+        template<typename T>
+            T read_value(std::istream& s)
+            {
+                T x;
+                s.read(reinterpret_cast<char*>(&x), sizeof(T));
+                if(!s)
+                    throw std::runtime_error("dual state truncated");
+                return x;
+            }
+
+        template<typename T>
+            void write_vector(std::ostream& s, const std::vector<double>& v)
+            {
+                write_value<uint64_t>(s, v.size());
+                std::vector<T> v_conv(v.begin(), v.end());
+                s.write(reinterpret_cast<const char*>(v_conv.data()), v_conv.size() * sizeof(T));
+            }
+
+        template<typename T>
+            std::vector<double> read_vector(std::istream& s)
+            {
+                const uint64_t n = read_value<uint64_t>(s);
+                std::vector<T> v(n);
+                s.read(reinterpret_cast<char*>(v.data()), n * sizeof(T));
+                if(!s)
+                    throw std::runtime_error("dual state truncated");
+                return std::vector<double>(v.begin(), v.end());
+            }
+    }
+
+    void bdd_dual_state::write(std::ostream& s) const
+    {
+        s.write(dual_state_magic, sizeof(dual_state_magic));
+        write_value(s, dual_state_version);
+        write_value(s, structure_hash);
+        write_value(s, value_size);
+        write_vector<double>(s, objective);
+        if(value_size == sizeof(float))
+            write_vector<float>(s, costs);
+        else if(value_size == sizeof(double))
+            write_vector<double>(s, costs);
+        else
+            throw std::runtime_error("dual state costs must be float or double");
+    }
+
+    bdd_dual_state bdd_dual_state::read(std::istream& s)
+    {
+        char magic[sizeof(dual_state_magic)];
+        s.read(magic, sizeof(magic));
+        if(!s || std::memcmp(magic, dual_state_magic, sizeof(magic)) != 0)
+            throw std::runtime_error("no dual state");
+        if(read_value<uint32_t>(s) != dual_state_version)
+            throw std::runtime_error("unsupported dual state version");
+
+        bdd_dual_state state;
+        state.structure_hash = read_value<uint64_t>(s);
+        state.value_size = read_value<uint8_t>(s);
+        state.objective = read_vector<double>(s);
+        if(state.value_size == sizeof(float))
+            state.costs = read_vector<float>(s);
+        else if(state.value_size == sizeof(double))
+            state.costs = read_vector<double>(s);
+        else
+            throw std::runtime_error("dual state costs must be float or double");
+        return state;
+    }
+
+    void bdd_dual_state::save(const std::string& filename) const
+    {
+        std::ofstream f(filename, std::ios::binary);
+        if(!f)
+            throw std::runtime_error("could not open " + filename + " for writing dual state");
+        write(f);
+    }
+
+    bdd_dual_state bdd_dual_state::load(const std::string& filename)
+    {
+        std::ifstream f(filename, std::ios::binary);
+        if(!f)
+            throw std::runtime_error("could not open dual state file " + filename);
+        return read(f);
+    }
+
+    std::vector<char> bdd_dual_state::serialize() const
+    {
+        std::ostringstream s(std::ios::binary);
+        write(s);
+        const std::string str = s.str();
+        return std::vector<char>(str.begin(), str.end());
+    }
+
+    bdd_dual_state bdd_dual_state::deserialize(const char* begin, const char* end)
+    {
+        std::istringstream s(std::string(begin, end), std::ios::binary);
+        return read(s);
+    }
+
+}
@@ -1,6 +1,8 @@
 #include "bdd_manager/bdd_memo_cache.h"
 #include <cassert>
 #include <algorithm>
+#include <iostream>
+#include <cmath>
 
 namespace BDD {
 
@@ -14,18 +16,26 @@ namespace BDD {
         return !(*this == m);
     }
 
+    bool memo_struct::can_be_purged() const
+    {
+        if(r == nullptr)
+            return true;
+        if(r->xref < 0 || f->xref < 0 || g->xref < 0)
+            return true;
+        // binary operations store their symbol in h
+        if(h != and_symb() && h != or_symb() && h != xor_symb() && h->xref < 0)
+            return true;
+        return false;
+    }
+
     memo_cache::memo_cache(bdd_node_cache& _node_cache)
         : node_cache(_node_cache)
     {
         init_cache();
     }
 
-    size_t memo_cache::cache_hash(node* f, node* g, node* h)
+    size_t memo_cache::cache_hash(node* f, node* g, node* h) const
     {
-        //const std::size_t f_hash = f->index;
-        //const std::size_t g_hash = (h == nullptr) ? (g->index << 1) : (reinterpret_cast<size_t>(g) << 1);
-        //const std::size_t h_hash = reinterpret_cast<size_t>(h) << 2;
-
         const size_t f_hash = f->hash_key;
         assert(g != nullptr);
         const size_t g_hash = g->hash_key << 1;
@@ -34,147 +44,146 @@ namespace BDD {
         size_t hash = f_hash;
         hash ^= g_hash + 0x9e3779b9 + (hash << 6) + (hash >> 2);
         hash ^= h_hash + 0x9e3779b9 + (hash << 6) + (hash >> 2);
-        //return f_hash ^ g_hash ^ h_hash; 
         return hash;
     }
 
-    memo_struct& memo_cache::get_memo(const size_t slot)
+    memo_cache::operation memo_cache::memo_operation(node* h)
     {
-        assert(memos_mask + 1 == memos.size());
-        const size_t n = slot & memos_mask;
-        assert(n < memos.size());
-        //std::cout << "memo slot = " << n << ", memos size = " << memos.size() << ", cache mask = " << memos_mask << "\n";
-        return memos[n];
+        if(h == memo_struct::and_symb())
+            return operation::and_op;
+        if(h == memo_struct::or_symb())
+            return operation::or_op;
+        if(h == memo_struct::xor_symb())
+            return operation::xor_op;
+        return operation::ite_op;
     }
 
     node* memo_cache::cache_lookup(node* f, node* g, node* h)
     {
-        /*
-        if(memos2.count({f,g,h}) == 0)
-            return nullptr;
-
-        auto it = memos2.find({f,g,h})->second;
-        std::get<1>(it->second)++;
-        node* r = std::get<0>(it->second);
-        if(cache_inserts++ > threshold)
+        statistics& s = stats[static_cast<size_t>(memo_operation(h))];
+        const size_t set = cache_hash(f,g,h) & sets_mask;
+        memo_struct* m = &memos[associativity*set];
+        for(size_t i=0; i<associativity; ++i)
         {
-            cache_inserts = 0;
-            for(auto [k, v] : memos)
+            if(m[i].r != nullptr && m[i].f == f && m[i].g == g && m[i].h == h)
             {
-                const size_t ts = std::get<1>(v);
-
+                ++s.hits;
+                aging_bits[set] |= 1 << i;
+                // killed nodes stay in the memo cache until the next garbage collection
+                if(m[i].r->xref < 0)
+                    m[i].r->recursively_revive();
+                return m[i].r;
             }
-
-        }
-        return r;
-        */
-        ////////
-
-        const size_t slot = cache_hash(f,g,h);
-        const memo_struct& m = get_memo(slot); 
-        if(m.r == nullptr)
-            return nullptr;
-        if(m.f == f && m.g == g && m.h == h) 
-        {
-            assert(m.r != nullptr);
-            if(m.r->xref < 0)
-            {
-                assert(false);
-                m.r->recursively_revive();
-                return m.r;
-            }
-            //m.r->xref++;
-            return m.r;
         }
+        ++s.misses;
         return nullptr;
     }
 
     void memo_cache::cache_insert(node* f, node* g, node* h, node* r)
     {
-        //memos2.insert(std::make_pair(std::array<node*,3>({f,g,h}),{r,insert_time_stamp++}));
-        //return;
-        ////////
+        assert(r != nullptr);
+        const size_t hash = cache_hash(f,g,h);
+        const size_t set = hash & sets_mask;
+        memo_struct* m = &memos[associativity*set];
+        size_t way = associativity;
+        for(size_t i=0; i<associativity; ++i)
+        {
+            if(m[i].r != nullptr && m[i].f == f && m[i].g == g && m[i].h == h)
+            {
+                m[i].r = r;
+                return;
+            }
+            if(m[i].r == nullptr && way == associativity)
+                way = i;
+        }
 
-        const size_t slot = cache_hash(f,g,h);
-        if(++cache_inserts >= threshold)
+        ++stats[static_cast<size_t>(memo_operation(h))].insertions;
+        if(way == associativity)
+        {
+            // evict entry not hit since the last eviction, otherwise a pseudo-random one
+            way = (hash >> 60) % associativity;
+            for(size_t i=0; i<associativity; ++i)
+                if((aging_bits[set] & (1 << i)) == 0)
+                {
+                    way = i;
+                    break;
+                }
+            ++stats[static_cast<size_t>(memo_operation(m[way].h))].evictions;
+            aging_bits[set] = 0;
+            ++evictions_since_resize;
+        }
+        m[way] = {f, g, h, r};
+        aging_bits[set] &= ~(1 << way);
+
+        if(evictions_since_resize >= memos.size())
             double_cache();
-        memo_struct& m = get_memo(cache_hash(f,g,h));
-        m.f = f;
-        m.g = g;
-        m.h = h;
-        m.r = r;
     }
 
     void memo_cache::init_cache()
     {
         assert(memos.size() == 0);
-        memos.resize(1);
-        memos_mask = 0;
+        memos.resize(associativity);
+        aging_bits.resize(1, 0);
+        sets_mask = 0;
     }
 
-    void memo_cache::double_cache()
+    void memo_cache::resize(const size_t new_size)
     {
-        //std::cout << "double cache size\n";
-        if(memos.size() >= 2<<21)
-            return;
-        cache_inserts = 0;
-        threshold = 1 + memos.size();
-        assert(memos.size() > 0);
-        memos.resize(2 * memos.size());
-        memos_mask = memos.size()-1;
-        //std::cout << "new cache size = " << memos.size() << "\n";
-
-        // rehash items on bottom half
-        size_t occupied_slots = 0;
-        for(size_t k = 0; k < memos.size()/2; ++k)
+        assert(new_size >= associativity && (new_size & (new_size-1)) == 0);
+        std::vector<memo_struct> new_memos(new_size);
+        std::vector<uint8_t> new_aging_bits(new_size / associativity, 0);
+        const size_t new_sets_mask = new_size / associativity - 1;
+        // When growing, the entries of a set are split among two sets, hence no entry is lost. When shrinking, entries not fitting into their set are dropped.
+        for(const memo_struct& m : memos)
         {
-            memo& m = memos[k];
-            if(m.r != nullptr)
-            {
-                ++occupied_slots;
-                memo& mm = get_memo(cache_hash(m.f, m.g, m.h));
-                if(mm != m)
+            if(m.r == nullptr)
+                continue;
+            memo_struct* new_set = &new_memos[associativity * (cache_hash(m.f, m.g, m.h) & new_sets_mask)];
+            for(size_t i=0; i<associativity; ++i)
+                if(new_set[i].r == nullptr)
                 {
-                    mm = m;
-                    m.r = nullptr;
-                } 
-            } 
-        } 
-        cache_inserts = occupied_slots;
+                    new_set[i] = m;
+                    break;
+                }
+        }
+        std::swap(memos, new_memos);
+        std::swap(aging_bits, new_aging_bits);
+        sets_mask = new_sets_mask;
+        evictions_since_resize = 0;
     }
 
-    bool memo_struct::can_be_purged() const
+    void memo_cache::double_cache()
     {
-        if(r == nullptr)
-            return true; // TODO: or false?
-        if(r->xref < 0)
-            return true;
-        if(f->xref < 0)
-            return true;
-        if(h != nullptr && g->xref < 0)
-            return true;
-        return false;
+        if(2*memos.size() > max_size_)
+        {
+            evictions_since_resize = 0;
+            return;
+        }
+        resize(2*memos.size());
+    }
+
+    void memo_cache::set_max_size(const size_t max_entries)
+    {
+        size_t n = associativity;
+        while(2*n <= max_entries)
+            n *= 2;
+        max_size_ = n;
+        if(memos.size() > max_size_)
+            resize(max_size_);
     }
 
     size_t memo_cache::choose_cache_size(const size_t items) const
     {
         // size shall be power of 2 such that not more than a quarter of slots are taken
-        size_t count = 0;
-        size_t c = items;
-        while(c != 0)
-        {
-            c >>= 1;  
-            count += 1;  
-        }  
-        size_t n = 1 << (count+2);  
-        assert(4*items >= n);
-        assert(8*items <= n);
+        size_t n = associativity;
+        while(n < 4*items)
+            n *= 2;
         return n;
     }
 
-    size_t memo_cache::nr_occupied_slots() const
+    size_t memo_cache::memory_usage() const
     {
-        return std::count_if(memos.begin(), memos.end(), [](const auto& m) { return !m.can_be_purged(); });
+        return memos.capacity() * sizeof(memo_struct) + aging_bits.capacity() * sizeof(uint8_t);
     }
 
     void memo_cache::purge()
@@ -186,24 +195,27 @@ namespace BDD {
             else
                 ++items;
 
-        return;
-        // TODO: resize memo cache? A resize will often not physically deallocate freed memory.
-        cache_inserts = items;
-        const size_t new_cache_size = choose_cache_size(items);
+        // shrink memo cache by a factor of 8 if sparsely populated, such that it need not be regrown all the way when filled again.
+        // The entries are moved to a newly allocated vector, since resizing would not deallocate memory.
+        const size_t new_cache_size = std::max(choose_cache_size(items), memos.size()/8);
+        if(8*new_cache_size <= memos.size())
+            resize(new_cache_size);
+    }
 
-        if(new_cache_size < memos.size())
+    void memo_cache::reset_statistics()
+    {
+        stats = {};
+    }
+
+    void memo_cache::print_statistics() const
+    {
+        constexpr static std::array<const char*,4> names = {"and", "or", "xor", "ite"};
+        std::cout << "[bdd memo cache] " << memos.size() << " entries of at most " << max_size_ << ", " << associativity << "-way set associative\n";
+        for(size_t op=0; op<stats.size(); ++op)
         {
-            size_t memos_mask = new_cache_size - 1;
-            for(size_t k = 0; k < memos.size(); ++k)
-            {
-                if(memos[k].r != nullptr && memos[k].h != nullptr)
-                {
-                    const size_t new_slot = cache_hash(memos[k].f, memos[k].g, memos[k].h) & memos_mask;
-                    if(new_slot != k)
-                        memos[new_slot] = memos[k];
-                }
-            }
-            memos.resize(new_cache_size);
+            const statistics& s = stats[op];
+            std::cout << "[bdd memo cache] " << names[op] << ": " << s.hits << " hits, " << s.misses << " misses, hit rate " << std::round(1000.0 * s.hit_rate()) / 10.0 << "%, "
+                << s.insertions << " insertions, " << s.evictions << " evictions\n";
         }
     }
 }
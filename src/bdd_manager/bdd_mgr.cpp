@@ -2,6 +2,11 @@
 #include "bdd_collection/bdd_collection.h"
 #include <cassert>
 #include <stack>
+#include <iostream>
+#include <stdexcept>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
 namespace BDD {
 
@@ -40,16 +45,7 @@ namespace BDD {
 
     node_ref bdd_mgr::negate(node_ref p)
     {
-        if(p.is_botsink())
-            return node_ref(node_cache_.topsink());
-        if(p.is_topsink())
-            return node_ref(node_cache_.botsink());
-        else
-        {
-            const std::size_t v = p.variable();
-            assert(v < nr_variables());
-            return node_ref(vars[v].unique_find( negate(p.low()).ref, negate(p.high()).ref));
-        }
+        return node_ref(apply(apply_op::xor_op, node_cache_.topsink(), p.address(), nullptr));
     }
 
     node_ref bdd_mgr::unique_find(const size_t var, node_ref lo, node_ref hi)
@@ -58,13 +54,213 @@ namespace BDD {
         return node_ref(vars[var].unique_find(lo.address(), hi.address()));
     }
 
+    node* bdd_mgr::apply_lookup(const apply_op op, node*& f, node*& g, node*& h)
+    {
+        node* top = node_cache_.topsink();
+        node* bot = node_cache_.botsink();
+        switch(op) {
+            case apply_op::and_op:
+                if(f == g)
+                    return f;
+                if(f > g)
+                    std::swap(f,g);
+                if(f == bot || g == bot)
+                    return bot;
+                if(f == top)
+                    return g;
+                if(g == top)
+                    return f;
+                return memo_.cache_lookup(f, g, memo_struct::and_symb());
+            case apply_op::or_op:
+                if(f == g)
+                    return f;
+                if(f > g)
+                    std::swap(f,g);
+                if(f == top || g == top)
+                    return top;
+                if(f == bot)
+                    return g;
+                if(g == bot)
+                    return f;
+                return memo_.cache_lookup(f, g, memo_struct::or_symb());
+            case apply_op::xor_op:
+                // xor with topsink is expanded further, it is resolved at the terminals
+                if(f == g)
+                    return bot;
+                if(f > g)
+                    std::swap(f,g);
+                if(f == bot)
+                    return g;
+                if(g == bot)
+                    return f;
+                return memo_.cache_lookup(f, g, memo_struct::xor_symb());
+            case apply_op::ite_op:
+                if(f == top)
+                    return g;
+                if(f == bot)
+                    return h;
+                if(g == f)
+                    g = top;
+                if(h == f)
+                    h = bot;
+                if(g == h)
+                    return g;
+                if(g == top && h == bot)
+                    return f;
+                return memo_.cache_lookup(f, g, h);
+        }
+        assert(false);
+        return nullptr;
+    }
+
+    namespace {
+        size_t apply_request_hash(node* f, node* g, node* h)
+        {
+            size_t hash = 0;
+            for(node* p : {f, g, h})
+                hash ^= std::hash<node*>{}(p) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            return hash;
+        }
+    }
+
+    std::uintptr_t bdd_mgr::apply_request(const apply_op op, node* f, node* g, node* h)
+    {
+        if(node* r = apply_lookup(op, f, g, h); r != nullptr)
+        {
+            assert((reinterpret_cast<std::uintptr_t>(r) & 1) == 0);
+            return reinterpret_cast<std::uintptr_t>(r);
+        }
+
+        if(2*(apply_requests_.size()+1) > apply_request_table_.size())
+            grow_apply_request_table();
+        const size_t mask = apply_request_table_.size()-1;
+        size_t slot = apply_request_hash(f, g, h) & mask;
+        for(; apply_request_table_[slot] != 0; slot = (slot+1) & mask)
+        {
+            const size_t i = apply_request_table_[slot] - 1;
+            if(apply_requests_[i].f == f && apply_requests_[i].g == g && apply_requests_[i].h == h)
+                return (i << 1) | 1;
+        }
+        apply_request_table_[slot] = apply_requests_.size() + 1;
+
+        // terminals have the largest indices
+        const size_t v = std::min({size_t(f->index), size_t(g->index), size_t(h != nullptr ? h->index : f->index)});
+        assert(v < nr_variables());
+        if(apply_levels_[v].empty())
+        {
+            apply_level_heap_.push_back(v);
+            std::push_heap(apply_level_heap_.begin(), apply_level_heap_.end(), std::greater<size_t>());
+        }
+        apply_levels_[v].push_back(apply_requests_.size());
+        apply_requests_.push_back({f, g, h, 0, 0, nullptr, slot});
+        return ((apply_requests_.size()-1) << 1) | 1;
+    }
+
+    void bdd_mgr::grow_apply_request_table()
+    {
+        const size_t size = std::max(size_t(1024), 2*apply_request_table_.size());
+        apply_request_table_.clear();
+        apply_request_table_.resize(size, 0);
+        for(size_t i=0; i<apply_requests_.size(); ++i)
+        {
+            apply_request_struct& req = apply_requests_[i];
+            size_t slot = apply_request_hash(req.f, req.g, req.h) & (size-1);
+            while(apply_request_table_[slot] != 0)
+                slot = (slot+1) & (size-1);
+            apply_request_table_[slot] = i+1;
+            req.slot = slot;
+        }
+    }
+
+    node* bdd_mgr::apply(const apply_op op, node* f, node* g, node* h)
+    {
+        assert(apply_requests_.empty() && apply_level_heap_.empty());
+        collect_garbage_if_needed();
+        if(apply_levels_.size() < nr_variables())
+            apply_levels_.resize(nr_variables());
+
+        const std::uintptr_t root = apply_request(op, f, g, h);
+        if((root & 1) == 0)
+            return reinterpret_cast<node*>(root);
+
+        // expand requests top down. Cofactors lie on deeper levels, hence each level is complete when it is expanded.
+        while(!apply_level_heap_.empty())
+        {
+            std::pop_heap(apply_level_heap_.begin(), apply_level_heap_.end(), std::greater<size_t>());
+            const size_t v = apply_level_heap_.back();
+            apply_level_heap_.pop_back();
+            apply_expanded_levels_.push_back(v);
+
+            auto low = [v](node* p) { return p != nullptr && p->index == v ? p->lo : p; };
+            auto high = [v](node* p) { return p != nullptr && p->index == v ? p->hi : p; };
+            for(const size_t i : apply_levels_[v])
+            {
+                node* rf = apply_requests_[i].f;
+                node* rg = apply_requests_[i].g;
+                node* rh = apply_requests_[i].h;
+                const std::uintptr_t lo = apply_request(op, low(rf), low(rg), low(rh));
+                const std::uintptr_t hi = apply_request(op, high(rf), high(rg), high(rh));
+                apply_requests_[i].lo = lo;
+                apply_requests_[i].hi = hi;
+            }
+        }
+
+        // reduce bottom up, one variable at a time
+        auto resolve = [&](const std::uintptr_t x) {
+            if((x & 1) == 0)
+                return reinterpret_cast<node*>(x);
+            assert(apply_requests_[x >> 1].r != nullptr);
+            return apply_requests_[x >> 1].r;
+        };
+        node* h_symb = op == apply_op::and_op ? memo_struct::and_symb() : op == apply_op::or_op ? memo_struct::or_symb() : memo_struct::xor_symb();
+        for(auto level_it=apply_expanded_levels_.rbegin(); level_it!=apply_expanded_levels_.rend(); ++level_it)
+        {
+            const size_t v = *level_it;
+            for(const size_t i : apply_levels_[v])
+            {
+                apply_request_struct& req = apply_requests_[i];
+                req.r = vars[v].unique_find(resolve(req.lo), resolve(req.hi));
+                assert(req.r != nullptr);
+                memo_.cache_insert(req.f, req.g, op == apply_op::ite_op ? req.h : h_symb, req.r);
+            }
+            apply_levels_[v].clear();
+        }
+
+        node* r = resolve(root);
+        for(const auto& req : apply_requests_)
+            apply_request_table_[req.slot] = 0;
+        apply_requests_.clear();
+        apply_expanded_levels_.clear();
+        return r;
+    }
+
     node_ref bdd_mgr::and_rec(node_ref f, node_ref g)
+    {
+        return node_ref(apply(apply_op::and_op, f.address(), g.address(), nullptr));
+    }
+
+    node_ref bdd_mgr::or_rec(node_ref f, node_ref g)
+    {
+        return node_ref(apply(apply_op::or_op, f.address(), g.address(), nullptr));
+    }
+
+    node_ref bdd_mgr::xor_rec(node_ref f, node_ref g)
+    {
+        return node_ref(apply(apply_op::xor_op, f.address(), g.address(), nullptr));
+    }
+
+    node_ref bdd_mgr::ite_rec(node_ref f, node_ref g, node_ref h)
+    {
+        return node_ref(apply(apply_op::ite_op, f.address(), g.address(), h.address()));
+    }
+
+    node_ref bdd_mgr::and_recursive(node_ref f, node_ref g)
     {
         if(f == g)
             return f;
 
         if(f.ref > g.ref)
-            return and_rec(g,f);
+            return and_recursive(g,f);
 
         if(f.ref == node_cache_.topsink())
             return g;
@@ -88,9 +284,9 @@ namespace BDD {
                 return g_var;
         }();
 
-        node_ref r0 = and_rec(&v == &f_var ? f.low() : f, &v == &g_var ? g.low() : g);
+        node_ref r0 = and_recursive(&v == &f_var ? f.low() : f, &v == &g_var ? g.low() : g);
         assert(r0.ref != nullptr);
-        node_ref r1 = and_rec(&v == &f_var ? f.high() : f, &v == &g_var ? g.high() : g);
+        node_ref r1 = and_recursive(&v == &f_var ? f.high() : f, &v == &g_var ? g.high() : g);
         assert(r1.ref != nullptr);
         
         node* r = v.unique_find(r0.ref, r1.ref);
@@ -100,70 +296,80 @@ namespace BDD {
         return node_ref(r); 
     }
 
-    // return
     std::tuple<node_ref,size_t> bdd_mgr::and_rec_limited(node_ref f, node_ref g, const size_t node_limit)
     {
-        if(f == g)
-        {
-            const size_t nr_nodes = f.nr_nodes();
-            if(nr_nodes > node_limit)
-               return {node_ref(nullptr), std::numeric_limits<size_t>::max()};
-            return {f,nr_nodes};
-        }
-
-        if(f.ref > g.ref)
-            return and_rec_limited(g,f,node_limit);
-
-        if(f.ref == node_cache_.topsink())
-            return {g,g.nr_nodes()};
-        else if(f.ref == node_cache_.botsink())
-            return {node_ref(node_cache_.botsink()),0};
-        else if(g.ref == node_cache_.topsink())
-            return {f,f.nr_nodes()};
-        else if(g.ref == node_cache_.botsink())
-            return {node_ref(node_cache_.botsink()),0};
-
-        node* m = memo_.cache_lookup(f.ref, g.ref, memo_struct::and_symb());
-        if(m != nullptr)
+        collect_garbage_if_needed();
+        // Nodes of the conjunction are marked and counted when reached. Since results of subproblems are final before their parents are built, each node is counted once.
+        std::vector<node*> counted;
+        auto count = [&](node* r) {
+            std::vector<node*> s = {r};
+            while(!s.empty())
+            {
+                node* p = s.back();
+                s.pop_back();
+                if(p->is_terminal() || p->marked())
+                    continue;
+                p->marked_ = 1;
+                counted.push_back(p);
+                if(counted.size() > node_limit)
+                    return false;
+                s.push_back(p->lo);
+                s.push_back(p->hi);
+            }
+            return true;
+        };
+        auto finish = [&](node* r) -> std::tuple<node_ref,size_t> {
+            for(node* p : counted)
+                p->marked_ = 0;
+            return {node_ref(r), counted.size()};
+        };
+
+        node* h = nullptr;
+        node* fp = f.address();
+        node* gp = g.address();
+        if(node* r = apply_lookup(apply_op::and_op, fp, gp, h); r != nullptr)
+            return finish(count(r) ? r : nullptr);
+
+        // explicit depth first search stack. state is the number of cofactors requested so far
+        struct frame { node* f; node* g; node* lo; node* hi; char state; };
+        std::vector<frame> s = {{fp, gp, nullptr, nullptr, 0}};
+        while(!s.empty())
         {
-            const size_t m_nr_nodes = m->nr_nodes();
-            if(m != nullptr)
+            frame& fr = s.back();
+            const size_t v = std::min(size_t(fr.f->index), size_t(fr.g->index));
+            if(fr.state < 2)
             {
-                if(m_nr_nodes <= node_limit)
-                    return {node_ref(m), m_nr_nodes};
-                else 
-                    return {node_ref(nullptr), std::numeric_limits<size_t>::max()};
+                const bool high = fr.state == 1;
+                fr.state++;
+                node* cf = fr.f->index == v ? (high ? fr.f->hi : fr.f->lo) : fr.f;
+                node* cg = fr.g->index == v ? (high ? fr.g->hi : fr.g->lo) : fr.g;
+                if(node* r = apply_lookup(apply_op::and_op, cf, cg, h); r != nullptr)
+                {
+                    if(!count(r))
+                        return finish(nullptr);
+                    (high ? fr.hi : fr.lo) = r;
+                }
+                else
+                    s.push_back({cf, cg, nullptr, nullptr, 0});
+                continue;
             }
-        }
-
-        var& f_var = vars[f.variable()];
-        var& g_var = vars[g.variable()];
-        var& v = [&]() -> var& {
-            if(&f_var < &g_var)
-                return f_var;
-            else 
-                return g_var;
-        }();
 
-        auto [r0, r0_nr_nodes] = and_rec_limited(&v == &f_var ? f.low() : f, &v == &g_var ? g.low() : g, node_limit);
-        assert((r0 == nullptr) == (r0_nr_nodes == std::numeric_limits<size_t>::max()));
-        assert(r0.ref != nullptr || r0_nr_nodes == std::numeric_limits<size_t>::max());
-        if(r0_nr_nodes > node_limit)
-            return {node_ref(nullptr), std::numeric_limits<size_t>::max()};
-        auto [r1, r1_nr_nodes] = and_rec_limited(&v == &f_var ? f.high() : f, &v == &g_var ? g.high() : g, node_limit);
-        assert((r1 == nullptr) == (r1_nr_nodes == std::numeric_limits<size_t>::max()));
-        assert(r1.ref != nullptr || r1_nr_nodes == std::numeric_limits<size_t>::max());
-        if(r0_nr_nodes == std::numeric_limits<size_t>::max() || r1_nr_nodes == std::numeric_limits<size_t>::max() || r0_nr_nodes + r1_nr_nodes > node_limit)
-            return {node_ref(nullptr), std::numeric_limits<size_t>::max()};
-        
-        node* r = v.unique_find(r0.ref, r1.ref);
-        assert(r != nullptr);
-        //if(r != nullptr)
-        memo_.cache_insert(f.ref, g.ref, memo_struct::and_symb(), r);
-        return {node_ref(r),r0_nr_nodes + r1_nr_nodes}; 
+            node* r = vars[v].unique_find(fr.lo, fr.hi);
+            assert(r != nullptr);
+            memo_.cache_insert(fr.f, fr.g, memo_struct::and_symb(), r);
+            // subgraphs of children are counted already
+            if(!count(r))
+                return finish(nullptr);
+            s.pop_back();
+            if(s.empty())
+                return finish(r);
+            (s.back().state == 1 ? s.back().lo : s.back().hi) = r;
+        }
+        assert(false);
+        return finish(nullptr);
     }
 
-    node_ref bdd_mgr::or_rec(node_ref f, node_ref g)
+    node_ref bdd_mgr::or_recursive(node_ref f, node_ref g)
     {
         // trivial cases
         if(f == g)
@@ -172,7 +378,7 @@ namespace BDD {
         }
 
         if(f.ref > g.ref)
-            return or_rec(g,f);
+            return or_recursive(g,f);
             //std::swap(f,g);
 
         if(f.ref == node_cache_.topsink())
@@ -206,9 +412,9 @@ namespace BDD {
                 return g_var;
         }();
 
-        node_ref r0 = or_rec(&v == &f_var ? f.low() : f, &v == &g_var ? g.low() : g);
+        node_ref r0 = or_recursive(&v == &f_var ? f.low() : f, &v == &g_var ? g.low() : g);
         assert(r0.ref != nullptr);
-        node_ref r1 = or_rec(&v == &f_var ? f.high() : f, &v == &g_var ? g.high() : g);
+        node_ref r1 = or_recursive(&v == &f_var ? f.high() : f, &v == &g_var ? g.high() : g);
         assert(r1.ref != nullptr);
         
         node* r = v.unique_find(r0.ref, r1.ref);
@@ -217,14 +423,14 @@ namespace BDD {
         return node_ref(r); 
     }
 
-    node_ref bdd_mgr::xor_rec(node_ref f, node_ref g)
+    node_ref bdd_mgr::xor_recursive(node_ref f, node_ref g)
     {
         // trivial cases
         if(f == g)
             return node_ref(node_cache_.botsink());
 
         if(f.ref > g.ref)
-            return xor_rec(g,f);
+            return xor_recursive(g,f);
 
         if(f.ref == node_cache_.botsink())
             return g;
@@ -244,11 +450,11 @@ namespace BDD {
         var& vf = vars[f.variable()];
         assert(g.variable() < nr_variables());
         var& vg = vars[g.variable()];
-        var& v = *std::max(&vg,&vf);
+        var& v = *std::min(&vg,&vf);
 
-        node_ref r0 = xor_rec(&v == &vf ? f.low() : f, &v == &vg ? g.low() : g);
+        node_ref r0 = xor_recursive(&v == &vf ? f.low() : f, &v == &vg ? g.low() : g);
         assert(r0.ref != nullptr);
-        node_ref r1 = xor_rec(&v == &vf ? f.high() : f, &v == &vg ? g.high() : g);
+        node_ref r1 = xor_recursive(&v == &vf ? f.high() : f, &v == &vg ? g.high() : g);
         assert(r1.ref != nullptr);
         
         node* r = v.unique_find(r0.ref, r1.ref);
@@ -257,7 +463,7 @@ namespace BDD {
         return node_ref(r); 
     }
 
-    node_ref bdd_mgr::ite_rec(node_ref f, node_ref g, node_ref h)
+    node_ref bdd_mgr::ite_recursive(node_ref f, node_ref g, node_ref h)
     {
         // trivial cases
         if(f.is_topsink())
@@ -266,38 +472,36 @@ namespace BDD {
             return h;
 
         if(g == f || g.is_topsink())
-            return or_rec(f,h);
+            return or_recursive(f,h);
         if(h == f || h.is_botsink())
-            return and_rec(f,g);
+            return and_recursive(f,g);
 
         if(g == h)
             return g;
 
         if(g.is_botsink() && h.is_topsink())
-            return xor_rec(node_ref(get_node_cache().topsink()), f);
+            return xor_recursive(node_ref(get_node_cache().topsink()), f);
 
         node* m = memo_.cache_lookup(f.ref, g.ref, h.ref);
         if(m != nullptr)
             return node_ref(m);
 
-        var& vf = vars[f.variable()];
-        var& vg = g.is_terminal() ? vars.back() : vars[g.variable()];
-        var& vh = h.is_terminal() ? vars.back() : vars[h.variable()];
-
-        //var& v = *std::min({&vf,&vg,&vh}); // compilation error on gcc-8.1?
-        var& v = *std::min(std::min(&vf,&vg),&vh);
+        // terminals have the largest indices, hence are never branched on
+        const size_t vi = std::min({f.variable(), g.variable(), h.variable()});
+        assert(vi < nr_variables());
+        var& v = vars[vi];
 
-        node_ref r0 = ite_rec(
-                (&vf == &v ? f.low() : f),
-                (&vg == &v ? g.low() : g),
-                (&vh == &v ? h.low() : h)
+        node_ref r0 = ite_recursive(
+                (f.variable() == vi ? f.low() : f),
+                (g.variable() == vi ? g.low() : g),
+                (h.variable() == vi ? h.low() : h)
                 );
         assert(r0.ref != nullptr);
 
-        node_ref r1 = ite_rec(
-                (&vf == &v ? f.high() : f),
-                (&vg == &v ? g.high() : g),
-                (&vh == &v ? h.high() : h)
+        node_ref r1 = ite_recursive(
+                (f.variable() == vi ? f.high() : f),
+                (g.variable() == vi ? g.high() : g),
+                (h.variable() == vi ? h.high() : h)
                 );
         assert(r1.ref != nullptr);
 
@@ -307,12 +511,77 @@ namespace BDD {
         return node_ref(r); 
     }
 
-    void bdd_mgr::collect_garbage()
+    size_t bdd_mgr::memory_usage() const
+    {
+        return node_cache_.memory_usage() + page_cache_.memory_usage() + memo_.memory_usage();
+    }
+
+    void bdd_mgr::set_garbage_collection(const double dead_node_ratio, const size_t min_nodes, const bool verbose)
     {
+        dead_node_ratio_ = dead_node_ratio;
+        gc_min_nodes_ = min_nodes;
+        gc_threshold_ = min_nodes;
+        gc_verbose_ = verbose;
+    }
+
+    size_t bdd_mgr::kill_dead_nodes()
+    {
+        // variables are processed in order, such that nodes whose parents are all killed are killed as well
+        size_t nr_killed = 0;
         for(size_t i=0; i<vars.size(); ++i)
-            vars[i].remove_dead_nodes();
+            nr_killed += vars[i].kill_dead_nodes();
+        return nr_killed;
+    }
 
+    void bdd_mgr::remove_dead_nodes(const std::chrono::steady_clock::time_point start_time)
+    {
+        const size_t memory_before = memory_usage();
+
+        // memo entries must not refer to freed nodes
         memo_.purge();
+        size_t nr_freed = 0;
+        for(size_t i=0; i<vars.size(); ++i)
+            nr_freed += vars[i].remove_dead_nodes();
+        page_cache_.release_free_pages();
+        node_cache_.release_free_pages();
+#if defined(__GLIBC__)
+        malloc_trim(0);
+#endif
+
+        // shrinking unique tables may allocate pages of smaller size
+        const size_t reclaimed = memory_before - std::min(memory_before, memory_usage());
+        const double pause = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        gc_stats_.nr_collections++;
+        gc_stats_.nr_freed_nodes += nr_freed;
+        gc_stats_.reclaimed_bytes += reclaimed;
+        gc_stats_.total_pause += pause;
+        gc_stats_.max_pause = std::max(gc_stats_.max_pause, pause);
+        if(gc_verbose_)
+            std::cout << "[bdd mgr] garbage collection freed " << nr_freed << " nodes, " << nr_nodes() << " nodes remaining, reclaimed " << reclaimed / (1024*1024) << " MB, pause " << pause << " s\n";
+    }
+
+    void bdd_mgr::collect_garbage()
+    {
+        const auto start_time = std::chrono::steady_clock::now();
+        kill_dead_nodes();
+        remove_dead_nodes(start_time);
+    }
+
+    void bdd_mgr::collect_garbage_if_needed()
+    {
+        const bool memory_exceeded = memory_limit_ != std::numeric_limits<size_t>::max() && memory_usage() > memory_limit_;
+        if(nr_nodes() < gc_threshold_ && !memory_exceeded)
+            return;
+
+        // killed nodes that are not collected are revived when found again in the unique table or memo cache
+        const auto start_time = std::chrono::steady_clock::now();
+        const size_t nr_killed = kill_dead_nodes();
+        if(memory_exceeded || double(nr_killed) >= dead_node_ratio_ * double(nr_nodes() - 2))
+            remove_dead_nodes(start_time);
+        gc_threshold_ = std::max(gc_min_nodes_, 2*nr_nodes());
+
+        if(memory_exceeded && memory_usage() > memory_limit_)
+            throw std::runtime_error("bdd manager memory usage of " + std::to_string(memory_usage() / (1024*1024)) + " MB exceeds limit of " + std::to_string(memory_limit_ / (1024*1024)) + " MB after garbage collection");
     }
 
     node_ref bdd_mgr::add_bdd(bdd_collection& bdd_col, const size_t bdd_nr)
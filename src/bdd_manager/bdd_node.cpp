@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <cstring>
 #include <deque>
+#include <tuple>
 #include <fstream>
 #include <filesystem>
 #include <cstdlib>
@@ -40,18 +41,25 @@ namespace BDD {
 
     size_t node::nr_nodes_impl()
     {
-        // TODO: make non-recursive
         if(is_terminal())
             return 0;
         assert(marked_ == 0);
 
-        size_t n = 1;
+        size_t n = 0;
+        std::vector<node*> s = {this};
         marked_ = 1;
-        if(lo->marked_ == 0)
-            n += lo->nr_nodes_impl();
-        if(hi->marked_ == 0)
-            n += hi->nr_nodes_impl();
-        
+        while(!s.empty())
+        {
+            node* p = s.back();
+            s.pop_back();
+            ++n;
+            for(node* c : {p->lo, p->hi})
+                if(!c->is_terminal() && c->marked_ == 0)
+                {
+                    c->marked_ = 1;
+                    s.push_back(c);
+                }
+        }
         return n;
     }
 
@@ -71,12 +79,26 @@ namespace BDD {
             return;
         assert(marked_ == 0);
 
+        // explicit depth first search stack, second entry counts visited children
+        std::vector<std::tuple<node*,char>> s = {{this, 0}};
         marked_ = 1;
-        if(lo->marked_ == 0)
-            lo->nodes_postorder_impl(n);
-        if(hi->marked_ == 0)
-            hi->nodes_postorder_impl(n); 
-        n.push_back(this);
+        while(!s.empty())
+        {
+            auto& [p, nr_visited] = s.back();
+            if(nr_visited == 2)
+            {
+                n.push_back(p);
+                s.pop_back();
+                continue;
+            }
+            node* c = nr_visited == 0 ? p->lo : p->hi;
+            ++nr_visited;
+            if(!c->is_terminal() && c->marked_ == 0)
+            {
+                c->marked_ = 1;
+                s.push_back({c, 0});
+            }
+        }
     }
 
     std::vector<node*> node::nodes_bfs()
@@ -172,6 +194,7 @@ namespace BDD {
         this->bdd_mgr_2 = mgr;
         this->xref = 1;
         this->index = botsink_index;
+        this->marked_ = 0;
     }
 
     bool node::is_botsink() const
@@ -186,6 +209,7 @@ namespace BDD {
         this->bdd_mgr_2 = mgr;
         this->xref = 1;
         this->index = topsink_index;
+        this->marked_ = 0;
 
     }
 
@@ -204,25 +228,31 @@ namespace BDD {
 
     void node_struct::mark()
     {
-        if(is_terminal())
-            return;
-        if(!marked())
+        std::vector<node_struct*> s = {this};
+        while(!s.empty())
         {
-            marked_ = 1;
-            lo->mark();
-            hi->mark();
+            node_struct* p = s.back();
+            s.pop_back();
+            if(p->is_terminal() || p->marked())
+                continue;
+            p->marked_ = 1;
+            s.push_back(p->hi);
+            s.push_back(p->lo);
         }
     }
 
     void node_struct::unmark()
     {
-        if(is_terminal())
-            return;
-        if(marked())
+        std::vector<node_struct*> s = {this};
+        while(!s.empty())
         {
-            marked_ = 0;
-            lo->unmark();
-            hi->unmark();
+            node_struct* p = s.back();
+            s.pop_back();
+            if(p->is_terminal() || !p->marked())
+                continue;
+            p->marked_ = 0;
+            s.push_back(p->hi);
+            s.push_back(p->lo);
         }
     }
 
@@ -247,12 +277,20 @@ namespace BDD {
             return;
         assert(marked_ == 0);
 
+        std::vector<node_struct*> s = {this};
         marked_ = 1;
-        v.push_back(index);
-        if(lo->marked_ == 0)
-            lo->variables_impl(v);
-        if(hi->marked_ == 0)
-            hi->variables_impl(v); 
+        while(!s.empty())
+        {
+            node_struct* p = s.back();
+            s.pop_back();
+            v.push_back(p->index);
+            for(node_struct* c : {p->lo, p->hi})
+                if(!c->is_terminal() && c->marked_ == 0)
+                {
+                    c->marked_ = 1;
+                    s.push_back(c);
+                }
+        }
     }
 
     bool node_struct::exactly_one_solution()
@@ -269,41 +307,57 @@ namespace BDD {
         return false; 
     }
 
-    // TODO: make implementations operate without stack
+    // xref counts references by parent nodes and node_refs. Killed nodes have xref = -1 and do not count as references of their children anymore.
+    // Nodes are revived resp. killed when put onto the stack, so each one is processed once.
+    // Resulting reference counts do not depend on the order in which nodes are processed.
     void node_struct::recursively_revive()
     {
+        assert(xref < 0);
+        std::vector<node_struct*> s = {this};
         xref = 0;
-        //deadnodes--;
-        if(lo->xref<0)
-            lo->recursively_revive();
-        else 
-            lo->xref++;
-        if(hi->xref<0)
-            hi->recursively_revive();
-        else 
-            hi->xref++;
+        while(!s.empty())
+        {
+            node_struct* p = s.back();
+            s.pop_back();
+            for(node_struct* c : {p->lo, p->hi})
+            {
+                if(c->xref < 0)
+                {
+                    c->xref = 1;
+                    s.push_back(c);
+                }
+                else
+                    c->xref++;
+            }
+        }
     }
 
     void node_struct::recursively_kill()
     {
-        xref= -1;
-        //deadnodes++;
-        if(lo->xref==0)
-            lo->recursively_kill();
-        else 
-            lo->xref--;
-        if(hi->xref==0)
-            hi->recursively_kill();
-        else 
-            hi->xref--;
+        assert(xref == 0);
+        std::vector<node_struct*> s = {this};
+        xref = -1;
+        while(!s.empty())
+        {
+            node_struct* p = s.back();
+            s.pop_back();
+            for(node_struct* c : {p->lo, p->hi})
+            {
+                assert(c->xref > 0);
+                if(--c->xref == 0)
+                {
+                    c->xref = -1;
+                    s.push_back(c);
+                }
+            }
+        }
     }
 
     void node_struct::deref()
     {
-        if(xref == 0) 
+        assert(xref > 0);
+        if(--xref == 0) 
             recursively_kill();
-        else 
-            xref--;
     }
 
     bdd_mgr* node_struct::find_bdd_mgr()
@@ -1,5 +1,6 @@
 #include "bdd_manager/bdd_node_cache.h"
 #include <cassert>
+#include <algorithm>
 
 namespace BDD {
 
@@ -26,6 +27,7 @@ namespace BDD {
         assert(new_bdd_node_page.get() != nullptr);
         std::swap(new_bdd_node_page.get()->next, mem_node);
         std::swap(new_bdd_node_page, mem_node);
+        ++nr_pages_;
 
         assert(nodeavail == nullptr);
         nodeptr = &(mem_node.get()->data[0]);
@@ -66,14 +68,60 @@ namespace BDD {
     void bdd_node_cache::free_node(node* p)
     {
         assert(p->xref <= 0);
-        assert(p->lo->xref > 0);
-        p->lo->xref--;
-        assert(p->hi->xref > 0);
-        p->hi->xref--;
+        // killed nodes do not hold references to their children anymore
+        if(p->xref == 0)
+        {
+            assert(p->lo->xref > 0);
+            p->lo->xref--;
+            assert(p->hi->xref > 0);
+            p->hi->xref--;
+        }
+        p->xref = free_node_xref;
         p->next_available = nodeavail;
         nodeavail = p;
         total_nodes--;
     }
 
+    size_t bdd_node_cache::release_free_pages()
+    {
+        // Pages are scanned sequentially instead of following the free list, which is rebuilt in address order from the remaining pages.
+        node* new_nodeavail = nullptr;
+        node** tail = &new_nodeavail;
+        auto append_free_nodes = [&](node* begin, node* end) {
+            for(node* p = begin; p != end; ++p)
+                if(p->xref == free_node_xref)
+                {
+                    *tail = p;
+                    tail = &p->next_available;
+                }
+        };
+
+        // the current page is kept, since nodeptr points into it. Sinks live on the first page, which is never entirely free.
+        append_free_nodes(&mem_node->data[0], nodeptr);
+        size_t nr_released = 0;
+        std::unique_ptr<bdd_node_page>* link = &mem_node->next;
+        while(*link != nullptr)
+        {
+            node* begin = &(*link)->data[0];
+            node* end = begin + bdd_node_page_size;
+            const size_t nr_free = std::count_if(begin, end, [](const node& p) { return p.xref == free_node_xref; });
+            if(nr_free == bdd_node_page_size)
+            {
+                std::unique_ptr<bdd_node_page> next = std::move((*link)->next);
+                *link = std::move(next);
+                ++nr_released;
+            }
+            else
+            {
+                append_free_nodes(begin, end);
+                link = &(*link)->next;
+            }
+        }
+        *tail = nullptr;
+        nodeavail = new_nodeavail;
+
+        nr_pages_ -= nr_released;
+        return nr_released * sizeof(bdd_node_page);
+    }
 
 }
@@ -6,6 +6,20 @@
 
 namespace BDD {
 
+    std::size_t unique_table_page_caches::memory_usage() const
+    {
+        std::size_t bytes = 0;
+        for_each_cache([&](const auto& cache) { bytes += cache.memory_usage(); });
+        return bytes;
+    }
+
+    std::size_t unique_table_page_caches::release_free_pages()
+    {
+        std::size_t bytes = 0;
+        for_each_cache([&](auto& cache) { bytes += cache.release_free_pages(); });
+        return bytes;
+    }
+
     size_t var_struct::base_index(const size_t k) const
     {
         assert(mask >= 63);
@@ -38,30 +52,34 @@ namespace BDD {
     {
         unique_table_page_caches& cache = bdd_mgr_.get_unique_table_page_cache();
         switch(new_mask) {
-            case 63: return reinterpret_cast<node**>(cache.cache_128.reserve_page()); 
-            case 127: return reinterpret_cast<node**>(cache.cache_256.reserve_page());
-            case 255: return reinterpret_cast<node**>(cache.cache_512.reserve_page());
-            case 511: return reinterpret_cast<node**>(cache.cache_1024.reserve_page());
-            case 1023: return reinterpret_cast<node**>(cache.cache_2048.reserve_page());
-            case 2047: return reinterpret_cast<node**>(cache.cache_4096.reserve_page());
-            case 4095: return reinterpret_cast<node**>(cache.cache_8192.reserve_page());
-            case 8191: return reinterpret_cast<node**>(cache.cache_16384.reserve_page());
-            case 16383: return reinterpret_cast<node**>(cache.cache_32768.reserve_page());
-            case 32767: return reinterpret_cast<node**>(cache.cache_65536.reserve_page());
-            case 65535: return reinterpret_cast<node**>(cache.cache_131072.reserve_page());
-            case 131071:return reinterpret_cast<node**>(cache.cache_262144.reserve_page());
-            case 262143:return reinterpret_cast<node**>(cache.cache_262144.reserve_page());
-            case 524287:return reinterpret_cast<node**>(cache.cache_524288.reserve_page());
-            case 1048575: throw std::runtime_error("Cannot increase unique table page cache size.");;
+            case 63: return reinterpret_cast<node**>(cache.cache_64.reserve_page());
+            case 127: return reinterpret_cast<node**>(cache.cache_128.reserve_page());
+            case 255: return reinterpret_cast<node**>(cache.cache_256.reserve_page());
+            case 511: return reinterpret_cast<node**>(cache.cache_512.reserve_page());
+            case 1023: return reinterpret_cast<node**>(cache.cache_1024.reserve_page());
+            case 2047: return reinterpret_cast<node**>(cache.cache_2048.reserve_page());
+            case 4095: return reinterpret_cast<node**>(cache.cache_4096.reserve_page());
+            case 8191: return reinterpret_cast<node**>(cache.cache_8192.reserve_page());
+            case 16383: return reinterpret_cast<node**>(cache.cache_16384.reserve_page());
+            case 32767: return reinterpret_cast<node**>(cache.cache_32768.reserve_page());
+            case 65535: return reinterpret_cast<node**>(cache.cache_65536.reserve_page());
+            case 131071: return reinterpret_cast<node**>(cache.cache_131072.reserve_page());
+            case 262143: return reinterpret_cast<node**>(cache.cache_262144.reserve_page());
+            case 524287: return reinterpret_cast<node**>(cache.cache_524288.reserve_page());
+            case 1048575: return reinterpret_cast<node**>(cache.cache_1048576.reserve_page());
             default: assert(false);
         } 
     }
 
     void var_struct::double_cache()
     {
-        // if maximum size is already reached, do not double
-        if(mask == 1048575)
+        // if maximum size is already reached, do not double. Keep one slot free for terminating linear probing.
+        if(mask == (static_cast<size_t>(1) << log_max_hash_size) - 1)
+        {
+            if(free <= 1)
+                throw std::runtime_error("Cannot increase unique table page cache size.");
             return;
+        }
 
         assert(free == nr_free_slots_debug());
         node** old_page = base;
@@ -124,7 +142,6 @@ namespace BDD {
 
     var_struct::var_struct(var_struct&& o)
         : var(o.var),
-        timer(o.timer),
         name(o.name),
         timestamp(o.timestamp),
         aux(o.aux),
@@ -202,78 +219,70 @@ namespace BDD {
         return double(new_page_size - free) / double(new_page_size);
     }
 
-    void var_struct::remove_dead_nodes()
+    size_t var_struct::kill_dead_nodes()
     {
-        for(std::size_t k = 0; k < hash_table_size(); ++k)
+        // children lie on subsequent variables, hence children losing their last reference here are killed when their variable is processed
+        size_t nr_killed = 0;
+        for(size_t k = 0; k <= mask; ++k)
         {
             node* p = fetch_node(k);
-            if(p != nullptr && p->dead())
+            if(p == nullptr)
+                continue;
+            if(p->xref == 0)
             {
-                bdd_mgr_.get_node_cache().free_node(p);
-                store_node(k, nullptr);
-                free++;
-                // move nodes that follow this one back if hash value indicates so
-                size_t first_free_slot = k;
-                for(size_t j = k+1;; ++j)
-                {
-                    const size_t jj = j & mask;
-                    node* p = fetch_node(jj);
-                    if(p == nullptr)
-                    {
-                        k = j;
-                        break;
-                    }
-                    if(p->dead())
-                    {
-                        store_node(jj, nullptr);
-                        free++;
-                    }
-                    else
-                    {
-                        // shift one place up if hash code says so
-                        // TODO: can be made faster.
-                        store_node(next_free_slot(hash_code(p)), p);
-                    }
-                }
+                p->xref = -1;
+                assert(p->lo->xref > 0 && p->hi->xref > 0);
+                p->lo->xref--;
+                p->hi->xref--;
             }
+            if(p->xref < 0)
+                ++nr_killed;
         }
+        return nr_killed;
+    }
 
-        // reduce nr of pages if unique table too sparsely populated
-        if(mask > 63 && occupied_rate() <= min_unique_table_fill)
+    size_t var_struct::remove_dead_nodes()
+    {
+        // Removing entries in place from linear probing sequences would require moving subsequent entries, hence the table is rebuilt from the live nodes.
+        std::vector<node*> live_nodes;
+        live_nodes.reserve(hash_table_size() - free);
+        size_t nr_freed = 0;
+        for(size_t k = 0; k <= mask; ++k)
         {
-            const size_t new_mask = [&]() {
-                size_t n = (mask+1)/2 - 1;
-                while(n >= 63 && occupied_rate(n) >= min_unique_table_fill)
-                    n /= (mask+1)/2 - 1;
-                return n;
-            }();
-
-            node** new_base = new_page(new_mask);
-
-            for(std::size_t k = 0; k <= mask; ++k)
+            node* p = fetch_node(k);
+            if(p == nullptr)
+                continue;
+            if(p->dead())
             {
-                node* p = fetch_node(k);
-                if(p != nullptr)
-                {
-                    const size_t next_free_slot = [&]() {
-                        for(size_t l=k;; l++)
-                        {
-                            l = l & new_mask;
-                            if(new_base[k] == nullptr)
-                                return l;
-                        }
-                        assert(false);
-                        return size_t(0);
-                    }();
-
-                    new_base[next_free_slot] = p;
-                } 
+                bdd_mgr_.get_node_cache().free_node(p);
+                ++nr_freed;
             }
+            else
+                live_nodes.push_back(p);
+        }
+        if(nr_freed == 0)
+            return 0;
+
+        // reduce nr of pages if unique table too sparsely populated
+        size_t new_mask = mask;
+        while(new_mask > 63 && double(live_nodes.size()) <= min_unique_table_fill * double(new_mask + 1))
+            new_mask /= 2;
 
+        if(new_mask != mask)
+        {
             free_page(base, mask);
-            base = new_base;
             mask = new_mask;
+            base = new_page(mask);
         }
+        else
+            std::fill(base, base + hash_table_size(), nullptr);
+
+        for(node* p : live_nodes)
+            store_node(next_free_slot(base_index(hash_code(p))), p);
+        free = hash_table_size() - live_nodes.size();
+        assert(free == nr_free_slots_debug());
+
+        return nr_freed;
     }
 
     node* var_struct::unique_find(const size_t index, node* l, node* h)
@@ -286,31 +295,10 @@ namespace BDD {
 
         if(p != nullptr) // node present
         {
-            return p;
+            // killed nodes stay in the unique table until the next garbage collection
             if(p->xref < 0)
-            {
-                //dead_nodes--;
-                //p->xref= 0;
-                return p;
-            }
-            else 
-            {
-                //l->xref--;
-                //h->xref--;
-                //p->xref++;
-                return p;
-            }
-        }
-        else // node not present
-        {
-            // garbage collection
-            //if((++timer % timerinterval) == 0 && (dead_nodes > unique_table_size()/dead_fraction))
-            if((++timer % timerinterval) == 0)
-            {
-                // TODO: implement
-                //remove_dead_nodes();
-                return unique_find(l, h);
-            }
+                p->recursively_revive();
+            return p;
         }
 
         // allocate free node and add it to unique table
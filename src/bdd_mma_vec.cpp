@@ -57,6 +57,12 @@ namespace LPMP {
         pimpl->mma.iteration();
     }
 
+    template<typename REAL>
+    void bdd_mma_vec<REAL>::set_nr_threads(const size_t nr_threads)
+    {
+        pimpl->mma.set_nr_threads(nr_threads);
+    }
+
     template<typename REAL>
     double bdd_mma_vec<REAL>::lower_bound()
     {
@@ -69,6 +75,12 @@ namespace LPMP {
         return pimpl->mma.min_marginals();
     }
 
+    template<typename REAL>
+    void bdd_mma_vec<REAL>::min_marginal_agreement(std::vector<mm_agreement>& agreement, const double eps)
+    {
+        pimpl->mma.min_marginal_agreement(agreement, eps);
+    }
+
     template<typename REAL>
     void bdd_mma_vec<REAL>::fix_variable(const size_t var, const bool value)
     {
@@ -76,9 +88,22 @@ namespace LPMP {
     }
 
     template<typename REAL>
-    void bdd_mma_vec<REAL>::tighten()
+    tightening_statistics bdd_mma_vec<REAL>::tighten(const tightening_options& opt)
     {
-        return LPMP::tighten(pimpl->mma, 0.1); 
+        return LPMP::tighten(pimpl->mma, opt); 
+    }
+
+    template<typename REAL>
+    bdd_dual_state bdd_mma_vec<REAL>::export_dual_state(const std::vector<double>& objective)
+    {
+        return LPMP::export_dual_state(pimpl->mma, objective.begin(), objective.end());
+    }
+
+    template<typename REAL>
+    void bdd_mma_vec<REAL>::import_dual_state(const bdd_dual_state& state, const std::vector<double>& objective)
+    {
+        LPMP::import_dual_state(pimpl->mma, state, objective.begin(), objective.end());
+        pimpl->mma.backward_run();
     }
 
     // explicitly instantiate templates
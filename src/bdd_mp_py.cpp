@@ -1,34 +1,125 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/eigen.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
+#include <stdexcept>
 #include "bdd_sequential_base.h"
 #include "bdd_branch_instruction.h"
 #include "ILP_input.h"
 #include "bdd_preprocessor.h"
+#include "run_solver_util.h"
 
 namespace py=pybind11;
 
 using bdd_base_type = LPMP::bdd_sequential_base<LPMP::bdd_branch_instruction<float,uint16_t>>;
 
+// Solver together with buffers for min-marginals, costs and lower bounds per bdd.
+// Results are handed out as numpy views onto these buffers, hence they are overwritten by the next call of the same method.
+// One solver must not be used from several Python threads at the same time, different solvers can run concurrently.
+struct bdd_mp_solver {
+    bdd_mp_solver(BDD::bdd_collection& bdd_col)
+        : base(bdd_col),
+        min_margs(base.nr_bdd_variables(), 2),
+        costs(base.nr_bdd_variables()),
+        lbs(base.nr_bdds())
+    {}
+
+    // interface for run_solver
+    void iteration() { base.parallel_mma(); }
+    double lower_bound() { return base.lower_bound(); }
+
+    bdd_base_type base;
+    bdd_base_type::min_marginal_type min_margs;
+    bdd_base_type::vector_type costs;
+    bdd_base_type::vector_type lbs;
+};
+
+// views keep the solver object alive through their base object
+py::array_t<float> numpy_view(bdd_base_type::vector_type& v, py::handle owner)
+{
+    return py::array_t<float>({py::ssize_t(v.size())}, {py::ssize_t(sizeof(float))}, v.data(), owner);
+}
+
+// Eigen matrices are column major
+py::array_t<float> numpy_view(bdd_base_type::min_marginal_type& m, py::handle owner)
+{
+    return py::array_t<float>(
+            {py::ssize_t(m.rows()), py::ssize_t(m.cols())},
+            {py::ssize_t(sizeof(float)), py::ssize_t(m.rows() * sizeof(float))},
+            m.data(), owner);
+}
+
 PYBIND11_MODULE(bdd_mp_py, m) {
     m.doc() = "Python binding for solution of bdd-based message passing";
 
-    py::class_<bdd_base_type>(m, "bdd_mp")
+    py::class_<bdd_mp_solver>(m, "bdd_mp")
         .def(py::init([](const LPMP::ILP_input& ilp) {
                     LPMP::bdd_preprocessor bdd_pre(ilp);
-                    auto* base = new bdd_base_type(bdd_pre.get_bdd_collection()); 
-                    base->update_costs(ilp.objective().begin(), ilp.objective().begin(), ilp.objective().begin(), ilp.objective().end());
-                    return base;
+                    auto* s = new bdd_mp_solver(bdd_pre.get_bdd_collection());
+                    s->base.update_costs(ilp.objective().begin(), ilp.objective().begin(), ilp.objective().begin(), ilp.objective().end());
+                    return s;
                     }))
-    .def("min_marginals", [](bdd_base_type& base) { return base.min_marginals_stacked(); })
-    .def("update_costs", [](bdd_base_type& base, const Eigen::Matrix<float, Eigen::Dynamic, 2>& delta) { return base.update_costs(delta); })
-    .def("update_costs", [](bdd_base_type& base, const Eigen::Matrix<float, Eigen::Dynamic, 1>& delta) { return base.update_costs(delta); })
-    .def("get_costs", &bdd_base_type::get_costs)
-    .def("Lagrange_constraint_matrix", &bdd_base_type::Lagrange_constraint_matrix)
-    .def("lower_bound", &bdd_base_type::lower_bound)
-    .def("lower_bound_per_bdd", [](bdd_base_type& base) { return base.lower_bound_per_bdd(); })
-    .def("nr_bdds", [](const bdd_base_type& base) { return base.nr_bdds(); })
-    .def("nr_variables", [](const bdd_base_type& base) { return base.nr_variables(); })
+    .def("iteration", &bdd_mp_solver::iteration, py::call_guard<py::gil_scoped_release>())
+    .def("backward_run", [](bdd_mp_solver& s) { s.base.backward_run(); }, py::call_guard<py::gil_scoped_release>())
+    .def("solve", [](bdd_mp_solver& s, const size_t max_iter, const double tolerance, const double improvement_slope, const double time_limit, const bool verbose) {
+            LPMP::run_solver(s, max_iter, tolerance, improvement_slope, time_limit, verbose);
+            return s.lower_bound();
+            },
+            py::arg("max_iter") = 1000, py::arg("tolerance") = 1e-9, py::arg("improvement_slope") = 1e-6, py::arg("time_limit") = 3600.0, py::arg("verbose") = false,
+            py::call_guard<py::gil_scoped_release>())
+    .def("min_marginals", [](bdd_mp_solver& s) { return s.base.min_marginals_stacked(); })
+    // zero-copy views, valid until the next call of the same method
+    .def("min_marginals_view", [](py::object self) {
+            auto& s = self.cast<bdd_mp_solver&>();
+            {
+                py::gil_scoped_release release;
+                s.base.min_marginals_stacked(s.min_margs);
+            }
+            return numpy_view(s.min_margs, self);
+            })
+    .def("costs_view", [](py::object self) {
+            auto& s = self.cast<bdd_mp_solver&>();
+            {
+                py::gil_scoped_release release;
+                s.base.get_costs(s.costs);
+            }
+            return numpy_view(s.costs, self);
+            })
+    .def("lower_bound_per_bdd_view", [](py::object self) {
+            auto& s = self.cast<bdd_mp_solver&>();
+            {
+                py::gil_scoped_release release;
+                s.base.lower_bound_per_bdd(s.lbs);
+            }
+            return numpy_view(s.lbs, self);
+            })
+    // delta is read in place if it is a float32 array, either with one column for high arc costs or two columns for low and high arc costs
+    .def("update_costs", [](bdd_mp_solver& s, py::array_t<float, py::array::forcecast> delta) {
+            const py::ssize_t rows = delta.ndim() > 0 ? delta.shape(0) : 0;
+            if(rows != py::ssize_t(s.base.nr_bdd_variables()))
+                throw std::runtime_error("cost delta must have one row per bdd variable");
+            const py::ssize_t elem = sizeof(float);
+            if(delta.ndim() == 1 || (delta.ndim() == 2 && delta.shape(1) == 1))
+            {
+                Eigen::Map<const bdd_base_type::vector_type, 0, Eigen::InnerStride<>> d(delta.data(), rows, Eigen::InnerStride<>(delta.strides(0) / elem));
+                py::gil_scoped_release release;
+                s.base.update_costs(d);
+            }
+            else if(delta.ndim() == 2 && delta.shape(1) == 2)
+            {
+                using stride_type = Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>;
+                Eigen::Map<const bdd_base_type::min_marginal_type, 0, stride_type> d(delta.data(), rows, 2, stride_type(delta.strides(1) / elem, delta.strides(0) / elem));
+                py::gil_scoped_release release;
+                s.base.update_costs(d);
+            }
+            else
+                throw std::runtime_error("cost delta must have one or two columns");
+            })
+    .def("get_costs", [](bdd_mp_solver& s) { return s.base.get_costs(); })
+    .def("Lagrange_constraint_matrix", [](const bdd_mp_solver& s) { return s.base.Lagrange_constraint_matrix(); })
+    .def("lower_bound", &bdd_mp_solver::lower_bound, py::call_guard<py::gil_scoped_release>())
+    .def("lower_bound_per_bdd", [](bdd_mp_solver& s) { return s.base.lower_bound_per_bdd(); })
+    .def("nr_bdds", [](const bdd_mp_solver& s) { return s.base.nr_bdds(); })
+    .def("nr_variables", [](const bdd_mp_solver& s) { return s.base.nr_variables(); })
     ;
 }
-
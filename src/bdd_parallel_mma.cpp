@@ -2,6 +2,7 @@
 #include "bdd_sequential_base.h"
 #include "bdd_branch_node_vector.h"
 #include "time_measure_util.h"
+#include <numeric>
 
 namespace LPMP {
 
@@ -57,6 +58,30 @@ namespace LPMP {
         pimpl->base.parallel_mma();
     }
 
+    template<typename REAL>
+    void bdd_parallel_mma<REAL>::set_active_set(const double threshold, const size_t full_sweep_interval)
+    {
+        pimpl->base.set_active_set(threshold, full_sweep_interval);
+    }
+
+    template<typename REAL>
+    size_t bdd_parallel_mma<REAL>::nr_active_bdds() const
+    {
+        return pimpl->base.nr_active_bdds();
+    }
+
+    template<typename REAL>
+    void bdd_parallel_mma<REAL>::set_omega(const double omega, const bool adaptive)
+    {
+        pimpl->base.set_omega(omega, adaptive);
+    }
+
+    template<typename REAL>
+    void bdd_parallel_mma<REAL>::set_momentum(const double momentum, const size_t interval)
+    {
+        pimpl->base.set_momentum(momentum, interval);
+    }
+
     template<typename REAL>
     void bdd_parallel_mma<REAL>::distribute_delta()
     {
@@ -75,6 +100,18 @@ namespace LPMP {
         return pimpl->base.min_marginals();
     }
 
+    template<typename REAL>
+    void bdd_parallel_mma<REAL>::min_marginal_agreement(std::vector<mm_agreement>& agreement, const double eps)
+    {
+        pimpl->base.min_marginal_agreement(agreement, eps);
+    }
+
+    template<typename REAL>
+    std::vector<char> bdd_parallel_mma<REAL>::decode_primal_solution(const bool verbose)
+    {
+        return pimpl->base.decode_primal_solution(10*pimpl->base.nr_bdds(), verbose);
+    }
+
     template<typename REAL>
     void bdd_parallel_mma<REAL>::fix_variable(const size_t var, const bool value)
     {
@@ -93,9 +130,46 @@ namespace LPMP {
     }
 
     template<typename REAL>
-    void bdd_parallel_mma<REAL>::tighten()
+    tightening_statistics bdd_parallel_mma<REAL>::tighten(const tightening_options& opt)
     {
-        throw std::runtime_error("not implemented");
+        pimpl->base.distribute_delta();
+        return LPMP::tighten(pimpl->base, opt);
+    }
+
+    template<typename REAL>
+    std::vector<size_t> bdd_parallel_mma<REAL>::add_bdds(BDD::bdd_collection& bdd_col)
+    {
+        std::vector<size_t> bdd_nrs(bdd_col.nr_bdds());
+        std::iota(bdd_nrs.begin(), bdd_nrs.end(), 0);
+        pimpl->base.distribute_delta();
+        return pimpl->base.add_bdds(bdd_col, bdd_nrs.begin(), bdd_nrs.end());
+    }
+
+    template<typename REAL>
+    std::vector<size_t> bdd_parallel_mma<REAL>::remove_bdds(const std::vector<size_t>& bdd_nrs)
+    {
+        return pimpl->base.remove_bdds(bdd_nrs.begin(), bdd_nrs.end());
+    }
+
+    template<typename REAL>
+    size_t bdd_parallel_mma<REAL>::nr_bdds() const
+    {
+        return pimpl->base.nr_bdds();
+    }
+
+    template<typename REAL>
+    bdd_dual_state bdd_parallel_mma<REAL>::export_dual_state(const std::vector<double>& objective)
+    {
+        pimpl->base.distribute_delta();
+        return LPMP::export_dual_state(pimpl->base, objective.begin(), objective.end());
+    }
+
+    template<typename REAL>
+    void bdd_parallel_mma<REAL>::import_dual_state(const bdd_dual_state& state, const std::vector<double>& objective)
+    {
+        pimpl->base.distribute_delta();
+        LPMP::import_dual_state(pimpl->base, state, objective.begin(), objective.end());
+        pimpl->base.backward_run();
     }
 
     // explicitly instantiate templates
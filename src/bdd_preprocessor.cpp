@@ -4,6 +4,10 @@
 #include <tsl/robin_map.h>
 #include <tsl/robin_set.h>
 #include <cmath>
+#include <algorithm>
+#include <functional>
+#include <tuple>
+#include <exception>
 #include "time_measure_util.h"
 #include <omp.h>
 
@@ -13,6 +17,7 @@ namespace LPMP {
     {
         MEASURE_FUNCTION_EXECUTION_TIME;
         assert(bdd_collection.nr_bdds() == 0);
+        nr_variables = input.nr_variables();
         // first transform linear inequalities into BDDs
         std::cout << "[bdd_preprocessor] convert " << input.constraints().size() << " linear inequalities.\n";
 
@@ -48,19 +53,30 @@ namespace LPMP {
                     coefficients.push_back(e.coefficient);
                     variables.push_back(e.var);
                 }
-                BDD::node_ref bdd = converter.convert_to_bdd(coefficients, constraint.ineq, constraint.right_hand_side);
-                if(bdd.is_topsink())
+                // constraints on increasing variables are written as qbdds directly, others go through bdd_mgr
+                const bool increasing_vars = std::adjacent_find(variables.begin(), variables.end(), std::greater_equal<size_t>()) == variables.end();
+                const size_t bdd_nr = [&]() {
+                    if(increasing_vars)
+                        return converter.convert_to_qbdd(coefficients.begin(), coefficients.end(), constraint.ineq, constraint.right_hand_side, variables.begin(), cur_bdd_collection);
+                    BDD::node_ref bdd = converter.convert_to_bdd(coefficients, constraint.ineq, constraint.right_hand_side);
+                    if(bdd.is_topsink())
+                        return BDD::bdd_instruction::topsink_index;
+                    if(bdd.is_botsink())
+                        return BDD::bdd_instruction::botsink_index;
+                    const size_t nr = cur_bdd_collection.add_bdd(bdd);
+                    cur_bdd_collection.reorder(nr);
+                    assert(cur_bdd_collection.is_reordered(nr));
+                    cur_bdd_collection.rebase(nr, variables.begin(), variables.end());
+                    return nr;
+                }();
+                if(bdd_nr == BDD::bdd_instruction::topsink_index)
                 {
                     if(constraint_groups == true && input.nr_constraint_groups() > 0)
                         throw std::runtime_error("constraint groups and empty constraints not both supported");
                     continue;
                 }
-                else if(bdd.is_botsink())
+                else if(bdd_nr == BDD::bdd_instruction::botsink_index)
                     throw std::runtime_error("problem is infeasible");
-                const size_t bdd_nr = cur_bdd_collection.add_bdd(bdd);
-                cur_bdd_collection.reorder(bdd_nr);
-                assert(cur_bdd_collection.is_reordered(bdd_nr));
-                cur_bdd_collection.rebase(bdd_nr, variables.begin(), variables.end());
             }
 #pragma omp ordered
             {
@@ -108,15 +124,19 @@ namespace LPMP {
         // transform all BDDs to qbdds
         std::cout << "[bdd preprocessor] Transform BDDs into QBDDs\n";
         std::vector<size_t> bdds_to_remove;
+        std::vector<size_t> large_bdds;
         const size_t orig_nr_bdds = bdd_collection.nr_bdds();
 #pragma omp parallel
         {
             BDD::bdd_collection cur_bdd_collection;
             std::vector<size_t> cur_bdds_to_remove;
+            std::vector<size_t> cur_large_bdds;
 #pragma omp for schedule(static,256)
             for(size_t bdd_nr = 0; bdd_nr<orig_nr_bdds; ++bdd_nr)
             {
-                if(!bdd_collection.is_qbdd(bdd_nr))
+                if(bdd_collection.nr_bdd_nodes(bdd_nr) > BDD::bdd_collection::parallel_threshold)
+                    cur_large_bdds.push_back(bdd_nr);
+                else if(!bdd_collection.is_qbdd(bdd_nr))
                 {
                     bdd_collection.make_qbdd(bdd_nr, cur_bdd_collection);
                     cur_bdds_to_remove.push_back(bdd_nr);
@@ -126,9 +146,25 @@ namespace LPMP {
             {
                 for(const size_t nr : cur_bdds_to_remove)
                     bdds_to_remove.push_back(nr);
+                large_bdds.insert(large_bdds.end(), cur_large_bdds.begin(), cur_large_bdds.end());
                 bdd_collection.append(cur_bdd_collection);
             }
         }
+
+        // large bdds are transformed one after the other, each one by all threads
+        {
+            std::sort(large_bdds.begin(), large_bdds.end());
+            BDD::bdd_collection large_bdd_collection;
+            for(const size_t bdd_nr : large_bdds)
+            {
+                if(!bdd_collection.is_qbdd(bdd_nr))
+                {
+                    bdd_collection.make_qbdd(bdd_nr, large_bdd_collection);
+                    bdds_to_remove.push_back(bdd_nr);
+                }
+            }
+            bdd_collection.append(large_bdd_collection);
+        }
         {
             std::sort(bdds_to_remove.begin(), bdds_to_remove.end());
             std::cout << "[bdd preprocessor] " << bdds_to_remove.size() << " BDDs had to be transformed\n";
@@ -286,6 +322,32 @@ namespace LPMP {
         return candidates;
     }
 
+    std::vector<bdd_preprocessor::coalesce_candidate> bdd_preprocessor::overlap_candidates(const two_dim_variable_array<size_t>& var_bdd_adjacency, const size_t max_bdds_per_variable) const
+    {
+        std::vector<coalesce_candidate> candidates;
+        tsl::robin_set<std::array<size_t,2>> considered_candidates;
+
+        for(size_t v=0; v<var_bdd_adjacency.size(); ++v)
+        {
+            if(var_bdd_adjacency[v].size() > max_bdds_per_variable)
+                continue;
+            for(size_t bdd_idx_1=0; bdd_idx_1<var_bdd_adjacency[v].size(); ++bdd_idx_1)
+            {
+                for(size_t bdd_idx_2=bdd_idx_1+1; bdd_idx_2<var_bdd_adjacency[v].size(); ++bdd_idx_2)
+                {
+                    const size_t bdd_1 = std::min(var_bdd_adjacency(v,bdd_idx_1), var_bdd_adjacency(v,bdd_idx_2));
+                    const size_t bdd_2 = std::max(var_bdd_adjacency(v,bdd_idx_1), var_bdd_adjacency(v,bdd_idx_2));
+                    if(considered_candidates.count({bdd_1, bdd_2}) > 0)
+                        continue;
+                    considered_candidates.insert({bdd_1, bdd_2});
+                    candidates.push_back({bdd_1,bdd_2});
+                }
+            }
+        }
+
+        return candidates;
+    }
+
         std::vector<bdd_preprocessor::coalesce_candidate> bdd_preprocessor::compute_candidates(const bool subsumption, const bool contiguous_overlap, const bool subsumption_except_one, const bool partial_contiguous_overlap, const two_dim_variable_array<size_t>& bdd_var_adjacency, const two_dim_variable_array<size_t>& var_bdd_adjacency) const
 
     {
@@ -412,195 +474,180 @@ namespace LPMP {
         return candidates;
     }
 
-    void bdd_preprocessor::coalesce()
+    // Merging two bdds removes the duplicate copies of their shared variables, on which the solver otherwise has to reach agreement by message passing.
+    // Each removed copy is counted as expected saving of iterations. The cost is the change in nr of qbdd nodes, since an iteration takes time linear in it.
+    // Candidates are ranked by saving per additional node, merges shrinking the bdds first, and accepted greedily while the total nr of nodes stays within the budget.
+    coalesce_statistics bdd_preprocessor::coalesce(const coalesce_options& opt)
     {
-        /*
-        std::cout << "rebasing bdds\n";
-        rebase_bdds(); 
+        MEASURE_FUNCTION_EXECUTION_TIME;
+        assert(opt.node_budget >= 1.0);
+        coalesce_statistics stats;
+        stats.nr_bdds_before = bdd_collection.nr_bdds();
+        for(size_t bdd_nr=0; bdd_nr<bdd_collection.nr_bdds(); ++bdd_nr)
+            stats.nr_nodes_before += bdd_collection.nr_bdd_nodes(bdd_nr);
+        const size_t node_budget = opt.node_budget * stats.nr_nodes_before;
+        size_t nr_nodes = stats.nr_nodes_before;
 
-        for(size_t coalesce_round = 1; coalesce_round<10; ++coalesce_round) // iterate until no coalescing takes place
-        {
-            std::cout << "coalescing bdds, round = " << coalesce_round << ", nr bdds = " << bdd_collection.nr_bdds() << "\n"; 
-            // TODO: sort bdds according to some criterion, e.g. largest/smallest nr of variables covered, largest/smallest nr of nodes.
-
-            // iterate over bdds in order of ascending size
-            std::vector<size_t> bdd_coalesce_order(bdd_collection.nr_bdds());
-            std::iota(bdd_coalesce_order.begin(), bdd_coalesce_order.end(), 0);
-            std::sort(bdd_coalesce_order.begin(), bdd_coalesce_order.end(),
-                    [&](const size_t i, const size_t j) {
-                    return bdd_collection.nr_bdd_nodes(i) < bdd_collection.nr_bdd_nodes(j);
-                    });
+        const bool overlap = coalesce_overlap_ || !(coalesce_bridge_ || coalesce_subsumption_ || coalesce_contiguous_overlap_ || coalesce_subsumption_except_one_ || coalesce_partial_contiguous_overlap_);
 
-            std::vector<size_t> bdd_indices(bdd_collection.nr_bdds());
-            std::iota(bdd_indices.begin(), bdd_indices.end(), 0);
+        // pairs whose conjunction exceeded the node limit are not tried again in later rounds
+        tsl::robin_set<std::array<size_t,2>> exceeded_candidates;
 
-            two_dim_variable_array<size_t> bdd_var_adjacency;
-            std::vector<size_t> var_bdd_adjacency_size(nr_variables, 0);
-            // first compute variable bdd incidence matrix
-            for(size_t j=0; j<bdd_collection.nr_bdds(); ++j)
+        for(size_t round=0; round<opt.max_rounds; ++round)
+        {
+            two_dim_variable_array<size_t> bdd_var_adj, var_bdd_adj;
+            std::tie(bdd_var_adj, var_bdd_adj) = construct_bdd_var_adjacency(bdd_collection);
+            std::vector<coalesce_candidate> candidates;
+            if(overlap)
+                candidates = overlap_candidates(var_bdd_adj, opt.max_bdds_per_variable);
+            if(coalesce_bridge_)
             {
-                const auto vars = bdd_collection.variables(j);
-                bdd_var_adjacency.push_back(vars.begin(), vars.end());
-                for(const size_t v : vars)
-                {
-                    assert(v < var_bdd_adjacency_size.size());
-                    var_bdd_adjacency_size[v]++;
-                }
+                const auto c = bridge_candidates(bdd_var_adj, var_bdd_adj);
+                candidates.insert(candidates.end(), c.begin(), c.end());
             }
+            if(coalesce_subsumption_ || coalesce_contiguous_overlap_ || coalesce_subsumption_except_one_ || coalesce_partial_contiguous_overlap_)
+            {
+                const auto c = compute_candidates(coalesce_subsumption_, coalesce_contiguous_overlap_, coalesce_subsumption_except_one_, coalesce_partial_contiguous_overlap_, bdd_var_adj, var_bdd_adj);
+                candidates.insert(candidates.end(), c.begin(), c.end());
+            }
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+            candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](const coalesce_candidate& c) { return exceeded_candidates.count(c) > 0; }), candidates.end());
+            stats.nr_candidates += candidates.size();
+            if(candidates.size() == 0)
+                break;
 
-            two_dim_variable_array<size_t> var_bdd_adjacency(var_bdd_adjacency_size.begin(), var_bdd_adjacency_size.end());
-            std::fill(var_bdd_adjacency_size.begin(), var_bdd_adjacency_size.end(), 0);
-            for(size_t j=0; j<bdd_var_adjacency.size(); ++j)
-                for(const size_t v : bdd_var_adjacency[j])
-                    var_bdd_adjacency(v, var_bdd_adjacency_size[v]++) = j;
-
-            std::vector<char> active_bdds(bdd_collection.nr_bdds(), true);
-
-            // for each bdd, search for overlapping ones. Sort by greatest overlap and test if intersection grows moderately only. If so, keep intersection and remove individual bdds.
-            //std::unordered_map<size_t,size_t> checked_bdd_pairs; // value is timestamp
-            tsl::robin_map<size_t,size_t> checked_bdd_pairs; // value is timestamp
-            //std::unordered_map<size_t,size_t> adjacent_bdds;
-            tsl::robin_map<size_t,size_t> adjacent_bdds;
-            struct bdd_intersection { size_t bdd; size_t nr_common_vars; };
-            std::vector<bdd_intersection> adjacent_bdds_sorted;
+            // node-limited quasi-reduced conjunction of two bdds, qbdd_col is only filled within the node limit
+            enum class merge_result { exceeded_node_limit, within_node_limit, infeasible };
+            auto merge = [&](const size_t i, const size_t j, BDD::bdd_collection& qbdd_col) -> merge_result {
+                BDD::bdd_collection tmp_bdd_col;
+                const size_t bdd_nr = bdd_collection.bdd_and(i, j, tmp_bdd_col, opt.node_limit);
+                if(bdd_nr == std::numeric_limits<size_t>::max())
+                    return merge_result::exceeded_node_limit;
+                const BDD::bdd_instruction& root = tmp_bdd_col.get_bdd_instruction(tmp_bdd_col.offset(bdd_nr));
+                if(root.is_botsink())
+                    return merge_result::infeasible;
+                assert(!root.is_terminal());
+                tmp_bdd_col.reorder(bdd_nr);
+                tmp_bdd_col.make_qbdd(bdd_nr, qbdd_col);
+                // the quasi-reduced bdd has additional nodes on skipped variables, the limit applies to it as well
+                return qbdd_col.nr_bdd_nodes(0) - 2 <= opt.node_limit ? merge_result::within_node_limit : merge_result::exceeded_node_limit;
+            };
 
-            for(size_t j_idx=0; j_idx<bdd_var_adjacency.size(); ++j_idx)
+            // estimate blow-up by computing the node-limited conjunction of each candidate pair in parallel.
+            // Only node counts are kept, selected merges are recomputed afterwards.
+            struct candidate_estimate { bool within_node_limit = false; size_t nr_shared_vars; std::ptrdiff_t nr_additional_nodes; };
+            std::vector<candidate_estimate> estimates(candidates.size());
+            bool infeasible = false;
+            // exceptions must not escape the parallel region, the first one is rethrown afterwards
+            std::exception_ptr error;
+#pragma omp parallel for schedule(dynamic) reduction(||:infeasible)
+            for(size_t c=0; c<candidates.size(); ++c)
             {
-                const size_t j = bdd_coalesce_order[j_idx];
-                if(active_bdds[j] == false)
+                const size_t i = candidates[c][0];
+                const size_t j = candidates[c][1];
+                BDD::bdd_collection qbdd_col;
+                merge_result result;
+                try {
+                    result = merge(i, j, qbdd_col);
+                } catch(...) {
+#pragma omp critical
+                    if(!error)
+                        error = std::current_exception();
                     continue;
-
-                checked_bdd_pairs.clear();
-                adjacent_bdds.clear();
-
-                for(size_t i : bdd_var_adjacency[j])
-                    for(size_t jj : var_bdd_adjacency[i])
-                        if(j != jj && active_bdds[jj] && !(checked_bdd_pairs.count(jj) > 0))
-                            adjacent_bdds[jj]++;
-
-                // sort by largest intersection
-                adjacent_bdds_sorted.clear();
-                adjacent_bdds_sorted.reserve(adjacent_bdds.size());
-                for(const auto [bdd_nr, nr_common_vars] : adjacent_bdds)
-                    adjacent_bdds_sorted.push_back({bdd_nr, nr_common_vars});
-                std::sort(adjacent_bdds_sorted.begin(), adjacent_bdds_sorted.end(), 
-                        [](const bdd_intersection a, const bdd_intersection b) { return a.nr_common_vars > b.nr_common_vars; });
-
-                // go over sorted bdd list and try out intersection. If growth moderate, replace bdd nr j by intersection and remove the other bdd.
-                for(const auto [jj, nr_common_vars] : adjacent_bdds_sorted)
-                {
-                    checked_bdd_pairs.insert({jj,0});
-                    const size_t node_limit = 
-                        2*std::min(bdd_collection.nr_bdd_nodes(bdd_indices[j]), bdd_collection.nr_bdd_nodes(bdd_indices[jj])) +
-                        std::max(bdd_collection.nr_bdd_nodes(bdd_indices[j]), bdd_collection.nr_bdd_nodes(bdd_indices[jj]));
-                    //const size_t node_limit = 1.5*(bdd_collection.nr_bdd_nodes(bdd_indices[j]) + bdd_collection.nr_bdd_nodes(bdd_indices[jj]));
-                    const size_t intersect = bdd_collection.bdd_and(bdd_indices[j], bdd_indices[jj], node_limit);
-                    if(intersect != std::numeric_limits<size_t>::max())
-                    {
-                        //std::cout << "nr nodes before = " << bdds[j].nr_nodes() << ", " << bdds[jj].nr_nodes() << ", nodes after = " << intersect.nr_nodes() << " = " <<  (bdds[j] & bdds[jj]).nr_nodes() << "\n";
-                        active_bdds[j] = false;
-                        active_bdds[jj] = false;
-                        assert(intersect == active_bdds.size());
-                        assert(intersect +1 == bdd_collection.nr_bdds());
-                        active_bdds.push_back(true);
-                        bdd_indices[j] = intersect;
-                    } 
                 }
+                if(result == merge_result::infeasible)
+                    infeasible = true;
+                if(result != merge_result::within_node_limit)
+                    continue;
+                std::vector<size_t> shared_vars;
+                std::set_intersection(bdd_var_adj[i].begin(), bdd_var_adj[i].end(), bdd_var_adj[j].begin(), bdd_var_adj[j].end(), std::back_inserter(shared_vars));
+                estimates[c] = {true, shared_vars.size(), std::ptrdiff_t(qbdd_col.nr_bdd_nodes(0)) - std::ptrdiff_t(bdd_collection.nr_bdd_nodes(i) + bdd_collection.nr_bdd_nodes(j))};
             }
+            if(error)
+                std::rethrow_exception(error);
+            if(infeasible)
+                throw std::runtime_error("problem is infeasible");
 
-            std::vector<size_t> bdds_to_remove;
-            for(size_t i=0; i<active_bdds.size(); ++i)
-                if(active_bdds[i] == false)
-                    bdds_to_remove.push_back(i);
-            if(bdds_to_remove.size() == 0)
-                break;
-            bdd_collection.remove(bdds_to_remove.begin(), bdds_to_remove.end());
-
-            assert(bdd_collection.nr_bdds() < bdd_indices.size());
-        }
-        /*
-        for(;;) // iterate until no coalescing takes place
-        { 
-            std::cout << "coalescing bdds, nr bdds = " << bdds.size() << "\n"; 
-            // TODO: sort bdds according to some criterion, e.g. largest/smallest nr of variables covered, largest/smallest nr of nodes.
-
-            two_dim_variable_array<size_t> bdd_var_adjacency;
-            std::vector<size_t> var_bdd_adjacency_size(bdd_mgr.nr_variables(), 0);
-            // first compute variable bdd incidence matrix
-            for(size_t j=0; j<bdds.size(); ++j)
+            std::vector<size_t> order;
+            for(size_t c=0; c<candidates.size(); ++c)
             {
-                const auto vars = bdds[j].variables();
-                bdd_var_adjacency.push_back(vars.begin(), vars.end());
-                for(const size_t v : vars)
-                    var_bdd_adjacency_size[v]++;
+                if(estimates[c].within_node_limit)
+                    order.push_back(c);
+                else
+                {
+                    ++stats.nr_exceeded_node_limit;
+                    exceeded_candidates.insert(candidates[c]);
+                }
             }
+            auto score = [&](const size_t c) {
+                return double(estimates[c].nr_shared_vars) / double(std::max(std::ptrdiff_t(1), estimates[c].nr_additional_nodes));
+            };
+            std::stable_sort(order.begin(), order.end(), [&](const size_t c, const size_t d) {
+                    const bool c_shrinks = estimates[c].nr_additional_nodes <= 0;
+                    const bool d_shrinks = estimates[d].nr_additional_nodes <= 0;
+                    if(c_shrinks != d_shrinks)
+                        return c_shrinks;
+                    if(c_shrinks)
+                        return estimates[c].nr_shared_vars > estimates[d].nr_shared_vars;
+                    return score(c) > score(d);
+                    });
 
-            two_dim_variable_array<size_t> var_bdd_adjacency(var_bdd_adjacency_size.begin(), var_bdd_adjacency_size.end());
-            std::fill(var_bdd_adjacency_size.begin(), var_bdd_adjacency_size.end(), 0);
-            for(size_t j=0; j<bdd_var_adjacency.size(); ++j)
-                for(const size_t v : bdd_var_adjacency[j])
-                    var_bdd_adjacency(v, var_bdd_adjacency_size[v]++) = j;
-
-            std::vector<char> active_bdds(bdds.size(), true);
-
-            // for each bdd, search for overlapping ones. Sort by greatest overlap and test if intersection grows moderately only. If so, keep intersection and remove individual bdds.
-            std::unordered_map<size_t,size_t> checked_bdd_pairs; // value is timestamp
-            std::unordered_map<size_t,size_t> adjacent_bdds;
-            struct bdd_intersection { size_t bdd; size_t nr_common_vars; };
-            std::vector<bdd_intersection> adjacent_bdds_sorted;
-
-            for(size_t j=0; j<bdds.size(); ++j)
+            // each bdd takes part in at most one merge per round
+            std::vector<char> merged_bdds(bdd_collection.nr_bdds(), false);
+            std::vector<size_t> selected;
+            for(const size_t c : order)
             {
-                if(active_bdds[j] == false)
+                const size_t i = candidates[c][0];
+                const size_t j = candidates[c][1];
+                if(merged_bdds[i] || merged_bdds[j])
                     continue;
-
-                checked_bdd_pairs.clear();
-                adjacent_bdds.clear();
-                size_t cur_nr_nodes = bdds[j].nr_nodes();
-
-                for(size_t i : bdd_var_adjacency[j])
-                    for(size_t jj : var_bdd_adjacency[i])
-                        if(j != jj && active_bdds[jj] && !(checked_bdd_pairs.count(jj) > 0))
-                            adjacent_bdds[jj]++;
-
-                // sort by largest intersection
-                adjacent_bdds_sorted.clear();
-                adjacent_bdds_sorted.reserve(adjacent_bdds.size());
-                for(const auto [bdd_nr, nr_common_vars] : adjacent_bdds)
-                    adjacent_bdds_sorted.push_back({bdd_nr, nr_common_vars});
-                std::sort(adjacent_bdds_sorted.begin(), adjacent_bdds_sorted.end(), 
-                        [](const bdd_intersection a, const bdd_intersection b) { return a.nr_common_vars > b.nr_common_vars; });
-
-                // go over sorted bdd list and try out intersection. If growth moderate, replace bdd nr j by intersection and remove the other bdd.
-                for(const auto [jj, nr_common_vars] : adjacent_bdds_sorted)
-                {
-                    checked_bdd_pairs.insert({jj,0});
-                    const size_t jj_nr_nodes = bdds[jj].nr_nodes();
-                    const size_t node_limit = 3*(cur_nr_nodes + jj_nr_nodes);
-                    auto [intersect, nr_intersect_nodes] = bdd_mgr.and_rec_limited(bdds[j], bdds[jj], cur_nr_nodes * jj_nr_nodes);
-                    if(intersect.address() != nullptr && intersect.nr_nodes() <= node_limit)
-                    {
-                        //std::cout << "nr nodes before = " << bdds[j].nr_nodes() << ", " << bdds[jj].nr_nodes() << ", nodes after = " << intersect.nr_nodes() << " = " <<  (bdds[j] & bdds[jj]).nr_nodes() << "\n";
-                        bdds[j] = intersect;
-                        active_bdds[jj] = false;
-                        cur_nr_nodes = intersect.nr_nodes();
-                    } 
-                }
+                if(std::ptrdiff_t(nr_nodes) + estimates[c].nr_additional_nodes > std::ptrdiff_t(node_budget))
+                    continue;
+                nr_nodes += estimates[c].nr_additional_nodes;
+                merged_bdds[i] = true;
+                merged_bdds[j] = true;
+                selected.push_back(c);
             }
-
-            // TODO: remove inactive bdds for new round of coalescing until no further progress can be made
-            std::vector<BDD::node_ref> new_bdds;
-            for(size_t j=0; j<bdds.size(); ++j)
-                if(active_bdds[j])
-                    new_bdds.push_back(bdds[j]);
-
-            std::swap(bdds, new_bdds);
-            if(bdds.size() == new_bdds.size())
+            std::cout << "[bdd preprocessor] coalesce round " << round+1 << ": " << candidates.size() << " candidates, " << order.size() << " within node limit, " << selected.size() << " merged\n";
+            if(selected.size() == 0)
                 break;
+            stats.nr_merges += selected.size();
+            ++stats.nr_rounds;
+
+            // bdd numbers of surviving bdds shift when merged ones are removed
+            std::vector<size_t> new_bdd_nr(bdd_collection.nr_bdds());
+            for(size_t bdd_nr=0, c=0; bdd_nr<bdd_collection.nr_bdds(); ++bdd_nr)
+                new_bdd_nr[bdd_nr] = merged_bdds[bdd_nr] ? std::numeric_limits<size_t>::max() : c++;
+            tsl::robin_set<std::array<size_t,2>> new_exceeded_candidates;
+            for(const auto [i,j] : exceeded_candidates)
+                if(!merged_bdds[i] && !merged_bdds[j])
+                    new_exceeded_candidates.insert({new_bdd_nr[i], new_bdd_nr[j]});
+            std::swap(exceeded_candidates, new_exceeded_candidates);
+
+            std::vector<size_t> bdds_to_remove;
+            for(size_t bdd_nr=0; bdd_nr<merged_bdds.size(); ++bdd_nr)
+                if(merged_bdds[bdd_nr])
+                    bdds_to_remove.push_back(bdd_nr);
+            std::vector<BDD::bdd_collection> merged(selected.size());
+#pragma omp parallel for schedule(dynamic)
+            for(size_t s=0; s<selected.size(); ++s)
+            {
+                [[maybe_unused]] const merge_result result = merge(candidates[selected[s]][0], candidates[selected[s]][1], merged[s]);
+                assert(result == merge_result::within_node_limit);
+            }
+            bdd_collection.remove(bdds_to_remove.begin(), bdds_to_remove.end());
+            for(const BDD::bdd_collection& m : merged)
+                bdd_collection.append(m);
         }
-    */
 
-        //bdd_mgr.collect_garbage();
+        stats.nr_bdds_after = bdd_collection.nr_bdds();
+        for(size_t bdd_nr=0; bdd_nr<bdd_collection.nr_bdds(); ++bdd_nr)
+            stats.nr_nodes_after += bdd_collection.nr_bdd_nodes(bdd_nr);
+        assert(stats.nr_nodes_after == nr_nodes);
+        assert(stats.nr_nodes_after <= node_budget);
+        std::cout << "[bdd preprocessor] coalesced " << stats.nr_bdds_before << " into " << stats.nr_bdds_after << " BDDs, #nodes " << stats.nr_nodes_before << " -> " << stats.nr_nodes_after << "\n";
+        return stats;
     }
 
     void bdd_preprocessor::coalesce_bdd_collection()
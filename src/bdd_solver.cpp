@@ -8,6 +8,8 @@
 #include <omp.h>
 #endif
 #include <iomanip>
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include <stdlib.h>
 #include <stdexcept>
@@ -38,6 +40,14 @@ namespace LPMP {
         std::cout << "[print_statistics] #average nr vars per group = " << stor.nr_variables() / double(var_groups.size()) << "\n";
     }
 
+    // relative gap between primal objective and lower bound, infinite if no primal solution is known
+    double relative_gap(const double lb, const double ub)
+    {
+        if(ub == std::numeric_limits<double>::infinity())
+            return std::numeric_limits<double>::infinity();
+        return std::max(ub - lb, 0.0) / std::max({std::abs(lb), std::abs(ub), 1e-9});
+    }
+
     bdd_solver_options::bdd_solver_options(int argc, char** argv)
     {
         MEASURE_FUNCTION_EXECUTION_TIME;
@@ -81,6 +91,28 @@ namespace LPMP {
 
         app.add_option("--constraint_groups", constraint_groups, "allow multiple constraints to be fused into one, default = true");
 
+        auto coalesce_arg = app.add_flag("--coalesce", coalesce, "merge overlapping bdds whose conjunction stays small, fewer and larger bdds need fewer iterations");
+        auto coalesce_param_group = app.add_option_group("coalescing parameters", "parameters for merging bdds before optimization");
+        coalesce_param_group->needs(coalesce_arg);
+        coalesce_param_group->add_option("--coalesce_heuristics", coalesce_heuristics, "heuristics proposing bdd pairs to merge, any of overlap, bridge, subsumption, contiguous_overlap, subsumption_except_one, partial_contiguous_overlap, default = overlap")
+            ->check(CLI::IsMember({"overlap", "bridge", "subsumption", "contiguous_overlap", "subsumption_except_one", "partial_contiguous_overlap"}));
+        coalesce_param_group->add_option("--coalesce_node_limit", coalesce_options_.node_limit, "maximum number of nodes of a merged bdd, default value = 10000")
+            ->check(CLI::PositiveNumber);
+        coalesce_param_group->add_option("--coalesce_node_budget", coalesce_options_.node_budget, "maximum total number of nodes after coalescing relative to before, default value = 1.2")
+            ->check(CLI::Range(1.0, std::numeric_limits<double>::max()));
+        coalesce_param_group->add_option("--coalesce_bdds_per_variable", coalesce_options_.max_bdds_per_variable, "overlap heuristic: only pair bdds sharing a variable covered by at most so many bdds, default value = 16")
+            ->check(CLI::PositiveNumber);
+        coalesce_param_group->add_option("--coalesce_rounds", coalesce_options_.max_rounds, "maximum number of coalescing rounds, default value = 5")
+            ->check(CLI::NonNegativeNumber);
+
+        auto anytime_group = app.add_option_group("anytime primal", "periodic primal solutions during dual optimization");
+        anytime_group->add_option("--anytime_primal_iterations", anytime_primal_iterations, "compute primal solution every so many iterations, default value = 0 (never)")
+            ->check(CLI::NonNegativeNumber);
+        anytime_group->add_option("--anytime_primal_time", anytime_primal_time, "compute primal solution every so many seconds, default value = 0 (never)")
+            ->check(CLI::NonNegativeNumber);
+        anytime_group->add_option("--gap_tolerance", gap_tolerance, "termination criterion: relative gap between best primal solution and lower bound, default value = 0")
+            ->check(CLI::NonNegativeNumber);
+
         app.add_option("-l, --time_limit", time_limit, "time limit in seconds, default value = 3600")
             ->check(CLI::PositiveNumber);
 
@@ -97,6 +129,20 @@ namespace LPMP {
         solver_group->add_option("-s, --solver", bdd_solver_impl_, "name of solver for the relaxation")
             ->transform(CLI::CheckedTransformer(bdd_solver_impl_map, CLI::ignore_case));
 
+        app.add_option("--sequential_mma_threads", sequential_mma_nr_threads, "number of threads for sequential mma, sweeps advance in wavefronts of variables that are processed in parallel, default value = 1")
+            ->check(CLI::PositiveNumber);
+
+        app.add_option("--active_set_threshold", parallel_mma_active_set_threshold, "parallel mma skips bdds whose variables had min-marginal residuals of at most this value in the previous iteration, default value = 0 (process all bdds)")
+            ->check(CLI::NonNegativeNumber);
+
+        app.add_option("--omega", parallel_mma_omega, "parallel mma: fraction of min-marginal differences sent per pass, in (0,1], default value = 0.5")
+            ->check(CLI::Range(std::numeric_limits<double>::min(), 1.0));
+        app.add_flag("--adaptive_omega", parallel_mma_adaptive_omega, "parallel mma: adapt omega between 0.3 and 0.7 to lower bound progress");
+        app.add_option("--momentum", parallel_mma_momentum, "parallel mma: extrapolate reparametrization by this multiple of its change since the last extrapolation, reverted if the lower bound does not improve, e.g. 0.9, default value = 0 (off)")
+            ->check(CLI::NonNegativeNumber);
+        app.add_option("--momentum_interval", parallel_mma_momentum_interval, "parallel mma: number of iterations between extrapolations, default value = 3")
+            ->check(CLI::PositiveNumber);
+
         auto solution_statistics_arg = app.add_flag("--solution_statistics", solution_statistics, "list min marginals and objective after solving dual problem");
 
         std::unordered_map<std::string, bdd_solver_precision> bdd_solver_precision_map{
@@ -111,6 +157,7 @@ namespace LPMP {
         auto primal_group = app.add_option_group("primal rounding", "method for obtaining a primal solution from the dual optimization");
         auto diving_primal_arg = primal_group->add_flag("--diving_primal", diving_primal_rounding, "diving primal rounding flag");
         auto incremental_primal_arg = primal_group->add_flag("--incremental_primal", incremental_primal_rounding, "incremental primal rounding flag");
+        primal_group->add_flag("--decoding_primal", decoding_primal_rounding, "primal solution by voting over shortest paths of bdds with conflict repair");
         primal_group->require_option(0,1); 
 
         auto primal_param_group = app.add_option_group("primal diving parameters", "parameters for rounding a primal solution");
@@ -140,7 +187,25 @@ namespace LPMP {
         incremental_rounding_param_group->add_option("--incremental_primal_num_itr_lb", incremental_primal_num_itr_lb, "number of iterations of dual optimization during incremental primal rounding")
             ->check(CLI::Range(1,std::numeric_limits<int>::max()));
 
+        auto local_search_arg = app.add_flag("--local_search", local_search, "improve primal solution found by rounding with local search");
+        auto local_search_param_group = app.add_option_group("local search parameters", "parameters for local search improvement of primal solutions");
+        local_search_param_group->needs(local_search_arg);
+        local_search_param_group->add_option("--local_search_rounds", local_search_options_.max_rounds, "maximum number of local search rounds, default value = 10")
+            ->check(CLI::NonNegativeNumber);
+        local_search_param_group->add_option("--local_search_repair_iterations", local_search_options_.max_repair_iterations, "number of resolves of bdd neighbourhoods with variables of violated constraints fixed, default value = 3")
+            ->check(CLI::NonNegativeNumber);
+
         auto tighten_arg = app.add_flag("--tighten", tighten, "tighten relaxation flag");
+        auto tighten_param_group = app.add_option_group("tightening parameters", "parameters for tightening the relaxation when lower bound progress stalls");
+        tighten_param_group->needs(tighten_arg);
+        tighten_param_group->add_option("--tighten_rounds", tighten_max_rounds, "maximum number of tightening rounds, default value = 10")
+            ->check(CLI::NonNegativeNumber);
+        tighten_param_group->add_option("--tighten_variables", tightening_options_.max_variables, "maximum number of variables with inconsistent min-marginals targeted per round, default value = 100")
+            ->check(CLI::PositiveNumber);
+        tighten_param_group->add_option("--tighten_bdds", tightening_options_.max_bdds_per_group, "maximum number of bdds intersected per targeted variable, default value = 8")
+            ->check(CLI::Range(size_t(2), std::numeric_limits<size_t>::max()));
+        tighten_param_group->add_option("--tighten_node_limit", tightening_options_.node_limit, "maximum number of nodes of an intersected bdd, default value = 10000")
+            ->check(CLI::PositiveNumber);
         
         solver_group->add_flag("--statistics", statistics, "statistics of the problem");
 
@@ -148,6 +213,10 @@ namespace LPMP {
 
         solver_group->add_option("--export_bdd_graph", export_bdd_graph_file, "filename for export of BDD representation in .dot format");
 
+        app.add_option("--import_dual_state", import_dual_state_file, "warm start dual optimization from dual state exported by a previous solve of a structurally identical instance")
+            ->check(CLI::ExistingPath);
+        app.add_option("--export_dual_state", export_dual_state_file, "filename for export of dual state after dual optimization");
+
         solver_group->require_option(1); // either a solver or statistics
 
         // TODO: replace with needs as for incremental rounding options
@@ -252,6 +321,27 @@ namespace LPMP {
         costs = options.ilp.objective();
 
         bdd_preprocessor bdd_pre(options.ilp, options.constraint_groups);
+        if(options.coalesce)
+        {
+            for(const std::string& heuristic : options.coalesce_heuristics)
+            {
+                if(heuristic == "overlap")
+                    bdd_pre.set_coalesce_overlap();
+                else if(heuristic == "bridge")
+                    bdd_pre.set_coalesce_bridge();
+                else if(heuristic == "subsumption")
+                    bdd_pre.set_coalesce_subsumption();
+                else if(heuristic == "contiguous_overlap")
+                    bdd_pre.set_coalesce_contiguous_overlap();
+                else if(heuristic == "subsumption_except_one")
+                    bdd_pre.set_coalesce_subsumption_except_one();
+                else if(heuristic == "partial_contiguous_overlap")
+                    bdd_pre.set_coalesce_partial_contiguous_overlap();
+                else
+                    throw std::runtime_error("bdd coalescing heuristic " + heuristic + " not recognized.");
+            }
+            bdd_pre.coalesce(options.coalesce_options_);
+        }
         bdd_storage stor(bdd_pre);
 
         std::cout << std::setprecision(10);
@@ -310,11 +400,16 @@ namespace LPMP {
                 solver = std::move(bdd_mma_vec<double>(bdd_pre.get_bdd_collection(), options.ilp.objective().begin(), options.ilp.objective().end()));
             else
                 throw std::runtime_error("only float and double precision allowed");
+            if(options.sequential_mma_nr_threads > 1)
+                std::visit([&](auto&& s) {
+                        if constexpr(std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_mma_vec<float>> || std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_mma_vec<double>>)
+                        s.set_nr_threads(options.sequential_mma_nr_threads);
+                        }, *solver);
             std::cout << "[bdd solver] constructed sequential mma solver\n"; 
         } 
         else if(options.bdd_solver_impl_ == bdd_solver_options::bdd_solver_impl::decomposition_mma)
         {
-            solver = std::move(decomposition_bdd_mma(stor, options.ilp.objective().begin(), options.ilp.objective().end(), options.decomposition_mma_options_));
+            solver = std::move(decomposition_bdd_mma(bdd_pre.get_bdd_collection(), options.ilp.objective().begin(), options.ilp.objective().end(), options.decomposition_mma_options_));
             std::cout << "[bdd solver] constructed decomposition mma solver\n";
         }
         else if(options.bdd_solver_impl_ == bdd_solver_options::bdd_solver_impl::parallel_mma)
@@ -325,6 +420,15 @@ namespace LPMP {
                 solver = std::move(bdd_parallel_mma<double>(bdd_pre.get_bdd_collection(), options.ilp.objective().begin(), options.ilp.objective().end()));
             else
                 throw std::runtime_error("only float and double precision allowed");
+            std::visit([&](auto&& s) {
+                    if constexpr(std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_parallel_mma<float>> || std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_parallel_mma<double>>)
+                    {
+                        if(options.parallel_mma_active_set_threshold > 0.0)
+                            s.set_active_set(options.parallel_mma_active_set_threshold);
+                        s.set_omega(options.parallel_mma_omega, options.parallel_mma_adaptive_omega);
+                        s.set_momentum(options.parallel_mma_momentum, options.parallel_mma_momentum_interval);
+                    }
+                    }, *solver);
             std::cout << "[bdd solver] constructed parallel mma solver\n"; 
         }
         else if(options.bdd_solver_impl_ == bdd_solver_options::bdd_solver_impl::mma_cuda)
@@ -342,13 +446,22 @@ namespace LPMP {
             throw std::runtime_error("no solver nor output of statistics or export of lp selected");
         }
 
+        if(options.import_dual_state_file != "")
+            import_dual_state(options.import_dual_state_file);
+
         if(options.diving_primal_rounding)
         {
             std::cout << options.fixing_options_.var_order << ", " << options.fixing_options_.var_value << "\n";
-            primal_heuristic = std::move(bdd_fix(stor, options.fixing_options_));
+            primal_heuristic = std::move(bdd_dive(bdd_pre.get_bdd_collection(), options.fixing_options_));
             std::cout << "[bdd solver] constructed primal heuristic\n";
         }
 
+        if(options.local_search)
+        {
+            local_search = std::move(primal_local_search(options.ilp, bdd_pre.get_bdd_collection(), options.local_search_options_));
+            std::cout << "[bdd solver] constructed primal local search\n";
+        }
+
         auto setup_time = (double) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count() / 1000;
         std::cout << "[bdd solver] setup time = " << setup_time << " s" << "\n";
         options.time_limit -= setup_time;
@@ -380,24 +493,59 @@ namespace LPMP {
             std::cout << "[bdd_solver] Time limit exceeded." << std::endl;
             return;
         }
+        const auto solve_begin_time = std::chrono::steady_clock::now();
+        run_solver_callback callback;
+        if(options.anytime_primal_iterations > 0 || options.anytime_primal_time > 0.0)
+        {
+            std::cout << "[bdd solver] anytime primal every " << options.anytime_primal_iterations << " iterations and " << options.anytime_primal_time << " s, gap tolerance = " << options.gap_tolerance << "\n";
+            // run_solver restarts iterations and time after each tightening round, hence count both from the start of solve
+            callback = [this, solve_begin_time, nr_iterations = size_t(0), last_primal_time = 0.0](const size_t, const double lb, const double) mutable {
+                const double time_spent = (double) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - solve_begin_time).count() / 1000;
+                return anytime_primal(nr_iterations++, lb, time_spent, last_primal_time);
+            };
+        }
+
+        auto remaining_time = [&]() {
+            const auto time = std::chrono::steady_clock::now();
+            return options.time_limit - (double) std::chrono::duration_cast<std::chrono::milliseconds>(time - solve_begin_time).count() / 1000;
+        };
+
         std::visit([&](auto&& s) {
 
-                run_solver(s, options.max_iter, options.tolerance, options.improvement_slope, options.time_limit);
+                run_solver(s, options.max_iter, options.tolerance, options.improvement_slope, options.time_limit, true, callback);
                 }, *solver);
 
-        // TODO: improve, do periodic tightening
-        if(options.tighten)
+        // dual optimization stops when lower bound progress stalls. Then tighten the relaxation and continue
+        for(size_t tighten_round=0; options.tighten && tighten_round<options.tighten_max_rounds; ++tighten_round)
         {
-            for(size_t tighten_iter=0; tighten_iter<10; ++tighten_iter)
-            {
-            tighten();
+            if(remaining_time() <= 0.0 || relative_gap(lower_bound(), upper_bound_) <= options.gap_tolerance)
+                break;
+            const double lb_before = lower_bound();
+            const auto tighten_begin_time = std::chrono::steady_clock::now();
+            const tightening_statistics stats = tighten();
+            const double tighten_time = (double) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - tighten_begin_time).count() / 1000;
+            const double lb_gain = lower_bound() - lb_before;
+            std::cout << "[bdd solver] tightening round " << tighten_round << ": " << stats.nr_inconsistent_variables << " inconsistent variables, " 
+                << stats.nr_new_bdds << " of " << stats.nr_groups << " intersections added, " << stats.nr_existing_intersections << " already present, " << stats.nr_exceeded_node_limit << " exceeded node limit, " << stats.nr_intersection_nodes << " intersection nodes, "
+                << "time = " << tighten_time << " s, lower bound gain = " << lb_gain << ", gain per second = " << lb_gain / std::max(tighten_time, 1e-3) << "\n";
+            if(stats.nr_new_bdds == 0 && stats.nr_existing_intersections == 0)
+                break;
+
             std::visit([&](auto&& s) {
-                    for(size_t iter=0; iter<10; ++iter)
-                        s.iteration();
+                    run_solver(s, options.max_iter, options.tolerance, options.improvement_slope, std::max(remaining_time(), 0.0), true, callback);
                     }, *solver);
-            }
+            std::cout << "[bdd solver] lower bound gain after tightening round " << tighten_round << " and reoptimization = " << lower_bound() - lb_before << "\n";
+            // only costs were moved between existing bdds and this did not help
+            if(stats.nr_new_bdds == 0 && lower_bound() - lb_before <= options.tolerance * std::abs(lb_before))
+                break;
         }
 
+        if(options.export_dual_state_file != "")
+            export_dual_state(options.export_dual_state_file);
+
+        if(callback)
+            std::cout << "[bdd solver] best primal solution = " << upper_bound_ << ", lower bound = " << lower_bound() << ", gap = " << relative_gap(lower_bound(), upper_bound_) << "\n";
+
         if(options.solution_statistics)
         {
             std::cout << "[bdd solver] print solution statistics:\n";
@@ -460,11 +608,16 @@ namespace LPMP {
             assert(primal_solution.size() == costs.size());
             double upper_bound = std::inner_product(primal_solution.begin(), primal_solution.end(), costs.begin(), 0.0);
             std::cout << "Primal solution value: " << upper_bound << std::endl;
+            if(local_search && options.ilp.feasible(primal_solution.begin(), primal_solution.end()))
+            {
+                upper_bound = local_search->improve(primal_solution);
+                std::cout << "Primal solution value after local search: " << upper_bound << std::endl;
+            }
         }
         else if(options.incremental_primal_rounding)
         {
             std::cout << "[incremental primal rounding] start rounding\n";
-            const auto sol = std::visit([&](auto&& s) {
+            auto sol = std::visit([&](auto&& s) {
                     if constexpr( // CPU rounding
                             std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_mma_vec<float>>
                             || std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_mma_vec<double>>
@@ -492,28 +645,93 @@ namespace LPMP {
 
             const double obj = options.ilp.evaluate(sol.begin(), sol.end());
             std::cout << "[incremental primal rounding] solution objective = " << obj << "\n";
+            if(local_search && obj < std::numeric_limits<double>::infinity())
+            {
+                const double improved_obj = local_search->improve(sol);
+                std::cout << "[incremental primal rounding] solution objective after local search = " << improved_obj << "\n";
+            }
+        }
+        else if(options.decoding_primal_rounding)
+        {
+            std::cout << "[primal decoding] start decoding\n";
+            auto sol = std::visit([&](auto&& s) {
+                    if constexpr(
+                            std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_parallel_mma<float>>
+                            || std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_parallel_mma<double>>
+                            )
+                    return s.decode_primal_solution(true);
+                    else
+                    {
+                    throw std::runtime_error("solver not supported for primal decoding");
+                    return std::vector<char>{};
+                    }
+                    }, *solver);
+
+            if(sol.empty())
+                return;
+            // variables not covered by any bdd
+            for(size_t i=sol.size(); i<costs.size(); ++i)
+                sol.push_back(costs[i] < 0.0 ? 1 : 0);
+
+            const double obj = options.ilp.evaluate(sol.begin(), sol.end());
+            std::cout << "[primal decoding] solution objective = " << obj << "\n";
+            if(local_search && obj < std::numeric_limits<double>::infinity())
+            {
+                const double improved_obj = local_search->improve(sol);
+                std::cout << "[primal decoding] solution objective after local search = " << improved_obj << "\n";
+            }
         }
     } 
 
-    void bdd_solver::tighten()
+    tightening_statistics bdd_solver::tighten()
     {
         MEASURE_FUNCTION_EXECUTION_TIME;
 
         if(options.time_limit < 0)
         {
             std::cout << "Time limit exceeded, aborting tightening." << std::endl;
-            return;
+            return {};
         }
 
         std::cout << "Tighten...\n";
-        std::visit([](auto&& s) {
-            if constexpr(std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_mma_vec<float>>)
-            s.tighten();
+        return std::visit([&](auto&& s) -> tightening_statistics {
+            if constexpr(
+                    std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_mma_vec<float>> || std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_mma_vec<double>>
+                    || std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_parallel_mma<float>> || std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_parallel_mma<double>>)
+                return s.tighten(options.tightening_options_);
             else
                 throw std::runtime_error("tighten not implemented");
             }, *solver);
     }
 
+    void bdd_solver::import_dual_state(const std::string& filename)
+    {
+        const bdd_dual_state state = bdd_dual_state::load(filename);
+        std::visit([&](auto&& s) {
+            if constexpr(
+                    std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_mma_vec<float>> || std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_mma_vec<double>>
+                    || std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_parallel_mma<float>> || std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_parallel_mma<double>>)
+                s.import_dual_state(state, options.ilp.objective());
+            else
+                throw std::runtime_error("dual state import not implemented");
+            }, *solver);
+        std::cout << "[bdd solver] warm start from dual state " << filename << ", lower bound = " << lower_bound() << "\n";
+    }
+
+    void bdd_solver::export_dual_state(const std::string& filename)
+    {
+        const bdd_dual_state state = std::visit([&](auto&& s) -> bdd_dual_state {
+            if constexpr(
+                    std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_mma_vec<float>> || std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_mma_vec<double>>
+                    || std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_parallel_mma<float>> || std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_parallel_mma<double>>)
+                return s.export_dual_state(options.ilp.objective());
+            else
+                throw std::runtime_error("dual state export not implemented");
+            }, *solver);
+        state.save(filename);
+        std::cout << "[bdd solver] exported dual state of " << state.costs.size() << " bdd variables to " << filename << "\n";
+    }
+
     void bdd_solver::fix_variable(const size_t var, const bool value)
     {
         std::visit([var, value](auto&& s) {
@@ -534,6 +752,61 @@ namespace LPMP {
         fix_variable(var_index, value);
     }
 
+    std::vector<char> bdd_solver::cheap_primal_solution()
+    {
+        std::vector<char> sol = std::visit([&](auto&& s) {
+                if constexpr(
+                        std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_parallel_mma<float>>
+                        || std::is_same_v<std::remove_reference_t<decltype(s)>, bdd_parallel_mma<double>>
+                        )
+                return s.decode_primal_solution();
+                else
+                {
+                // round by agreement of min-marginals, inconsistent variables according to their sum
+                std::vector<mm_agreement> agreement;
+                detail::min_marginal_agreement(s, agreement, 0);
+                std::vector<char> sol(agreement.size());
+                for(size_t i=0; i<agreement.size(); ++i)
+                    sol[i] = agreement[i].type == mm_type::one || (agreement[i].type == mm_type::inconsistent && agreement[i].sum_diff < 0.0) ? 1 : 0;
+                return sol;
+                }
+                }, *solver);
+
+        if(sol.empty())
+            return sol;
+        // variables not covered by any bdd
+        for(size_t i=sol.size(); i<costs.size(); ++i)
+            sol.push_back(costs[i] < 0.0 ? 1 : 0);
+        return sol;
+    }
+
+    bool bdd_solver::anytime_primal(const size_t iter, const double lb, const double time_spent, double& last_primal_time)
+    {
+        const bool iteration_due = options.anytime_primal_iterations > 0 && (iter+1) % options.anytime_primal_iterations == 0;
+        const bool time_due = options.anytime_primal_time > 0.0 && time_spent - last_primal_time >= options.anytime_primal_time;
+        if(iteration_due || time_due)
+        {
+            last_primal_time = time_spent;
+            std::vector<char> sol = cheap_primal_solution();
+            double obj = sol.empty() ? std::numeric_limits<double>::infinity() : options.ilp.evaluate(sol.begin(), sol.end());
+            if(local_search && obj < std::numeric_limits<double>::infinity())
+                obj = local_search->improve(sol);
+            if(obj < upper_bound_)
+            {
+                upper_bound_ = obj;
+                incumbent_ = std::move(sol);
+            }
+            std::cout << "[bdd solver] iteration " << iter << ", primal solution = " << obj << ", best primal solution = " << upper_bound_ << ", lower bound = " << lb << ", gap = " << relative_gap(lb, upper_bound_) << "\n";
+        }
+
+        if(relative_gap(lb, upper_bound_) <= options.gap_tolerance)
+        {
+            std::cout << "[bdd solver] gap " << relative_gap(lb, upper_bound_) << " below tolerance " << options.gap_tolerance << "\n";
+            return false;
+        }
+        return true;
+    }
+
     double bdd_solver::lower_bound()
     {
         return std::visit([](auto&& s) {
@@ -8,10 +8,10 @@ namespace LPMP {
             using decomposition_bdd_base::decomposition_bdd_base; 
     };
 
-    decomposition_bdd_mma::decomposition_bdd_mma(bdd_storage& bdd_storage_, decomposition_mma_options opt)
+    decomposition_bdd_mma::decomposition_bdd_mma(BDD::bdd_collection& bdd_col, decomposition_mma_options opt)
     {
         MEASURE_FUNCTION_EXECUTION_TIME;
-        pimpl = std::make_unique<impl>(bdd_storage_, opt);
+        pimpl = std::make_unique<impl>(bdd_col, opt);
     }
 
     decomposition_bdd_mma::decomposition_bdd_mma(decomposition_bdd_mma&& o)
@@ -26,6 +26,11 @@ namespace LPMP {
 
     decomposition_bdd_mma::~decomposition_bdd_mma() {}
 
+    size_t decomposition_bdd_mma::nr_variables() const
+    {
+        return pimpl->nr_variables();
+    }
+
     void decomposition_bdd_mma::set_cost(const double c, const size_t var)
     {
         pimpl->set_cost(c, var);
@@ -1,118 +1,206 @@
 #include "decomposition_bdd_mma_base.h"
+#include <map>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <stdexcept>
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
 namespace LPMP {
 
-    ///////////////////////////////
-    // Lagrange_multiplier_queue //
-    ///////////////////////////////
+    /////////////////////////////////
+    // Lagrange_multiplier_channel //
+    /////////////////////////////////
 
-    //////////////////
-    // bdd_sub_base //
-    //////////////////
+    size_t decomposition_bdd_base::Lagrange_multiplier_channel::frame_size() const
+    {
+        size_t s = 0;
+        for(const auto& e : endpoints)
+            s += 2*(e.last_node - e.first_node);
+        return s;
+    }
+
+    void decomposition_bdd_base::Lagrange_multiplier_channel::init(const size_t capacity)
+    {
+        ring = std::make_unique<spsc_ring_buffer<double>>(frame_size(), capacity);
+        pending.resize(frame_size(), 0.0);
+        has_pending = false;
+    }
 
     ////////////////////////////
     // decomposition_bdd_base //
     ////////////////////////////
 
-    decomposition_bdd_base::decomposition_bdd_base(bdd_storage& bdd_storage_, decomposition_mma_options opt)
-        : intervals(bdd_storage_.compute_intervals(opt.nr_threads, opt.min_nr_bdd_nodes * (1-opt.force_thread_nr))),
-        intra_interval_message_passing_weight(opt.parallel_message_passing_weight)
+    decomposition_bdd_base::decomposition_bdd_base(BDD::bdd_collection& bdd_col, decomposition_mma_options opt)
+        : intra_interval_message_passing_weight(opt.parallel_message_passing_weight)
     {
-        costs.clear();
-        costs.resize(bdd_storage_.nr_variables(), 0.0);
+        assert(intra_interval_message_passing_weight >= 0 && intra_interval_message_passing_weight <= 1.0);
+        if(opt.multiplier_channel_capacity == 0)
+            throw std::runtime_error("Lagrange multiplier channels need positive capacity");
 
-        if(intervals.nr_intervals() == 1)
+        compute_intervals(bdd_col, opt);
+        costs.clear();
+        costs.resize(nr_variables(), 0.0);
+
+        // split bdds into slices, one per interval containing some of its variables.
+        // Consecutive slices of a bdd share the last variable of the earlier slice.
+        struct slice {
+            size_t bdd_nr;
+            std::array<size_t,2> var_range;
+            size_t interval_nr;
+            size_t local_bdd_nr;
+        };
+        std::vector<slice> slices;
+        std::vector<size_t> bdd_slice_offsets = {0};
+        for(size_t bdd_nr=0; bdd_nr<bdd_col.nr_bdds(); ++bdd_nr)
         {
-            // use base class alone without decomposition
-            std::cout << "not using decomposition, solve directly.\n";
-            bdd_bases = std::make_unique<bdd_sub_base[]>(1);
-            throw std::runtime_error("switch to bdd_collection");
-            //bdd_bases[0].base.add_bdds(bdd_storage_);
-            return; 
+            const auto vars = bdd_col.variables(bdd_nr);
+            size_t first_var = vars.front();
+            for(size_t i=0; i<vars.size(); ++i)
+            {
+                if(i+1 == vars.size() || interval(vars[i+1]) != interval(vars[i]))
+                {
+                    slices.push_back({bdd_nr, {first_var, vars[i]}, interval(vars[i]), std::numeric_limits<size_t>::max()});
+                    first_var = vars[i];
+                }
+            }
+            bdd_slice_offsets.push_back(slices.size());
         }
 
-        //intra_interval_message_passing_weight = 0.5;
-        //std::cout << "decomposing BDDs into " << intervals.nr_intervals() << " intervals: ";
-        //for(size_t i=0; i<intervals.nr_intervals(); ++i)
-        //    std::cout << "[" << intervals.interval_boundaries[i] << "," << intervals.interval_boundaries[i+1] << "), ";
-        //std::cout << "\n";
+        std::vector<std::vector<size_t>> interval_slices(nr_intervals());
+        for(size_t s=0; s<slices.size(); ++s)
+            interval_slices[slices[s].interval_nr].push_back(s);
 
-        assert(intra_interval_message_passing_weight >= 0 && intra_interval_message_passing_weight <= 1.0);
-        const size_t nr_intervals = opt.nr_threads;
+        bdd_bases = std::make_unique<bdd_sub_base[]>(nr_intervals());
+#pragma omp parallel for schedule(dynamic)
+        for(size_t i=0; i<nr_intervals(); ++i)
+        {
+            std::vector<size_t> bdd_nrs;
+            std::vector<std::array<size_t,2>> var_ranges;
+            for(const size_t s : interval_slices[i])
+            {
+                bdd_nrs.push_back(slices[s].bdd_nr);
+                var_ranges.push_back(slices[s].var_range);
+            }
+            const std::vector<size_t> local_bdd_nrs = bdd_bases[i].base.add_bdd_slices(bdd_col, bdd_nrs.begin(), bdd_nrs.end(), var_ranges.begin());
+            assert(local_bdd_nrs.size() == interval_slices[i].size());
+            for(size_t j=0; j<local_bdd_nrs.size(); ++j)
+                slices[interval_slices[i][j]].local_bdd_nr = local_bdd_nrs[j];
+        }
 
-        std::vector<bdd_storage> bdd_storages;
-        tsl::robin_set<bdd_storage::duplicate_variable, bdd_storage::duplicate_variable_hash> duplicated_bdd_variables;
-        std::tie(bdd_storages, duplicated_bdd_variables) = bdd_storage_.split_bdd_nodes(intervals);
-        // Does not compile on clang
-        //auto [bdd_storages, duplicated_bdd_variables] = bdd_storage_.split_bdd_nodes(intervals);
+        for(size_t i=0; i<nr_intervals(); ++i)
+            std::cout << "[decomposition mma] interval " << i << " = [" << interval_boundaries[i] << "," << interval_boundaries[i+1] << ") has " << bdd_bases[i].base.nr_bdd_nodes() << " bdd nodes\n";
 
-        //std::cout << "Allocate " << nr_intervals << " bdd bases\n";
-        bdd_bases = std::make_unique<bdd_sub_base[]>(nr_intervals);
-        std::vector<std::vector<typename bdd_storage::bdd_endpoints_>> bdd_endpoints(nr_intervals);
+        // one channel per direction and pair of intervals sharing split bdds
+        std::map<std::array<size_t,2>, size_t> channel_map;
+        auto get_channel = [&](const size_t from_interval, const size_t to_interval) -> Lagrange_multiplier_channel& {
+            auto it = channel_map.find({from_interval, to_interval});
+            if(it == channel_map.end())
+            {
+                it = channel_map.insert({{from_interval, to_interval}, channels.size()}).first;
+                channels.push_back(std::make_unique<Lagrange_multiplier_channel>(from_interval, to_interval));
+            }
+            return *channels[it->second];
+        };
 
-        bdd_endpoints.resize(nr_intervals);
-#pragma omp parallel for
-        for(size_t i=0; i<nr_intervals; ++i)
+        for(size_t bdd_nr=0; bdd_nr<bdd_col.nr_bdds(); ++bdd_nr)
         {
-            throw std::runtime_error("switch to bdd_collection");
-            //bdd_bases[i].base.add_bdds(bdd_storages[i]); 
-            std::cout << "BDD base for interval " << i << " has " << bdd_bases[i].base.nr_bdd_nodes() << " bdd nodes\n";
-            bdd_endpoints[i] = bdd_storages[i].bdd_endpoints();
+            for(size_t s=bdd_slice_offsets[bdd_nr]; s+1<bdd_slice_offsets[bdd_nr+1]; ++s)
+            {
+                const slice& s1 = slices[s];
+                const slice& s2 = slices[s+1];
+                assert(s1.interval_nr < s2.interval_nr);
+                assert(s1.var_range[1] == s2.var_range[0]);
+                const auto nodes_1 = bdd_bases[s1.interval_nr].base.last_bdd_node_range(s1.local_bdd_nr);
+                const auto nodes_2 = bdd_bases[s2.interval_nr].base.first_bdd_node_range(s2.local_bdd_nr);
+                assert(nodes_1[1] - nodes_1[0] == nodes_2[1] - nodes_2[0]);
+                get_channel(s1.interval_nr, s2.interval_nr).endpoints.push_back({nodes_1[0], nodes_1[1], nodes_2[0]});
+                get_channel(s2.interval_nr, s1.interval_nr).endpoints.push_back({nodes_2[0], nodes_2[1], nodes_1[0]});
+            }
         }
 
-        for(const auto [interval_1, bdd_nr_1, interval_2, bdd_nr_2] : duplicated_bdd_variables)
-
+        for(auto& c : channels)
         {
-            assert(interval_1 < interval_2);
-            //const auto [first_bdd_var_1, first_bdd_index_1, last_bdd_var_1, last_bdd_index_1] = bdd_endpoints(interval_1, bdd_nr_1);
-            //const auto [first_bdd_var_2, first_bdd_index_2, last_bdd_var_2, last_bdd_index_2] = bdd_endpoints(interval_2, bdd_nr_2);
-            const auto [first_bdd_var_1, first_bdd_index_1, last_bdd_var_1, last_bdd_index_1] = bdd_endpoints[interval_1][bdd_nr_1];
-            const auto [first_bdd_var_2, first_bdd_index_2, last_bdd_var_2, last_bdd_index_2] = bdd_endpoints[interval_2][bdd_nr_2];
-
-            //std::cout << first_bdd_var_1 << "," <<  first_bdd_index_1 << "," <<  last_bdd_var_1 << "," <<  last_bdd_index_1 << "\n";
-            //std::cout << first_bdd_var_2 << "," <<  first_bdd_index_2 << "," <<  last_bdd_var_2 << "," <<  last_bdd_index_2 << "\n";
-            //std::cout << "\n";
-
-            assert(last_bdd_var_1 == first_bdd_var_2);
-
-            const auto offsets_1 = bdd_bases[interval_1].base.bdd_branch_node_offset(last_bdd_var_1, last_bdd_index_1);
-            const auto offsets_2 = bdd_bases[interval_2].base.bdd_branch_node_offset(first_bdd_var_2, first_bdd_index_2);
-            const endpoint e1 = {offsets_1[0], offsets_1[1], interval_2, offsets_2[0]};
-            bdd_bases[interval_1].forward_endpoints.push_back(e1);
-            const endpoint e2 = {offsets_2[0], offsets_2[1], interval_1, offsets_1[0]};
-            bdd_bases[interval_2].backward_endpoints.push_back(e2);
+            c->init(opt.multiplier_channel_capacity);
+            if(c->from_interval < c->to_interval)
+            {
+                bdd_bases[c->from_interval].forward_out.push_back(c.get());
+                bdd_bases[c->to_interval].forward_in.push_back(c.get());
+            }
+            else
+            {
+                bdd_bases[c->from_interval].backward_out.push_back(c.get());
+                bdd_bases[c->to_interval].backward_in.push_back(c.get());
+            }
         }
+        std::cout << "[decomposition mma] " << channels.size() << " Lagrange multiplier channels\n";
+    }
 
-        for(size_t i=0; i<intervals.nr_intervals(); ++i)
+    void decomposition_bdd_base::compute_intervals(const BDD::bdd_collection& bdd_col, const decomposition_mma_options& opt)
+    {
+        std::vector<size_t> nodes_per_variable;
+        size_t nr_bdd_nodes = 0;
+        for(size_t bdd_nr=0; bdd_nr<bdd_col.nr_bdds(); ++bdd_nr)
         {
-            auto endpoint_order = [](const auto& e1, const auto& e2) { return e1.opposite_interval_nr < e2.opposite_interval_nr; };
-            std::sort(bdd_bases[i].forward_endpoints.begin(), bdd_bases[i].forward_endpoints.end(), endpoint_order);
-            std::sort(bdd_bases[i].backward_endpoints.begin(), bdd_bases[i].backward_endpoints.end(), endpoint_order);
+            for(auto it=bdd_col.cbegin(bdd_nr); it!=bdd_col.cend(bdd_nr); ++it)
+            {
+                if(it->is_terminal())
+                    continue;
+                if(it->index >= nodes_per_variable.size())
+                    nodes_per_variable.resize(it->index+1, 0);
+                ++nodes_per_variable[it->index];
+                ++nr_bdd_nodes;
+            }
         }
+        nr_variables_ = nodes_per_variable.size();
+
+        // if number of intervals would lead to subproblems that have fewer than min_nr_bdd_nodes, decrease the number of intervals
+        const size_t min_nr_bdd_nodes = opt.force_thread_nr ? 0 : opt.min_nr_bdd_nodes;
+        const size_t nr_intervals = [&]() -> size_t {
+            if(nr_bdd_nodes <= min_nr_bdd_nodes)
+                return 1;
+            else if(min_nr_bdd_nodes * opt.nr_threads >= nr_bdd_nodes)
+                return nr_bdd_nodes / min_nr_bdd_nodes;
+            return std::max(size_t(1), std::min(opt.nr_threads, nr_variables()));
+        }();
+        std::cout << "[decomposition mma] nr intervals = " << nr_intervals << ", requested nr intervals = " << opt.nr_threads << ", min nr bdd nodes per interval = " << min_nr_bdd_nodes << "\n";
+
+        // partition into intervals with equal number of bdd nodes
+        interval_boundaries.clear();
+        interval_boundaries.push_back(0);
+        size_t cumulative_sum = 0;
+        for(size_t i=0; i+1<nr_variables(); ++i)
+        {
+            cumulative_sum += nodes_per_variable[i];
+            if(interval_boundaries.size() < nr_intervals && cumulative_sum >= nr_bdd_nodes*double(interval_boundaries.size())/double(nr_intervals))
+                interval_boundaries.push_back(i+1);
+        }
+        interval_boundaries.push_back(nr_variables());
     }
 
-    size_t decomposition_bdd_base::nr_variables() const
+    size_t decomposition_bdd_base::interval(const size_t var) const
     {
-        return bdd_bases[0].base.nr_variables();
+        assert(var < nr_variables());
+        return std::distance(interval_boundaries.begin(), std::upper_bound(interval_boundaries.begin(), interval_boundaries.end(), var)) - 1;
     }
 
     void decomposition_bdd_base::set_cost(const double c, const size_t var)
     {
         assert(var < costs.size());
-        assert(intervals.interval(var) < intervals.nr_intervals());
         assert(costs[var] == 0.0);
         costs[var] = c;
+        auto covers = [&](const size_t i) { return var < bdd_bases[i].base.nr_variables() && bdd_bases[i].base.nr_bdds(var) > 0; };
         size_t nr_cover_intervals = 0;
-        for(size_t i=0; i<intervals.nr_intervals(); ++i)
-            if(bdd_bases[i].base.nr_bdds(var) > 0)
+        for(size_t i=0; i<nr_intervals(); ++i)
+            if(covers(i))
                 ++nr_cover_intervals;
+        assert(nr_cover_intervals > 0);
 
-        for(size_t i=0; i<intervals.nr_intervals(); ++i)
+        for(size_t i=0; i<nr_intervals(); ++i)
         {
-            if(bdd_bases[i].base.nr_bdds(var) > 0)
+            if(covers(i))
             {
                 const double interval_cost = c/double(nr_cover_intervals);
                 bdd_bases[i].base.update_cost(0, interval_cost, var);
@@ -122,168 +210,75 @@ namespace LPMP {
 
     void decomposition_bdd_base::backward_run()
     {
-#pragma omp parallel for
-        for(std::ptrdiff_t interval_nr=intervals.nr_intervals()-1; interval_nr>=0; --interval_nr)
+#pragma omp parallel for schedule(static,1) num_threads(nr_intervals())
+        for(size_t interval_nr=0; interval_nr<nr_intervals(); ++interval_nr)
         {
-            bdd_bases[interval_nr].read_in_Lagrange_multipliers(bdd_bases[interval_nr].backward_queue);
-            bdd_bases[interval_nr].read_in_Lagrange_multipliers(bdd_bases[interval_nr].forward_queue);
+            for(auto* c : bdd_bases[interval_nr].forward_in)
+                flush_Lagrange_multipliers(*c);
+            for(auto* c : bdd_bases[interval_nr].backward_in)
+                flush_Lagrange_multipliers(*c);
             bdd_bases[interval_nr].base.backward_run();
             bdd_bases[interval_nr].base.compute_lower_bound();
         }
     }
 
-    void decomposition_bdd_base::solve(const size_t max_iter, const double tolerance, const double time_limit)
+    void decomposition_bdd_base::iteration()
     {
-        const auto start_time = std::chrono::steady_clock::now();
-        double lb_prev = this->lower_bound();
-        double lb_post = lb_prev;
-        std::cout << "initial lower bound = " << lb_prev;
-        auto time = std::chrono::steady_clock::now();
-        std::cout << ", time = " << (double) std::chrono::duration_cast<std::chrono::milliseconds>(time - start_time).count() / 1000 << " s";
-        std::cout << "\n";
-        // version where forward and backward passes are executed at
-        for(size_t i=0; i<max_iter; ++i)
-        {
-#pragma omp parallel for
-            for(size_t t=0; t<intervals.nr_intervals(); ++t)
-            {
-                min_marginal_averaging_forward(t);
-            }
-#pragma omp parallel for
-            for(size_t t=0; t<intervals.nr_intervals(); ++t)
-            {
-                min_marginal_averaging_backward(t);
-            }
-#pragma omp parallel for
-            for(size_t t=0; t<intervals.nr_intervals(); ++t)
-            {
-                bdd_bases[t].base.compute_lower_bound();
-            }
-            lb_prev = lb_post;
-            lb_post = this->lower_bound();
-            std::cout << "iteration " << i << ", lower bound = " << lb_post;
-            time = std::chrono::steady_clock::now();
-            double time_spent = (double) std::chrono::duration_cast<std::chrono::milliseconds>(time - start_time).count() / 1000;
-            std::cout << ", time = " << time_spent << " s";
-            std::cout << "\n";
-            assert(lb_post >= lb_prev - std::numeric_limits<double>::epsilon());
-            if (lb_post < lb_prev - std::numeric_limits<double>::epsilon())
-            {
-                std::cout << "Lower bound did not increase (something went wrong). Abort." << std::endl;
-                exit(0);
-            }
-            if (time_spent > time_limit)
-            {
-                std::cout << "Time limit reached." << std::endl;
-                break;
-            }
-            if (std::abs(lb_prev-lb_post) < std::abs(tolerance*lb_prev))
-            {
-                std::cout << "Relative progress less than tolerance (" << tolerance << ")\n";
-                break;
-            }
-        }
-
-        backward_run(); // To flush out the Lagrange multiplier queues and recompute final lower bound
-        std::cout << "final lower bound = " << lower_bound() << "\n"; 
+#pragma omp parallel for schedule(static,1) num_threads(nr_intervals())
+        for(size_t t=0; t<nr_intervals(); ++t)
+            min_marginal_averaging_forward(t);
+#pragma omp parallel for schedule(static,1) num_threads(nr_intervals())
+        for(size_t t=0; t<nr_intervals(); ++t)
+            min_marginal_averaging_backward(t);
+#pragma omp parallel for schedule(static,1) num_threads(nr_intervals())
+        for(size_t t=0; t<nr_intervals(); ++t)
+            bdd_bases[t].base.compute_lower_bound();
     }
 
-    void decomposition_bdd_base::iteration()
+    void decomposition_bdd_base::apply_Lagrange_multipliers(const Lagrange_multiplier_channel& c, const double* deltas)
     {
-#pragma omp parallel for
-            for(size_t t=0; t<intervals.nr_intervals(); ++t)
-            {
-                min_marginal_averaging_forward(t);
-            }
-#pragma omp parallel for
-            for(size_t t=0; t<intervals.nr_intervals(); ++t)
-            {
-                min_marginal_averaging_backward(t);
-            }
-#pragma omp parallel for
-            for(size_t t=0; t<intervals.nr_intervals(); ++t)
-            {
-                bdd_bases[t].base.compute_lower_bound();
-            }
+        auto& base = bdd_bases[c.to_interval].base;
+        for(const auto& e : c.endpoints)
+        {
+            const size_t nr_deltas = 2*(e.last_node - e.first_node);
+            base.update_arc_costs(e.first_node_opposite_interval, deltas, deltas + nr_deltas);
+            deltas += nr_deltas;
+        }
     }
 
-    void decomposition_bdd_base::bdd_sub_base::read_in_Lagrange_multipliers(typename decomposition_bdd_base::Lagrange_multiplier_queue& q)
+    void decomposition_bdd_base::read_in_Lagrange_multipliers(Lagrange_multiplier_channel& c)
     {
-        //std::cout << "read in queue of size " << q.queue.size() << "\n";
-        std::lock_guard<std::mutex> lck(q.mutex);
-        std::vector<double> deltas;
-        while(!q.queue.empty())
+        while(const double* deltas = c.ring->front_read())
         {
-            assert(q.queue.size() >= 4); // at least two deltas are present
-            const size_t first_node = q.queue.front().first_node;
-            q.queue.pop();
-            const size_t nr_deltas = q.queue.front().nr_deltas;
-            assert(nr_deltas % 2 == 0);
-            q.queue.pop();
-            assert(q.queue.size() >= nr_deltas);
-            deltas.clear();
-            //std::cout << "Lagrange multiplier update: ";
-            for(size_t c=0; c<nr_deltas; ++c)
-            {
-                deltas.push_back(q.queue.front().delta);
-                //std::cout << deltas.back() << ", ";
-                assert(deltas.back() >= 0.0);
-                q.queue.pop();
-            }
-            //std::cout << "\n";
-
-            base.update_arc_costs(first_node, deltas.begin(), deltas.end()); 
+            apply_Lagrange_multipliers(c, deltas);
+            c.ring->pop();
         }
     }
 
-    template<typename ITERATOR>
-        void decomposition_bdd_base::Lagrange_multiplier_queue::write_to_queue(const size_t node_nr, ITERATOR begin, ITERATOR end)
+    void decomposition_bdd_base::flush_Lagrange_multipliers(Lagrange_multiplier_channel& c)
+    {
+        read_in_Lagrange_multipliers(c);
+        if(c.has_pending)
         {
-            //std::cout << "write Lagrange multipliers: ";
-            Lagrange_multiplier L;
-            L.first_node = node_nr;
-            queue.push(L);
-            //std::cout << node_nr << ", ";
-            L.nr_deltas = std::distance(begin, end);
-            queue.push(L);
-            //std::cout << L.nr_deltas << ", ";
-            for(auto it=begin; it!=end; ++it)
-            {
-                L.delta = *it;
-                queue.push(L);
-                //std::cout << *it << ", ";
-            }
-            //std::cout << "\n";
+            apply_Lagrange_multipliers(c, c.pending.data());
+            c.has_pending = false;
         }
+    }
 
-    // after forward pass, collect min marginals of all duplicated arcs are computed and sent
-    void decomposition_bdd_base::min_marginal_averaging_forward(const size_t interval_nr)
+    void decomposition_bdd_base::send_Lagrange_multipliers(Lagrange_multiplier_channel& c, const bool forward)
     {
-        assert(interval_nr < intervals.nr_intervals());
-        if(interval_nr == 0)
-            assert(bdd_bases[interval_nr].forward_queue.queue.empty());
-        bdd_bases[interval_nr].read_in_Lagrange_multipliers(bdd_bases[interval_nr].forward_queue);
-
-        bdd_bases[interval_nr].base.min_marginal_averaging_forward();
-
-        // TODO: use stack variables
+        auto& base = bdd_bases[c.from_interval].base;
         std::vector<double> arc_marginals;
-
-        size_t last_interval_nr = std::numeric_limits<size_t>::max();
-        for(const auto& e : bdd_bases[interval_nr].forward_endpoints)
+        size_t pos = 0;
+        for(const auto& e : c.endpoints)
         {
-            assert(e.opposite_interval_nr != interval_nr);
-            if(last_interval_nr != e.opposite_interval_nr)
-            {
-                if(last_interval_nr != std::numeric_limits<size_t>::max())
-                    bdd_bases[last_interval_nr].forward_queue.mutex.unlock();
-                bdd_bases[e.opposite_interval_nr].forward_queue.mutex.lock();
-                last_interval_nr = e.opposite_interval_nr;
-            }
-            bdd_bases[interval_nr].base.get_arc_marginals(e.first_node, e.last_node, arc_marginals);
-            for(const auto x : arc_marginals)
-                assert(std::isfinite(x) || x == std::numeric_limits<float>::infinity());
+            if(forward)
+                base.get_arc_marginals(e.first_node, e.last_node, arc_marginals);
+            else
+                base.get_root_arc_marginals(e.first_node, e.last_node, arc_marginals);
             const double min_arc_cost = *std::min_element(arc_marginals.begin(), arc_marginals.end());
+            if(!std::isfinite(min_arc_cost))
+                std::fill(arc_marginals.begin(), arc_marginals.end(), 0.0);
             for(auto& x : arc_marginals)
             {
                 if(x != std::numeric_limits<float>::infinity())
@@ -293,103 +288,83 @@ namespace LPMP {
                     x *= -intra_interval_message_passing_weight;
                 }
             }
-            bdd_bases[interval_nr].base.update_arc_costs(e.first_node, arc_marginals.begin(), arc_marginals.end());
+            base.update_arc_costs(e.first_node, arc_marginals.begin(), arc_marginals.end());
 
-            for(auto& x : arc_marginals)
+            for(size_t k=0; k<arc_marginals.size(); ++k)
             {
-                if(x != std::numeric_limits<float>::infinity())
-                    x *= -1.0;
-                assert(x >= 0.0);
+                const double delta = arc_marginals[k] == std::numeric_limits<float>::infinity() ? arc_marginals[k] : -arc_marginals[k];
+                assert(delta >= 0.0);
+                c.pending[pos+k] = c.has_pending ? c.pending[pos+k] + delta : delta;
             }
+            pos += arc_marginals.size();
+        }
+        assert(pos == c.pending.size());
+        c.has_pending = true;
 
-            bdd_bases[e.opposite_interval_nr].forward_queue.write_to_queue(e.first_node_opposite_interval, arc_marginals.begin(), arc_marginals.end());
+        if(double* frame = c.ring->front_write())
+        {
+            std::copy(c.pending.begin(), c.pending.end(), frame);
+            c.ring->push();
+            c.has_pending = false;
         }
-        if(last_interval_nr != std::numeric_limits<size_t>::max())
-            bdd_bases[last_interval_nr].forward_queue.mutex.unlock();
     }
 
-    void decomposition_bdd_base::min_marginal_averaging_backward(const size_t interval_nr)
+    // after forward pass, min marginals of all duplicated arcs are computed and sent
+    void decomposition_bdd_base::min_marginal_averaging_forward(const size_t interval_nr)
     {
-        assert(interval_nr < intervals.nr_intervals());
-        if(interval_nr == intervals.nr_intervals()-1)
-            assert(bdd_bases[interval_nr].backward_queue.queue.empty());
-        bdd_bases[interval_nr].read_in_Lagrange_multipliers(bdd_bases[interval_nr].backward_queue);
-
-        bdd_bases[interval_nr].base.min_marginal_averaging_backward();
+        assert(interval_nr < nr_intervals());
+        auto& sub_base = bdd_bases[interval_nr];
+        for(auto* c : sub_base.forward_in)
+            read_in_Lagrange_multipliers(*c);
 
-        std::vector<double> arc_marginals; // TODO: use stack variables
+        sub_base.base.min_marginal_averaging_forward();
 
-        size_t last_interval_nr = std::numeric_limits<size_t>::max();
-        for(const auto& e : bdd_bases[interval_nr].backward_endpoints)
-        {
-            assert(e.opposite_interval_nr != interval_nr);
-            if(last_interval_nr != e.opposite_interval_nr)
-            {
-                if(last_interval_nr != std::numeric_limits<size_t>::max())
-                    bdd_bases[last_interval_nr].backward_queue.mutex.unlock();
-                bdd_bases[e.opposite_interval_nr].backward_queue.mutex.lock();
-                last_interval_nr = e.opposite_interval_nr;
-            }
+        for(auto* c : sub_base.forward_out)
+            send_Lagrange_multipliers(*c, true);
+    }
 
-            bdd_bases[interval_nr].base.get_arc_marginals(e.first_node, e.last_node, arc_marginals);
-            const double min_arc_cost = *std::min_element(arc_marginals.begin(), arc_marginals.end());
-            for(auto& x : arc_marginals)
-            {
-                if(x != std::numeric_limits<float>::infinity())
-                {
-                    x -= min_arc_cost;
-                    x *= -intra_interval_message_passing_weight;
-                    assert(x <= 0.0);
-                }
-            }
-            bdd_bases[interval_nr].base.update_arc_costs(e.first_node, arc_marginals.begin(), arc_marginals.end());
+    void decomposition_bdd_base::min_marginal_averaging_backward(const size_t interval_nr)
+    {
+        assert(interval_nr < nr_intervals());
+        auto& sub_base = bdd_bases[interval_nr];
+        for(auto* c : sub_base.backward_in)
+            read_in_Lagrange_multipliers(*c);
 
-            for(auto& x : arc_marginals)
-            {
-                if(x != std::numeric_limits<float>::infinity())
-                    x *= -1.0;
-                assert(x >= 0.0);
-            }
+        sub_base.base.min_marginal_averaging_backward();
 
-            bdd_bases[e.opposite_interval_nr].backward_queue.write_to_queue(e.first_node_opposite_interval, arc_marginals.begin(), arc_marginals.end());
-        }
-        if(last_interval_nr != std::numeric_limits<size_t>::max())
-            bdd_bases[last_interval_nr].backward_queue.mutex.unlock();
+        for(auto* c : sub_base.backward_out)
+            send_Lagrange_multipliers(*c, false);
     }
 
     double decomposition_bdd_base::lower_bound()
     {
         double lb = 0.0;
-        for(size_t i=0; i<intervals.nr_intervals(); ++i)
+        for(size_t i=0; i<nr_intervals(); ++i)
             lb += bdd_bases[i].base.lower_bound();
         return lb;
     }
 
     two_dim_variable_array<std::array<double,2>> decomposition_bdd_base::min_marginals()
     {
-#pragma omp parallel for
-        for(size_t i=0; i<intervals.nr_intervals(); ++i)
-        {
-            bdd_bases[i].read_in_Lagrange_multipliers(bdd_bases[i].forward_queue);
-            bdd_bases[i].read_in_Lagrange_multipliers(bdd_bases[i].backward_queue);
-        }
-
-        std::vector<two_dim_variable_array<std::array<double,2>>> decomposition_mms(intervals.nr_intervals());
-#pragma omp parallel for
-        for(size_t i=0; i<intervals.nr_intervals(); ++i)
+        std::vector<two_dim_variable_array<std::array<double,2>>> decomposition_mms(nr_intervals());
+#pragma omp parallel for schedule(static,1) num_threads(nr_intervals())
+        for(size_t i=0; i<nr_intervals(); ++i)
         {
+            for(auto* c : bdd_bases[i].forward_in)
+                flush_Lagrange_multipliers(*c);
+            for(auto* c : bdd_bases[i].backward_in)
+                flush_Lagrange_multipliers(*c);
             decomposition_mms[i] = bdd_bases[i].base.min_marginals();
         }
 
         two_dim_variable_array<std::array<double,2>> mms;
         std::vector<std::array<double,2>> current_mms;
-        for(size_t i=0; i<nr_variables(); ++i)
+        for(size_t var=0; var<nr_variables(); ++var)
         {
             current_mms.clear();
-            for(size_t j=0; j<decomposition_mms.size(); ++j)
-            {
-                current_mms.insert(current_mms.end(), decomposition_mms[i][j].begin(), decomposition_mms[i][j].end());
-            }
+            for(size_t i=0; i<decomposition_mms.size(); ++i)
+                if(var < decomposition_mms[i].size())
+                    current_mms.insert(current_mms.end(), decomposition_mms[i][var].begin(), decomposition_mms[i][var].end());
             mms.push_back(current_mms.begin(), current_mms.end());
         }
 
@@ -1,10 +1,67 @@
 #include "lineq_bdd.h"
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
 
 namespace LPMP {
 
-    bool lineq_bdd::build_bdd_node(lineq_bdd_node * &node_ptr, const integer path_cost, const unsigned int level, const ILP_input::inequality_type ineq_type)
+    void lineq_bdd_interval_map::clear()
+    {
+        for (size_t b = 0; b < nr_blocks; ++b)
+            blocks[b].clear();
+        block_lb.clear();
+        nr_blocks = 0;
+    }
+
+    const lineq_bdd_interval* lineq_bdd_interval_map::find(const integer slack) const
+    {
+        auto lb_less = [](const integer x, const lineq_bdd_interval& i) { return x < i.lb; };
+        const auto block_it = std::upper_bound(block_lb.begin(), block_lb.end(), slack);
+        if (block_it == block_lb.begin())
+            return nullptr;
+        const auto& block = blocks[std::distance(block_lb.begin(), block_it) - 1];
+        const auto it = std::upper_bound(block.begin(), block.end(), slack, lb_less);
+        assert(it != block.begin());
+        if (std::prev(it)->ub < slack)
+            return nullptr;
+        return &*std::prev(it);
+    }
+
+    void lineq_bdd_interval_map::insert(const lineq_bdd_interval& interval)
+    {
+        assert(interval.lb <= interval.ub);
+        assert(find(interval.lb) == nullptr && find(interval.ub) == nullptr);
+        if (nr_blocks == 0)
+        {
+            if (blocks.empty())
+                blocks.emplace_back();
+            blocks[0].push_back(interval);
+            block_lb.push_back(interval.lb);
+            nr_blocks = 1;
+            return;
+        }
+
+        // block of last interval with smaller lower bound or first one
+        const size_t b = std::max(std::ptrdiff_t(0), std::distance(block_lb.begin(), std::upper_bound(block_lb.begin(), block_lb.end(), interval.lb)) - 1);
+        auto lb_less = [](const integer x, const lineq_bdd_interval& i) { return x < i.lb; };
+        blocks[b].insert(std::upper_bound(blocks[b].begin(), blocks[b].end(), interval.lb, lb_less), interval);
+        block_lb[b] = blocks[b].front().lb;
+
+        // split full block, reusing a spare one
+        if (blocks[b].size() > max_block_size)
+        {
+            if (blocks.size() == nr_blocks)
+                blocks.emplace_back();
+            std::rotate(blocks.begin()+b+1, blocks.begin()+nr_blocks, blocks.begin()+nr_blocks+1);
+            const size_t half = blocks[b].size()/2;
+            blocks[b+1].assign(blocks[b].begin()+half, blocks[b].end());
+            blocks[b].resize(half);
+            block_lb.insert(block_lb.begin()+b+1, blocks[b+1].front().lb);
+            nr_blocks++;
+        }
+    }
+
+    bool lineq_bdd::build_bdd_node(size_t& node, const integer path_cost, const size_t level, const ILP_input::inequality_type ineq_type)
     {
         assert(level < rests.size());
         const integer slack = rhs - path_cost;
@@ -16,24 +73,24 @@ namespace LPMP {
             case ILP_input::inequality_type::equal:
                 if (slack < 0 || slack > rest)
                 {
-                    node_ptr = &botsink;
+                    node = lineq_bdd_node::botsink;
                     return false;
                 }
                 if (slack == 0 && slack == rest)
                 {
-                    node_ptr = &topsink;
+                    node = lineq_bdd_node::topsink;
                     return false;
                 }
                 break;
             case ILP_input::inequality_type::smaller_equal:
                 if (slack < 0)
                 {
-                    node_ptr = &botsink;
+                    node = lineq_bdd_node::botsink;
                     return false;
                 }
                 if (slack >= rest)
                 {
-                    node_ptr = &topsink;
+                    node = lineq_bdd_node::topsink;
                     return false;
                 }
                 break;
@@ -45,36 +102,44 @@ namespace LPMP {
                 break;
         }
 
-        assert(level < levels.size());
+        assert(level < nr_levels);
 
         // check for equivalent nodes
-        avl_node<lineq_bdd_node> * ptr = levels[level].find(slack);
-        if (ptr != nullptr)
+        const lineq_bdd_interval* interval = intervals[level].find(slack);
+        if (interval != nullptr)
         {
-            if (ptr->wraps_botsink) // check if node is equivalent to botsink (only applicable for equations)
-                node_ptr = &botsink;
-            else
-                node_ptr = &(ptr->data);
+            node = interval->node;
             return false;
         }
 
         // otherwise create new node
-        lineq_bdd_node node;
-        node.ub_ = path_cost;
-        node_ptr = levels[level].create_node(node);
-        assert(node_ptr != nullptr);
+        lineq_bdd_node n;
+        n.ub_ = path_cost;
+        node = levels[level].size();
+        levels[level].push_back(n);
         return true;
     }
 
-
     void lineq_bdd::build_from_inequality(const std::vector<int>& nf, const ILP_input::inequality_type ineq_type)
     {
         const size_t dim = nf.size() - 1;
-        inverted = std::vector<char>(dim);
-        levels = std::vector<avl_tree<lineq_bdd_node>>(dim);
+        inverted.clear();
+        inverted.resize(dim, 0);
+        // reuse memory of previous constructions
+        nr_levels = dim;
+        if (levels.size() < dim)
+        {
+            levels.resize(dim);
+            intervals.resize(dim);
+        }
+        for (size_t l = 0; l < dim; ++l)
+        {
+            levels[l].clear();
+            intervals[l].clear();
+        }
 
         rhs = nf[0];
-        coefficients = std::vector<int>(nf.begin()+1, nf.end());
+        coefficients.assign(nf.begin()+1, nf.end());
 
         // transform to nonnegative coefficients
         for (size_t i = 0; i < dim; i++)
@@ -87,73 +152,94 @@ namespace LPMP {
             }
         }
 
-        rests = std::vector<integer>(dim+1);
-        rests[0] = std::accumulate(coefficients.begin(), coefficients.end(), 0);
+        rests.resize(dim+1);
+        rests[0] = std::accumulate(coefficients.begin(), coefficients.end(), integer(0));
         for (size_t i = 0; i < coefficients.size(); i++)
             rests[i+1] = rests[i] - coefficients[i];
 
-        unsigned int level = 0;
+        size_t level = 0;
         build_bdd_node(root_node, 0, level, ineq_type);
-        if (root_node == &topsink || root_node == &botsink)
+        if (is_topsink() || is_botsink())
             return;
-        
-        std::stack<lineq_bdd_node*> node_stack;
-        node_stack.push(root_node);
+        assert(root_node == 0);
+
+        // nodes on the current path, one per level
+        std::vector<size_t> node_stack;
+        node_stack.push_back(root_node);
 
         while (!node_stack.empty())
         {
-            lineq_bdd_node* current_node = node_stack.top();
-            assert(level < dim);
+            const size_t current = node_stack.back();
+            assert(level < dim && node_stack.size() == level+1);
             const int coeff = coefficients[level];
+            // kids are appended to the next level, hence references to current level stay valid
+            lineq_bdd_node& current_node = levels[level][current];
 
-            if (current_node->zero_kid_ == nullptr) // build zero child
+            if (current_node.zero_kid_ == lineq_bdd_node::undefined) // build zero child
             {
-                bool is_new = build_bdd_node(current_node->zero_kid_, current_node->ub_ + 0, level+1, ineq_type);
+                const bool is_new = build_bdd_node(current_node.zero_kid_, current_node.ub_ + 0, level+1, ineq_type);
                 if (!is_new)
                     continue;
-                node_stack.push(current_node->zero_kid_);
+                node_stack.push_back(current_node.zero_kid_);
                 level++;
             }
-            else if (current_node->one_kid_ == nullptr) // build one child
+            else if (current_node.one_kid_ == lineq_bdd_node::undefined) // build one child
             {
-                bool is_new = build_bdd_node(current_node->one_kid_, current_node->ub_ + coeff, level+1, ineq_type);
+                const bool is_new = build_bdd_node(current_node.one_kid_, current_node.ub_ + coeff, level+1, ineq_type);
                 if (!is_new)
                     continue;
-                node_stack.push(current_node->one_kid_);
+                node_stack.push_back(current_node.one_kid_);
                 level++;
             }
             else // set bounds and go to parent
             {
-                auto* bdd_0 = current_node->zero_kid_;
-                auto* bdd_1 = current_node->one_kid_;
+                auto kid = [&](const size_t k) -> const lineq_bdd_node& { assert(level+1 < dim); return levels[level+1][k]; };
+                const size_t bdd_0 = current_node.zero_kid_;
+                const size_t bdd_1 = current_node.one_kid_;
+                lineq_bdd_interval interval;
+                interval.node = current;
                 switch (ineq_type)
                 {
                     case ILP_input::inequality_type::equal:
                     {
                         // replace children by botsink if they are equivalent
-                        if ((bdd_0->wrapper_ != nullptr) && bdd_0->wrapper_->wraps_botsink)
-                            bdd_0 = &botsink;
-                        if ((bdd_1->wrapper_ != nullptr) && bdd_1->wrapper_->wraps_botsink)
-                            bdd_1 = &botsink;
-                        if (bdd_0 == &botsink && bdd_1 == &botsink) // label node equivalent to botsink
-                        {
-                            assert(current_node->wrapper_ != nullptr);
-                            current_node->wrapper_->wraps_botsink = true;
-                        }
+                        auto equivalent_to_botsink = [&](const size_t k) {
+                            if (k == lineq_bdd_node::botsink || k == lineq_bdd_node::topsink)
+                                return k == lineq_bdd_node::botsink;
+                            return kid(k).zero_kid_ == lineq_bdd_node::botsink && kid(k).one_kid_ == lineq_bdd_node::botsink;
+                        };
+                        if (equivalent_to_botsink(bdd_0))
+                            current_node.zero_kid_ = lineq_bdd_node::botsink;
+                        if (equivalent_to_botsink(bdd_1))
+                            current_node.one_kid_ = lineq_bdd_node::botsink;
+                        if (current_node.zero_kid_ == lineq_bdd_node::botsink && current_node.one_kid_ == lineq_bdd_node::botsink) // label node equivalent to botsink
+                            interval.node = lineq_bdd_node::botsink;
                         // set lower bound and upper bound to match slack
-                        current_node->lb_ = rhs - current_node->ub_;
-                        current_node->ub_ = rhs - current_node->ub_;
+                        current_node.lb_ = rhs - current_node.ub_;
+                        current_node.ub_ = rhs - current_node.ub_;
                         break;
                     }
                     case ILP_input::inequality_type::smaller_equal:
                     {
                         // lower bound of topsink needs to be adjusted if it is a shortcut
-                        const integer lb_0 = (bdd_0 == &topsink) ? rests[level+1] : bdd_0->lb_;
-                        const integer lb_1 = (bdd_1 == &topsink) ? rests[level+1] + coeff : bdd_1->lb_ + coeff;
-                        const integer lb = std::max(lb_0, lb_1);
-                        const integer ub = std::max(std::min(bdd_0->ub_, bdd_1->ub_ + coeff), lb); // ensure that bound-interval is non-empty
-                        current_node->lb_ = lb;
-                        current_node->ub_ = ub;
+                        auto lb = [&](const size_t k) -> integer {
+                            if (k == lineq_bdd_node::topsink)
+                                return rests[level+1];
+                            if (k == lineq_bdd_node::botsink)
+                                return std::numeric_limits<integer>::min() + coeff;
+                            return kid(k).lb_;
+                        };
+                        auto ub = [&](const size_t k) -> integer {
+                            if (k == lineq_bdd_node::topsink)
+                                return std::numeric_limits<integer>::max() - coeff;
+                            if (k == lineq_bdd_node::botsink)
+                                return -1;
+                            return kid(k).ub_;
+                        };
+                        const integer lb_ = std::max(lb(bdd_0), lb(bdd_1) + coeff);
+                        const integer ub_ = std::max(std::min(ub(bdd_0), ub(bdd_1) + coeff), lb_); // ensure that bound-interval is non-empty
+                        current_node.lb_ = lb_;
+                        current_node.ub_ = ub_;
                         break;
                     }
                     case ILP_input::inequality_type::greater_equal:
@@ -163,59 +249,180 @@ namespace LPMP {
                         throw std::runtime_error("inequality type not supported");
                         break;
                 }
-                levels[level].insert(current_node->wrapper_); // when bounds are determined, insert into AVL tree
-                node_stack.pop();
+                // when bounds are determined, make node findable
+                interval.lb = current_node.lb_;
+                interval.ub = current_node.ub_;
+                intervals[level].insert(interval);
+                node_stack.pop_back();
                 level--;
             }
         }
+
+        if (levels[0][root_node].zero_kid_ == lineq_bdd_node::botsink && levels[0][root_node].one_kid_ == lineq_bdd_node::botsink)
+            root_node = lineq_bdd_node::botsink;
     }
 
 
     BDD::node_ref lineq_bdd::convert_to_lbdd(BDD::bdd_mgr& bdd_mgr_) const
     {
-        if (root_node == &topsink)
+        if (is_topsink())
             return bdd_mgr_.topsink();
-        if (root_node == &botsink)
+        if (is_botsink())
             return bdd_mgr_.botsink();
 
-        std::vector<std::vector<BDD::node_ref>> bdd_nodes(levels.size());
-        tsl::robin_map<lineq_bdd_node const*,size_t> node_refs;
-        for(std::ptrdiff_t l=levels.size()-1; l>=0; --l)
+        std::vector<std::vector<BDD::node_ref>> bdd_nodes(nr_levels);
+        for(std::ptrdiff_t l=nr_levels-1; l>=0; --l)
         {
-            auto& nodes = levels[l].get_avl_nodes();
-            for(auto it = nodes.begin(); it != nodes.end(); it++)
+            auto get_node = [&](const size_t kid) {
+                if(kid == lineq_bdd_node::botsink)
+                    return bdd_mgr_.botsink();
+                else if(kid == lineq_bdd_node::topsink)
+                    return bdd_mgr_.topsink();
+                assert(l+1 < nr_levels && kid < bdd_nodes[l+1].size());
+                return bdd_nodes[l+1][kid];
+            };
+            bdd_nodes[l].reserve(levels[l].size());
+            for(const lineq_bdd_node& lbdd : levels[l])
             {
-                auto& lbdd = it->data;
-                auto get_node = [&](lineq_bdd_node const* ptr) {
-                    if(ptr == &botsink)
-                        return bdd_mgr_.botsink();
-                    else if(ptr == &topsink)
-                        return bdd_mgr_.topsink();
-                    else
-                    {
-                        auto ref = node_refs.find(ptr);
-                        if (ref != node_refs.end())
-                        {
-                            assert(ref->second < bdd_nodes[l+1].size());
-                            return bdd_nodes[l+1][ref->second];
-                        }
-                        else
-                            throw std::runtime_error("node reference not found");
-                    }
-                };
                 BDD::node_ref zero_bdd_node = get_node(lbdd.zero_kid_);
                 BDD::node_ref one_bdd_node = get_node(lbdd.one_kid_);
                 if(inverted[l])
                     bdd_nodes[l].push_back(bdd_mgr_.ite_rec(bdd_mgr_.projection(l), zero_bdd_node, one_bdd_node));
                 else
                     bdd_nodes[l].push_back(bdd_mgr_.ite_rec(bdd_mgr_.projection(l), one_bdd_node, zero_bdd_node));
-                node_refs.insert(std::make_pair(&lbdd, bdd_nodes[l].size()-1));
             }
         }
         assert(bdd_nodes[0].size() == 1);
         return bdd_nodes[0][0];
     }
 
+    size_t lineq_bdd::convert_to_qbdd(BDD::bdd_collection& bdd_col) const
+    {
+        if (is_topsink() || is_botsink())
+            throw std::runtime_error("constant bdd cannot be added to bdd collection");
+
+        constexpr static size_t unreachable = std::numeric_limits<size_t>::max();
+        constexpr static size_t topsink = lineq_bdd_node::topsink;
+        constexpr static size_t botsink = lineq_bdd_node::botsink;
+
+        // nodes equivalent to botsink on equations are not referenced anymore, hence only reachable nodes are emitted
+        std::vector<std::vector<size_t>> new_index(nr_levels);
+        new_index[0].assign(levels[0].size(), unreachable);
+        new_index[0][root_node] = 0;
+        size_t nr_reachable_levels = 0;
+        for (size_t l = 0; l < nr_levels; ++l)
+        {
+            if (l+1 < nr_levels)
+                new_index[l+1].assign(levels[l+1].size(), unreachable);
+            bool has_nodes = false;
+            for (size_t i = 0; i < levels[l].size(); ++i)
+            {
+                if (new_index[l][i] == unreachable)
+                    continue;
+                has_nodes = true;
+                for (const size_t kid : {levels[l][i].zero_kid_, levels[l][i].one_kid_})
+                {
+                    assert(kid != lineq_bdd_node::undefined);
+                    if (kid != topsink && kid != botsink)
+                        new_index[l+1][kid] = 0;
+                }
+            }
+            if (!has_nodes)
+                break;
+            nr_reachable_levels = l+1;
+        }
+
+        // Levels on which all nodes have equal children do not depend on their variable and are skipped, as in reduced bdds.
+        // Nodes on such levels are forwarded to their child, given as (level, node). The level of sinks is irrelevant.
+        std::vector<std::vector<std::array<size_t,2>>> forward(nr_reachable_levels);
+        std::vector<char> redundant_level(nr_reachable_levels);
+        auto kid_ref = [&](const size_t l, const size_t kid) -> std::array<size_t,2> {
+            if (kid == topsink || kid == botsink)
+                return {nr_reachable_levels, kid};
+            assert(l+1 < nr_reachable_levels);
+            return forward[l+1][kid];
+        };
+        for (std::ptrdiff_t l = nr_reachable_levels-1; l >= 0; --l)
+        {
+            forward[l].resize(levels[l].size());
+            bool redundant = true;
+            for (size_t i = 0; i < levels[l].size() && redundant; ++i)
+                if (new_index[l][i] != unreachable)
+                    redundant = kid_ref(l, levels[l][i].zero_kid_) == kid_ref(l, levels[l][i].one_kid_);
+            for (size_t i = 0; i < levels[l].size(); ++i)
+                if (new_index[l][i] != unreachable)
+                    forward[l][i] = redundant ? kid_ref(l, levels[l][i].zero_kid_) : std::array<size_t,2>{size_t(l), i};
+            redundant_level[l] = redundant;
+        }
+
+        // Number nodes level by level. Arcs to topsink skipping levels are routed through a chain of nodes equivalent to topsink, one per level.
+        // All other arcs go to the next remaining level.
+        std::vector<size_t> kept_levels;
+        std::vector<size_t> rank(nr_reachable_levels, unreachable);
+        std::vector<size_t> level_offset = {0};
+        size_t topsink_chain_begin = unreachable;
+        for (size_t l = 0; l < nr_reachable_levels; ++l)
+        {
+            if (redundant_level[l])
+                continue;
+            rank[l] = kept_levels.size();
+            kept_levels.push_back(l);
+            size_t nr_nodes = 0;
+            for (size_t i = 0; i < levels[l].size(); ++i)
+            {
+                if (new_index[l][i] == unreachable)
+                    continue;
+                new_index[l][i] = nr_nodes++;
+                if (kid_ref(l, levels[l][i].zero_kid_)[1] == topsink || kid_ref(l, levels[l][i].one_kid_)[1] == topsink)
+                    topsink_chain_begin = std::min(topsink_chain_begin, rank[l]+1);
+            }
+            level_offset.push_back(level_offset.back() + nr_nodes + (topsink_chain_begin <= rank[l]));
+        }
+        assert(kept_levels.size() > 0 && level_offset[1] - level_offset[0] == 1);
+
+        const size_t nr_ranks = kept_levels.size();
+        const size_t topsink_pos = level_offset[nr_ranks];
+        const size_t botsink_pos = topsink_pos+1;
+        // chain node is the last one of its level
+        auto topsink_chain = [&](const size_t r) -> size_t {
+            if (r == nr_ranks)
+                return topsink_pos;
+            assert(r >= topsink_chain_begin);
+            return level_offset[r+1]-1;
+        };
+
+        std::vector<BDD::bdd_instruction> instructions(topsink_pos + 2);
+        for (size_t r = 0; r < nr_ranks; ++r)
+        {
+            const size_t l = kept_levels[r];
+            auto pos = [&](const size_t kid) -> size_t {
+                const auto [kid_level, kid_node] = kid_ref(l, kid);
+                if (kid_node == topsink)
+                    return topsink_chain(r+1);
+                if (kid_node == botsink)
+                    return botsink_pos;
+                assert(rank[kid_level] == r+1 && new_index[kid_level][kid_node] != unreachable);
+                return level_offset[r+1] + new_index[kid_level][kid_node];
+            };
+            for (size_t i = 0; i < levels[l].size(); ++i)
+            {
+                if (new_index[l][i] == unreachable)
+                    continue;
+                const lineq_bdd_node& node = levels[l][i];
+                BDD::bdd_instruction& instr = instructions[level_offset[r] + new_index[l][i]];
+                instr.index = l;
+                instr.lo = inverted[l] ? pos(node.one_kid_) : pos(node.zero_kid_);
+                instr.hi = inverted[l] ? pos(node.zero_kid_) : pos(node.one_kid_);
+            }
+            if (topsink_chain_begin <= r)
+                instructions[topsink_chain(r)] = {topsink_chain(r+1), topsink_chain(r+1), l};
+        }
+        instructions[topsink_pos] = BDD::bdd_instruction::topsink();
+        instructions[botsink_pos] = BDD::bdd_instruction::botsink();
+
+        return bdd_col.add_bdd_instructions(instructions.begin(), instructions.end());
+    }
+
     void lineq_bdd::export_graphviz(const std::string& filename)
     {
         const std::string dot_file = std::filesystem::path(filename).replace_extension("dot");
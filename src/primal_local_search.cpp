@@ -0,0 +1,372 @@
+#include "primal_local_search.h"
+#include "time_measure_util.h"
+#include <limits>
+#include <algorithm>
+#include <numeric>
+#include <cassert>
+#include <iostream>
+
+namespace LPMP {
+
+    primal_local_search::primal_local_search(const ILP_input& ilp, const BDD::bdd_collection& bdd_col, const primal_local_search_options opts)
+        : options_(opts)
+    {
+        costs_.reserve(ilp.nr_variables());
+        for(size_t i=0; i<ilp.nr_variables(); ++i)
+            costs_.push_back(ilp.objective(i));
+
+        std::vector<size_t> nr_rows_per_var(ilp.nr_variables(), 0);
+        for(const auto& constr : ilp.constraints())
+        {
+            rows_.push_back(constr.variables.begin(), constr.variables.end());
+            for(const auto& v : constr.variables)
+                nr_rows_per_var[v.var]++;
+            switch(constr.ineq) {
+                case ILP_input::inequality_type::smaller_equal:
+                    row_bounds_.push_back({std::numeric_limits<int>::min(), constr.right_hand_side});
+                    break;
+                case ILP_input::inequality_type::greater_equal:
+                    row_bounds_.push_back({constr.right_hand_side, std::numeric_limits<int>::max()});
+                    break;
+                case ILP_input::inequality_type::equal:
+                    row_bounds_.push_back({constr.right_hand_side, constr.right_hand_side});
+                    break;
+                default:
+                    throw std::runtime_error("inequality type not supported");
+            }
+        }
+
+        var_rows_ = two_dim_variable_array<std::array<size_t,2>>(nr_rows_per_var.begin(), nr_rows_per_var.end());
+        std::fill(nr_rows_per_var.begin(), nr_rows_per_var.end(), 0);
+        for(size_t r=0; r<rows_.size(); ++r)
+            for(size_t j=0; j<rows_.size(r); ++j)
+            {
+                const size_t var = rows_(r,j).var;
+                var_rows_(var, nr_rows_per_var[var]++) = {r, j};
+            }
+
+        // only the branch structure of the bdds is needed for shortest paths
+        assert(ilp.nr_variables() < bdd_node::topsink_var);
+        std::vector<size_t> nr_bdd_nodes;
+        nr_bdd_nodes.reserve(bdd_col.nr_bdds());
+        for(size_t bdd_nr=0; bdd_nr<bdd_col.nr_bdds(); ++bdd_nr)
+        {
+            assert(bdd_col.nr_bdd_nodes(bdd_nr) < std::numeric_limits<uint32_t>::max());
+            nr_bdd_nodes.push_back(bdd_col.nr_bdd_nodes(bdd_nr));
+        }
+        bdd_nodes_ = two_dim_variable_array<bdd_node>(nr_bdd_nodes.begin(), nr_bdd_nodes.end());
+        for(size_t bdd_nr=0; bdd_nr<bdd_col.nr_bdds(); ++bdd_nr)
+        {
+            const size_t offset = bdd_col.offset(bdd_nr);
+            for(size_t i=0; i<nr_bdd_nodes[bdd_nr]; ++i)
+            {
+                const BDD::bdd_instruction& instr = bdd_col.get_bdd_instruction(offset + i);
+                if(instr.is_botsink())
+                    bdd_nodes_(bdd_nr, i) = {0, 0, bdd_node::botsink_var};
+                else if(instr.is_topsink())
+                    bdd_nodes_(bdd_nr, i) = {0, 0, bdd_node::topsink_var};
+                else
+                    bdd_nodes_(bdd_nr, i) = {uint32_t(instr.lo - offset), uint32_t(instr.hi - offset), uint32_t(instr.index)};
+            }
+        }
+
+        activity_.resize(rows_.size(), 0);
+        commit_buffer_.delta.resize(rows_.size(), 0);
+        commit_buffer_.touched.resize(rows_.size(), 0);
+    }
+
+    void primal_local_search::row_delta_buffer::clear()
+    {
+        for(const size_t r : touched_rows)
+        {
+            delta[r] = 0;
+            touched[r] = 0;
+        }
+        touched_rows.clear();
+    }
+
+    std::pair<double,bool> primal_local_search::evaluate(const std::vector<change>& changes, const std::vector<char>& sol, row_delta_buffer& buf, std::vector<size_t>* violated_rows) const
+    {
+        assert(buf.touched_rows.empty());
+        double cost_delta = 0.0;
+        for(const auto [var, value] : changes)
+        {
+            if(sol[var] == value)
+                continue;
+            const int d = value == 1 ? 1 : -1;
+            cost_delta += d * costs_[var];
+            for(size_t j=0; j<var_rows_.size(var); ++j)
+            {
+                const auto [r, idx] = var_rows_(var,j);
+                if(!buf.touched[r])
+                {
+                    buf.touched[r] = 1;
+                    buf.touched_rows.push_back(r);
+                }
+                buf.delta[r] += d * rows_(r,idx).coefficient;
+            }
+        }
+
+        bool feasible = true;
+        for(const size_t r : buf.touched_rows)
+            if(!row_feasible(r, activity_[r] + buf.delta[r]))
+            {
+                feasible = false;
+                if(violated_rows == nullptr)
+                    break;
+                violated_rows->push_back(r);
+            }
+        buf.clear();
+
+        return {cost_delta, feasible};
+    }
+
+    void primal_local_search::apply(const std::vector<change>& changes, std::vector<char>& sol)
+    {
+        for(const auto [var, value] : changes)
+        {
+            if(sol[var] == value)
+                continue;
+            const int d = value == 1 ? 1 : -1;
+            objective_ += d * costs_[var];
+            for(size_t j=0; j<var_rows_.size(var); ++j)
+            {
+                const auto [r, idx] = var_rows_(var,j);
+                activity_[r] += d * rows_(r,idx).coefficient;
+            }
+            sol[var] = value;
+        }
+    }
+
+    size_t primal_local_search::commit(std::vector<move>& moves, std::vector<char>& sol)
+    {
+        std::sort(moves.begin(), moves.end(), [](const move& a, const move& b) { return a.delta < b.delta; });
+        size_t nr_applied = 0;
+        for(const move& m : moves)
+        {
+            // earlier moves may have changed variables or activities of this move
+            const auto [delta, feasible] = evaluate(m.changes, sol, commit_buffer_);
+            if(feasible && delta < -1e-9)
+            {
+                apply(m.changes, sol);
+                ++nr_applied;
+            }
+        }
+        return nr_applied;
+    }
+
+    std::vector<primal_local_search::move> primal_local_search::one_flip_moves(const std::vector<char>& sol) const
+    {
+        std::vector<move> moves;
+#pragma omp parallel
+        {
+            row_delta_buffer buf;
+            buf.delta.resize(rows_.size(), 0);
+            buf.touched.resize(rows_.size(), 0);
+            std::vector<move> local_moves;
+            std::vector<change> changes(1);
+#pragma omp for schedule(static,512) nowait
+            for(size_t var=0; var<sol.size(); ++var)
+            {
+                // only flips decreasing cost can improve
+                if((sol[var] == 1 && costs_[var] <= 0.0) || (sol[var] == 0 && costs_[var] >= 0.0))
+                    continue;
+                changes[0] = {var, 1-sol[var]};
+                const auto [delta, feasible] = evaluate(changes, sol, buf);
+                if(feasible && delta < 0.0)
+                    local_moves.push_back({delta, changes});
+            }
+#pragma omp critical
+            moves.insert(moves.end(), local_moves.begin(), local_moves.end());
+        }
+        return moves;
+    }
+
+    std::vector<primal_local_search::move> primal_local_search::two_flip_moves(const std::vector<char>& sol) const
+    {
+        std::vector<move> moves;
+#pragma omp parallel
+        {
+            row_delta_buffer buf;
+            buf.delta.resize(rows_.size(), 0);
+            buf.touched.resize(rows_.size(), 0);
+            std::vector<move> local_moves;
+            std::vector<change> changes(2);
+#pragma omp for schedule(dynamic,64) nowait
+            for(size_t r=0; r<rows_.size(); ++r)
+            {
+                if(rows_.size(r) > options_.max_two_flip_row_length)
+                    continue;
+                // swap values of two variables in the same row, e.g. move the one in a simplex constraint
+                for(size_t j1=0; j1<rows_.size(r); ++j1)
+                {
+                    const size_t var1 = rows_(r,j1).var;
+                    for(size_t j2=j1+1; j2<rows_.size(r); ++j2)
+                    {
+                        const size_t var2 = rows_(r,j2).var;
+                        if(sol[var1] == sol[var2])
+                            continue;
+                        const double cost_delta = (sol[var1] == 1 ? -costs_[var1] : costs_[var1]) + (sol[var2] == 1 ? -costs_[var2] : costs_[var2]);
+                        if(cost_delta >= 0.0)
+                            continue;
+                        changes[0] = {var1, 1-sol[var1]};
+                        changes[1] = {var2, 1-sol[var2]};
+                        const auto [delta, feasible] = evaluate(changes, sol, buf);
+                        if(feasible)
+                            local_moves.push_back({delta, changes});
+                    }
+                }
+            }
+#pragma omp critical
+            moves.insert(moves.end(), local_moves.begin(), local_moves.end());
+        }
+        return moves;
+    }
+
+    void primal_local_search::shortest_path(const size_t bdd_nr, const std::vector<char>& sol, const std::vector<char>& fixed, std::vector<double>& dist, std::vector<change>& changes) const
+    {
+        constexpr static double inf = std::numeric_limits<double>::infinity();
+        const size_t nr_nodes = bdd_nodes_.size(bdd_nr);
+        dist.resize(nr_nodes);
+
+        // arc costs are changes of objective w.r.t. current solution. Variables skipped by arcs to the top sink keep their value.
+        const auto arc_cost = [&](const size_t var, const char value) -> double {
+            if(sol[var] == value)
+                return 0.0;
+            if(fixed[var])
+                return inf;
+            return value == 1 ? costs_[var] : -costs_[var];
+        };
+
+        for(std::ptrdiff_t i=nr_nodes-1; i>=0; --i)
+        {
+            const bdd_node& node = bdd_nodes_(bdd_nr, i);
+            if(node.is_botsink())
+                dist[i] = inf;
+            else if(node.is_topsink())
+                dist[i] = 0.0;
+            else
+                dist[i] = std::min(arc_cost(node.var, 0) + dist[node.lo], arc_cost(node.var, 1) + dist[node.hi]);
+        }
+
+        changes.clear();
+        if(dist[0] == inf)
+            return;
+        for(size_t i=0;;)
+        {
+            const bdd_node& node = bdd_nodes_(bdd_nr, i);
+            if(node.is_terminal())
+            {
+                assert(node.is_topsink());
+                break;
+            }
+            const double lo_dist = arc_cost(node.var, 0) + dist[node.lo];
+            const double hi_dist = arc_cost(node.var, 1) + dist[node.hi];
+            // on ties keep current value
+            const char value = lo_dist < hi_dist || (lo_dist == hi_dist && sol[node.var] == 0) ? 0 : 1;
+            if(value != sol[node.var])
+                changes.push_back({node.var, value});
+            i = value == 0 ? node.lo : node.hi;
+        }
+    }
+
+    std::vector<primal_local_search::move> primal_local_search::bdd_moves(const std::vector<char>& sol) const
+    {
+        std::vector<move> moves;
+#pragma omp parallel
+        {
+            row_delta_buffer buf;
+            buf.delta.resize(rows_.size(), 0);
+            buf.touched.resize(rows_.size(), 0);
+            std::vector<move> local_moves;
+            std::vector<char> fixed(sol.size(), 0);
+            std::vector<size_t> fixed_vars;
+            std::vector<double> dist;
+            std::vector<change> changes;
+            std::vector<size_t> violated_rows;
+#pragma omp for schedule(dynamic) nowait
+            for(size_t bdd_nr=0; bdd_nr<bdd_nodes_.size(); ++bdd_nr)
+            {
+                // the bdd only covers some constraints. If the optimal path violates others, keep variables of violated rows and resolve.
+                for(size_t iter=0; iter<=options_.max_repair_iterations; ++iter)
+                {
+                    shortest_path(bdd_nr, sol, fixed, dist, changes);
+                    if(changes.empty())
+                        break;
+                    violated_rows.clear();
+                    const auto [delta, feasible] = evaluate(changes, sol, buf, &violated_rows);
+                    if(delta >= 0.0)
+                        break;
+                    if(feasible)
+                    {
+                        local_moves.push_back({delta, changes});
+                        break;
+                    }
+                    for(const size_t r : violated_rows)
+                        for(size_t j=0; j<rows_.size(r); ++j)
+                        {
+                            const size_t var = rows_(r,j).var;
+                            if(!fixed[var])
+                            {
+                                fixed[var] = 1;
+                                fixed_vars.push_back(var);
+                            }
+                        }
+                }
+                for(const size_t var : fixed_vars)
+                    fixed[var] = 0;
+                fixed_vars.clear();
+            }
+#pragma omp critical
+            moves.insert(moves.end(), local_moves.begin(), local_moves.end());
+        }
+        return moves;
+    }
+
+    double primal_local_search::improve(std::vector<char>& sol)
+    {
+        MEASURE_FUNCTION_EXECUTION_TIME;
+        if(sol.size() != costs_.size())
+            throw std::runtime_error("primal solution size does not match number of variables");
+
+        std::fill(activity_.begin(), activity_.end(), 0);
+        for(size_t r=0; r<rows_.size(); ++r)
+        {
+            for(size_t j=0; j<rows_.size(r); ++j)
+                activity_[r] += rows_(r,j).coefficient * sol[rows_(r,j).var];
+            if(!row_feasible(r, activity_[r]))
+                throw std::runtime_error("local search needs feasible primal solution");
+        }
+        objective_ = 0.0;
+        for(size_t i=0; i<sol.size(); ++i)
+            objective_ += costs_[i] * sol[i];
+
+        std::cout << "[primal local search] initial objective = " << objective_ << "\n";
+        for(size_t round=0; round<options_.max_rounds; ++round)
+        {
+            std::vector<move> moves = one_flip_moves(sol);
+            const size_t nr_one_flips = commit(moves, sol);
+
+            size_t nr_two_flips = 0;
+            if(options_.two_flip)
+            {
+                moves = two_flip_moves(sol);
+                nr_two_flips = commit(moves, sol);
+            }
+
+            size_t nr_bdd_moves = 0;
+            if(options_.bdd_neighbourhood)
+            {
+                moves = bdd_moves(sol);
+                nr_bdd_moves = commit(moves, sol);
+            }
+
+            std::cout << "[primal local search] round " << round << ": #1-flips = " << nr_one_flips << ", #2-flips = " << nr_two_flips << ", #bdd moves = " << nr_bdd_moves << ", objective = " << objective_ << "\n";
+            if(nr_one_flips + nr_two_flips + nr_bdd_moves == 0)
+                break;
+        }
+
+        return objective_;
+    }
+
+}
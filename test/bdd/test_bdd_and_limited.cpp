@@ -20,14 +20,29 @@ int main(int argc, char** argv)
     node_ref simplex_2 = mgr.simplex(vars.begin()+5, vars.end());
     test(simplex_2.nr_nodes() == 9, "simplex has wrong nr of nodes");
 
+    // simplices are on disjoint variables, hence their conjunction has 9 + 9 nodes
     {
-    auto [simplex_and, nr_simplex_and_nodes] = mgr.and_rec_limited(simplex_1, simplex_2, 9 + 9);
+    auto [simplex_and, nr_simplex_and_nodes] = mgr.and_rec_limited(simplex_1, simplex_2, 9 + 9 - 1);
     test(simplex_and.address() == nullptr, "simplex intersection too big");
+    test(nr_simplex_and_nodes == 9 + 9, "partial node count must exceed node limit by one");
     }
 
     {
-        auto [simplex_and, nr_simplex_and_nodes] = mgr.and_rec_limited(simplex_1, simplex_2, 100);
+        auto [simplex_and, nr_simplex_and_nodes] = mgr.and_rec_limited(simplex_1, simplex_2, 9 + 9);
         test(simplex_and.address() != nullptr, "simplex intersection not constructed big");
+        test(nr_simplex_and_nodes == 9 + 9, "simplex intersection node count incorrect");
         test(simplex_and == mgr.and_rec(simplex_1, simplex_2), "limited simplex intersection computation incorrect");
     } 
+
+    // overlapping cardinality constraints share much substructure, node counts must not count it twice
+    {
+        node_ref at_most_1 = mgr.at_most(vars.begin(), vars.begin()+7, 2);
+        node_ref at_most_2 = mgr.at_most(vars.begin()+3, vars.end(), 2);
+        node_ref at_most_and = mgr.and_rec(at_most_1, at_most_2);
+        const size_t nr_nodes = at_most_and.nr_nodes();
+        auto [limited_and, nr_limited_and_nodes] = mgr.and_rec_limited(at_most_1, at_most_2, nr_nodes);
+        test(limited_and == at_most_and);
+        test(nr_limited_and_nodes == nr_nodes);
+        test(std::get<0>(mgr.and_rec_limited(at_most_1, at_most_2, nr_nodes-1)).address() == nullptr);
+    }
 }
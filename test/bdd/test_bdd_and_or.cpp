@@ -90,9 +90,8 @@ int main(int argc, char** argv)
 
     nr_nodes_max = mgr.nr_nodes();
     }
-    // TODO: enable garbage collection again
-    //mgr.collect_garbage();
-    //test(nr_nodes_max > mgr.nr_nodes(), "garbage collection did not remove unused nodes.");
+    mgr.collect_garbage();
+    test(nr_nodes_max > mgr.nr_nodes(), "garbage collection did not remove unused nodes.");
 }
 
 
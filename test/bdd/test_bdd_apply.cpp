@@ -0,0 +1,84 @@
+#include "bdd_manager/bdd_mgr.h"
+#include "../test.h"
+#include <random>
+
+using namespace BDD;
+using namespace LPMP;
+
+int main(int argc, char** argv)
+{
+    // breadth-first apply and recursive reference implementation must give identical nodes
+    {
+        bdd_mgr mgr;
+        constexpr size_t nr_vars = 12;
+        std::vector<node_ref> bdds;
+        for(size_t i=0; i<nr_vars; ++i)
+        {
+            bdds.push_back(mgr.projection(i));
+            bdds.push_back(mgr.neg_projection(i));
+        }
+        bdds.push_back(mgr.topsink());
+        bdds.push_back(mgr.botsink());
+
+        std::mt19937 gen(42);
+        for(size_t iter=0; iter<2000; ++iter)
+        {
+            std::uniform_int_distribution<size_t> bdd_dist(0, bdds.size()-1);
+            node_ref f = bdds[bdd_dist(gen)];
+            node_ref g = bdds[bdd_dist(gen)];
+            node_ref h = bdds[bdd_dist(gen)];
+            switch(iter % 4) {
+                case 0: { node_ref r = mgr.and_rec(f,g); test(r == mgr.and_recursive(f,g)); bdds.push_back(r); break; }
+                case 1: { node_ref r = mgr.or_rec(f,g); test(r == mgr.or_recursive(f,g)); bdds.push_back(r); break; }
+                case 2: { node_ref r = mgr.xor_rec(f,g); test(r == mgr.xor_recursive(f,g)); bdds.push_back(r); break; }
+                case 3: { node_ref r = mgr.ite_rec(f,g,h); test(r == mgr.ite_recursive(f,g,h)); bdds.push_back(r); break; }
+            }
+        }
+
+        // check semantics on random labelings
+        std::vector<char> labeling(nr_vars);
+        for(size_t k=0; k<100; ++k)
+        {
+            for(auto& x : labeling)
+                x = std::bernoulli_distribution(0.5)(gen);
+            node_ref f = bdds[std::uniform_int_distribution<size_t>(0, bdds.size()-1)(gen)];
+            node_ref g = bdds[std::uniform_int_distribution<size_t>(0, bdds.size()-1)(gen)];
+            node_ref h = bdds[std::uniform_int_distribution<size_t>(0, bdds.size()-1)(gen)];
+            const bool fv = f.evaluate(labeling.begin(), labeling.end());
+            const bool gv = g.evaluate(labeling.begin(), labeling.end());
+            const bool hv = h.evaluate(labeling.begin(), labeling.end());
+            test(mgr.and_rec(f,g).evaluate(labeling.begin(), labeling.end()) == (fv && gv));
+            test(mgr.or_rec(f,g).evaluate(labeling.begin(), labeling.end()) == (fv || gv));
+            test(mgr.xor_rec(f,g).evaluate(labeling.begin(), labeling.end()) == (fv != gv));
+            test(mgr.ite_rec(f,g,h).evaluate(labeling.begin(), labeling.end()) == (fv ? gv : hv));
+            test(mgr.negate(f).evaluate(labeling.begin(), labeling.end()) == !fv);
+        }
+    }
+
+    // long constraints whose depth would exceed the stack for recursive traversal
+    {
+        bdd_mgr mgr;
+        constexpr size_t n = 200000;
+        std::vector<node_ref> vars;
+        for(size_t i=0; i<n; ++i)
+            vars.push_back(mgr.projection(i));
+
+        node_ref parity = mgr.xor_rec(vars.begin(), vars.end());
+        test(parity.nr_nodes() == 2*n-1);
+        node_ref neg_parity = mgr.negate(parity);
+        test(neg_parity.nr_nodes() == 2*n-1);
+        test(mgr.xor_rec(parity, neg_parity) == mgr.topsink());
+        test(mgr.and_rec(parity, neg_parity) == mgr.botsink());
+
+        std::vector<char> labeling(n, 0);
+        labeling[n/2] = 1;
+        test(parity.evaluate(labeling.begin(), labeling.end()) == true);
+        test(neg_parity.evaluate(labeling.begin(), labeling.end()) == false);
+
+        node_ref all_true = mgr.and_rec(vars.begin(), vars.end());
+        test(all_true.nr_nodes() == n);
+        test(all_true.variables().size() == n);
+        test(all_true.nodes_postorder().size() == n);
+        test(mgr.ite_rec(all_true, parity, neg_parity) == mgr.or_rec(mgr.and_rec(all_true, parity), mgr.and_rec(mgr.negate(all_true), neg_parity)));
+    }
+}
@@ -44,4 +44,16 @@ int main(int argc, char** argv)
     //collection.export_graphviz(covering_ineq_coll_intersect, fs);
 
     test(covering_ineq_intersect == covering_ineq_intersect_transformed); 
+
+    // node limited conjunction succeeds exactly when the limit is at least the size of the conjunction
+    {
+        node_ref covering_01 = mgr.and_rec(covering_ineq[0], covering_ineq[1]);
+        const size_t nr_nodes = covering_01.nr_nodes();
+        const size_t nr_bdds = collection.nr_bdds();
+        test(collection.bdd_and(covering_ineq_coll[0], covering_ineq_coll[1], nr_nodes-1) == std::numeric_limits<size_t>::max());
+        test(collection.nr_bdds() == nr_bdds);
+        const size_t limited_intersect = collection.bdd_and(covering_ineq_coll[0], covering_ineq_coll[1], nr_nodes);
+        test(limited_intersect == nr_bdds);
+        test(collection.export_bdd(mgr, limited_intersect) == covering_01);
+    }
 }
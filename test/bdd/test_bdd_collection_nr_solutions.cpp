@@ -0,0 +1,132 @@
+#include "bdd_collection/bdd_collection.h"
+#include "bdd_manager/bdd_mgr.h"
+#include "../test.h"
+#include <unordered_set>
+#include <random>
+#include <cmath>
+
+using namespace LPMP;
+
+// count solutions by enumerating all assignments of the bdd's variables
+std::vector<size_t> brute_force_nr_solutions(const BDD::bdd_collection& bdd_col, const size_t bdd_nr, const std::unordered_set<size_t>& pos, const std::unordered_set<size_t>& neg)
+{
+    const std::vector<size_t> vars = bdd_col.variables(bdd_nr);
+    // total count first, then count with each variable set to true
+    std::vector<size_t> counts(vars.size()+1, 0);
+    std::vector<char> labeling(vars.back()+1, 0);
+    for(size_t l=0; l<(size_t(1) << vars.size()); ++l)
+    {
+        bool feasible = true;
+        for(size_t i=0; i<vars.size(); ++i)
+        {
+            labeling[vars[i]] = (l >> i) & 1;
+            if((pos.count(vars[i]) > 0 && labeling[vars[i]] == 0) || (neg.count(vars[i]) > 0 && labeling[vars[i]] == 1))
+                feasible = false;
+        }
+        if(!feasible || !bdd_col.evaluate(bdd_nr, labeling.begin(), labeling.end()))
+            continue;
+        counts[0]++;
+        for(size_t i=0; i<vars.size(); ++i)
+            counts[i+1] += labeling[vars[i]];
+    }
+    return counts;
+}
+
+bool log_equal(const double log_count, const size_t count)
+{
+    if(count == 0)
+        return log_count == -std::numeric_limits<double>::infinity();
+    return std::abs(log_count - std::log2(double(count))) <= 1e-9;
+}
+
+int main(int argc, char** argv)
+{
+    // random bdds with and without forced variables against enumeration
+    {
+        BDD::bdd_mgr bdd_mgr;
+        BDD::bdd_collection bdd_col;
+        constexpr size_t nr_vars = 12;
+        std::vector<BDD::node_ref> vars;
+        for(size_t i=0; i<nr_vars; ++i)
+            vars.push_back(bdd_mgr.projection(i));
+
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<size_t> var_dist(0, nr_vars-1);
+        for(size_t k=0; k<30; ++k)
+        {
+            BDD::node_ref f = bdd_mgr.botsink();
+            for(size_t c=0; c<4; ++c)
+            {
+                BDD::node_ref clause = bdd_mgr.topsink();
+                for(size_t l=0; l<3; ++l)
+                {
+                    const size_t v = var_dist(gen);
+                    clause = bdd_mgr.and_rec(clause, std::bernoulli_distribution(0.5)(gen) ? vars[v] : bdd_mgr.negate(vars[v]));
+                }
+                f = bdd_mgr.or_rec(f, clause);
+            }
+            if(f.is_terminal())
+                continue;
+            bdd_col.add_bdd(f);
+        }
+        test(bdd_col.nr_bdds() > 20);
+
+        std::vector<double> log_counts = bdd_col.log_nr_solutions();
+        std::vector<std::vector<double>> log_marginals = bdd_col.log_nr_solutions_marginals();
+        for(size_t bdd_nr=0; bdd_nr<bdd_col.nr_bdds(); ++bdd_nr)
+        {
+            const std::vector<size_t> bdd_vars = bdd_col.variables(bdd_nr);
+            const std::unordered_set<size_t> empty;
+            const std::vector<size_t> counts = brute_force_nr_solutions(bdd_col, bdd_nr, empty, empty);
+            test(bdd_col.bdd_nr_solutions(bdd_nr, empty, empty) == counts[0]);
+            test(log_equal(log_counts[bdd_nr], counts[0]));
+            test(log_counts[bdd_nr] == bdd_col.log_nr_solutions(bdd_nr));
+            test(log_marginals[bdd_nr].size() == bdd_vars.size());
+            for(size_t i=0; i<bdd_vars.size(); ++i)
+                test(log_equal(log_marginals[bdd_nr][i], counts[i+1]));
+
+            // force one variable of the bdd and one outside of it
+            const std::unordered_set<size_t> pos = {bdd_vars[bdd_nr % bdd_vars.size()], nr_vars};
+            const std::unordered_set<size_t> neg = {bdd_vars[(bdd_nr+1) % bdd_vars.size()]};
+            if(neg.count(*pos.begin()) > 0 || bdd_vars.size() < 2)
+                continue;
+            const std::vector<size_t> forced_counts = brute_force_nr_solutions(bdd_col, bdd_nr, pos, neg);
+            test(bdd_col.bdd_nr_solutions(bdd_nr, pos, neg) == forced_counts[0]);
+            test(log_equal(bdd_col.log_nr_solutions(bdd_nr, pos, neg), forced_counts[0]));
+            const std::vector<double> forced_marginals = bdd_col.log_nr_solutions_marginals(bdd_nr, pos, neg);
+            for(size_t i=0; i<bdd_vars.size(); ++i)
+                test(log_equal(forced_marginals[i], forced_counts[i+1]));
+            test(bdd_col.log_nr_solutions(pos, neg)[bdd_nr] == bdd_col.log_nr_solutions(bdd_nr, pos, neg));
+        }
+    }
+
+    // counts beyond size_t in log domain
+    {
+        BDD::bdd_collection bdd_col;
+        constexpr size_t n = 100;
+        const size_t simplex_nr = bdd_col.simplex_constraint(n);
+        const size_t not_all_false_nr = bdd_col.not_all_false_constraint(n);
+        const std::unordered_set<size_t> empty;
+
+        test(bdd_col.bdd_nr_solutions(simplex_nr, empty, empty) == n);
+        test(std::abs(bdd_col.log_nr_solutions(simplex_nr) - std::log2(double(n))) <= 1e-9);
+        for(const double m : bdd_col.log_nr_solutions_marginals(simplex_nr))
+            test(std::abs(m) <= 1e-9);
+
+        test(std::abs(bdd_col.log_nr_solutions(not_all_false_nr) - n) <= 1e-9);
+        for(const double m : bdd_col.log_nr_solutions_marginals(not_all_false_nr))
+            test(std::abs(m - (n-1)) <= 1e-9);
+        bool overflow = false;
+        try { bdd_col.bdd_nr_solutions(not_all_false_nr, empty, empty); }
+        catch(const std::runtime_error&) { overflow = true; }
+        test(overflow);
+
+        // forcing all but few variables to be false brings the count back into range
+        std::unordered_set<size_t> neg;
+        for(size_t i=3; i<n; ++i)
+            neg.insert(i);
+        test(bdd_col.bdd_nr_solutions(not_all_false_nr, empty, neg) == 7);
+        test(bdd_col.bdd_nr_solutions(simplex_nr, std::unordered_set<size_t>{0}, empty) == 1);
+        test(bdd_col.log_nr_solutions(simplex_nr, std::unordered_set<size_t>{0,1}, empty) == -std::numeric_limits<double>::infinity());
+    }
+}
@@ -0,0 +1,137 @@
+#include "bdd_collection/bdd_collection.h"
+#include "bdd_manager/bdd_mgr.h"
+#include "../test.h"
+#include <chrono>
+#include <iostream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace BDD;
+using namespace LPMP;
+
+int main(int argc, char** argv)
+{
+    // large bdds are reduced and transformed into qbdds level by level in parallel. Results must not depend on the number of threads
+    constexpr size_t n = 1200;
+    constexpr size_t b = 80;
+
+    // at most b of n variables are true. Nodes are pairs of variable and number of true variables before it
+    bdd_mgr mgr;
+    for(size_t i=0; i<n; ++i)
+        mgr.add_variable();
+    std::vector<node_ref> next(b+2, mgr.topsink());
+    next[b+1] = mgr.botsink();
+    for(ptrdiff_t i=n-1; i>=0; --i)
+    {
+        std::vector<node_ref> cur(b+2, mgr.botsink());
+        for(size_t c=0; c<=std::min(size_t(i),b); ++c)
+            cur[c] = mgr.unique_find(i, next[c], next[c+1]);
+        std::swap(cur, next);
+    }
+    const node_ref at_most = next[0];
+
+#ifdef _OPENMP
+    const size_t max_threads = omp_get_max_threads();
+#else
+    const size_t max_threads = 1;
+#endif
+    size_t nr_qbdd_nodes = 0;
+    for(size_t nr_threads=1; nr_threads<=std::max(max_threads, size_t(4)); nr_threads*=2)
+    {
+#ifdef _OPENMP
+        omp_set_num_threads(nr_threads);
+#endif
+        // same layered graph, not reduced
+        bdd_collection col;
+        const size_t bdd_nr = col.new_bdd();
+        std::vector<bdd_collection_node> nodes;
+        std::vector<size_t> level_offset;
+        for(size_t i=0; i<n; ++i)
+        {
+            level_offset.push_back(nodes.size());
+            for(size_t c=0; c<=std::min(i,b); ++c)
+                nodes.push_back(col.add_bdd_node(i));
+        }
+        for(size_t i=0; i<n; ++i)
+            for(size_t c=0; c<=std::min(i,b); ++c)
+            {
+                bdd_collection_node& node = nodes[level_offset[i] + c];
+                if(i+1 == n)
+                    node.set_lo_to_1_terminal();
+                else
+                    node.set_lo_arc(nodes[level_offset[i+1] + c]);
+                if(c == b)
+                    node.set_hi_to_0_terminal();
+                else if(i+1 == n)
+                    node.set_hi_to_1_terminal();
+                else
+                    node.set_hi_arc(nodes[level_offset[i+1] + c + 1]);
+            }
+        test(col.nr_bdd_nodes(bdd_nr) > bdd_collection::parallel_threshold);
+
+        const auto reduce_begin_time = std::chrono::steady_clock::now();
+        col.close_bdd();
+        const auto reduce_end_time = std::chrono::steady_clock::now();
+        test(col.is_bdd(bdd_nr));
+        test(col.nr_bdd_nodes(bdd_nr) == at_most.nr_nodes() + 2);
+        test(col.export_bdd(mgr, bdd_nr) == at_most);
+
+        bdd_collection o;
+        const auto qbdd_begin_time = std::chrono::steady_clock::now();
+        const size_t qbdd_nr = col.make_qbdd(bdd_nr, o);
+        const auto qbdd_end_time = std::chrono::steady_clock::now();
+        test(o.is_qbdd(qbdd_nr));
+        test(o.is_reordered(qbdd_nr));
+        test(o.export_bdd(mgr, qbdd_nr) == at_most);
+        if(nr_threads == 1)
+            nr_qbdd_nodes = o.nr_bdd_nodes(qbdd_nr);
+        test(o.nr_bdd_nodes(qbdd_nr) == nr_qbdd_nodes);
+
+        std::cout << "[strong scaling] " << nr_threads << " threads: reduce "
+            << std::chrono::duration<double,std::milli>(reduce_end_time - reduce_begin_time).count() << " ms, make_qbdd "
+            << std::chrono::duration<double,std::milli>(qbdd_end_time - qbdd_begin_time).count() << " ms for "
+            << nr_qbdd_nodes << " qbdd nodes\n";
+    }
+    // bdds whose nodes all collapse into one terminal are reduced to the constant bdd, sequentially for small and in parallel for large ones
+    for(const size_t nr_levels : {size_t(4), n})
+    for(const bool topsink : {false, true})
+    {
+        bdd_collection col;
+        const size_t bdd_nr = col.new_bdd();
+        std::vector<bdd_collection_node> nodes;
+        std::vector<size_t> level_offset;
+        for(size_t i=0; i<nr_levels; ++i)
+        {
+            level_offset.push_back(nodes.size());
+            for(size_t c=0; c<=std::min(i,b); ++c)
+                nodes.push_back(col.add_bdd_node(i));
+        }
+        for(size_t i=0; i<nr_levels; ++i)
+            for(size_t c=0; c<=std::min(i,b); ++c)
+            {
+                bdd_collection_node& node = nodes[level_offset[i] + c];
+                if(i+1 == nr_levels && topsink)
+                {
+                    node.set_lo_to_1_terminal();
+                    node.set_hi_to_1_terminal();
+                }
+                else if(i+1 == nr_levels)
+                {
+                    node.set_lo_to_0_terminal();
+                    node.set_hi_to_0_terminal();
+                }
+                else
+                {
+                    node.set_lo_arc(nodes[level_offset[i+1] + c]);
+                    node.set_hi_arc(nodes[level_offset[i+1] + std::min(c+1, std::min(i+1,b))]);
+                }
+            }
+        test((col.nr_bdd_nodes(bdd_nr) > bdd_collection::parallel_threshold) == (nr_levels == n));
+        col.close_bdd();
+        test(col.is_bdd(bdd_nr));
+        test(col.nr_bdd_nodes(bdd_nr) == 2);
+        test(topsink ? col.begin(bdd_nr)->is_topsink() : col.begin(bdd_nr)->is_botsink());
+        test(col.export_bdd(mgr, bdd_nr) == (topsink ? mgr.topsink() : mgr.botsink()));
+    }
+}
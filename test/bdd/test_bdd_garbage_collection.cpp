@@ -0,0 +1,115 @@
+#include "bdd_manager/bdd_mgr.h"
+#include "../test.h"
+#include <random>
+#include <vector>
+
+using namespace BDD;
+using namespace LPMP;
+
+int main(int argc, char** argv)
+{
+    constexpr size_t nr_vars = 40;
+    std::mt19937 gen(17);
+    auto random_bdd = [&](bdd_mgr& mgr) {
+        while(mgr.nr_variables() < nr_vars)
+            mgr.add_variable();
+        std::vector<node_ref> clauses;
+        for(size_t c=0; c<8; ++c)
+        {
+            std::vector<node_ref> literals;
+            for(size_t l=0; l<3; ++l)
+            {
+                const size_t var = std::uniform_int_distribution<size_t>(0, nr_vars-1)(gen);
+                literals.push_back(std::bernoulli_distribution(0.5)(gen) ? mgr.projection(var) : mgr.neg_projection(var));
+            }
+            clauses.push_back(mgr.or_rec(literals.begin(), literals.end()));
+        }
+        return mgr.and_rec(clauses.begin(), clauses.end());
+    };
+
+    // explicit garbage collection keeps referenced bdds intact
+    {
+        bdd_mgr mgr;
+        mgr.set_garbage_collection(2.0, std::numeric_limits<size_t>::max());
+
+        std::vector<node_ref> kept;
+        std::vector<size_t> kept_nr_nodes;
+        for(size_t i=0; i<200; ++i)
+        {
+            node_ref f = random_bdd(mgr);
+            if(i % 10 == 0)
+            {
+                kept.push_back(f);
+                kept_nr_nodes.push_back(f.nr_nodes());
+            }
+        }
+        std::vector<std::vector<char>> labelings(100, std::vector<char>(nr_vars));
+        std::vector<std::vector<char>> values;
+        for(auto& l : labelings)
+        {
+            for(auto& x : l)
+                x = std::bernoulli_distribution(0.5)(gen);
+            values.emplace_back();
+            for(node_ref& f : kept)
+                values.back().push_back(f.evaluate(l.begin(), l.end()));
+        }
+
+        const size_t nr_nodes_before = mgr.nr_nodes();
+        const size_t memory_before = mgr.memory_usage();
+        mgr.collect_garbage();
+        test(mgr.nr_nodes() < nr_nodes_before, "garbage collection did not remove unused nodes.");
+        test(mgr.memory_usage() <= memory_before);
+        test(mgr.gc_statistics().nr_collections == 1);
+        test(mgr.gc_statistics().nr_freed_nodes == nr_nodes_before - mgr.nr_nodes());
+
+        for(size_t i=0; i<kept.size(); ++i)
+            test(kept[i].nr_nodes() == kept_nr_nodes[i], "referenced bdd changed by garbage collection");
+        for(size_t k=0; k<labelings.size(); ++k)
+            for(size_t i=0; i<kept.size(); ++i)
+                test(kept[i].evaluate(labelings[k].begin(), labelings[k].end()) == values[k][i], "referenced bdd changed by garbage collection");
+
+        // unique tables stay canonical after collection
+        for(size_t i=0; i+1<kept.size(); ++i)
+        {
+            node_ref f = mgr.and_rec(kept[i], kept[i+1]);
+            test(f == mgr.and_recursive(kept[i], kept[i+1]));
+            test(mgr.or_rec(mgr.negate(kept[i]), mgr.negate(kept[i+1])) == mgr.negate(f));
+        }
+
+        // all nodes except sinks are freed when no references are left
+        kept.clear();
+        mgr.collect_garbage();
+        test(mgr.nr_nodes() == 2, "unreferenced nodes left after garbage collection");
+    }
+
+    // automatic garbage collection bounds the nr of nodes when bdds are discarded
+    {
+        bdd_mgr mgr;
+        mgr.set_garbage_collection(0.5, 10000);
+        std::vector<node_ref> kept(5, mgr.topsink());
+        size_t max_nr_nodes = 0;
+        for(size_t i=0; i<2000; ++i)
+        {
+            node_ref f = random_bdd(mgr);
+            if(i % 100 == 0)
+                kept[(i/100) % kept.size()] = f;
+            max_nr_nodes = std::max(max_nr_nodes, mgr.nr_nodes());
+        }
+        test(mgr.gc_statistics().nr_collections > 0, "no automatic garbage collection");
+        test(mgr.gc_statistics().total_pause >= mgr.gc_statistics().max_pause);
+        test(max_nr_nodes < 4*10000, "nr of nodes not bounded by garbage collection");
+    }
+
+    // exceeding the memory limit with referenced nodes throws
+    {
+        bdd_mgr mgr;
+        std::vector<node_ref> kept;
+        for(size_t i=0; i<200; ++i)
+            kept.push_back(random_bdd(mgr));
+        mgr.set_memory_limit(mgr.memory_usage() / 2);
+        bool thrown = false;
+        try { random_bdd(mgr); }
+        catch(const std::runtime_error& e) { thrown = true; }
+        test(thrown, "memory limit not enforced");
+    }
+}
@@ -0,0 +1,85 @@
+#include "bdd_manager/bdd_mgr.h"
+#include "../test.h"
+#include <random>
+#include <vector>
+
+using namespace BDD;
+using namespace LPMP;
+
+int main(int argc, char** argv)
+{
+    // eviction policy within a single set
+    {
+        bdd_mgr mgr;
+        std::vector<node_ref> p;
+        for(size_t i=0; i<6; ++i)
+            p.push_back(mgr.projection(i));
+        memo_cache& cache = mgr.get_memo_cache();
+        cache.set_max_size(memo_cache::associativity);
+        test(cache.size() == memo_cache::associativity);
+        cache.reset_statistics();
+
+        node* r = mgr.topsink().address();
+        node* and_symb = memo_struct::and_symb();
+        for(size_t i=0; i<4; ++i)
+            cache.cache_insert(p[i].address(), p[i+1].address(), and_symb, r);
+        test(cache.get_statistics(memo_cache::operation::and_op).evictions == 0);
+        test(cache.cache_lookup(p[0].address(), p[1].address(), and_symb) == r);
+        test(cache.cache_lookup(p[2].address(), p[3].address(), and_symb) == r);
+
+        // the first entry not hit since the last eviction is evicted
+        cache.cache_insert(p[4].address(), p[5].address(), and_symb, r);
+        test(cache.get_statistics(memo_cache::operation::and_op).evictions == 1);
+        test(cache.cache_lookup(p[1].address(), p[2].address(), and_symb) == nullptr);
+        test(cache.cache_lookup(p[0].address(), p[1].address(), and_symb) == r);
+        test(cache.cache_lookup(p[4].address(), p[5].address(), and_symb) == r);
+
+        // aging bits are cleared on eviction, hence entries hit before are evicted next unless hit again
+        cache.cache_insert(p[1].address(), p[2].address(), and_symb, r);
+        test(cache.cache_lookup(p[2].address(), p[3].address(), and_symb) == nullptr);
+        cache.cache_insert(p[2].address(), p[3].address(), and_symb, r);
+        test(cache.cache_lookup(p[0].address(), p[1].address(), and_symb) == nullptr);
+
+        const auto& stats = cache.get_statistics(memo_cache::operation::and_op);
+        test(stats.hits == 4 && stats.misses == 3 && stats.insertions == 7 && stats.evictions == 3);
+        test(cache.get_statistics(memo_cache::operation::or_op).hits + cache.get_statistics(memo_cache::operation::or_op).misses == 0);
+    }
+
+    // results do not depend on the cache size, statistics are counted per operation
+    {
+        constexpr size_t nr_vars = 30;
+        std::vector<std::vector<size_t>> nr_nodes;
+        std::vector<memo_cache::statistics> and_stats;
+        for(const size_t max_size : {size_t(4), size_t(256), size_t(1) << 20})
+        {
+            bdd_mgr mgr;
+            mgr.get_memo_cache().set_max_size(max_size);
+            std::mt19937 gen(5);
+            std::vector<node_ref> bdds;
+            for(size_t i=0; i<nr_vars; ++i)
+                bdds.push_back(mgr.projection(i));
+            nr_nodes.emplace_back();
+            for(size_t iter=0; iter<300; ++iter)
+            {
+                std::uniform_int_distribution<size_t> bdd_dist(0, bdds.size()-1);
+                node_ref f = bdds[bdd_dist(gen)];
+                node_ref g = bdds[bdd_dist(gen)];
+                node_ref h = bdds[bdd_dist(gen)];
+                switch(iter % 4) {
+                    case 0: bdds.push_back(mgr.and_rec(f,g)); break;
+                    case 1: bdds.push_back(mgr.or_rec(f,g)); break;
+                    case 2: bdds.push_back(mgr.xor_rec(f,g)); break;
+                    case 3: bdds.push_back(mgr.ite_rec(f,g,h)); break;
+                }
+                nr_nodes.back().push_back(bdds.back().nr_nodes());
+            }
+            test(mgr.get_memo_cache().size() <= max_size);
+            for(const auto op : {memo_cache::operation::and_op, memo_cache::operation::or_op, memo_cache::operation::xor_op, memo_cache::operation::ite_op})
+                test(mgr.get_memo_cache().get_statistics(op).misses > 0, "memo cache misses not counted");
+            and_stats.push_back(mgr.get_memo_cache().get_statistics(memo_cache::operation::and_op));
+        }
+        test(nr_nodes[0] == nr_nodes[1] && nr_nodes[1] == nr_nodes[2], "memo cache size changes results");
+        test(and_stats[0].evictions > and_stats[2].evictions, "small memo cache does not evict more");
+        test(and_stats[0].hit_rate() <= and_stats[2].hit_rate());
+    }
+}
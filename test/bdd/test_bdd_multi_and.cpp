@@ -41,4 +41,53 @@ int main(int argc, char** argv)
                                     const std::array<size_t,8> labeling = {l0,l1,l2,l3,l4,l5,l5,l7};
                                         test(simplex_and.evaluate(labeling.begin(), labeling.end()) == collection.evaluate(simplex_and_idx, labeling.begin(), labeling.end()), "bdd collection multi and not correct.");
                                 }
+
+    // groups larger than the maximal arity are intersected hierarchically
+    for(const size_t nr_constraints : {10, 40, 200})
+    {
+        bdd_collection cardinality_collection;
+        std::vector<node_ref> vars;
+        for(size_t i=0; i<nr_constraints+7; ++i)
+            vars.push_back(mgr.projection(i));
+
+        node_ref cardinality_and = mgr.topsink();
+        std::vector<size_t> cardinality_bdds;
+        for(size_t i=0; i<nr_constraints; ++i)
+        {
+            node_ref c = mgr.at_most(vars.begin()+i, vars.begin()+i+8, 2);
+            cardinality_bdds.push_back(cardinality_collection.add_bdd(c));
+            cardinality_and = mgr.and_rec(cardinality_and, c);
+        }
+
+        bdd_collection o;
+        const size_t cardinality_and_idx = cardinality_collection.bdd_and(cardinality_bdds.begin(), cardinality_bdds.end(), o);
+        test(cardinality_collection.nr_bdds() == nr_constraints);
+        test(o.nr_bdds() == 1);
+        test(o.is_bdd(cardinality_and_idx));
+        test(o.export_bdd(mgr, cardinality_and_idx) == cardinality_and, "bdd collection multi and not correct.");
+    }
+
+    // infeasible conjunctions result in a bdd whose root is the botsink
+    for(const size_t nr_constraints : {2, 40})
+    {
+        bdd_collection infeasible_collection;
+        std::vector<node_ref> vars;
+        for(size_t i=0; i<nr_constraints+7; ++i)
+            vars.push_back(mgr.projection(i));
+
+        std::vector<size_t> infeasible_bdds;
+        for(size_t i=0; i<nr_constraints; ++i)
+            infeasible_bdds.push_back(infeasible_collection.add_bdd(mgr.at_most(vars.begin()+i, vars.begin()+i+8, 2)));
+        // three variables of the first cardinality constraint are forced to one
+        for(size_t i=0; i<3; ++i)
+            infeasible_bdds.push_back(infeasible_collection.add_bdd(vars[i]));
+
+        bdd_collection o;
+        const size_t infeasible_and_idx = infeasible_collection.bdd_and(infeasible_bdds.begin(), infeasible_bdds.end(), o);
+        test(o.nr_bdds() == 1);
+        test(o.is_bdd(infeasible_and_idx));
+        test(o.nr_bdd_nodes(infeasible_and_idx) == 2);
+        test(o.begin(infeasible_and_idx)->is_botsink());
+        test(o.export_bdd(mgr, infeasible_and_idx) == mgr.botsink());
+    }
 }
@@ -1,6 +1,7 @@
 #include "bdd_manager/bdd_node_cache.h"
 #include "../test.h"
 #include <vector>
+#include <algorithm>
 
 using namespace BDD;
 using namespace LPMP;
@@ -27,4 +28,23 @@ int main(int argc, char** argv)
     } 
 
     test(2 == cache.nr_nodes());
+
+    // all pages except the one holding the sinks and the current one are unused
+    const size_t nr_pages = cache.nr_pages();
+    test(nr_pages == (nr_nodes_to_insert + 2 + bdd_node_page_size - 1) / bdd_node_page_size);
+    test(cache.release_free_pages() == (nr_pages - 2) * sizeof(bdd_node_page), "unused node pages not released");
+    test(cache.nr_pages() == 2);
+
+    v.clear();
+    for(std::size_t i=0; i<nr_nodes_to_insert; ++i)
+    {
+        v.push_back(cache.reserve_node());
+        v.back()->lo = cache.topsink();
+        v.back()->hi = cache.topsink();
+        cache.topsink()->xref += 2;
+    }
+    test(nr_nodes_to_insert + 2 == cache.nr_nodes());
+    std::sort(v.begin(), v.end());
+    test(std::adjacent_find(v.begin(), v.end()) == v.end(), "node reserved twice");
+    test(cache.release_free_pages() == 0, "pages in use released");
 }
@@ -21,6 +21,15 @@ void test_unique_table_page_cache()
     {
         cache.free_page(v[i]);
     } 
+
+    const std::size_t nr_pages = cache.nr_pages();
+    test(cache.release_free_pages() == nr_pages * sizeof(unique_table_page<PAGE_SIZE>), "unused pages not released");
+    test(cache.nr_pages() == 0, "page counting error when releasing pages");
+    v.clear();
+    for(std::size_t i=0; i<n; ++i)
+        v.push_back(cache.reserve_page());
+    cache.free_page(v[0]);
+    test(cache.release_free_pages() == 0, "pages in use released");
 }
 
 int main(int argc, char** argv)
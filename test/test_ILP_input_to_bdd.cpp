@@ -2,6 +2,8 @@
 #include "convert_pb_to_bdd.h"
 #include "lineq_bdd.h"
 #include <vector>
+#include <random>
+#include <algorithm>
 
 using namespace LPMP;
 
@@ -232,6 +234,95 @@ void test_covering(bdd_converter& converter)
     test(bdd_1.nr_solutions() == 8-1);
 }
 
+void test_qbdd_emission(bdd_converter& converter)
+{
+    BDD::bdd_mgr& bdd_mgr = converter.bdd_mgr();
+    lineq_bdd& lbdd = converter.get_lineq_bdd();
+    BDD::bdd_collection bdd_col;
+    std::mt19937 gen(17);
+
+    for(size_t iter=0; iter<500; ++iter)
+    {
+        const size_t nr_vars = std::uniform_int_distribution<size_t>(1, 40)(gen);
+        const int max_coeff = iter % 2 == 0 ? 3 : 1000; // small coefficients give many equivalent slacks, large ones knapsack-like rows
+        std::uniform_int_distribution<int> coeff_dist(-max_coeff, max_coeff);
+        std::vector<int> coeffs;
+        for(size_t i=0; i<nr_vars; ++i)
+            coeffs.push_back(coeff_dist(gen));
+        int abs_sum = 0;
+        for(const int c : coeffs)
+            abs_sum += std::abs(c);
+        const int rhs = std::uniform_int_distribution<int>(-abs_sum/2, abs_sum/2)(gen);
+        const auto ineq = std::array<ILP_input::inequality_type,3>{ILP_input::inequality_type::equal, ILP_input::inequality_type::smaller_equal, ILP_input::inequality_type::greater_equal}[iter % 3];
+        if(std::all_of(coeffs.begin(), coeffs.end(), [](const int c) { return c == 0; }))
+            continue;
+
+        const auto [nf, nf_ineq] = lineq_bdd::normal_form(coeffs.begin(), coeffs.end(), ineq, rhs);
+        lbdd.build_from_inequality(nf, nf_ineq);
+        BDD::node_ref bdd = lbdd.convert_to_lbdd(bdd_mgr);
+        if(lbdd.is_topsink() || lbdd.is_botsink())
+        {
+            test(bdd == (lbdd.is_topsink() ? bdd_mgr.topsink() : bdd_mgr.botsink()));
+            continue;
+        }
+
+        const size_t qbdd_nr = lbdd.convert_to_qbdd(bdd_col);
+        test(bdd_col.is_qbdd(qbdd_nr));
+        test(bdd_col.is_reordered(qbdd_nr));
+        test(bdd_col.export_bdd(bdd_mgr, qbdd_nr) == bdd);
+
+        // same as going through bdd_mgr
+        const size_t bdd_nr = bdd_col.add_bdd(bdd);
+        bdd_col.reorder(bdd_nr);
+        const size_t mgr_qbdd_nr = bdd_col.make_qbdd(bdd_nr);
+        test(bdd_col.nr_bdd_nodes(mgr_qbdd_nr) == bdd_col.nr_bdd_nodes(qbdd_nr));
+        test(bdd_col.variables(mgr_qbdd_nr) == bdd_col.variables(qbdd_nr));
+    }
+}
+
+void test_converter_qbdd(bdd_converter& converter)
+{
+    BDD::bdd_mgr& bdd_mgr = converter.bdd_mgr();
+    BDD::bdd_collection bdd_col;
+    std::mt19937 gen(5);
+
+    for(size_t iter=0; iter<200; ++iter)
+    {
+        // repeat constraints on other variables to exercise the cache
+        std::mt19937 coeff_gen(iter/2);
+        const size_t nr_vars = std::uniform_int_distribution<size_t>(1, 20)(coeff_gen);
+        std::vector<int> coeffs;
+        for(size_t i=0; i<nr_vars; ++i)
+            coeffs.push_back(std::uniform_int_distribution<int>(-5, 5)(coeff_gen));
+        const int rhs = std::uniform_int_distribution<int>(-5, 5)(coeff_gen);
+        if(std::all_of(coeffs.begin(), coeffs.end(), [](const int c) { return c == 0; }))
+            continue;
+        const auto ineq = std::array<ILP_input::inequality_type,3>{ILP_input::inequality_type::equal, ILP_input::inequality_type::smaller_equal, ILP_input::inequality_type::greater_equal}[(iter/2) % 3];
+        std::vector<size_t> vars;
+        for(size_t i=0; i<nr_vars; ++i)
+            vars.push_back((vars.empty() ? 0 : vars.back() + 1) + std::uniform_int_distribution<size_t>(0, 3)(gen));
+        while(bdd_mgr.nr_variables() <= vars.back())
+            bdd_mgr.add_variable();
+
+        const size_t qbdd_nr = converter.convert_to_qbdd(coeffs.begin(), coeffs.end(), ineq, rhs, vars.begin(), bdd_col);
+        BDD::node_ref bdd = converter.convert_to_bdd(coeffs, ineq, rhs);
+        if(bdd.is_topsink() || bdd.is_botsink())
+        {
+            test(qbdd_nr == (bdd.is_topsink() ? BDD::bdd_instruction::topsink_index : BDD::bdd_instruction::botsink_index));
+            continue;
+        }
+
+        const size_t bdd_nr = bdd_col.add_bdd(bdd);
+        bdd_col.reorder(bdd_nr);
+        bdd_col.rebase(bdd_nr, vars.begin(), vars.end());
+        const size_t mgr_qbdd_nr = bdd_col.make_qbdd(bdd_nr);
+        test(bdd_col.is_qbdd(qbdd_nr));
+        test(bdd_col.nr_bdd_nodes(qbdd_nr) == bdd_col.nr_bdd_nodes(mgr_qbdd_nr));
+        test(bdd_col.variables(qbdd_nr) == bdd_col.variables(mgr_qbdd_nr));
+        test(bdd_col.export_bdd(bdd_mgr, qbdd_nr) == bdd_col.export_bdd(bdd_mgr, mgr_qbdd_nr));
+    }
+}
+
 int main(int argc, char** argv)
 {
     BDD::bdd_mgr bdd_mgr;
@@ -244,4 +335,10 @@ int main(int argc, char** argv)
     test_subset_sum(converter);
     test_covering(converter);
     test_cardinality(converter);
+    test_qbdd_emission(converter);
+    test_converter_qbdd(converter);
+
+    // qbdd cache is dropped repeatedly
+    bdd_converter small_cache_converter(bdd_mgr, 64);
+    test_converter_qbdd(small_cache_converter);
 }
@@ -0,0 +1,124 @@
+#include "bdd_batch_solver.h"
+#include "bdd_sequential_base.h"
+#include "bdd_branch_instruction.h"
+#include "ILP_parser.h"
+#include "bdd_preprocessor.h"
+#include "test_problem_generator.h"
+#include "test.h"
+
+using namespace LPMP;
+
+const char * two_simplex_problem = 
+R"(Minimize
+2 x_1 + 1 x_2 + 1 x_3
++1 x_4 + 2 x_5 - 1 x_6
+Subject To
+x_1 + x_2 + x_3 = 1
+x_4 + x_5 + x_6 = 2
+End)";
+
+// all rows prefer the first column, lower bound needs several iterations
+const char * assignment_problem = 
+R"(Minimize
+-2 x_11 - 1 x_12 - 1 x_13
+-2 x_21 - 1 x_22 - 1 x_23
+-2 x_31 - 1 x_32 - 1 x_33
+Subject To
+x_11 + x_12 + x_13 = 1 
+x_21 + x_22 + x_23 = 1 
+x_31 + x_32 + x_33 = 1 
+x_11 + x_21 + x_31 = 1 
+x_12 + x_22 + x_32 = 1 
+x_13 + x_23 + x_33 = 1 
+End)";
+
+// no constraints, lower bound is sum of negative costs
+const char * unconstrained_problem = 
+R"(Minimize
+-1 x_1 + 2 x_2 - 3 x_3
+Subject To
+End)";
+
+// first constraint can never be satisfied
+const char * infeasible_problem = 
+R"(Minimize
+1 x_1 + 1 x_2 + 1 x_3
+Subject To
+x_1 + x_2 = 3
+x_1 + x_3 <= 1
+End)";
+
+// lower bound when solving the instance by itself with the same convergence criterion
+double single_lower_bound(const ILP_input& ilp, const double tolerance)
+{
+    bdd_preprocessor pre(ilp);
+    bdd_sequential_base<bdd_branch_instruction<float,uint16_t>> solver(pre.get_bdd_collection());
+    solver.update_costs(ilp.objective().begin(), ilp.objective().begin(), ilp.objective().begin(), ilp.objective().end());
+    double lb_prev = solver.lower_bound();
+    for(size_t iter=0; iter<1000; ++iter)
+    {
+        solver.parallel_mma();
+        const double lb = solver.lower_bound();
+        if(lb - lb_prev <= tolerance * std::abs(lb_prev))
+            return std::max(lb, lb_prev);
+        lb_prev = lb;
+    }
+    return lb_prev;
+}
+
+int main(int argc, char** argv)
+{
+    const double tolerance = 1e-6;
+    std::vector<ILP_input> instances;
+    instances.push_back(ILP_parser::parse_string(two_simplex_problem));
+    instances.push_back(ILP_parser::parse_string(assignment_problem));
+    instances.push_back(ILP_parser::parse_string(unconstrained_problem));
+    for(size_t nr_vars=3; nr_vars<20; ++nr_vars)
+    {
+        const auto [coefficients, ineq, rhs] = generate_random_inequality(nr_vars);
+        instances.push_back(generate_ILP(coefficients, ineq, rhs));
+    }
+
+    bdd_batch_solver batch(instances);
+    test(batch.nr_instances() == instances.size());
+    test(batch.variable_offset(0) == 0 && batch.variable_offset(1) == 6 && batch.variable_offset(2) == 15);
+    test(batch.converged(2));
+    test(batch.nr_active_instances() == instances.size()-1);
+    test(std::abs(batch.lower_bound(2) - (-4.0)) <= 1e-6);
+
+    batch.solve(1000, tolerance, 3600);
+    test(batch.nr_active_instances() == 0);
+
+    const std::vector<double> lbs = batch.lower_bounds();
+    test(lbs.size() == instances.size());
+    test(std::abs(lbs[0] - 1.0) <= 1e-5);
+    test(std::abs(lbs[1] - (-4.0)) <= 1e-4);
+    size_t max_iterations = 0;
+    for(size_t i=0; i<instances.size(); ++i)
+    {
+        test(batch.converged(i));
+        test(std::abs(lbs[i] - batch.lower_bound(i)) <= 1e-9);
+        test(std::abs(lbs[i] - single_lower_bound(instances[i], tolerance)) <= 1e-4);
+        max_iterations = std::max(max_iterations, batch.nr_iterations(i));
+    }
+    test(batch.nr_iterations(2) == 0);
+    // converged instances leave the sweeps early
+    test(batch.nr_iterations(0) < max_iterations);
+    test(batch.nr_iterations(1) == max_iterations);
+    // an infeasible instance does not affect the others
+    {
+        std::vector<ILP_input> mixed_instances;
+        mixed_instances.push_back(ILP_parser::parse_string(two_simplex_problem));
+        mixed_instances.push_back(ILP_parser::parse_string(infeasible_problem));
+        mixed_instances.push_back(ILP_parser::parse_string(assignment_problem));
+        bdd_batch_solver mixed_batch(mixed_instances);
+        test(mixed_batch.converged(1));
+        test(mixed_batch.lower_bound(1) == std::numeric_limits<double>::infinity());
+        test(mixed_batch.nr_active_instances() == 2);
+        mixed_batch.solve(1000, tolerance, 3600);
+        test(mixed_batch.nr_active_instances() == 0);
+        test(mixed_batch.lower_bound(1) == std::numeric_limits<double>::infinity());
+        test(std::abs(mixed_batch.lower_bound(0) - lbs[0]) <= 1e-5);
+        test(std::abs(mixed_batch.lower_bound(2) - lbs[1]) <= 1e-4);
+    }
+}
@@ -46,6 +46,21 @@ x_12 + x_22 + x_32 = 1
 x_13 + x_23 + x_33 = 1
 End)";
 
+void test_anytime_primal(const std::string input_string, const double expected_ub, std::vector<std::string> args)
+{
+    args.push_back("--lp_input_string");
+    args.push_back(input_string);
+    args.push_back("--anytime_primal_iterations");
+    args.push_back("1");
+    args.push_back("--gap_tolerance");
+    args.push_back("1e-6");
+    bdd_solver solver(args);
+    solver.solve();
+
+    test(std::abs(solver.upper_bound() - expected_ub) <= 1e-6);
+    test(solver.upper_bound() >= solver.lower_bound() - 1e-6);
+}
+
 
 int main(int argc, char** arv)
 {
@@ -60,4 +75,7 @@ int main(int argc, char** arv)
 //    test_problem(matching_3x3_first_row, -4.0, {"-s", "anisotropic_mma", "--max_iter", "20"});
 //    test_problem(matching_3x3_first_row, -4.0, {"-s", "mma_srmp", "--max_iter", "20"});
     test_problem(matching_3x3_first_row, -4.0, {"-s", "mma_vec", "--max_iter", "20"});
+
+    test_anytime_primal(matching_3x3_diag, -6.0, {"-s", "mma_vec", "--max_iter", "1000"});
+    test_anytime_primal(matching_3x3_diag, -6.0, {"-s", "parallel_mma", "--max_iter", "1000"});
 }
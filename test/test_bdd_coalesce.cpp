@@ -0,0 +1,116 @@
+#include "bdd_preprocessor.h"
+#include "bdd_solver.h"
+#include "ILP_parser.h"
+#include "test.h"
+#include <vector>
+#include <string>
+
+using namespace LPMP;
+
+// binary graphical model triplet with negative Potts
+const std::string triplet_instance = R"(Minimize
+- mu_12_01 - mu_12_10 - mu_13_01 - mu_13_10 - mu_23_01 - mu_23_10
+Subject To
+mu_1_0 + mu_1_1 = 1
+mu_2_0 + mu_2_1 = 1
+mu_3_0 + mu_3_1 = 1
+mu_12_00 + mu_12_01 + mu_12_10 + mu_12_11 = 1
+mu_13_00 + mu_13_01 + mu_13_10 + mu_13_11 = 1
+mu_23_00 + mu_23_01 + mu_23_10 + mu_23_11 = 1
+mu_1_0 - mu_12_00 - mu_12_01 = 0
+mu_1_1 - mu_12_10 - mu_12_11 = 0
+mu_2_0 - mu_12_00 - mu_12_10 = 0
+mu_2_1 - mu_12_01 - mu_12_11 = 0
+mu_1_0 - mu_13_00 - mu_13_01 = 0
+mu_1_1 - mu_13_10 - mu_13_11 = 0
+mu_3_0 - mu_13_00 - mu_13_10 = 0
+mu_3_1 - mu_13_01 - mu_13_11 = 0
+mu_2_0 - mu_23_00 - mu_23_01 = 0
+mu_2_1 - mu_23_10 - mu_23_11 = 0
+mu_3_0 - mu_23_00 - mu_23_10 = 0
+mu_3_1 - mu_23_01 - mu_23_11 = 0
+End)";
+
+// each constraint is feasible on its own, their conjunction is not
+const std::string infeasible_pair_instance = R"(Minimize
+x_1 + x_2 + x_3
+Subject To
+x_1 + x_2 = 1
+x_1 + x_2 + x_3 = 3
+End)";
+
+// bdds must have exactly the feasible points of the ILP as common solutions
+void test_equivalence(const ILP_input& ilp, BDD::bdd_collection& bdd_col)
+{
+    assert(ilp.nr_variables() <= 20);
+    std::vector<char> labeling(ilp.nr_variables());
+    for(size_t l=0; l<(size_t(1) << ilp.nr_variables()); ++l)
+    {
+        for(size_t i=0; i<ilp.nr_variables(); ++i)
+            labeling[i] = (l >> i) & 1;
+        bool bdds_feasible = true;
+        for(size_t bdd_nr=0; bdd_nr<bdd_col.nr_bdds() && bdds_feasible; ++bdd_nr)
+            bdds_feasible = bdd_col.evaluate(bdd_nr, labeling.begin(), labeling.end());
+        test(bdds_feasible == ilp.feasible(labeling.begin(), labeling.end()));
+    }
+}
+
+double solve(const std::vector<std::string>& extra_args)
+{
+    std::vector<std::string> args = {"--lp_input_string", triplet_instance, "-s", "mma", "--precision", "double", "-m", "100"};
+    args.insert(args.end(), extra_args.begin(), extra_args.end());
+    bdd_solver solver(args);
+    solver.solve();
+    return solver.lower_bound();
+}
+
+int main(int argc, char** argv)
+{
+    const ILP_input ilp = ILP_parser::parse_string(triplet_instance);
+
+    // default heuristics and budget
+    {
+        bdd_preprocessor bdd_pre(ilp);
+        const size_t nr_bdds = bdd_pre.get_bdd_collection().nr_bdds();
+        const coalesce_statistics stats = bdd_pre.coalesce();
+        test(stats.nr_bdds_before == nr_bdds);
+        test(stats.nr_merges > 0);
+        test(stats.nr_bdds_after == stats.nr_bdds_before - stats.nr_merges);
+        test(stats.nr_bdds_after == bdd_pre.get_bdd_collection().nr_bdds());
+        test(stats.nr_nodes_after <= 1.2 * stats.nr_nodes_before);
+        for(size_t bdd_nr=0; bdd_nr<bdd_pre.get_bdd_collection().nr_bdds(); ++bdd_nr)
+            test(bdd_pre.get_bdd_collection().is_qbdd(bdd_nr));
+        test_equivalence(ilp, bdd_pre.get_bdd_collection());
+    }
+
+    // merges must respect node limit and node budget
+    {
+        bdd_preprocessor bdd_pre(ilp);
+        bdd_pre.set_coalesce_overlap();
+        bdd_pre.set_coalesce_partial_contiguous_overlap();
+        coalesce_options opt;
+        opt.node_limit = 20;
+        opt.node_budget = 1.0;
+        const coalesce_statistics stats = bdd_pre.coalesce(opt);
+        test(stats.nr_nodes_after <= stats.nr_nodes_before);
+        for(size_t bdd_nr=0; bdd_nr<bdd_pre.get_bdd_collection().nr_bdds(); ++bdd_nr)
+            test(bdd_pre.get_bdd_collection().nr_bdd_nodes(bdd_nr) <= 20 + 2);
+        test_equivalence(ilp, bdd_pre.get_bdd_collection());
+    }
+
+    // infeasibility is detected when merging a pair of bdds
+    {
+        bdd_preprocessor bdd_pre(ILP_parser::parse_string(infeasible_pair_instance));
+        test(bdd_pre.get_bdd_collection().nr_bdds() == 2);
+        bool infeasible = false;
+        try { bdd_pre.coalesce(); } catch(const std::runtime_error&) { infeasible = true; }
+        test(infeasible);
+    }
+
+    // coalescing can only tighten the relaxation
+    {
+        const double lb = solve({});
+        const double coalesced_lb = solve({"--coalesce", "--coalesce_heuristics", "overlap", "--coalesce_heuristics", "bridge"});
+        test(coalesced_lb >= lb - 1e-6);
+    }
+}
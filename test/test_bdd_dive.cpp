@@ -0,0 +1,116 @@
+#include "bdd_dive.h"
+#include "bdd_dive_base.hxx"
+#include "ILP_parser.h"
+#include "bdd_preprocessor.h"
+#include "test_problem_generator.h"
+#include "test.h"
+
+using namespace LPMP;
+
+const char * assignment_problem = 
+R"(Minimize
+-2 x_11 - 1 x_12 - 1 x_13
+-1 x_21 - 2 x_22 - 1 x_23
+-1 x_31 - 1 x_32 - 2 x_33
+Subject To
+x_11 + x_12 + x_13 = 1 
+x_21 + x_22 + x_23 = 1 
+x_31 + x_32 + x_33 = 1 
+x_11 + x_21 + x_31 = 1 
+x_12 + x_22 + x_32 = 1 
+x_13 + x_23 + x_33 = 1 
+End)";
+
+const char * forced_problem = 
+R"(Minimize
+x_1 + x_2 + x_3
+Subject To
+x_1 + x_2 = 2
+x_2 + x_3 <= 1
+End)";
+
+const char * infeasible_problem = 
+R"(Minimize
+x_1 + x_2 + x_3
+Subject To
+x_1 + x_2 = 2
+x_2 + x_3 = 2
+x_1 + x_3 <= 1
+End)";
+
+void test_round(const ILP_input& ilp, const std::vector<double>& total_min_marginals, const bdd_fix_options opts)
+{
+    bdd_preprocessor pre(ilp);
+    bdd_dive dive(pre.get_bdd_collection(), opts);
+    test(dive.round(total_min_marginals));
+    const std::vector<char> sol = dive.primal_solution();
+    test(sol.size() == ilp.nr_variables());
+    test(ilp.feasible(sol.begin(), sol.end()));
+}
+
+int main(int argc, char** argv)
+{
+    using fix_order = bdd_fix_options::variable_order;
+    using fix_value = bdd_fix_options::variable_value;
+
+    const ILP_input assignment_ilp = ILP_parser::parse_string(assignment_problem);
+
+    // all orders and values must lead to a feasible assignment
+    for(const fix_order o : {fix_order::marginals_absolute, fix_order::marginals_up, fix_order::marginals_down, fix_order::marginals_reduction})
+        for(const fix_value v : {fix_value::marginal, fix_value::reduction, fix_value::one, fix_value::zero})
+        {
+            bdd_fix_options opts;
+            opts.var_order = o;
+            opts.var_value = v;
+            test_round(assignment_ilp, std::vector<double>(assignment_ilp.nr_variables(), 0.0), opts);
+            test_round(assignment_ilp, assignment_ilp.objective(), opts);
+        }
+
+    // fixing one variable of an assignment problem forces its row and column to zero
+    {
+        bdd_preprocessor pre(assignment_ilp);
+        bdd_dive_base dive(pre.get_bdd_collection());
+        test(dive.nr_variables() == 9);
+        test(std::count(dive.primal_solution().begin(), dive.primal_solution().end(), 2) == 9);
+        test(dive.fix_variable(assignment_ilp.get_var_index("x_22"), 1));
+        for(const std::string var : {"x_12", "x_32", "x_21", "x_23"})
+            test(dive.primal_solution()[assignment_ilp.get_var_index(var)] == 0);
+        test(std::count(dive.primal_solution().begin(), dive.primal_solution().end(), 2) == 4);
+        const size_t trail_size = dive.trail_size();
+        test(dive.fix_variable(assignment_ilp.get_var_index("x_11"), 1));
+        test(std::count(dive.primal_solution().begin(), dive.primal_solution().end(), 2) == 0);
+        test(dive.primal_solution()[assignment_ilp.get_var_index("x_33")] == 1);
+        dive.revert_changes(trail_size);
+        test(std::count(dive.primal_solution().begin(), dive.primal_solution().end(), 2) == 4);
+        test(!dive.fix_variable(assignment_ilp.get_var_index("x_12"), 1));
+        dive.revert_changes(0);
+        test(std::count(dive.primal_solution().begin(), dive.primal_solution().end(), 2) == 9);
+    }
+
+    // variables forced by constraints alone are fixed before diving
+    {
+        const ILP_input ilp = ILP_parser::parse_string(forced_problem);
+        bdd_fix_options opts;
+        opts.var_value = fix_value::one;
+        test_round(ilp, std::vector<double>(ilp.nr_variables(), 0.0), opts);
+    }
+
+    {
+        const ILP_input ilp = ILP_parser::parse_string(infeasible_problem);
+        bdd_preprocessor pre(ilp);
+        bdd_dive dive(pre.get_bdd_collection());
+        test(!dive.round(std::vector<double>(ilp.nr_variables(), 0.0)));
+    }
+
+    // random inequalities
+    for(size_t nr_vars=2; nr_vars<50; ++nr_vars)
+    {
+        const auto [coefficients, ineq, rhs] = generate_random_inequality(nr_vars);
+        ILP_input ilp = generate_ILP(coefficients, ineq, rhs);
+        bdd_fix_options opts;
+        opts.var_value = fix_value::one;
+        test_round(ilp, std::vector<double>(ilp.nr_variables(), 0.0), opts);
+        opts.var_value = fix_value::zero;
+        test_round(ilp, ilp.objective(), opts);
+    }
+}
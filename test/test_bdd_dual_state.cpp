@@ -0,0 +1,155 @@
+#include "bdd_dual_state.h"
+#include "bdd_parallel_mma.h"
+#include "bdd_mma_vec.h"
+#include "bdd_solver.h"
+#include "ILP_parser.h"
+#include "bdd_preprocessor.h"
+#include "test.h"
+#include <cstdio>
+
+using namespace LPMP;
+
+// all rows prefer the first column, lower bound needs several iterations
+const char * assignment_problem = 
+R"(Minimize
+-2 x_11 - 1 x_12 - 1 x_13
+-2 x_21 - 1 x_22 - 1 x_23
+-2 x_31 - 1 x_32 - 1 x_33
+Subject To
+x_11 + x_12 + x_13 = 1 
+x_21 + x_22 + x_23 = 1 
+x_31 + x_32 + x_33 = 1 
+x_11 + x_21 + x_31 = 1 
+x_12 + x_22 + x_32 = 1 
+x_13 + x_23 + x_33 = 1 
+End)";
+
+// same constraints, slightly changed objective
+const char * perturbed_assignment_problem = 
+R"(Minimize
+-2.2 x_11 - 1 x_12 - 1 x_13
+-2 x_21 - 1.1 x_22 - 1 x_23
+-2 x_31 - 1 x_32 - 1 x_33
+Subject To
+x_11 + x_12 + x_13 = 1 
+x_21 + x_22 + x_23 = 1 
+x_31 + x_32 + x_33 = 1 
+x_11 + x_21 + x_31 = 1 
+x_12 + x_22 + x_32 = 1 
+x_13 + x_23 + x_33 = 1 
+End)";
+
+const char * two_simplex_problem = 
+R"(Minimize
+2 x_1 + 1 x_2 + 1 x_3
++1 x_4 + 2 x_5 - 1 x_6
+Subject To
+x_1 + x_2 + x_3 = 1
+x_4 + x_5 + x_6 = 2
+End)";
+
+template<typename SOLVER>
+size_t iterations_to_convergence(SOLVER& s)
+{
+    double lb_prev = s.lower_bound();
+    for(size_t iter=0; iter<1000; ++iter)
+    {
+        s.iteration();
+        const double lb = s.lower_bound();
+        if(lb - lb_prev <= 1e-6 * std::abs(lb_prev))
+            return iter+1;
+        lb_prev = lb;
+    }
+    return 1000;
+}
+
+template<typename SOLVER>
+void test_warm_start(const ILP_input& ilp, const ILP_input& perturbed_ilp)
+{
+    bdd_preprocessor pre(ilp);
+    SOLVER solver(pre.get_bdd_collection(), ilp.objective().begin(), ilp.objective().end());
+    for(size_t iter=0; iter<5; ++iter)
+        solver.iteration();
+    // pending updates of parallel mma are distributed on export
+    const bdd_dual_state exported = solver.export_dual_state(ilp.objective());
+    const double lb = solver.lower_bound();
+
+    // round trip through buffer
+    const std::vector<char> buffer = exported.serialize();
+    const bdd_dual_state state = bdd_dual_state::deserialize(buffer.data(), buffer.data() + buffer.size());
+    test(state.structure_hash == exported.structure_hash);
+    test(state.objective == exported.objective);
+    test(state.costs.size() == exported.costs.size());
+
+    // same objective: lower bound is restored
+    {
+        bdd_preprocessor pre(ilp);
+        SOLVER warm_solver(pre.get_bdd_collection(), ilp.objective().begin(), ilp.objective().end());
+        warm_solver.import_dual_state(state, ilp.objective());
+        test(std::abs(warm_solver.lower_bound() - lb) <= 1e-5);
+    }
+
+    // changed objective: warm start converges to the same lower bound in fewer iterations
+    {
+        bdd_preprocessor cold_pre(perturbed_ilp);
+        SOLVER cold_solver(cold_pre.get_bdd_collection(), perturbed_ilp.objective().begin(), perturbed_ilp.objective().end());
+        const size_t cold_iterations = iterations_to_convergence(cold_solver);
+
+        bdd_preprocessor warm_pre(perturbed_ilp);
+        SOLVER warm_solver(warm_pre.get_bdd_collection(), perturbed_ilp.objective().begin(), perturbed_ilp.objective().end());
+        warm_solver.import_dual_state(state, perturbed_ilp.objective());
+        const size_t warm_iterations = iterations_to_convergence(warm_solver);
+
+        test(std::abs(warm_solver.lower_bound() - cold_solver.lower_bound()) <= 1e-3);
+        test(warm_iterations < cold_iterations);
+    }
+
+    // structurally different instance is rejected
+    {
+        const ILP_input other_ilp = ILP_parser::parse_string(two_simplex_problem);
+        bdd_preprocessor other_pre(other_ilp);
+        SOLVER other_solver(other_pre.get_bdd_collection(), other_ilp.objective().begin(), other_ilp.objective().end());
+        bool rejected = false;
+        try {
+            other_solver.import_dual_state(state, other_ilp.objective());
+        } catch(const std::runtime_error&) {
+            rejected = true;
+        }
+        test(rejected);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const ILP_input ilp = ILP_parser::parse_string(assignment_problem);
+    const ILP_input perturbed_ilp = ILP_parser::parse_string(perturbed_assignment_problem);
+
+    test_warm_start<bdd_parallel_mma<float>>(ilp, perturbed_ilp);
+    test_warm_start<bdd_parallel_mma<double>>(ilp, perturbed_ilp);
+    test_warm_start<bdd_mma_vec<float>>(ilp, perturbed_ilp);
+    test_warm_start<bdd_mma_vec<double>>(ilp, perturbed_ilp);
+
+    // export and import through files from command line
+    {
+        const std::string dual_state_file = "test_bdd_dual_state.bin";
+        const std::vector<std::string> export_args = {
+            "--lp_input_string", assignment_problem,
+            "-s", "parallel_mma",
+            "--max_iter", "1000",
+            "--export_dual_state", dual_state_file
+        };
+        bdd_solver export_solver(export_args);
+        export_solver.solve();
+        const double lb = export_solver.lower_bound();
+
+        const std::vector<std::string> import_args = {
+            "--lp_input_string", assignment_problem,
+            "-s", "parallel_mma",
+            "--max_iter", "1",
+            "--import_dual_state", dual_state_file
+        };
+        bdd_solver import_solver(import_args);
+        test(std::abs(import_solver.lower_bound() - lb) <= 1e-5);
+        std::remove(dual_state_file.c_str());
+    }
+}
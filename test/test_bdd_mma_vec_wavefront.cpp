@@ -0,0 +1,74 @@
+#include "bdd_mma_vec.h"
+#include "ILP_parser.h"
+#include "bdd_preprocessor.h"
+#include <random>
+#include <sstream>
+#include "test.h"
+
+using namespace LPMP;
+
+// chain of assignment problems, consecutive ones coupled by a single constraint
+std::string assignment_chain(const size_t nr_problems, const size_t n)
+{
+    std::mt19937 gen;
+    std::uniform_int_distribution<> d(-10,10);
+    auto var = [](const size_t k, const size_t i, const size_t j) { return "x_" + std::to_string(k) + "_" + std::to_string(i) + "_" + std::to_string(j); };
+
+    std::stringstream s;
+    s << "Minimize\n";
+    for(size_t k=0; k<nr_problems; ++k)
+        for(size_t i=0; i<n; ++i)
+            for(size_t j=0; j<n; ++j)
+                s << (d(gen) >= 0 ? "+ " : "- ") << std::abs(d(gen)) << " " << var(k,i,j) << "\n";
+    s << "Subject To\n";
+    for(size_t k=0; k<nr_problems; ++k)
+    {
+        for(size_t i=0; i<n; ++i)
+        {
+            for(size_t j=0; j<n; ++j)
+                s << (j > 0 ? " + " : "") << var(k,i,j);
+            s << " = 1\n";
+            for(size_t j=0; j<n; ++j)
+                s << (j > 0 ? " + " : "") << var(k,j,i);
+            s << " = 1\n";
+        }
+        if(k+1 < nr_problems)
+            s << var(k,0,0) << " + " << var(k+1,0,0) << " <= 1\n";
+    }
+    s << "End\n";
+    return s.str();
+}
+
+template<typename REAL>
+void test_wavefront(BDD::bdd_collection& bdd_col, const ILP_input& ilp)
+{
+    bdd_mma_vec<REAL> sequential(bdd_col, ilp.objective().begin(), ilp.objective().end());
+    bdd_mma_vec<REAL> wavefront(bdd_col, ilp.objective().begin(), ilp.objective().end());
+    wavefront.set_nr_threads(4);
+
+    for(size_t iter=0; iter<10; ++iter)
+    {
+        sequential.iteration();
+        wavefront.iteration();
+        test(sequential.lower_bound() == wavefront.lower_bound());
+    }
+
+    const auto mms_sequential = sequential.min_marginals();
+    const auto mms_wavefront = wavefront.min_marginals();
+    test(mms_sequential.size() == mms_wavefront.size());
+    for(size_t i=0; i<mms_sequential.size(); ++i)
+    {
+        test(mms_sequential.size(i) == mms_wavefront.size(i));
+        for(size_t j=0; j<mms_sequential.size(i); ++j)
+            test(mms_sequential(i,j) == mms_wavefront(i,j));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const ILP_input ilp = ILP_parser::parse_string(assignment_chain(60, 10));
+    bdd_preprocessor pre(ilp);
+
+    test_wavefront<float>(pre.get_bdd_collection(), ilp);
+    test_wavefront<double>(pre.get_bdd_collection(), ilp);
+}
@@ -4,6 +4,9 @@
 #include "bdd_preprocessor.h"
 #include "test_problem_generator.h"
 #include "test.h"
+#include <random>
+#include <chrono>
+#include <algorithm>
 
 using namespace LPMP;
 
@@ -123,4 +126,335 @@ int main(int argc, char** argv)
         test_mm(ilp, "forward");
         test_mm(ilp, "backward");
     }
+
+    // min-marginal agreement must coincide with aggregated min-marginals
+    {
+        bdd_base_type solver(pre.get_bdd_collection());
+        solver.update_costs(ilp.objective().begin(), ilp.objective().begin(), ilp.objective().begin(), ilp.objective().end());
+        for(size_t iter=0; iter<5; ++iter)
+            solver.parallel_mma();
+        solver.distribute_delta();
+
+        std::vector<mm_agreement> expected;
+        compute_mm_agreement(solver.min_marginals(), expected);
+        std::vector<mm_agreement> agreement;
+        solver.min_marginal_agreement(agreement);
+        test(agreement.size() == expected.size());
+        for(size_t i=0; i<agreement.size(); ++i)
+        {
+            test(agreement[i].nr_bdds == expected[i].nr_bdds);
+            test(agreement[i].type == expected[i].type);
+            test(std::abs(agreement[i].min_diff - expected[i].min_diff) <= 1e-6);
+            test(std::abs(agreement[i].max_diff - expected[i].max_diff) <= 1e-6);
+            test(std::abs(agreement[i].sum_diff - expected[i].sum_diff) <= 1e-6);
+        }
+    }
+
+    // primal decoding from shortest paths
+    {
+        bdd_base_type solver(pre.get_bdd_collection());
+        solver.update_costs(ilp.objective().begin(), ilp.objective().begin(), ilp.objective().begin(), ilp.objective().end());
+        for(size_t iter=0; iter<5; ++iter)
+            solver.parallel_mma();
+        const std::vector<char> sol = solver.decode_primal_solution(100);
+        test(ilp.feasible(sol.begin(), sol.end()));
+        test(std::abs(ilp.evaluate(sol.begin(), sol.end()) - 1.0) <= 1e-6);
+    }
+
+    // incremental removal and insertion of bdds
+    {
+        bdd_base_type solver(pre.get_bdd_collection());
+        solver.update_costs(ilp.objective().begin(), ilp.objective().begin(), ilp.objective().begin(), ilp.objective().end());
+        for(size_t iter=0; iter<5; ++iter)
+            solver.parallel_mma();
+        test(std::abs(solver.lower_bound() - 1.0) <= 1e-6);
+
+        // second simplex is dropped, its variables are free and x_6 = 1
+        const size_t second_bdd = solver.variables(0)[0] == 0 ? 1 : 0;
+        const std::vector<size_t> to_remove = {second_bdd};
+        const auto new_bdd_nrs = solver.remove_bdds(to_remove.begin(), to_remove.end());
+        test(new_bdd_nrs.size() == 2);
+        test(new_bdd_nrs[second_bdd] == std::numeric_limits<size_t>::max() && new_bdd_nrs[1-second_bdd] == 1-second_bdd);
+        test(solver.nr_bdds() == 2 && solver.removed(second_bdd));
+        test(std::abs(solver.lower_bound() - 0.0) <= 1e-6);
+        for(size_t iter=0; iter<5; ++iter)
+            solver.parallel_mma();
+        test(std::abs(solver.lower_bound() - 0.0) <= 1e-6);
+
+        const auto compacted_bdd_nrs = solver.compactify();
+        test(compacted_bdd_nrs[second_bdd] == std::numeric_limits<size_t>::max() && compacted_bdd_nrs[1-second_bdd] == 0);
+        test(solver.nr_bdds() == 1);
+        test(std::abs(solver.lower_bound() - 0.0) <= 1e-6);
+
+        // costs of remaining bdd are kept when adding the second simplex again
+        const std::vector<size_t> to_add = {pre.get_bdd_collection().variables(0)[0] == 0 ? size_t(1) : size_t(0)};
+        const auto added_bdd_nrs = solver.add_bdds(pre.get_bdd_collection(), to_add.begin(), to_add.end());
+        test(added_bdd_nrs.size() == 1 && added_bdd_nrs[0] == 1);
+        test(solver.nr_bdds() == 2);
+        test(std::abs(solver.lower_bound() - 0.0) <= 1e-6);
+        for(size_t iter=0; iter<5; ++iter)
+            solver.parallel_mma();
+        test(std::abs(solver.lower_bound() - 0.0) <= 1e-6);
+
+        // first simplex is dropped, its variables have nonnegative costs
+        const std::vector<size_t> first = {0};
+        solver.remove_bdds(first.begin(), first.end());
+        for(size_t iter=0; iter<5; ++iter)
+            solver.parallel_mma();
+        test(std::abs(solver.lower_bound() - (-1.0)) <= 1e-6);
+
+        // all nodes belong to removed bdds, hence compaction
+        const std::vector<size_t> second = {1};
+        const auto last_bdd_nrs = solver.remove_bdds(second.begin(), second.end());
+        test(last_bdd_nrs.size() == 2 && last_bdd_nrs[0] == std::numeric_limits<size_t>::max() && last_bdd_nrs[1] == std::numeric_limits<size_t>::max());
+        test(solver.nr_bdds() == 0);
+        test(std::abs(solver.lower_bound() - (-1.0)) <= 1e-6);
+    }
+
+    // active set: disjoint assignment problems converge at different speeds, settled ones are skipped
+    {
+        ILP_input assignments;
+        std::mt19937 gen(17);
+        std::uniform_int_distribution<> cost_dist(-10,10);
+        size_t var_offset = 0;
+        for(size_t n=3; n<=8; ++n)
+        {
+            for(size_t i=0; i<n; ++i)
+                for(size_t j=0; j<n; ++j)
+                {
+                    const size_t var = assignments.add_new_variable("x_" + std::to_string(n) + "_" + std::to_string(i) + "_" + std::to_string(j));
+                    assignments.add_to_objective(double(cost_dist(gen)), var);
+                }
+            for(size_t dir=0; dir<2; ++dir)
+                for(size_t i=0; i<n; ++i)
+                {
+                    assignments.begin_new_inequality();
+                    for(size_t j=0; j<n; ++j)
+                        assignments.add_to_constraint(1, var_offset + (dir == 0 ? i*n + j : j*n + i));
+                    assignments.set_inequality_type(ILP_input::inequality_type::equal);
+                    assignments.set_right_hand_side(1);
+                }
+            var_offset += n*n;
+        }
+
+        bdd_preprocessor assignments_pre(assignments);
+        const size_t nr_iterations = 500;
+
+        bdd_base_type solver(assignments_pre.get_bdd_collection());
+        solver.update_costs(assignments.objective().begin(), assignments.objective().begin(), assignments.objective().begin(), assignments.objective().end());
+        for(size_t iter=0; iter<nr_iterations; ++iter)
+            solver.parallel_mma();
+        const double lb = solver.lower_bound();
+
+        bdd_base_type active_set_solver(assignments_pre.get_bdd_collection());
+        active_set_solver.update_costs(assignments.objective().begin(), assignments.objective().begin(), assignments.objective().begin(), assignments.objective().end());
+        active_set_solver.set_active_set(1e-2);
+        size_t nr_processed_bdds = 0;
+        for(size_t iter=0; iter<nr_iterations; ++iter)
+        {
+            active_set_solver.parallel_mma();
+            nr_processed_bdds += active_set_solver.nr_active_bdds();
+        }
+        const double active_set_lb = active_set_solver.lower_bound();
+        std::cout << "lower bound " << lb << ", with active set " << active_set_lb << ", processed " << nr_processed_bdds << " of " << nr_iterations * solver.nr_bdds() << " bdds\n";
+        test(4*nr_processed_bdds < 3*nr_iterations * solver.nr_bdds());
+        test(std::abs(lb - active_set_lb) <= 1e-3 * std::abs(lb));
+
+        // lower bound stays valid after pending deltas are handed to all bdds
+        active_set_solver.distribute_delta();
+        test(active_set_solver.lower_bound() >= active_set_lb - 1e-3 * std::abs(lb));
+    }
+
+    // acceleration by adaptive omega and momentum on overlapping set packing constraints
+    {
+        ILP_input packing;
+        std::mt19937 gen(0);
+        std::uniform_int_distribution<> cost_dist(-10,10);
+        const size_t nr_vars = 300;
+        std::uniform_int_distribution<size_t> var_dist(0, nr_vars-1);
+        for(size_t i=0; i<nr_vars; ++i)
+        {
+            packing.add_new_variable("x_" + std::to_string(i));
+            packing.add_to_objective(double(cost_dist(gen)), i);
+        }
+        for(size_t c=0; c<200; ++c)
+        {
+            std::vector<size_t> vars;
+            while(vars.size() < 3 + c % 8)
+            {
+                const size_t var = var_dist(gen);
+                if(std::find(vars.begin(), vars.end(), var) == vars.end())
+                    vars.push_back(var);
+            }
+            packing.begin_new_inequality();
+            for(const size_t var : vars)
+                packing.add_to_constraint(1, var);
+            packing.set_inequality_type(ILP_input::inequality_type::smaller_equal);
+            packing.set_right_hand_side(1);
+        }
+        bdd_preprocessor packing_pre(packing);
+
+        const size_t max_iter = 3000;
+        auto iterations_to_bound = [&](auto configure, const double target) {
+            bdd_base_type solver(packing_pre.get_bdd_collection());
+            solver.update_costs(packing.objective().begin(), packing.objective().begin(), packing.objective().begin(), packing.objective().end());
+            configure(solver);
+            double prev_lb = -std::numeric_limits<double>::infinity();
+            size_t iter = 0;
+            const auto start_time = std::chrono::steady_clock::now();
+            for(; iter<max_iter && solver.lower_bound() < target; ++iter)
+            {
+                solver.parallel_mma();
+                test(solver.lower_bound() >= prev_lb - 1e-4 * std::abs(prev_lb));
+                prev_lb = solver.lower_bound();
+                test(solver.omega() >= 0.3 - 1e-6 && solver.omega() <= 0.7 + 1e-6);
+            }
+            const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+            return std::make_tuple(iter, solver.lower_bound(), time);
+        };
+
+        bdd_base_type solver(packing_pre.get_bdd_collection());
+        solver.update_costs(packing.objective().begin(), packing.objective().begin(), packing.objective().begin(), packing.objective().end());
+        for(size_t iter=0; iter<max_iter; ++iter)
+            solver.parallel_mma();
+        const double target = solver.lower_bound() - 1e-3 * std::abs(solver.lower_bound());
+
+        const auto [plain_iter, plain_lb, plain_time] = iterations_to_bound([](bdd_base_type& s) {}, target);
+        const auto [adaptive_iter, adaptive_lb, adaptive_time] = iterations_to_bound([](bdd_base_type& s) { s.set_omega(0.5, true); }, target);
+        const auto [momentum_iter, momentum_lb, momentum_time] = iterations_to_bound([](bdd_base_type& s) { s.set_momentum(0.9); }, target);
+        const auto [momentum_1_iter, momentum_1_lb, momentum_1_time] = iterations_to_bound([](bdd_base_type& s) { s.set_momentum(0.9, 1); }, target);
+        std::cout << "iterations to lower bound " << target << ": plain " << plain_iter << ", adaptive omega " << adaptive_iter << ", momentum " << momentum_iter << ", momentum every iteration " << momentum_1_iter << "\n";
+        std::cout << "time to lower bound " << target << ": plain " << plain_time << " s, adaptive omega " << adaptive_time << " s, momentum " << momentum_time << " s, momentum every iteration " << momentum_1_time << " s\n";
+        test(plain_lb >= target && adaptive_lb >= target && momentum_lb >= target && momentum_1_lb >= target);
+        test(adaptive_iter < plain_iter);
+        test(2*momentum_iter < plain_iter);
+        test(2*momentum_1_iter < plain_iter);
+
+        // extrapolated costs still sum up to the objective
+        bdd_base_type momentum_solver(packing_pre.get_bdd_collection());
+        momentum_solver.update_costs(packing.objective().begin(), packing.objective().begin(), packing.objective().begin(), packing.objective().end());
+        momentum_solver.set_momentum(0.9);
+        for(size_t iter=0; iter<100; ++iter)
+            momentum_solver.parallel_mma();
+        momentum_solver.distribute_delta();
+        std::vector<double> cost_sum(nr_vars, 0.0);
+        for(size_t bdd_nr=0; bdd_nr<momentum_solver.nr_bdds(); ++bdd_nr)
+        {
+            const auto vars = momentum_solver.variables(bdd_nr);
+            const auto costs = momentum_solver.get_costs(bdd_nr);
+            for(size_t i=0; i<vars.size(); ++i)
+                cost_sum[vars[i]] += costs[i];
+        }
+        for(size_t var=0; var<momentum_solver.nr_variables(); ++var)
+            if(momentum_solver.nr_bdds(var) > 0)
+                test(std::abs(cost_sum[var] - packing.objective()[var]) <= 1e-3);
+    }
+
+    // conflicting paths of bdds must be repaired
+    {
+        const ILP_input assignment_ilp = ILP_parser::parse_string(
+R"(Minimize
+-2 x_11 - 1 x_12 - 1 x_13
+-2 x_21 - 1 x_22 - 1 x_23
+-2 x_31 - 1 x_32 - 1 x_33
+Subject To
+x_11 + x_12 + x_13 = 1 
+x_21 + x_22 + x_23 = 1 
+x_31 + x_32 + x_33 = 1 
+x_11 + x_21 + x_31 = 1 
+x_12 + x_22 + x_32 = 1 
+x_13 + x_23 + x_33 = 1 
+End)");
+        bdd_preprocessor assignment_pre(assignment_ilp);
+        bdd_base_type solver(assignment_pre.get_bdd_collection());
+        // without dual optimization all row bdds choose the first column
+        solver.update_costs(assignment_ilp.objective().begin(), assignment_ilp.objective().begin(), assignment_ilp.objective().begin(), assignment_ilp.objective().end());
+        const std::vector<char> sol = solver.decode_primal_solution(100);
+        test(assignment_ilp.feasible(sol.begin(), sol.end()));
+
+        // bdds added after iterations must not receive pending deltas of the others
+        bdd_base_type reference_solver(assignment_pre.get_bdd_collection());
+        bdd_base_type extended_solver(assignment_pre.get_bdd_collection());
+        for(bdd_base_type* s : {&reference_solver, &extended_solver})
+        {
+            s->update_costs(assignment_ilp.objective().begin(), assignment_ilp.objective().begin(), assignment_ilp.objective().begin(), assignment_ilp.objective().end());
+            for(size_t iter=0; iter<3; ++iter)
+                s->parallel_mma();
+        }
+        reference_solver.distribute_delta();
+        const std::vector<size_t> duplicates = {0, 3};
+        extended_solver.add_bdds(assignment_pre.get_bdd_collection(), duplicates.begin(), duplicates.end());
+        extended_solver.distribute_delta();
+        test(extended_solver.nr_bdds() == reference_solver.nr_bdds() + 2);
+        test(std::abs(extended_solver.lower_bound() - reference_solver.lower_bound()) <= 1e-4);
+
+        auto cost_per_variable = [](const bdd_base_type& s) {
+            std::vector<double> cost_sum(s.nr_variables(), 0.0);
+            for(size_t bdd_nr=0; bdd_nr<s.nr_bdds(); ++bdd_nr)
+            {
+                const auto costs = s.get_costs(bdd_nr);
+                const auto vars = s.variables(bdd_nr);
+                for(size_t i=0; i<vars.size(); ++i)
+                    cost_sum[vars[i]] += costs[i];
+            }
+            return cost_sum;
+        };
+        const std::vector<double> reference_costs = cost_per_variable(reference_solver);
+        const std::vector<double> extended_costs = cost_per_variable(extended_solver);
+        for(size_t var=0; var<reference_costs.size(); ++var)
+            test(std::abs(reference_costs[var] - extended_costs[var]) <= 1e-4);
+
+        // pending deltas of removed bdds are handed over together with their costs
+        bdd_base_type pending_solver(assignment_pre.get_bdd_collection());
+        pending_solver.update_costs(assignment_ilp.objective().begin(), assignment_ilp.objective().begin(), assignment_ilp.objective().begin(), assignment_ilp.objective().end());
+        for(size_t iter=0; iter<3; ++iter)
+            pending_solver.parallel_mma();
+        const std::vector<size_t> first_row = {0};
+        reference_solver.remove_bdds(first_row.begin(), first_row.end());
+        pending_solver.remove_bdds(first_row.begin(), first_row.end());
+        test(pending_solver.removed(0));
+        test(std::abs(pending_solver.lower_bound() - reference_solver.lower_bound()) <= 1e-4);
+        const std::vector<double> reference_removed_costs = cost_per_variable(reference_solver);
+        const std::vector<double> pending_removed_costs = cost_per_variable(pending_solver);
+        for(size_t var=0; var<reference_removed_costs.size(); ++var)
+            test(std::abs(reference_removed_costs[var] - pending_removed_costs[var]) <= 1e-4);
+    }
+    // removing a bdd after message passing on overlapping constraints hands over its low and high costs
+    {
+        const std::string assignment_problem =
+R"(Minimize
+-3 x_11 + 1 x_12 - 2 x_13
++2 x_21 - 4 x_22 + 1 x_23
+-1 x_31 + 2 x_32 - 5 x_33
+Subject To
+x_11 + x_12 + x_13 = 1
+x_21 + x_22 + x_23 = 1
+x_31 + x_32 + x_33 = 1
+x_11 + x_21 + x_31 = 1
+x_12 + x_22 + x_32 = 1
+x_13 + x_23 + x_33 = 1
+)";
+        const ILP_input assignment_ilp = ILP_parser::parse_string(assignment_problem + "End");
+        const ILP_input extended_ilp = ILP_parser::parse_string(assignment_problem + "x_11 + x_22 + x_33 <= 1\nEnd");
+        bdd_preprocessor assignment_pre(assignment_ilp);
+        bdd_preprocessor extended_pre(extended_ilp);
+        bdd_base_type reference_solver(assignment_pre.get_bdd_collection());
+        bdd_base_type solver(extended_pre.get_bdd_collection());
+        reference_solver.update_costs(assignment_ilp.objective().begin(), assignment_ilp.objective().begin(), assignment_ilp.objective().begin(), assignment_ilp.objective().end());
+        solver.update_costs(extended_ilp.objective().begin(), extended_ilp.objective().begin(), extended_ilp.objective().begin(), extended_ilp.objective().end());
+        for(size_t iter=0; iter<300; ++iter)
+        {
+            reference_solver.parallel_mma();
+            solver.parallel_mma();
+        }
+        test(solver.lower_bound() >= reference_solver.lower_bound() - 1e-4);
+
+        const std::vector<size_t> diagonal = {solver.nr_bdds()-1};
+        test(solver.variables(diagonal[0]) == std::vector<size_t>({0, 4, 8}));
+        solver.remove_bdds(diagonal.begin(), diagonal.end());
+        test(solver.lower_bound() <= reference_solver.lower_bound() + 1e-4);
+        for(size_t iter=0; iter<300; ++iter)
+            solver.parallel_mma();
+        test(std::abs(solver.lower_bound() - reference_solver.lower_bound()) <= 1e-4);
+    }
 }
@@ -43,4 +43,32 @@ int main(int argc, char** argv)
     test(mm(3,0) == std::array<double,2>{1.0,0.0});
     test(mm(4,0) == std::array<double,2>{0.0,1.0});
     test(mm(5,0) == std::array<double,2>{3.0,0.0});
+
+    // preallocated buffers are filled like the returned ones
+    {
+        const auto [mm_stacked, sol] = solver.min_marginals_stacked();
+        bdd_base_type::min_marginal_type mm_buffer(solver.nr_bdd_variables(), 2);
+        solver.min_marginals_stacked(mm_buffer);
+        test(mm_buffer == mm_stacked);
+
+        bdd_base_type::vector_type lb_buffer(solver.nr_bdds());
+        solver.lower_bound_per_bdd(lb_buffer);
+        test(lb_buffer == solver.lower_bound_per_bdd());
+        test(std::abs(lb_buffer.sum() - lb) <= 1e-6);
+
+        bdd_base_type::vector_type cost_buffer(solver.nr_bdd_variables());
+        solver.get_costs(cost_buffer);
+        test(cost_buffer == solver.get_costs());
+
+        // single column is added to high costs, two columns to low and high costs
+        Eigen::Map<const bdd_base_type::vector_type> cost_view(cost_buffer.data(), cost_buffer.size());
+        solver.update_costs(-cost_view);
+        test(solver.get_costs().isZero());
+        bdd_base_type::min_marginal_type delta(solver.nr_bdd_variables(), 2);
+        delta.col(0).setZero();
+        delta.col(1) = cost_buffer;
+        solver.update_costs(delta);
+        test(solver.get_costs() == cost_buffer);
+        test(std::abs(solver.lower_bound() - lb) <= 1e-6);
+    }
 }
@@ -0,0 +1,60 @@
+#include "decomposition_bdd_mma.h"
+#include "bdd_mma_vec.h"
+#include "ILP_parser.h"
+#include "bdd_preprocessor.h"
+#include "test.h"
+
+using namespace LPMP;
+
+const char * matching_3x3 = 
+R"(Minimize
+-2 x_11 - 1 x_12 - 1 x_13
+-1 x_21 - 2 x_22 - 1 x_23
+-1 x_31 - 1 x_32 - 2 x_33
+Subject To
+x_11 + x_12 + x_13 = 1
+x_21 + x_22 + x_23 = 1
+x_31 + x_32 + x_33 = 1
+x_11 + x_21 + x_31 = 1
+x_12 + x_22 + x_32 = 1
+x_13 + x_23 + x_33 = 1
+End)";
+
+const char * knapsack_problem = 
+R"(Minimize
+- 2 x1 - 2 x2 - x3 - x4
+Subject To
+2 x1 + 3 x2 + 4 x3 + x4 <= 5
+End)";
+
+void test_problem(const std::string& problem, const double expected_lb)
+{
+    const ILP_input ilp = ILP_parser::parse_string(problem);
+    bdd_preprocessor pre(ilp);
+
+    for(const size_t nr_threads : {1, 2, 3, 4})
+    {
+        decomposition_mma_options opt;
+        opt.nr_threads = nr_threads;
+        opt.force_thread_nr = true;
+        opt.multiplier_channel_capacity = 2;
+        decomposition_bdd_mma solver(pre.get_bdd_collection(), ilp.objective().begin(), ilp.objective().end(), opt);
+        test(solver.lower_bound() <= expected_lb + 1e-4);
+        for(size_t iter=0; iter<200; ++iter)
+        {
+            solver.iteration();
+            test(solver.lower_bound() <= expected_lb + 1e-4);
+        }
+        solver.backward_run();
+        test(std::abs(solver.lower_bound() - expected_lb) <= 1e-4);
+
+        const auto mms = solver.min_marginals();
+        test(mms.size() == solver.nr_variables());
+    }
+}
+
+int main(int argc, char** argv)
+{
+    test_problem(matching_3x3, -6.0);
+    test_problem(knapsack_problem, -4.0);
+}
@@ -26,7 +26,7 @@ void test_ILP(const std::string ilp, const double expected_lb, const permutation
 
     {
     bdd_solver solver({
-            "--input_string", ilp_string,
+            "--lp_input_string", ilp_string,
             "-s", "mma_vec",
             "--max_iter", "20"
             });
@@ -37,7 +37,7 @@ void test_ILP(const std::string ilp, const double expected_lb, const permutation
 
     {
         bdd_solver solver({
-                "--input_string", ilp_string,
+                "--lp_input_string", ilp_string,
                 "-s", "decomposition_mma",
                 "--nr_threads", "2",
                 "--force_thread_nr",
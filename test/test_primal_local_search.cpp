@@ -0,0 +1,84 @@
+#include "primal_local_search.h"
+#include "ILP_parser.h"
+#include "bdd_preprocessor.h"
+#include "test.h"
+
+using namespace LPMP;
+
+const char * two_simplex_problem = 
+R"(Minimize
+2 x_1 + 1 x_2 + 1 x_3
++1 x_4 + 2 x_5 - 1 x_6
+Subject To
+x_1 + x_2 + x_3 = 1
+x_4 + x_5 + x_6 = 2
+End)";
+
+const char * covering_problem = 
+R"(Minimize
+2 x_1 + 1 x_2 + 3 x_3 + 1 x_4
+Subject To
+x_1 + x_2 >= 1
+x_2 + x_3 + x_4 >= 1
+x_3 + x_4 <= 1
+End)";
+
+std::vector<char> solution(const ILP_input& ilp, const std::vector<std::string>& one_vars)
+{
+    std::vector<char> sol(ilp.nr_variables(), 0);
+    for(const auto& var : one_vars)
+        sol[ilp.get_var_index(var)] = 1;
+    test(ilp.feasible(sol.begin(), sol.end()));
+    return sol;
+}
+
+int main(int argc, char** argv)
+{
+    const ILP_input two_simplex_ilp = ILP_parser::parse_string(two_simplex_problem);
+    bdd_preprocessor two_simplex_pre(two_simplex_ilp);
+
+    // 1-flips cannot leave equality constraints
+    {
+        primal_local_search_options opts;
+        opts.two_flip = false;
+        opts.bdd_neighbourhood = false;
+        primal_local_search ls(two_simplex_ilp, two_simplex_pre.get_bdd_collection(), opts);
+        std::vector<char> sol = solution(two_simplex_ilp, {"x_1", "x_4", "x_5"});
+        test(std::abs(ls.improve(sol) - 5.0) <= 1e-8);
+        test(sol == solution(two_simplex_ilp, {"x_1", "x_4", "x_5"}));
+    }
+
+    // 2-flips within rows and bdd neighbourhoods each find the optimum
+    for(const bool two_flip : {true, false})
+    {
+        primal_local_search_options opts;
+        opts.two_flip = two_flip;
+        opts.bdd_neighbourhood = !two_flip;
+        primal_local_search ls(two_simplex_ilp, two_simplex_pre.get_bdd_collection(), opts);
+        std::vector<char> sol = solution(two_simplex_ilp, {"x_1", "x_4", "x_5"});
+        const double obj = ls.improve(sol);
+        test(std::abs(obj - 1.0) <= 1e-8);
+        test(two_simplex_ilp.feasible(sol.begin(), sol.end()));
+        test(std::abs(two_simplex_ilp.evaluate(sol.begin(), sol.end()) - obj) <= 1e-8);
+    }
+
+    // 1-flips remove unneeded variables of covering constraints
+    {
+        const ILP_input ilp = ILP_parser::parse_string(covering_problem);
+        bdd_preprocessor pre(ilp);
+        primal_local_search ls(ilp, pre.get_bdd_collection());
+        std::vector<char> sol = solution(ilp, {"x_1", "x_2", "x_3"});
+        const double obj = ls.improve(sol);
+        test(std::abs(obj - 1.0) <= 1e-8);
+        test(sol == solution(ilp, {"x_2"}));
+    }
+
+    // infeasible start is rejected
+    {
+        primal_local_search ls(two_simplex_ilp, two_simplex_pre.get_bdd_collection());
+        std::vector<char> sol(two_simplex_ilp.nr_variables(), 0);
+        bool thrown = false;
+        try { ls.improve(sol); } catch(const std::runtime_error&) { thrown = true; }
+        test(thrown);
+    }
+}